@@ -0,0 +1,441 @@
+#pragma once
+// Heap allocation profiler with per-phase attribution.
+//
+// Build with ALLOC_TRACKER_ENABLED (CMake: -DENABLE_ALLOC_TRACKER=ON) and, in
+// exactly one translation unit of the executable,
+//   #define ALLOC_TRACKER_IMPLEMENTATION
+//   #include "alloc_tracker.h"
+// to replace the global operator new/delete. Code marks pipeline phases with
+// ALLOC_PHASE("parse"); allocations the thread makes while the scope is open
+// are charged to it. The phase is per thread: scopes on the I/O thread, the
+// job pool and the frame loop do not see each other. Job-system tasks run in
+// the phase that was current where they were created (job_system.h), so work
+// fanned out from a phase stays in it. Frees are charged to the phase that
+// allocated the block, wherever they happen. Buffers that pages::Allocator
+// maps directly (page_alloc.h) bypass operator new and are reported through
+// note_mapped / note_unmapped instead, so they count the same. At exit the
+// tracker prints, per phase, the number of allocations and frees, bytes
+// requested, the peak of the process-wide live heap while the phase was
+// active and the call sites that allocated the most.
+//
+// Counters live in per-thread tables, so threads only share the live-bytes
+// counter. Every allocation captures a short backtrace, which makes tracked
+// builds several times slower; link with -rdynamic (ENABLE_EXPORTS) to get
+// symbol names. Without ALLOC_TRACKER_ENABLED the phase macros compile to
+// nothing.
+
+#include <cstddef>
+#include <cstdio>
+
+#ifdef ALLOC_TRACKER_ENABLED
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <cxxabi.h>
+#include <execinfo.h>
+#endif
+
+namespace alloc {
+
+#ifdef ALLOC_TRACKER_ENABLED
+
+namespace detail {
+
+constexpr int kMaxPhases = 32;
+constexpr int kSiteDepth = 6;      // frames kept per call site
+constexpr int kSiteSkip = 3;       // capture helper, allocate(), operator new
+constexpr size_t kSiteSlots = 4096; // per thread, open addressing
+
+struct Site {
+    uint64_t hash;
+    uint32_t phase;
+    uint32_t depth;
+    void *frames[kSiteDepth];
+    uint64_t count;
+    uint64_t bytes;
+};
+
+struct ThreadStats {
+    uint64_t allocs[kMaxPhases];
+    uint64_t bytes[kMaxPhases];
+    uint64_t frees[kMaxPhases];
+    uint64_t dropped_sites;
+    Site sites[kSiteSlots];
+    ThreadStats *next;
+};
+
+// Prepended to every block; 16 bytes keeps the default new alignment.
+struct Header {
+    uint64_t size;
+    uint32_t phase;
+    uint32_t offset; // from the start of the malloc'ed block to the user pointer
+};
+static_assert(sizeof(Header) == 16, "header must preserve 16-byte alignment");
+
+// All globals are constant-initialized so that allocations made by static
+// constructors before main are safe to track.
+inline std::atomic<ThreadStats *> g_threads{nullptr};
+inline std::atomic<const char *> g_phase_names[kMaxPhases] = {};
+inline std::atomic<int64_t> g_live{0};
+inline std::atomic<int64_t> g_peak[kMaxPhases] = {};
+inline std::atomic<bool> g_reporting{false};
+
+inline thread_local ThreadStats *t_stats = nullptr;
+inline thread_local bool t_in_hook = false;
+inline thread_local int t_phase = 0;
+
+inline ThreadStats *thread_stats() {
+    if (!t_stats) {
+        // calloc, not new: this runs inside operator new
+        auto *s = static_cast<ThreadStats *>(std::calloc(1, sizeof(ThreadStats)));
+        if (!s) return nullptr;
+        ThreadStats *head = g_threads.load(std::memory_order_relaxed);
+        do {
+            s->next = head;
+        } while (!g_threads.compare_exchange_weak(head, s, std::memory_order_release, std::memory_order_relaxed));
+        t_stats = s;
+    }
+    return t_stats;
+}
+
+__attribute__((noinline)) inline void record_site(ThreadStats *s, int phase, size_t n) {
+    void *frames[kSiteSkip + kSiteDepth];
+    int depth = backtrace(frames, kSiteSkip + kSiteDepth) - kSiteSkip;
+    if (depth <= 0) return;
+    uint64_t h = 1469598103934665603ull ^ static_cast<uint64_t>(phase);
+    for (int i = 0; i < depth; ++i) {
+        h ^= reinterpret_cast<uintptr_t>(frames[kSiteSkip + i]);
+        h *= 1099511628211ull;
+    }
+    for (size_t probe = 0; probe < 16; ++probe) {
+        Site &site = s->sites[(h + probe) & (kSiteSlots - 1)];
+        if (site.count == 0) {
+            site.hash = h;
+            site.phase = static_cast<uint32_t>(phase);
+            site.depth = static_cast<uint32_t>(depth);
+            std::memcpy(site.frames, frames + kSiteSkip, sizeof(void *) * static_cast<size_t>(depth));
+        } else if (site.hash != h) {
+            continue;
+        }
+        ++site.count;
+        site.bytes += n;
+        return;
+    }
+    ++s->dropped_sites;
+}
+
+inline void raise_peak(int phase, int64_t live) {
+    int64_t peak = g_peak[phase].load(std::memory_order_relaxed);
+    while (live > peak && !g_peak[phase].compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+__attribute__((noinline)) inline void *allocate(size_t n, size_t align) {
+    const size_t offset = align > sizeof(Header) ? align : sizeof(Header);
+    void *base = nullptr;
+    if (align > alignof(std::max_align_t)) {
+        if (posix_memalign(&base, align, n + offset) != 0) base = nullptr;
+    } else {
+        base = std::malloc(n + offset);
+    }
+    if (!base) return nullptr;
+
+    const int phase = t_phase;
+    auto *user = static_cast<unsigned char *>(base) + offset;
+    auto *hdr = reinterpret_cast<Header *>(user) - 1;
+    hdr->size = n;
+    hdr->phase = static_cast<uint32_t>(phase);
+    hdr->offset = static_cast<uint32_t>(offset);
+
+    if (!t_in_hook && !g_reporting.load(std::memory_order_relaxed)) {
+        t_in_hook = true; // backtrace() may allocate on first use
+        if (ThreadStats *s = thread_stats()) {
+            ++s->allocs[phase];
+            s->bytes[phase] += n;
+            record_site(s, phase, n);
+        }
+        t_in_hook = false;
+    }
+    raise_peak(phase, g_live.fetch_add(static_cast<int64_t>(n), std::memory_order_relaxed) + static_cast<int64_t>(n));
+    return user;
+}
+
+inline void release(void *p) {
+    if (!p) return;
+    auto *hdr = static_cast<Header *>(p) - 1;
+    g_live.fetch_sub(static_cast<int64_t>(hdr->size), std::memory_order_relaxed);
+    if (!t_in_hook && !g_reporting.load(std::memory_order_relaxed)) {
+        t_in_hook = true;
+        if (ThreadStats *s = thread_stats()) ++s->frees[hdr->phase];
+        t_in_hook = false;
+    }
+    std::free(static_cast<unsigned char *>(p) - hdr->offset);
+}
+
+// Buffers mapped outside the heap (page_alloc.h) carry no header, so their
+// phase is kept here. They are 2 MB and up, so few are live at once.
+constexpr size_t kMappedSlots = 1024;
+
+struct MappedBlock {
+    std::atomic<void *> ptr;
+    int phase;
+};
+
+inline MappedBlock g_mapped[kMappedSlots] = {};
+
+__attribute__((noinline)) inline void note_mapped(void *p, size_t n) {
+    const int phase = t_phase;
+    for (MappedBlock &b : g_mapped) {
+        void *expected = nullptr;
+        if (b.ptr.load(std::memory_order_relaxed) == nullptr &&
+            b.ptr.compare_exchange_strong(expected, p, std::memory_order_acq_rel)) {
+            b.phase = phase;
+            break;
+        }
+    } // table full: the free is charged to "(no phase)"
+    if (!t_in_hook && !g_reporting.load(std::memory_order_relaxed)) {
+        t_in_hook = true;
+        if (ThreadStats *s = thread_stats()) {
+            ++s->allocs[phase];
+            s->bytes[phase] += n;
+            record_site(s, phase, n);
+        }
+        t_in_hook = false;
+    }
+    raise_peak(phase, g_live.fetch_add(static_cast<int64_t>(n), std::memory_order_relaxed) + static_cast<int64_t>(n));
+}
+
+inline void note_unmapped(void *p, size_t n) {
+    int phase = 0;
+    for (MappedBlock &b : g_mapped) {
+        if (b.ptr.load(std::memory_order_acquire) == p) {
+            phase = b.phase;
+            b.ptr.store(nullptr, std::memory_order_release);
+            break;
+        }
+    }
+    g_live.fetch_sub(static_cast<int64_t>(n), std::memory_order_relaxed);
+    if (!t_in_hook && !g_reporting.load(std::memory_order_relaxed)) {
+        t_in_hook = true;
+        if (ThreadStats *s = thread_stats()) ++s->frees[phase];
+        t_in_hook = false;
+    }
+}
+
+inline int register_phase(const char *name) {
+    for (int i = 1; i < kMaxPhases; ++i) {
+        const char *cur = g_phase_names[i].load(std::memory_order_acquire);
+        if (cur && std::strcmp(cur, name) == 0) return i;
+        if (!cur) {
+            const char *expected = nullptr;
+            if (g_phase_names[i].compare_exchange_strong(expected, name)) return i;
+            if (std::strcmp(expected, name) == 0) return i;
+        }
+    }
+    return 0; // table full: charge to "other"
+}
+
+inline const char *phase_name(int i) {
+    const char *n = g_phase_names[i].load(std::memory_order_acquire);
+    return i == 0 ? "(no phase)" : (n ? n : "?");
+}
+
+// "binary(_ZN3foo3barEv+0x1a) [0x...]" -> "foo::bar()"
+inline void print_frame(std::FILE *out, void *addr) {
+    char **sym = backtrace_symbols(&addr, 1);
+    if (!sym) {
+        std::fprintf(out, "%p", addr);
+        return;
+    }
+    const char *s = sym[0];
+    const char *open = std::strchr(s, '(');
+    const char *plus = open ? std::strchr(open, '+') : nullptr;
+    bool printed = false;
+    if (open && plus && plus > open + 1) {
+        char mangled[512];
+        size_t len = std::min(static_cast<size_t>(plus - open - 1), sizeof(mangled) - 1);
+        std::memcpy(mangled, open + 1, len);
+        mangled[len] = '\0';
+        int status = 0;
+        char *demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+        if (status == 0 && demangled) {
+            // Template-heavy names are long; keep the start
+            std::fprintf(out, "%.100s", demangled);
+            printed = true;
+        }
+        std::free(demangled);
+        if (!printed) {
+            std::fputs(mangled, out);
+            printed = true;
+        }
+    }
+    if (!printed) std::fprintf(out, "%p", addr);
+    std::free(sym);
+}
+
+} // namespace detail
+
+// The calling thread's phase, for handing to work that runs elsewhere
+inline int current_phase() { return detail::t_phase; }
+
+// Reports memory obtained outside operator new (page_alloc.h maps its large
+// buffers directly); counted like a heap block of n bytes.
+inline void note_mapped(void *p, size_t n) { detail::note_mapped(p, n); }
+inline void note_unmapped(void *p, size_t n) { detail::note_unmapped(p, n); }
+
+class PhaseScope {
+public:
+    explicit PhaseScope(const char *name) : PhaseScope(detail::register_phase(name)) {}
+    // Re-enters a phase from current_phase() on another thread
+    explicit PhaseScope(int id) : previous_(detail::t_phase) {
+        detail::t_phase = id;
+        if (id) detail::raise_peak(id, detail::g_live.load(std::memory_order_relaxed));
+    }
+    ~PhaseScope() { detail::t_phase = previous_; }
+    PhaseScope(const PhaseScope &) = delete;
+    PhaseScope &operator=(const PhaseScope &) = delete;
+
+private:
+    int previous_ = 0;
+};
+
+inline constexpr bool kEnabled = true;
+
+inline void print_report(std::FILE *out, size_t top_sites = 5) {
+    using namespace detail;
+    g_reporting.store(true);
+
+    uint64_t allocs[kMaxPhases] = {}, bytes[kMaxPhases] = {}, frees[kMaxPhases] = {};
+    uint64_t dropped = 0;
+    for (ThreadStats *s = g_threads.load(std::memory_order_acquire); s; s = s->next) {
+        for (int p = 0; p < kMaxPhases; ++p) {
+            allocs[p] += s->allocs[p];
+            bytes[p] += s->bytes[p];
+            frees[p] += s->frees[p];
+        }
+        dropped += s->dropped_sites;
+    }
+
+    std::fprintf(out, "\n%-16s %12s %14s %12s %14s\n", "alloc phase", "allocs", "bytes", "frees", "peak live");
+    for (int p = 0; p < kMaxPhases; ++p) {
+        if (allocs[p] == 0 && frees[p] == 0) continue;
+        std::fprintf(out, "%-16s %12llu %14llu %12llu %14lld\n", phase_name(p), static_cast<unsigned long long>(allocs[p]),
+                     static_cast<unsigned long long>(bytes[p]), static_cast<unsigned long long>(frees[p]),
+                     static_cast<long long>(g_peak[p].load()));
+    }
+
+    // Merge identical sites across threads, then list the heaviest per phase
+    const size_t max_sites = 4096;
+    Site *merged = static_cast<Site *>(std::calloc(max_sites, sizeof(Site)));
+    size_t merged_count = 0;
+    for (ThreadStats *s = g_threads.load(std::memory_order_acquire); s && merged; s = s->next) {
+        for (const Site &site : s->sites) {
+            if (site.count == 0) continue;
+            size_t i = 0;
+            while (i < merged_count && merged[i].hash != site.hash) ++i;
+            if (i == merged_count) {
+                if (merged_count == max_sites) continue;
+                merged[merged_count++] = site;
+            } else {
+                merged[i].count += site.count;
+                merged[i].bytes += site.bytes;
+            }
+        }
+    }
+    for (int p = 0; p < kMaxPhases && merged; ++p) {
+        if (allocs[p] == 0) continue;
+        std::fprintf(out, "top call sites in %s:\n", phase_name(p));
+        for (size_t rank = 0; rank < top_sites; ++rank) {
+            Site *best = nullptr;
+            for (size_t i = 0; i < merged_count; ++i) {
+                if (static_cast<int>(merged[i].phase) == p && merged[i].count &&
+                    (!best || merged[i].bytes > best->bytes)) {
+                    best = &merged[i];
+                }
+            }
+            if (!best) break;
+            std::fprintf(out, "  %10llu allocs %12llu bytes  ", static_cast<unsigned long long>(best->count),
+                         static_cast<unsigned long long>(best->bytes));
+            for (uint32_t f = 0; f < best->depth && f < 3; ++f) {
+                if (f) std::fputs(" <- ", out);
+                print_frame(out, best->frames[f]);
+            }
+            std::fputc('\n', out);
+            best->count = 0; // consumed
+        }
+    }
+    if (dropped) std::fprintf(out, "(%llu allocations had no free call-site slot)\n", static_cast<unsigned long long>(dropped));
+    std::free(merged);
+    g_reporting.store(false);
+}
+
+// Prints the report at exit; call once from main.
+inline void init() {
+    std::atexit([] { print_report(stderr); });
+}
+
+#else
+
+inline int current_phase() { return 0; }
+inline void note_mapped(void *, size_t) {}
+inline void note_unmapped(void *, size_t) {}
+
+class PhaseScope {
+public:
+    explicit PhaseScope(const char *) {}
+    explicit PhaseScope(int) {}
+};
+
+inline constexpr bool kEnabled = false;
+inline void print_report(std::FILE *, size_t = 5) {}
+inline void init() {}
+
+#endif
+
+} // namespace alloc
+
+#define ALLOC_CONCAT_INNER(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_INNER(a, b)
+#ifdef ALLOC_TRACKER_ENABLED
+#define ALLOC_PHASE(name) ::alloc::PhaseScope ALLOC_CONCAT(alloc_phase_, __LINE__)(name)
+#else
+#define ALLOC_PHASE(name) ((void)0)
+#endif
+
+#if defined(ALLOC_TRACKER_ENABLED) && defined(ALLOC_TRACKER_IMPLEMENTATION)
+// Replacement global allocation functions. Defined once per executable.
+void *operator new(std::size_t n) {
+    if (void *p = ::alloc::detail::allocate(n, alignof(std::max_align_t))) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t n) {
+    if (void *p = ::alloc::detail::allocate(n, alignof(std::max_align_t))) return p;
+    throw std::bad_alloc();
+}
+void *operator new(std::size_t n, const std::nothrow_t &) noexcept {
+    return ::alloc::detail::allocate(n, alignof(std::max_align_t));
+}
+void *operator new[](std::size_t n, const std::nothrow_t &) noexcept {
+    return ::alloc::detail::allocate(n, alignof(std::max_align_t));
+}
+void *operator new(std::size_t n, std::align_val_t a) {
+    if (void *p = ::alloc::detail::allocate(n, static_cast<std::size_t>(a))) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t n, std::align_val_t a) {
+    if (void *p = ::alloc::detail::allocate(n, static_cast<std::size_t>(a))) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { ::alloc::detail::release(p); }
+void operator delete[](void *p) noexcept { ::alloc::detail::release(p); }
+void operator delete(void *p, std::size_t) noexcept { ::alloc::detail::release(p); }
+void operator delete[](void *p, std::size_t) noexcept { ::alloc::detail::release(p); }
+void operator delete(void *p, std::align_val_t) noexcept { ::alloc::detail::release(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { ::alloc::detail::release(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { ::alloc::detail::release(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { ::alloc::detail::release(p); }
+#endif
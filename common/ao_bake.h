@@ -0,0 +1,40 @@
+#pragma once
+// Per-vertex ambient occlusion, baked once at load so the viewers can shade
+// with it for free (one float attribute per vertex, see gl_mesh.h).
+//
+// Every vertex casts rays cosine-distributed over the hemisphere of its
+// normal against a TriangleBvh of the mesh; the value is the fraction that
+// escapes within AoBakeOptions::distance. All vertices use the same
+// Hammersley directions, shifted per vertex (Cranley-Patterson), so the
+// noise is spread over the mesh instead of banding. Vertices run in parallel
+// on the job system, four rays at a time through TriangleBvh::occluded4.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "page_alloc.h"
+
+namespace gx {
+
+struct AoBakeOptions {
+    uint32_t rays = 64;     // per vertex, rounded up to a multiple of 4
+    float distance = 0.25f; // occluders further away than this do not count, bounding radii
+};
+
+struct AoBakeStats {
+    uint64_t rays = 0;
+    double bvh_ms = 0.0;
+    double ms = 0.0; // BVH build included
+    size_t threads = 0;
+
+    double rays_per_second() const { return ms > 0.0 ? static_cast<double>(rays) / (ms / 1e3) : 0.0; }
+};
+
+// vertices: kVertexStride floats each (position, normal); radius: bounding
+// radius of the mesh. Returns one value in [0, 1] per vertex, 1 = open;
+// vertices without a normal get 1.
+pages::Vector<float> bake_vertex_ao(const float *vertices, size_t vertex_count, const unsigned int *indices,
+                                    size_t index_count, float radius, const AoBakeOptions &opt = {},
+                                    AoBakeStats *stats = nullptr);
+
+} // namespace gx
@@ -0,0 +1,348 @@
+#pragma once
+// Coroutine tasks for pipelines that hop between threads (C++20).
+//
+// A Task<T> is a lazily started coroutine: nothing runs until it is awaited.
+// Inside a task, `co_await executor.schedule()` moves the rest of the body to
+// that executor's thread and `co_await async::resume_on_pool()` moves it onto
+// the job system, so a pipeline reads top to bottom while each stage runs
+// where it must:
+//
+//   async::Task<Mesh> load(async::Executor &io, std::string path) {
+//       co_await io.schedule();          // blocking file I/O on the I/O thread
+//       std::string bytes = read(path);
+//       co_await async::resume_on_pool(); // parsing on the workers
+//       co_return parse(bytes);
+//   }
+//
+// when_all() starts several tasks at once and resumes when all have finished.
+// run_until_complete() drives a task from a thread that owns an Executor (the
+// GL context thread), executing the work posted to it meanwhile. Exceptions
+// thrown in a task propagate to whoever awaits it.
+
+#if !defined(__cpp_impl_coroutine)
+#error "async.h requires C++20 coroutines"
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "job_system.h"
+#include "trace.h"
+
+namespace async {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+            return h.promise().continuation;
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U &&v) {
+        value.emplace(std::forward<U>(v));
+    }
+    T take() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+    void take() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+} // namespace detail
+
+template <typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> h) : h_(h) {}
+    Task(Task &&o) noexcept : h_(std::exchange(o.h_, {})) {}
+    Task &operator=(Task &&o) noexcept {
+        if (this != &o) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(o.h_, {});
+        }
+        return *this;
+    }
+    ~Task() {
+        if (h_) h_.destroy();
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    // Awaiting starts the task; the awaiter resumes on whichever thread the
+    // task finishes on. Awaiting a moved-from task throws std::logic_error in
+    // the awaiting coroutine.
+    bool await_ready() const noexcept { return h_ && h_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+        if (!h_) throw std::logic_error("co_await on an empty async::Task");
+        h_.promise().continuation = awaiting;
+        return h_;
+    }
+    T await_resume() { return h_.promise().take(); }
+
+private:
+    std::coroutine_handle<promise_type> h_;
+};
+
+namespace detail {
+
+template <typename T>
+inline Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// Fire-and-forget coroutine that frees itself when it finishes.
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+template <typename T>
+struct Result {
+    std::optional<T> value;
+    std::exception_ptr error;
+    T get() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Result<void> {
+    std::exception_ptr error;
+    void get() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+// Awaits task, stores its outcome in out and then calls on_done. on_done must
+// be the last access to caller state: it may let the caller return.
+template <typename T, typename F>
+Detached drive(Task<T> &task, Result<T> &out, F on_done) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+        } else {
+            out.value.emplace(co_await task);
+        }
+    } catch (...) {
+        out.error = std::current_exception();
+    }
+    on_done();
+}
+
+struct Latch {
+    explicit Latch(size_t n) : count(n + 1) {} // +1 for the awaiting coroutine
+    std::atomic<size_t> count;
+    std::coroutine_handle<> waiter;
+
+    void arrive() {
+        if (count.fetch_sub(1, std::memory_order_acq_rel) == 1) waiter.resume();
+    }
+};
+
+template <typename Start>
+struct LatchAwaiter {
+    Latch &latch;
+    Start start;
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h) {
+        latch.waiter = h;
+        start();
+        // Stay suspended unless every task already finished synchronously
+        return latch.count.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+    void await_resume() const noexcept {}
+};
+
+template <size_t... I, typename... T>
+Task<std::tuple<T...>> when_all_impl(std::index_sequence<I...>, Task<T>... tasks) {
+    std::tuple<Result<T>...> results;
+    Latch latch(sizeof...(T));
+    auto start = [&] { (drive(tasks, std::get<I>(results), [&latch] { latch.arrive(); }), ...); };
+    co_await LatchAwaiter<decltype(start)>{latch, start};
+    co_return std::tuple<T...>(std::get<I>(results).get()...);
+}
+
+} // namespace detail
+
+// Queue of suspended coroutines resumed by the thread that runs it. Used as is
+// for the GL context thread (the main thread drives it), or with its own
+// thread through ThreadExecutor.
+class Executor {
+public:
+    Executor() = default;
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    struct ScheduleAwaiter {
+        Executor &executor;
+        bool await_ready() const noexcept { return executor.in_this_thread(); }
+        void await_suspend(std::coroutine_handle<> h) { executor.post(h); }
+        void await_resume() const noexcept {}
+    };
+
+    // co_await executor.schedule() continues on the executor's thread; it
+    // does not suspend when already there.
+    ScheduleAwaiter schedule() { return ScheduleAwaiter{*this}; }
+
+    void post(std::coroutine_handle<> h) {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            queue_.push_back(h);
+        }
+        cv_.notify_one();
+    }
+
+    // Re-evaluates the stop condition of a blocked run_until().
+    void wake() {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+        }
+        cv_.notify_all();
+    }
+
+    // Resumes posted coroutines until done() returns true, sleeping while the
+    // queue is empty. Whoever makes done() true must call wake() afterwards.
+    template <typename Done>
+    void run_until(Done done) {
+        owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        std::unique_lock<std::mutex> lk(mutex_);
+        for (;;) {
+            cv_.wait(lk, [&] { return !queue_.empty() || done(); });
+            if (queue_.empty()) break;
+            std::coroutine_handle<> h = queue_.front();
+            queue_.pop_front();
+            lk.unlock();
+            h.resume();
+            lk.lock();
+        }
+    }
+
+    // Resumes what is queued right now without blocking, e.g. once per frame.
+    void run_pending() {
+        owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        std::deque<std::coroutine_handle<>> batch;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            batch.swap(queue_);
+        }
+        for (auto h : batch) h.resume();
+    }
+
+    // True on the thread that last ran this executor.
+    bool in_this_thread() const { return owner_.load(std::memory_order_relaxed) == std::this_thread::get_id(); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> queue_;
+    std::atomic<std::thread::id> owner_{};
+};
+
+// Executor with a dedicated thread, e.g. for blocking file I/O that should not
+// occupy a job system worker.
+class ThreadExecutor : public Executor {
+public:
+    explicit ThreadExecutor(std::string name)
+        : thread_([this, name = std::move(name)] {
+              TRACE_THREAD_NAME(name);
+              run_until([this] { return stop_.load(); });
+          }) {}
+    ~ThreadExecutor() {
+        stop_.store(true);
+        wake();
+        thread_.join();
+    }
+
+private:
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+// co_await async::resume_on_pool() continues on a job system worker.
+inline auto resume_on_pool() {
+    struct Awaiter {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) const { jobs::JobSystem::instance().run([h] { h.resume(); }); }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{};
+}
+
+// Runs the tasks concurrently; resumes (on the thread of the last one to
+// finish) with all results. If any task threw, the first exception in
+// argument order is rethrown.
+template <typename... T>
+Task<std::tuple<T...>> when_all(Task<T>... tasks) {
+    static_assert(sizeof...(T) > 0 && (!std::is_void_v<T> && ...), "when_all needs value-returning tasks");
+    return detail::when_all_impl(std::index_sequence_for<T...>{}, std::move(tasks)...);
+}
+
+// Starts task and keeps running executor on the calling thread until the task
+// has finished; returns its result.
+template <typename T>
+T run_until_complete(Executor &executor, Task<T> task) {
+    detail::Result<T> result;
+    std::atomic<bool> finished{false};
+    detail::drive(task, result, [&] {
+        finished.store(true, std::memory_order_release);
+        executor.wake();
+    });
+    executor.run_until([&] { return finished.load(std::memory_order_acquire); });
+    return result.get();
+}
+
+} // namespace async
@@ -0,0 +1,287 @@
+#pragma once
+// Small benchmark harness: calibrated batches, robust statistics and JSON.
+//
+// Each benchmark body receives an iteration count and must run the measured
+// operation that many times. The harness first grows the count until one batch
+// takes at least min_sample_ms, then times `samples` batches (fewer if the
+// benchmark would exceed max_time_ms). Per-iteration times are summarised by
+// their median and median absolute deviation, which unlike mean/stddev are not
+// dragged around by the occasional preempted batch; samples further than
+// 3 robust sigmas from the median are reported as outliers. The 95% confidence
+// interval of the median comes from binomial order statistics, so two builds
+// whose intervals do not overlap differ by more than noise.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+// Keeps the compiler from discarding a computed value.
+template <typename T>
+inline void keep(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+struct Stats {
+    size_t samples = 0;
+    uint64_t iterations = 0; // per sample
+    double median = 0, mad = 0, mean = 0, min = 0, max = 0;
+    double p10 = 0, p90 = 0;
+    double ci_low = 0, ci_high = 0; // 95% CI of the median
+    size_t outliers = 0;
+};
+
+// All values in ns per iteration.
+inline Stats summarize(std::vector<double> v, uint64_t iterations) {
+    Stats s;
+    s.samples = v.size();
+    s.iterations = iterations;
+    if (v.empty()) return s;
+    std::sort(v.begin(), v.end());
+    const size_t n = v.size();
+    auto quantile = [&](double q) {
+        double pos = q * static_cast<double>(n - 1);
+        size_t lo = static_cast<size_t>(pos);
+        size_t hi = std::min(lo + 1, n - 1);
+        return v[lo] + (v[hi] - v[lo]) * (pos - static_cast<double>(lo));
+    };
+    s.median = quantile(0.5);
+    s.p10 = quantile(0.1);
+    s.p90 = quantile(0.9);
+    s.min = v.front();
+    s.max = v.back();
+    double sum = 0;
+    for (double x : v) sum += x;
+    s.mean = sum / static_cast<double>(n);
+
+    std::vector<double> dev(n);
+    for (size_t i = 0; i < n; ++i) dev[i] = std::fabs(v[i] - s.median);
+    std::sort(dev.begin(), dev.end());
+    s.mad = n % 2 ? dev[n / 2] : 0.5 * (dev[n / 2 - 1] + dev[n / 2]);
+    const double sigma = 1.4826 * s.mad; // consistent with stddev for normal data
+    for (double x : v) {
+        if (sigma > 0 && std::fabs(x - s.median) > 3.0 * sigma) ++s.outliers;
+    }
+
+    // Ranks n/2 -+ 0.98 sqrt(n) bracket the median with ~95% probability
+    const double half_width = 0.98 * std::sqrt(static_cast<double>(n));
+    const double lo = std::floor(static_cast<double>(n) / 2.0 - half_width);
+    const double hi = std::ceil(static_cast<double>(n) / 2.0 + half_width);
+    s.ci_low = v[static_cast<size_t>(std::max(0.0, lo))];
+    s.ci_high = v[std::min(n - 1, static_cast<size_t>(std::max(0.0, hi)))];
+    return s;
+}
+
+struct Options {
+    size_t samples = 21;
+    double min_sample_ms = 5.0;
+    double max_time_ms = 3000.0; // per benchmark, after calibration
+    std::string filter;          // substring of the benchmark name
+    std::string json_path;
+    bool list_only = false;
+};
+
+struct Result {
+    std::string name;
+    Stats stats;
+    double items_per_iter = 0; // for throughput, 0 if not meaningful
+    std::string item_unit;
+};
+
+class Runner {
+public:
+    explicit Runner(Options opt) : opt_(std::move(opt)) {}
+
+    // items_per_iter/item_unit turn the median into a throughput column
+    // (e.g. vertices/s or bytes/s).
+    void run(const std::string &name, const std::function<void(uint64_t)> &body, double items_per_iter = 0,
+             const char *item_unit = "items") {
+        if (!opt_.filter.empty() && name.find(opt_.filter) == std::string::npos) return;
+        if (opt_.list_only) {
+            std::printf("%s\n", name.c_str());
+            return;
+        }
+        using Clock = std::chrono::steady_clock;
+        auto time_batch = [&](uint64_t iters) {
+            auto t0 = Clock::now();
+            body(iters);
+            return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        };
+
+        // Calibrate (doubles as warm-up)
+        uint64_t iters = 1;
+        double batch_ns = time_batch(iters);
+        const double min_ns = opt_.min_sample_ms * 1e6;
+        while (batch_ns < min_ns && iters < (uint64_t(1) << 40)) {
+            const double grow = batch_ns > 0 ? std::min(10.0, std::max(2.0, 1.2 * min_ns / batch_ns)) : 10.0;
+            iters = static_cast<uint64_t>(std::ceil(static_cast<double>(iters) * grow));
+            batch_ns = time_batch(iters);
+        }
+        size_t samples = opt_.samples;
+        if (batch_ns > 0) {
+            samples = std::min(samples, static_cast<size_t>(opt_.max_time_ms * 1e6 / batch_ns));
+        }
+        samples = std::max(samples, std::min<size_t>(opt_.samples, 5));
+
+        std::vector<double> per_iter;
+        per_iter.reserve(samples);
+        for (size_t i = 0; i < samples; ++i) per_iter.push_back(time_batch(iters) / static_cast<double>(iters));
+
+        Result r{name, summarize(std::move(per_iter), iters), items_per_iter, item_unit};
+        print_row(r);
+        results_.push_back(std::move(r));
+    }
+
+    const std::vector<Result> &results() const { return results_; }
+
+    // Extra "context" entry for the JSON report; value is written verbatim,
+    // so strings must carry their own quotes.
+    void add_context(const std::string &key, const std::string &json_value) {
+        context_.emplace_back(key, json_value);
+    }
+
+    static void print_header() {
+        std::printf("%-32s %12s %10s %12s %12s %5s %8s  %s\n", "benchmark", "median", "mad", "ci95 low", "ci95 high",
+                    "n", "outliers", "throughput");
+    }
+
+    bool write_json() const {
+        if (opt_.json_path.empty()) return true;
+        std::FILE *f = std::fopen(opt_.json_path.c_str(), "w");
+        if (!f) {
+            std::fprintf(stderr, "bench: cannot write %s\n", opt_.json_path.c_str());
+            return false;
+        }
+        char date[32] = "";
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        std::fprintf(f, "{\n  \"context\": {\n");
+        std::fprintf(f, "    \"date\": \"%s\",\n", date);
+        for (const auto &kv : context_) std::fprintf(f, "    \"%s\": %s,\n", kv.first.c_str(), kv.second.c_str());
+#if defined(__VERSION__)
+        std::fprintf(f, "    \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+#if defined(__OPTIMIZE__)
+        std::fprintf(f, "    \"optimized\": true,\n");
+#else
+        std::fprintf(f, "    \"optimized\": false,\n");
+#endif
+        std::fprintf(f, "    \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+        std::fprintf(f, "    \"samples\": %zu,\n", opt_.samples);
+        std::fprintf(f, "    \"min_sample_ms\": %g\n  },\n  \"benchmarks\": [", opt_.min_sample_ms);
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const Result &r = results_[i];
+            const Stats &s = r.stats;
+            std::fprintf(f, "%s\n    {\"name\": \"%s\", \"unit\": \"ns\", \"iterations\": %llu, \"samples\": %zu, ",
+                         i ? "," : "", r.name.c_str(), static_cast<unsigned long long>(s.iterations), s.samples);
+            std::fprintf(f, "\"median\": %.4f, \"mad\": %.4f, \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f, ",
+                         s.median, s.mad, s.mean, s.min, s.max);
+            std::fprintf(f, "\"p10\": %.4f, \"p90\": %.4f, \"ci95_low\": %.4f, \"ci95_high\": %.4f, \"outliers\": %zu",
+                         s.p10, s.p90, s.ci_low, s.ci_high, s.outliers);
+            if (r.items_per_iter > 0 && s.median > 0) {
+                std::fprintf(f, ", \"throughput\": %.6g, \"throughput_unit\": \"%s/s\"",
+                             r.items_per_iter / (s.median * 1e-9), r.item_unit.c_str());
+            }
+            std::fputc('}', f);
+        }
+        std::fprintf(f, "\n  ]\n}\n");
+        std::fclose(f);
+        std::printf("wrote %s\n", opt_.json_path.c_str());
+        return true;
+    }
+
+private:
+    static std::string format_ns(double ns) {
+        char buf[32];
+        if (ns < 1e3) {
+            std::snprintf(buf, sizeof(buf), "%.2f ns", ns);
+        } else if (ns < 1e6) {
+            std::snprintf(buf, sizeof(buf), "%.2f us", ns * 1e-3);
+        } else if (ns < 1e9) {
+            std::snprintf(buf, sizeof(buf), "%.2f ms", ns * 1e-6);
+        } else {
+            std::snprintf(buf, sizeof(buf), "%.2f s", ns * 1e-9);
+        }
+        return buf;
+    }
+
+    static void print_row(const Result &r) {
+        const Stats &s = r.stats;
+        std::printf("%-32s %12s %10s %12s %12s %5zu %8zu", r.name.c_str(), format_ns(s.median).c_str(),
+                    format_ns(s.mad).c_str(), format_ns(s.ci_low).c_str(), format_ns(s.ci_high).c_str(), s.samples,
+                    s.outliers);
+        if (r.items_per_iter > 0 && s.median > 0) {
+            double rate = r.items_per_iter / (s.median * 1e-9);
+            const char *prefix = "";
+            if (rate >= 1e9) {
+                rate *= 1e-9;
+                prefix = "G";
+            } else if (rate >= 1e6) {
+                rate *= 1e-6;
+                prefix = "M";
+            } else if (rate >= 1e3) {
+                rate *= 1e-3;
+                prefix = "k";
+            }
+            std::printf("  %.2f %s%s/s", rate, prefix, r.item_unit.c_str());
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+    Options opt_;
+    std::vector<Result> results_;
+    std::vector<std::pair<std::string, std::string>> context_;
+};
+
+// Parses --samples N, --min-time MS, --max-time MS, --filter S, --json PATH
+// and --list; unknown arguments are left for the caller in `rest`.
+inline bool parse_options(int argc, char **argv, Options &opt, std::vector<std::string> &rest) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--list") {
+            opt.list_only = true;
+            continue;
+        }
+        const bool known = a == "--samples" || a == "--min-time" || a == "--max-time" || a == "--filter" || a == "--json";
+        if (!known) {
+            rest.push_back(a);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "%s needs a value\n", a.c_str());
+            return false;
+        }
+        const char *v = argv[++i];
+        if (a == "--samples") {
+            opt.samples = static_cast<size_t>(std::max(1L, std::strtol(v, nullptr, 10)));
+        } else if (a == "--min-time") {
+            opt.min_sample_ms = std::strtod(v, nullptr);
+        } else if (a == "--max-time") {
+            opt.max_time_ms = std::strtod(v, nullptr);
+        } else if (a == "--filter") {
+            opt.filter = v;
+        } else {
+            opt.json_path = v;
+        }
+    }
+    return true;
+}
+
+} // namespace bench
@@ -0,0 +1,649 @@
+// Benchmarks for the hot paths in gx_core: OBJ loading stages, normal
+// generation and interleaving, mesh deformation, mesh export and compression,
+// file reading, page policies, matrix/quaternion math, draw command recording,
+// occlusion culling, ray intersection, BVH occlusion queries and AO baking.
+//
+//   benchmarks [--obj model.obj] [--grid N] [--cold] [--huge-pages] [--prefault]
+//              [--filter loader/] [--json out.json]
+//              [--samples N] [--min-time MS] [--max-time MS] [--list]
+//
+// Without --obj the loader benchmarks use a generated UV sphere (v/vt/vn and
+// quad faces) with 2N x N segments. The io/ benchmarks read the file from the
+// page cache unless --cold evicts it before every read (POSIX_FADV_DONTNEED;
+// put --obj on the device under test).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ao_bake.h"
+#include "bench.h"
+#include "bvh.h"
+#include "command_buffer.h"
+#include "deform.h"
+#include "file_reader.h"
+#include "job_system.h"
+#include "math3d.h"
+#include "mesh_codec.h"
+#include "mesh_export.h"
+#include "mesh_utils.h"
+#include "occlusion.h"
+#include "page_alloc.h"
+#include "ray.h"
+#include "tiny_obj_loader.h"
+
+#ifdef GX_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifndef GX_BUILD_TYPE
+#define GX_BUILD_TYPE ""
+#endif
+#ifndef GX_GIT_REVISION
+#define GX_GIT_REVISION ""
+#endif
+
+static std::string make_sphere_obj(int stacks) {
+    const int slices = stacks * 2;
+    std::string out;
+    out.reserve(static_cast<size_t>(stacks + 1) * (slices + 1) * 100);
+    char line[256]; // worst case: 12 ints of 11 characters in the face line
+    for (int i = 0; i <= stacks; ++i) {
+        float phi = gx::kPi * static_cast<float>(i) / static_cast<float>(stacks);
+        for (int j = 0; j <= slices; ++j) {
+            float theta = 2.0f * gx::kPi * static_cast<float>(j) / static_cast<float>(slices);
+            float x = std::sin(phi) * std::cos(theta), y = std::cos(phi), z = std::sin(phi) * std::sin(theta);
+            std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", x, y, z,
+                          static_cast<float>(j) / static_cast<float>(slices),
+                          static_cast<float>(i) / static_cast<float>(stacks), x, y, z);
+            out += line;
+        }
+    }
+    for (int i = 0; i < stacks; ++i) {
+        for (int j = 0; j < slices; ++j) {
+            int a = i * (slices + 1) + j + 1, b = a + 1, c = a + slices + 2, d = a + slices + 1;
+            std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d,
+                          d, d);
+            out += line;
+        }
+    }
+    return out;
+}
+
+static void bench_loader(bench::Runner &runner, const std::string &obj_path, const std::string &text) {
+    const double bytes = static_cast<double>(text.size());
+    runner.run("loader/read_file", [&](uint64_t n) {
+        std::string buffer, err;
+        for (uint64_t i = 0; i < n; ++i) {
+            tinyobj::detail::read_file(obj_path, buffer, err);
+            bench::keep(buffer.data());
+        }
+    }, bytes, "B");
+
+    runner.run("loader/parse_chunks", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            auto chunks = tinyobj::detail::parse_chunks(text.data(), text.size());
+            bench::keep(chunks.data());
+        }
+    }, bytes, "B");
+
+    const auto chunks = tinyobj::detail::parse_chunks(text.data(), text.size());
+    size_t faces = 0;
+    for (const auto &c : chunks) faces += c.faces.size();
+    runner.run("loader/assemble_mesh", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            tinyobj::MeshData mesh;
+            std::string err;
+            tinyobj::detail::assemble_mesh(chunks, mesh, err);
+            bench::keep(mesh.indices.data());
+        }
+    }, static_cast<double>(faces), "faces");
+
+    runner.run("loader/load_obj_from_buffer", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            tinyobj::MeshData mesh;
+            std::string err;
+            tinyobj::LoadObjFromBuffer(mesh, text.data(), text.size(), err);
+            bench::keep(mesh.indices.data());
+        }
+    }, bytes, "B");
+}
+
+// Drops the file from the page cache so the next read goes to the device
+static void evict_file(const std::string &path) {
+#if defined(POSIX_FADV_DONTNEED)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+#else
+    (void)path;
+#endif
+}
+
+// Read bandwidth of std::ifstream (tinyobj's read_file), mmap, io_uring and
+// the synchronous block path it falls back to, then reading and parsing one
+// after the other against streaming parse overlapped with the reads
+static void bench_io(bench::Runner &runner, const bench::Options &opt, const std::string &obj_path, size_t bytes,
+                     bool cold) {
+    const double b = static_cast<double>(bytes);
+    auto read_loop = [&](auto &&read) {
+        return [&, read](uint64_t n) {
+            std::string buffer, err;
+            for (uint64_t i = 0; i < n; ++i) {
+                if (cold) evict_file(obj_path);
+                read(buffer, err);
+                bench::keep(buffer.data());
+            }
+        };
+    };
+    runner.run("io/ifstream", read_loop([&](std::string &buffer, std::string &err) {
+        tinyobj::detail::read_file(obj_path, buffer, err);
+    }), b, "B");
+    runner.run("io/mmap", read_loop([&](std::string &buffer, std::string &err) {
+        gx::read_file_mmap(obj_path, buffer, err);
+    }), b, "B");
+    if (gx::uring_available()) {
+        runner.run("io/uring", read_loop([&](std::string &buffer, std::string &err) {
+            gx::read_file_streamed(obj_path, buffer, err);
+        }), b, "B");
+    } else if (!opt.list_only) {
+        std::printf("io/uring: io_uring is not available here, skipped\n");
+    }
+    gx::ReadOptions sync;
+    sync.uring = false;
+    runner.run("io/sync_blocks", read_loop([&](std::string &buffer, std::string &err) {
+        gx::read_file_streamed(obj_path, buffer, err, sync);
+    }), b, "B");
+
+    runner.run("io/read_then_parse", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            if (cold) evict_file(obj_path);
+            tinyobj::MeshData mesh;
+            std::string err;
+            tinyobj::LoadObj(mesh, obj_path, err);
+            bench::keep(mesh.indices.data());
+        }
+    }, b, "B");
+    runner.run("io/streaming_parse", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            if (cold) evict_file(obj_path);
+            tinyobj::MeshData mesh;
+            std::string err;
+            gx::load_obj_streaming(obj_path, mesh, err);
+            bench::keep(mesh.indices.data());
+        }
+    }, b, "B");
+}
+
+// The page policies of page_alloc.h on a 128 MB buffer: allocation plus first
+// touch, random reads across it (TLB reach: a few MB with 4 KB pages, GBs with
+// 2 MB pages) and the OBJ load, whose mesh arrays use the policy
+static void bench_pages(bench::Runner &runner, const bench::Options &opt, const std::string &text) {
+    constexpr size_t kFloats = size_t(32) << 20;
+    std::vector<uint32_t> gather(size_t(1) << 20);
+    std::mt19937 rng(7);
+    for (uint32_t &i : gather) i = static_cast<uint32_t>(rng() % kFloats);
+
+    const pages::Policy saved = pages::policy();
+    const struct {
+        const char *name;
+        pages::Policy policy;
+    } variants[] = {{"4k", {false, false}}, {"4k_prefault", {false, true}}, {"huge", {true, false}},
+                    {"huge_prefault", {true, true}}};
+    for (const auto &v : variants) {
+        pages::policy() = v.policy;
+        const std::string prefix = std::string("pages/") + v.name + "/";
+        runner.run(prefix + "alloc_touch", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                pages::Vector<float> buffer(kFloats, 1.0f);
+                bench::keep(buffer.data());
+            }
+        }, static_cast<double>(kFloats * sizeof(float)), "B");
+
+        pages::Vector<float> buffer(opt.list_only ? 0 : kFloats, 1.0f);
+        if (!opt.list_only && v.policy.huge) {
+            std::printf("%s: %zu MB of the process in transparent huge pages\n", v.name,
+                        pages::huge_page_bytes() >> 20);
+        }
+        runner.run(prefix + "random_gather", [&](uint64_t n) {
+            float sum = 0.0f;
+            for (uint64_t i = 0; i < n; ++i) {
+                for (uint32_t g : gather) sum += buffer[g];
+            }
+            bench::keep(&sum);
+        }, static_cast<double>(gather.size()), "reads");
+
+        runner.run(prefix + "load_obj", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                tinyobj::MeshData mesh;
+                std::string err;
+                tinyobj::LoadObjFromBuffer(mesh, text.data(), text.size(), err);
+                bench::keep(mesh.indices.data());
+            }
+        }, static_cast<double>(text.size()), "B");
+    }
+    pages::policy() = saved;
+}
+
+static void bench_mesh(bench::Runner &runner, const std::string &text) {
+    tinyobj::MeshData mesh;
+    std::string err;
+    if (!tinyobj::LoadObjFromBuffer(mesh, text.data(), text.size(), err)) {
+        std::fprintf(stderr, "mesh benchmarks skipped: %s\n", err.c_str());
+        return;
+    }
+    const double vertices = static_cast<double>(mesh.positions.size() / 3);
+    runner.run("mesh/compute_normals", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            mesh.normals.clear();
+            gx::compute_normals_if_missing(mesh);
+            bench::keep(mesh.normals.data());
+        }
+    }, vertices, "vertices");
+
+    runner.run("mesh/interleave_vertices", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            auto interleaved = gx::interleave_vertices(mesh);
+            bench::keep(interleaved.data());
+        }
+    }, vertices, "vertices");
+
+    runner.run("mesh/interleave_with_bounds", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            gx::MeshBounds bounds;
+            auto interleaved = gx::interleave_vertices(mesh, &bounds);
+            bench::keep(interleaved.data());
+            bench::keep(&bounds);
+        }
+    }, vertices, "vertices");
+
+    // Each iteration changes the parameters so every update does real work
+    auto interleaved = gx::interleave_vertices(mesh);
+    gx::MeshDeformer deformer(mesh);
+    gx::DeformParams params;
+    uint64_t step = 0;
+    runner.run("mesh/deform_twist", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            params.twist = 0.01f * static_cast<float>(++step % 100);
+            bench::keep(deformer.update(params, interleaved).data());
+        }
+    }, vertices, "vertices");
+
+    // Sparse morph: only the top 5% of the mesh moves
+    float min_y = 1e30f, max_y = -1e30f;
+    for (size_t v = 1; v < mesh.positions.size(); v += 3) {
+        min_y = std::min(min_y, mesh.positions[v]);
+        max_y = std::max(max_y, mesh.positions[v]);
+    }
+    std::vector<float> deltas(mesh.positions.size(), 0.0f);
+    for (size_t v = 1; v < mesh.positions.size(); v += 3) {
+        if (mesh.positions[v] > max_y - 0.05f * (max_y - min_y)) deltas[v] = 0.1f * (max_y - min_y);
+    }
+    params = gx::DeformParams{};
+    params.morph_weights.resize(1);
+    deformer.add_morph_target(deltas);
+    runner.run("mesh/deform_morph_sparse", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            params.morph_weights[0] = 0.01f * static_cast<float>(++step % 100);
+            bench::keep(deformer.update(params, interleaved).data());
+        }
+    }, vertices, "vertices");
+}
+
+// Written to the temp directory; the iostream writer is the baseline
+static void bench_export(bench::Runner &runner, const std::string &text) {
+    tinyobj::MeshData mesh;
+    std::string err;
+    if (!tinyobj::LoadObjFromBuffer(mesh, text.data(), text.size(), err)) return;
+    const auto dir = std::filesystem::temp_directory_path();
+    const std::string obj_path = (dir / "gx_export.obj").string(), ply_path = (dir / "gx_export.ply").string();
+    const double obj_bytes = static_cast<double>(gx::format_obj(mesh).size());
+
+    runner.run("export/obj_ostream", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::ofstream ofs(obj_path, std::ios::binary);
+            for (size_t v = 0; v < mesh.positions.size(); v += 3) {
+                ofs << "v " << mesh.positions[v] << ' ' << mesh.positions[v + 1] << ' ' << mesh.positions[v + 2] << '\n';
+            }
+            for (size_t v = 0; v < mesh.texcoords.size(); v += 2) {
+                ofs << "vt " << mesh.texcoords[v] << ' ' << mesh.texcoords[v + 1] << '\n';
+            }
+            for (size_t v = 0; v < mesh.normals.size(); v += 3) {
+                ofs << "vn " << mesh.normals[v] << ' ' << mesh.normals[v + 1] << ' ' << mesh.normals[v + 2] << '\n';
+            }
+            for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+                ofs << 'f';
+                for (int k = 0; k < 3; ++k) {
+                    const unsigned idx = mesh.indices[t + k] + 1;
+                    ofs << ' ' << idx << '/' << idx << '/' << idx;
+                }
+                ofs << '\n';
+            }
+        }
+    }, obj_bytes, "B");
+
+    runner.run("export/obj", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) gx::export_obj(mesh, obj_path, err);
+    }, obj_bytes, "B");
+
+    gx::ExportStats stats;
+    gx::export_ply(mesh, ply_path, err, {}, &stats);
+    runner.run("export/ply", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) gx::export_ply(mesh, ply_path, err);
+    }, static_cast<double>(stats.bytes), "B");
+
+    std::filesystem::remove(obj_path);
+    std::filesystem::remove(ply_path);
+}
+
+// The .gxm codec against the OBJ text (parsed) and gzip of it (inflate only,
+// the parse comes on top); throughput is in triangles
+static void bench_codec(bench::Runner &runner, const bench::Options &opt, const std::string &text) {
+    tinyobj::MeshData mesh;
+    std::string err;
+    if (!tinyobj::LoadObjFromBuffer(mesh, text.data(), text.size(), err)) return;
+    const double triangles = static_cast<double>(mesh.indices.size() / 3);
+    const std::string gxm = gx::encode_mesh(mesh);
+
+    runner.run("codec/encode", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) bench::keep(gx::encode_mesh(mesh).data());
+    }, triangles, "tris");
+
+    runner.run("codec/decode", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            tinyobj::MeshData decoded;
+            gx::decode_mesh(gxm.data(), gxm.size(), decoded, err);
+            bench::keep(decoded.indices.data());
+        }
+    }, triangles, "tris");
+
+    size_t gzip_size = 0;
+#ifdef GX_HAVE_ZLIB
+    uLongf packed_size = compressBound(static_cast<uLong>(text.size()));
+    std::vector<Bytef> packed(packed_size);
+    compress2(packed.data(), &packed_size, reinterpret_cast<const Bytef *>(text.data()), static_cast<uLong>(text.size()), 6);
+    gzip_size = packed_size;
+    runner.run("codec/gzip_inflate", [&](uint64_t n) {
+        std::vector<Bytef> unpacked(text.size());
+        for (uint64_t i = 0; i < n; ++i) {
+            uLongf size = static_cast<uLongf>(unpacked.size());
+            uncompress(unpacked.data(), &size, packed.data(), packed_size);
+            bench::keep(unpacked.data());
+        }
+    }, triangles, "tris");
+#endif
+    const bool selected = opt.filter.rfind("codec/", 0) == 0 || std::string("codec/").find(opt.filter) != std::string::npos;
+    if (!opt.list_only && selected) {
+        std::printf("  sizes: obj %.2f MB, gzip -6 %.2f MB, gxm %.2f MB (%.1fx smaller than obj)\n",
+                    static_cast<double>(text.size()) / 1e6, static_cast<double>(gzip_size) / 1e6,
+                    static_cast<double>(gxm.size()) / 1e6, static_cast<double>(text.size()) / static_cast<double>(gxm.size()));
+    }
+}
+
+static void bench_math(bench::Runner &runner) {
+    // Rotations keep repeated products bounded (no overflow or denormals)
+    std::vector<gx::Mat4> rotations(64);
+    for (size_t i = 0; i < rotations.size(); ++i) {
+        rotations[i] = gx::multiply(gx::rotate_y(0.1f * static_cast<float>(i)), gx::rotate_x(0.07f * static_cast<float>(i)));
+    }
+    runner.run("math/mat4_multiply", [&](uint64_t n) {
+        gx::Mat4 r = gx::identity();
+        for (uint64_t i = 0; i < n; ++i) r = gx::multiply(rotations[i & 63], r);
+        bench::keep(r);
+    });
+
+    // The per-frame matrix chain of obj_viewer
+    runner.run("math/model_view_projection", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            float yaw = 0.001f * static_cast<float>(i & 1023);
+            gx::Mat4 proj = gx::perspective(45.0f * gx::kPi / 180.0f, 16.0f / 9.0f, 0.05f, 200.0f);
+            gx::Mat4 view = gx::translate(0.0f, 0.0f, -3.0f);
+            gx::Mat4 model = gx::multiply(gx::translate(0.1f, 0.2f, 0.0f),
+                                          gx::multiply(gx::rotate_y(yaw), gx::multiply(gx::rotate_x(0.3f), gx::scale(1.5f))));
+            gx::Mat4 mvp = gx::multiply(gx::multiply(proj, view), model);
+            bench::keep(mvp);
+        }
+    });
+
+    const gx::Quat a = gx::quat_from_axis_angle(gx::Vec3(0, 1, 0), 0.0f);
+    const gx::Quat b = gx::quat_from_axis_angle(gx::Vec3(0.3f, 1, 0.2f), 3.0f);
+    runner.run("math/quat_slerp", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            gx::Quat q = gx::quat_slerp(a, b, static_cast<float>(i & 1023) * (1.0f / 1023.0f));
+            bench::keep(q);
+        }
+    });
+
+    runner.run("math/quat_to_mat4", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            gx::Mat4 m = gx::quat_to_mat4(gx::Quat{1.0f, 0.001f * static_cast<float>(i & 1023), 0.2f, 0.1f});
+            bench::keep(m);
+        }
+    });
+}
+
+// exp2's per-object work (model/MVP matrices, uniforms, draw) for a grid of
+// objects, recorded serially and on the job system
+static void bench_commands(bench::Runner &runner) {
+    const size_t objects = 10000;
+    const gx::Mat4 vp = gx::multiply(gx::perspective(0.8f, 16.0f / 9.0f, 0.05f, 50.0f), gx::translate(0.0f, 0.0f, -6.0f));
+    const gx::Quat a = gx::quat_from_axis_angle(gx::Vec3(0, 1, 0), 0.0f);
+    const gx::Quat b = gx::quat_from_axis_angle(gx::Vec3(0, 1, 0), gx::kPi);
+    auto record_range = [&](gx::CommandBuffer &cb, size_t lo, size_t hi) {
+        cb.use_program(1);
+        cb.bind_vertex_array(1);
+        for (size_t i = lo; i < hi; ++i) {
+            const float u = static_cast<float>(i % 100) * 0.01f, v = static_cast<float>(i / 100) * 0.01f;
+            gx::Mat4 model = gx::multiply(gx::translate(u, v, -4.0f),
+                                          gx::multiply(gx::quat_to_mat4(gx::quat_slerp(a, b, u)), gx::scale(0.03f)));
+            gx::Mat4 mvp = gx::multiply(vp, model);
+            cb.uniform_matrix4(0, mvp.m);
+            cb.uniform_matrix4(1, model.m);
+            cb.uniform3f(2, u, 0.4f, v);
+            cb.draw_elements(36);
+        }
+    };
+
+    gx::CommandBuffer serial;
+    runner.run("commands/record_serial", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            serial.clear();
+            record_range(serial, 0, objects);
+            bench::keep(serial.commands().data());
+        }
+    }, static_cast<double>(objects), "objects");
+
+    gx::ParallelRecorder recorder;
+    runner.run("commands/record_parallel", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            recorder.record(objects, 256, record_range);
+            bench::keep(recorder.begin());
+        }
+    }, static_cast<double>(objects), "objects");
+}
+
+// A wall in front of a 100x100 grid of box parts, as obj_viewer culls it
+static void bench_occlusion(bench::Runner &runner) {
+    tinyobj::MeshData mesh;
+    auto add_box = [&](float x, float y, float z, float h) {
+        const unsigned base = static_cast<unsigned>(mesh.positions.size() / 3);
+        for (int c = 0; c < 8; ++c) {
+            mesh.positions.insert(mesh.positions.end(), {x + (c & 1 ? h : -h), y + (c & 2 ? h : -h), z + (c & 4 ? h : -h)});
+        }
+        static const unsigned faces[12][3] = {{0, 1, 3}, {0, 3, 2}, {4, 6, 7}, {4, 7, 5}, {0, 4, 5}, {0, 5, 1},
+                                              {2, 3, 7}, {2, 7, 6}, {0, 2, 6}, {0, 6, 4}, {1, 5, 7}, {1, 7, 3}};
+        mesh.parts.push_back(tinyobj::MeshPart{{}, mesh.indices.size(), 36});
+        for (const auto &f : faces) mesh.indices.insert(mesh.indices.end(), {base + f[0], base + f[1], base + f[2]});
+    };
+    add_box(0.0f, 0.0f, 0.0f, 2.0f);
+    const int grid = 100;
+    for (int i = 0; i < grid * grid; ++i) {
+        add_box(-3.0f + 6.0f * (i % grid) / grid, -3.0f + 6.0f * (i / grid) / grid, -4.0f, 0.02f);
+    }
+    gx::OcclusionCuller culler(mesh);
+    const gx::Mat4 mvp = gx::multiply(gx::perspective(0.8f, 16.0f / 9.0f, 0.05f, 50.0f), gx::translate(0.0f, 0.0f, -8.0f));
+    runner.run("occlusion/cull", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) bench::keep(culler.cull(mvp).data());
+    }, static_cast<double>(mesh.parts.size()), "parts");
+}
+
+static void bench_ray(bench::Runner &runner) {
+    // Primary rays of exp3's camera; roughly a third hit the sphere
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(-0.5f, 0.5f);
+    std::vector<gx::Ray> rays(4096);
+    for (auto &r : rays) {
+        r.o = gx::Vec3(2.5f, 1.5f, 8.0f);
+        r.d = gx::normalize(gx::Vec3(u(rng), u(rng), -1.0f));
+    }
+    const gx::Vec3 center(2.5f, 1.2f, 2.5f);
+    runner.run("ray/intersect_sphere", [&](uint64_t n) {
+        int hits = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            float t;
+            gx::Vec3 normal;
+            hits += gx::intersect_sphere(rays[i & 4095], center, 0.9f, t, normal);
+        }
+        bench::keep(hits);
+    }, 1.0, "rays");
+
+    runner.run("ray/intersect_plane", [&](uint64_t n) {
+        int hits = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            float t;
+            hits += gx::intersect_plane(rays[i & 4095], gx::Vec3(0, 1, 0), 0.0f, t);
+        }
+        bench::keep(hits);
+    }, 1.0, "rays");
+}
+
+// Occlusion rays against a TriangleBvh of the loader mesh: four from each of
+// a set of vertices into the mesh (bundles like the AO bake's), cosine-
+// distributed around the inverted normal and reaching across it, so every ray
+// descends to the leaves on the far side. One at a time against packets of
+// four (SSE2 where available), then the whole per-vertex AO bake (16 rays per
+// vertex; on the convex sphere they leave at once).
+static void bench_bvh(bench::Runner &runner, const std::string &text) {
+    tinyobj::MeshData mesh;
+    std::string err;
+    if (!tinyobj::LoadObjFromBuffer(mesh, text.data(), text.size(), err) || mesh.indices.empty()) return;
+    gx::compute_normals_if_missing(mesh);
+    gx::MeshBounds bounds;
+    const auto interleaved = gx::interleave_vertices(mesh, &bounds);
+    const size_t vertex_count = interleaved.size() / gx::kVertexStride;
+    const gx::TriangleBvh bvh(gx::PositionView{interleaved.data(), gx::kVertexStride}, mesh.indices.data(),
+                              mesh.indices.size());
+    const float radius = bounds.sphere.radius;
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::vector<gx::Ray> rays(4096);
+    for (size_t i = 0; i < rays.size(); i += 4) {
+        const float *v = &interleaved[(rng() % vertex_count) * gx::kVertexStride];
+        const gx::Vec3 n = gx::normalize(gx::Vec3(v[3], v[4], v[5])) * -1.0f;
+        gx::Vec3 t, b;
+        gx::orthonormal_basis(n, t, b);
+        for (size_t k = i; k < i + 4; ++k) {
+            rays[k].o = gx::Vec3(v[0], v[1], v[2]) + n * (2e-4f * radius);
+            rays[k].d = gx::cosine_direction(n, t, b, u(rng), u(rng));
+        }
+    }
+    runner.run("bvh/occluded", [&](uint64_t n) {
+        int hits = 0;
+        for (uint64_t i = 0; i < n; ++i) hits += bvh.occluded(rays[i & 4095], 0.0f, 2.5f * radius);
+        bench::keep(hits);
+    }, 1.0, "rays");
+    runner.run("bvh/occluded4", [&](uint64_t n) {
+        unsigned hits = 0;
+        for (uint64_t i = 0; i < n; ++i) hits += bvh.occluded4(&rays[(i * 4) & 4095], 0.0f, 2.5f * radius);
+        bench::keep(hits);
+    }, 4.0, "rays");
+
+    gx::AoBakeOptions opt;
+    opt.rays = 16;
+    runner.run("ao/bake_vertex_ao", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            auto ao = gx::bake_vertex_ao(interleaved.data(), vertex_count, mesh.indices.data(), mesh.indices.size(),
+                                         radius, opt);
+            bench::keep(ao.data());
+        }
+    }, static_cast<double>(vertex_count * opt.rays), "rays");
+}
+
+int main(int argc, char **argv) {
+    bench::Options opt;
+    std::vector<std::string> rest;
+    if (!bench::parse_options(argc, argv, opt, rest)) return 1;
+    pages::init_from_env();
+    std::string obj_path;
+    int grid = 256;
+    bool cold = false;
+    for (size_t i = 0; i < rest.size(); ++i) {
+        if (rest[i] == "--obj" && i + 1 < rest.size()) {
+            obj_path = rest[++i];
+        } else if (rest[i] == "--cold") {
+            cold = true;
+        } else if (pages::parse_flag(rest[i])) {
+            // --huge-pages / --prefault for everything but the pages/ benchmarks
+        } else if (rest[i] == "--grid" && i + 1 < rest.size()) {
+            grid = std::max(2, std::atoi(rest[++i].c_str()));
+        } else {
+            std::fprintf(stderr, "unknown argument: %s\n", rest[i].c_str());
+            return 1;
+        }
+    }
+
+    // Loader input: the given OBJ, or a generated sphere written to a temp file
+    std::string text, err;
+    bool temp_file = false;
+    if (!obj_path.empty()) {
+        if (!tinyobj::detail::read_file(obj_path, text, err)) {
+            std::fprintf(stderr, "%s\n", err.c_str());
+            return 1;
+        }
+    } else if (!opt.list_only) {
+        text = make_sphere_obj(grid);
+        obj_path = (std::filesystem::temp_directory_path() / "gx_benchmarks.obj").string();
+        std::ofstream(obj_path, std::ios::binary).write(text.data(), static_cast<std::streamsize>(text.size()));
+        temp_file = true;
+    }
+
+    bench::Runner runner(opt);
+    runner.add_context("build_type", "\"" GX_BUILD_TYPE "\"");
+    runner.add_context("git_revision", "\"" GX_GIT_REVISION "\"");
+    runner.add_context("job_threads", std::to_string(jobs::JobSystem::instance().concurrency()));
+    runner.add_context("obj_bytes", std::to_string(text.size()));
+    runner.add_context("pages", "\"" + pages::describe() + "\"");
+    if (!opt.list_only) {
+        std::printf("obj: %s (%.1f MB), %zu job threads\n", obj_path.c_str(), static_cast<double>(text.size()) / 1e6,
+                    jobs::JobSystem::instance().concurrency());
+        bench::Runner::print_header();
+    }
+
+    bench_loader(runner, obj_path, text);
+    bench_io(runner, opt, obj_path, text.size(), cold);
+    bench_pages(runner, opt, text);
+    bench_mesh(runner, text);
+    bench_export(runner, text);
+    bench_codec(runner, opt, text);
+    bench_math(runner);
+    bench_commands(runner);
+    bench_occlusion(runner);
+    bench_ray(runner);
+    bench_bvh(runner, text);
+
+    if (temp_file) std::filesystem::remove(obj_path);
+    return runner.write_json() ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+// Scheduling overhead of the job system: empty tasks, continuation chains and
+// parallel_for over a trivial body at different grain sizes.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "job_system.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double ns_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+}
+
+// Best of several repetitions, to filter out scheduler noise
+template <typename F>
+static double best_ns(int reps, F &&fn) {
+    double best = 1e300;
+    for (int r = 0; r < reps; ++r) {
+        auto t0 = Clock::now();
+        fn();
+        best = std::min(best, ns_since(t0));
+    }
+    return best;
+}
+
+int main() {
+    auto &pool = jobs::JobSystem::instance();
+    std::printf("job system: %zu workers + caller\n", pool.worker_count());
+
+    const size_t task_count = 100000;
+    std::atomic<size_t> counter{0};
+    double ns = best_ns(5, [&] {
+        std::vector<jobs::TaskHandle> tasks;
+        tasks.reserve(task_count);
+        for (size_t i = 0; i < task_count; ++i) {
+            tasks.push_back(pool.run([&counter] { counter.fetch_add(1, std::memory_order_relaxed); }));
+        }
+        for (const auto &t : tasks) pool.wait(t);
+    });
+    std::printf("spawn + wait        : %8.1f ns/task\n", ns / task_count);
+
+    const size_t chain_length = 20000;
+    ns = best_ns(5, [&] {
+        jobs::TaskHandle t = pool.run([] {});
+        for (size_t i = 1; i < chain_length; ++i) t = pool.then(t, [] {});
+        pool.wait(t);
+    });
+    std::printf("continuation chain  : %8.1f ns/link\n", ns / chain_length);
+
+    const size_t fan = 10000;
+    ns = best_ns(5, [&] {
+        std::vector<jobs::TaskHandle> preds;
+        preds.reserve(fan);
+        for (size_t i = 0; i < fan; ++i) preds.push_back(pool.run([] {}));
+        pool.wait(pool.when_all(preds, [] {}));
+    });
+    std::printf("when_all fan-in     : %8.1f ns/dependency\n", ns / fan);
+
+    // Serial baseline against which parallel_for overhead is measured
+    const size_t n = size_t(1) << 22;
+    std::vector<float> data(n, 1.0f);
+    double serial = best_ns(5, [&] {
+        for (size_t i = 0; i < n; ++i) data[i] = data[i] * 1.0001f + 0.5f;
+    });
+    std::printf("serial loop         : %8.3f ms\n", serial * 1e-6);
+    const double ideal_threads = std::min<double>(pool.concurrency(), std::max(1u, std::thread::hardware_concurrency()));
+    for (size_t grain : {size_t(64), size_t(1024), size_t(16384), size_t(262144)}) {
+        double par = best_ns(5, [&] {
+            jobs::parallel_for(0, n, grain, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) data[i] = data[i] * 1.0001f + 0.5f;
+            });
+        });
+        size_t chunks = (n + grain - 1) / grain;
+        std::printf("parallel_for g=%-6zu: %8.3f ms  speedup %5.2fx  (%zu chunks, %.1f ns/chunk over ideal)\n",
+                    grain, par * 1e-6, serial / par, chunks,
+                    std::max(0.0, par - serial / ideal_threads) / chunks);
+    }
+    return counter.load() == 0;
+}
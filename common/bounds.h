@@ -0,0 +1,69 @@
+#pragma once
+// Bounding volumes of point sets (mesh vertices, splat centers): axis-aligned
+// box, bounding sphere and an oriented box along the principal axes.
+//
+// The first pass collects per-block minima/maxima and first and second
+// moments (SSE2 where available) and is meant to be fused into a loop that
+// reads the positions anyway (interleave_vertices). finish() reduces the
+// blocks in order, takes the principal axes from the covariance and makes a
+// second parallel pass for the sphere radius and the box extents.
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+#include "math3d.h"
+
+namespace gx {
+
+struct Aabb {
+    Vec3 min, max;
+};
+
+struct Sphere {
+    Vec3 center;
+    float radius = 0.0f;
+};
+
+struct Obb {
+    Vec3 center;
+    Vec3 axis[3]; // orthonormal, largest variance first
+    Vec3 half;    // half extents along axis
+};
+
+struct MeshBounds {
+    Aabb box;
+    Sphere sphere; // centered on the box
+    Obb obb;
+    size_t count = 0; // points
+};
+
+class BoundsAccumulator {
+public:
+    // positions: x,y,z per point; blocks of grain points are added separately.
+    BoundsAccumulator(const float *positions, size_t count, size_t grain);
+
+    // Adds points [lo, hi). Calls whose ranges share no block may run
+    // concurrently (parallel_for with the same grain).
+    void add(size_t lo, size_t hi);
+    MeshBounds finish() const;
+
+private:
+    struct Block {
+        float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        double sum[3] = {}, sq[3] = {}, cross[3] = {}; // relative to ref_: xx yy zz, xy yz zx
+        size_t count = 0;
+    };
+
+    void add_block(size_t lo, size_t hi);
+
+    const float *positions_;
+    size_t count_, grain_;
+    float ref_[4] = {0, 0, 0, 0}; // first point, keeps the float sums small
+    std::vector<Block> blocks_;
+};
+
+// Both passes in parallel over the points.
+MeshBounds compute_bounds(const float *positions, size_t count);
+
+} // namespace gx
@@ -0,0 +1,72 @@
+#pragma once
+// Bounding volume hierarchy over the triangles of a mesh, for ray queries on
+// the CPU (obj_viewer's still mode).
+//
+// Built top-down with a binned surface area heuristic (kBins bins along the
+// largest axis of the centroid bounds), falling back to a median split where
+// the heuristic finds nothing, so the depth stays logarithmic. Nodes are 32
+// bytes in depth-first order: the left child follows its parent and only the
+// right child is stored. Triangles are copied into leaf order as a vertex and
+// two edges, so a leaf reads one contiguous block. occluded4() traces four
+// rays through the tree together, with SSE2 where the target has it (box and
+// triangle tests for all four in one go), for bundles such as AO rays. Like
+// the mesh arrays, nodes and leaf-order triangles are pages::Vector, so large
+// trees get their own (optionally huge-page) mapping.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bounds.h"
+#include "mesh_utils.h"
+#include "page_alloc.h"
+#include "ray.h"
+
+namespace gx {
+
+struct RayHit {
+    float t = 0.0f;
+    float u = 0.0f, v = 0.0f; // barycentric weights of the second and third vertex
+    uint32_t triangle = 0;    // in the mesh's index buffer (indices 3 * triangle ..)
+};
+
+class TriangleBvh {
+public:
+    static constexpr int kBins = 16;
+    static constexpr uint32_t kMaxLeaf = 4; // triangles
+
+    TriangleBvh() = default;
+    TriangleBvh(PositionView positions, const unsigned int *indices, size_t index_count);
+
+    // Nearest hit with t_min < t < t_max; ray.d need not be normalized (t is
+    // in units of its length).
+    bool intersect(const Ray &ray, float t_min, float t_max, RayHit &hit) const;
+    // Any hit with t_min < t < t_max: shadow and occlusion rays.
+    bool occluded(const Ray &ray, float t_min, float t_max) const;
+    // occluded() for four rays: bit i of the result is set when rays[i] is
+    // blocked. Rays that share an origin keep to the same nodes and go fastest.
+    unsigned occluded4(const Ray rays[4], float t_min, float t_max) const;
+
+    bool empty() const { return nodes_.empty(); }
+    size_t triangle_count() const { return ids_.size(); }
+    size_t node_count() const { return nodes_.size(); }
+    Aabb bounds() const;
+    double build_ms() const { return build_ms_; }
+
+private:
+    struct Node {
+        float min[3];
+        uint32_t index; // inner: right child; leaf: first triangle
+        float max[3];
+        uint32_t count; // leaf: triangles; inner: 0
+    };
+
+    uint32_t build(pages::Vector<uint32_t> &order, size_t begin, size_t end, const pages::Vector<float> &boxes,
+                   const pages::Vector<float> &centroids, int depth);
+
+    pages::Vector<Node> nodes_;
+    pages::Vector<float> triangles_; // leaf order: v0, v1 - v0, v2 - v0
+    pages::Vector<uint32_t> ids_;    // mesh triangle of each leaf-order triangle
+    double build_ms_ = 0.0;
+};
+
+} // namespace gx
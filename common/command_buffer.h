@@ -0,0 +1,115 @@
+#pragma once
+// Deferred draw commands: any thread records, the GL thread replays (see
+// gl_commands.h). Recording touches no GL state, so per-object work such as
+// matrix math and uniform packing can run on the job system:
+//
+//   gx::ParallelRecorder recorder;
+//   recorder.record(objects.size(), 256, [&](gx::CommandBuffer &cb, size_t lo, size_t hi) {
+//       for (size_t i = lo; i < hi; ++i) {
+//           cb.uniform_matrix4(loc_mvp, mvp_of(objects[i]).m);
+//           cb.draw_elements(index_count);
+//       }
+//   });
+//   gx::replay(recorder); // on the GL thread
+//
+// Each chunk of the range records into its own buffer, so recording needs no
+// locks and replaying the buffers in chunk order reproduces the serial order.
+// Buffers keep their capacity between frames.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "job_system.h"
+#include "trace.h"
+
+namespace gx {
+
+enum class CommandOp : uint8_t {
+    UseProgram,      // handle: program
+    BindVertexArray, // handle: vertex array
+    UniformMatrix4,  // handle: location, a: payload offset (16 floats)
+    Uniform3f,       // handle: location, a: payload offset (3 floats)
+    Uniform4f,       // handle: location, a: payload offset (4 floats)
+    Uniform1f,       // handle: location, a: payload offset (1 float)
+    Uniform1i,       // handle: location, a: value
+    DrawElements,    // a: index count, b: first index (32-bit indices)
+    DrawElementsInstanced, // handle: instance count, a: index count, b: first index
+};
+
+struct Command {
+    CommandOp op;
+    int32_t handle;
+    uint32_t a, b;
+};
+static_assert(sizeof(Command) == 16, "Command should stay compact");
+
+class CommandBuffer {
+public:
+    void clear() {
+        commands_.clear();
+        payload_.clear();
+    }
+    bool empty() const { return commands_.empty(); }
+
+    void use_program(uint32_t program) { push(CommandOp::UseProgram, static_cast<int32_t>(program)); }
+    void bind_vertex_array(uint32_t vao) { push(CommandOp::BindVertexArray, static_cast<int32_t>(vao)); }
+    void uniform_matrix4(int32_t location, const float m[16]) { push_payload(CommandOp::UniformMatrix4, location, m, 16); }
+    void uniform3f(int32_t location, float x, float y, float z) {
+        const float v[3] = {x, y, z};
+        push_payload(CommandOp::Uniform3f, location, v, 3);
+    }
+    void uniform4f(int32_t location, float x, float y, float z, float w) {
+        const float v[4] = {x, y, z, w};
+        push_payload(CommandOp::Uniform4f, location, v, 4);
+    }
+    void uniform1f(int32_t location, float v) { push_payload(CommandOp::Uniform1f, location, &v, 1); }
+    void uniform1i(int32_t location, int32_t v) { push(CommandOp::Uniform1i, location, static_cast<uint32_t>(v)); }
+    void draw_elements(uint32_t count, uint32_t first = 0) { push(CommandOp::DrawElements, 0, count, first); }
+    void draw_elements_instanced(uint32_t count, uint32_t first, uint32_t instances) {
+        push(CommandOp::DrawElementsInstanced, static_cast<int32_t>(instances), count, first);
+    }
+
+    const std::vector<Command> &commands() const { return commands_; }
+    const float *payload(uint32_t offset) const { return payload_.data() + offset; }
+
+private:
+    void push(CommandOp op, int32_t handle, uint32_t a = 0, uint32_t b = 0) { commands_.push_back(Command{op, handle, a, b}); }
+
+    void push_payload(CommandOp op, int32_t location, const float *v, size_t n) {
+        push(op, location, static_cast<uint32_t>(payload_.size()));
+        payload_.insert(payload_.end(), v, v + n);
+    }
+
+    std::vector<Command> commands_;
+    std::vector<float> payload_;
+};
+
+// A frame's worth of command buffers recorded in parallel.
+class ParallelRecorder {
+public:
+    // Calls fn(buffer, lo, hi) over [0, count) in chunks of grain elements on
+    // the job system; chunk i records into buffers()[i].
+    template <typename F>
+    void record(size_t count, size_t grain, F &&fn) {
+        TRACE_SCOPE("record_commands");
+        grain = grain ? grain : 1;
+        const size_t chunks = (count + grain - 1) / grain;
+        if (buffers_.size() < chunks) buffers_.resize(chunks);
+        used_ = chunks;
+        jobs::parallel_for(0, count, grain, [&](size_t lo, size_t hi) {
+            CommandBuffer &cb = buffers_[lo / grain];
+            cb.clear();
+            fn(cb, lo, hi);
+        });
+    }
+
+    const CommandBuffer *begin() const { return buffers_.data(); }
+    const CommandBuffer *end() const { return buffers_.data() + used_; }
+
+private:
+    std::vector<CommandBuffer> buffers_;
+    size_t used_ = 0;
+};
+
+} // namespace gx
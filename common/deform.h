@@ -0,0 +1,69 @@
+#pragma once
+// Interactive CPU deformation of a loaded mesh: morph targets followed by a
+// twist (about the vertical axis) and a bend (about the horizontal x axis),
+// both ramping in over a band of the mesh height.
+//
+// update() evaluates the deformation for every vertex (SSE2 where available,
+// in parallel on the job system) but only does follow-up work for vertices
+// whose position actually changed: face normals of their faces, normals of
+// the vertices of those faces, and the interleaved copy. The touched vertices
+// are returned as merged ranges for partial VBO uploads (gl_dynamic_mesh.h).
+// Recomputed normals are area weighted like compute_normals_if_missing, also
+// where the OBJ supplied its own.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+
+namespace gx {
+
+struct DeformParams {
+    float twist = 0.0f; // radians at the top of the band
+    float bend = 0.0f;  // radians at the top of the band
+    float band_lo = 0.5f, band_hi = 1.0f; // fractions of the mesh height
+    std::vector<float> morph_weights; // one per morph target
+};
+
+struct DirtyRange {
+    uint32_t first, count; // vertices
+};
+
+class MeshDeformer {
+public:
+    explicit MeshDeformer(const tinyobj::MeshData &mesh);
+
+    // deltas: x,y,z per vertex; returns the target's index in morph_weights.
+    size_t add_morph_target(const std::vector<float> &deltas);
+
+    // Deforms the rest pose with p and writes positions and normals of every
+    // touched vertex into interleaved (kVertexStride floats per vertex).
+    // Ranges closer than a few vertices are merged to keep uploads coarse.
+    const std::vector<DirtyRange> &update(const DeformParams &p, pages::Vector<float> &interleaved);
+
+    size_t vertex_count() const { return vertex_count_; }
+    size_t moved_vertices() const { return moved_.size(); }      // last update
+    size_t touched_vertices() const { return touched_.size(); }  // moved + renormalized
+
+private:
+    void deform_range(const DeformParams &p, size_t lo, size_t hi, std::vector<uint32_t> &moved);
+    void update_face_normals(); // of dirty_faces_, from cur_
+
+    size_t vertex_count_ = 0, padded_ = 0; // padded_ is a multiple of 4
+    std::vector<unsigned int> indices_;
+    std::vector<float> rest_[3], cur_[3];  // SoA positions
+    std::vector<std::vector<float>> targets_; // 3 * padded_ per target (SoA)
+    float min_y_ = 0.0f, height_ = 1.0f, center_x_ = 0.0f, center_z_ = 0.0f;
+
+    std::vector<unsigned int> offsets_, vertex_faces_; // vertex -> faces (CSR)
+    std::vector<float> face_normals_;                   // unnormalized, per face
+
+    uint32_t epoch_ = 0;
+    std::vector<uint32_t> face_mark_, vertex_mark_;
+    std::vector<std::vector<uint32_t>> block_moved_;
+    std::vector<uint32_t> moved_, dirty_faces_, touched_;
+    std::vector<DirtyRange> ranges_;
+};
+
+} // namespace gx
@@ -0,0 +1,59 @@
+#pragma once
+// Large sequential file reads that keep the device queue full.
+//
+// On Linux the file is read through io_uring (raw syscalls, no liburing):
+// queue_depth reads of block_size bytes are in flight at once, each into one
+// of queue_depth buffers registered with the kernel (fixed buffers, so the
+// kernel doesn't map them per read). Blocks are handed to the caller in file
+// order as they complete and the buffer goes straight back into the ring for
+// the next read. Without io_uring (other platforms, old kernels, or disabled
+// by the administrator) the same interface reads the blocks one after another.
+//
+// load_obj_streaming() feeds the blocks into tinyobj's StreamingParser, so
+// OBJ parsing on the job system overlaps the remaining reads.
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include "tiny_obj_loader.h"
+
+namespace gx {
+
+struct ReadOptions {
+    size_t block_size = size_t(1) << 20; // bytes per read
+    unsigned queue_depth = 8;            // reads in flight (and buffers in the ring)
+    bool uring = true;                   // false: always the synchronous path
+};
+
+struct ReadStats {
+    size_t bytes = 0;
+    double ms = 0.0;
+    bool uring = false;           // false when the synchronous path was used
+    bool fixed_buffers = false;   // buffers registered (RLIMIT_MEMLOCK permitting)
+    unsigned max_in_flight = 0;
+};
+
+// Whether this kernel can do io_uring reads (checked once).
+bool uring_available();
+
+// Calls on_block(data, size) with consecutive pieces of the file, in order,
+// while later reads are in flight. data is only valid during the call. A false
+// return stops the read (and the function returns false with err empty).
+bool stream_file(const std::string &path, const std::function<bool(const char *, size_t)> &on_block,
+                 std::string &err, const ReadOptions &opt = {}, ReadStats *stats = nullptr);
+
+// The whole file through stream_file.
+bool read_file_streamed(const std::string &path, std::string &buffer, std::string &err,
+                        const ReadOptions &opt = {}, ReadStats *stats = nullptr);
+
+// The whole file by mapping it and copying it out (for comparisons; false
+// where mmap is unavailable).
+bool read_file_mmap(const std::string &path, std::string &buffer, std::string &err);
+
+// Reads and parses an OBJ at the same time; mtllib paths are relative to the
+// file. stats covers the read (parsing continues for a while after it).
+bool load_obj_streaming(const std::string &path, tinyobj::MeshData &mesh, std::string &err,
+                        const ReadOptions &opt = {}, ReadStats *stats = nullptr);
+
+} // namespace gx
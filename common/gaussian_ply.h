@@ -0,0 +1,268 @@
+#pragma once
+// Reader/writer for Gaussian splat captures stored as PLY, in the layout written
+// by gaussian-splatting (x,y,z, nx,ny,nz, f_dc_*, f_rest_*, opacity, scale_*, rot_*).
+// Every vertex property is kept as a float so that unknown attributes survive a
+// round trip untouched.
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "page_alloc.h"
+
+namespace splat {
+
+struct SplatCloud {
+    std::vector<std::string> properties; // property names, file order
+    pages::Vector<float> data;           // properties.size() floats per splat
+
+    size_t stride() const { return properties.size(); }
+    size_t size() const { return properties.empty() ? 0 : data.size() / properties.size(); }
+    const float *splat(size_t i) const { return data.data() + i * stride(); }
+    float *splat(size_t i) { return data.data() + i * stride(); }
+
+    int find(const char *name) const {
+        for (size_t i = 0; i < properties.size(); ++i) {
+            if (properties[i] == name) return static_cast<int>(i);
+        }
+        return -1;
+    }
+};
+
+// Offsets of the properties the LOD builder interprets; everything else is
+// treated as an opaque attribute and averaged.
+struct SplatLayout {
+    int pos[3] = {-1, -1, -1};
+    int scale[3] = {-1, -1, -1}; // log-space
+    int rot[4] = {-1, -1, -1, -1}; // w,x,y,z (not necessarily normalized)
+    int opacity = -1;            // logit-space
+
+    bool valid() const {
+        for (int i = 0; i < 3; ++i) {
+            if (pos[i] < 0 || scale[i] < 0) return false;
+        }
+        for (int i = 0; i < 4; ++i) {
+            if (rot[i] < 0) return false;
+        }
+        return opacity >= 0;
+    }
+
+    static SplatLayout from(const SplatCloud &cloud) {
+        SplatLayout l;
+        const char *pos_names[3] = {"x", "y", "z"};
+        const char *scale_names[3] = {"scale_0", "scale_1", "scale_2"};
+        const char *rot_names[4] = {"rot_0", "rot_1", "rot_2", "rot_3"};
+        for (int i = 0; i < 3; ++i) {
+            l.pos[i] = cloud.find(pos_names[i]);
+            l.scale[i] = cloud.find(scale_names[i]);
+        }
+        for (int i = 0; i < 4; ++i) l.rot[i] = cloud.find(rot_names[i]);
+        l.opacity = cloud.find("opacity");
+        return l;
+    }
+};
+
+namespace detail {
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+inline PlyType parse_type(const std::string &t) {
+    if (t == "char" || t == "int8") return PlyType::Int8;
+    if (t == "uchar" || t == "uint8") return PlyType::UInt8;
+    if (t == "short" || t == "int16") return PlyType::Int16;
+    if (t == "ushort" || t == "uint16") return PlyType::UInt16;
+    if (t == "int" || t == "int32") return PlyType::Int32;
+    if (t == "uint" || t == "uint32") return PlyType::UInt32;
+    if (t == "float" || t == "float32") return PlyType::Float32;
+    if (t == "double" || t == "float64") return PlyType::Float64;
+    return PlyType::Invalid;
+}
+
+inline size_t type_size(PlyType t) {
+    switch (t) {
+    case PlyType::Int8: case PlyType::UInt8: return 1;
+    case PlyType::Int16: case PlyType::UInt16: return 2;
+    case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+    case PlyType::Float64: return 8;
+    default: return 0;
+    }
+}
+
+template <typename T>
+inline float load_as_float(const unsigned char *p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return static_cast<float>(v);
+}
+
+inline float decode(PlyType t, const unsigned char *p) {
+    switch (t) {
+    case PlyType::Int8: return load_as_float<int8_t>(p);
+    case PlyType::UInt8: return load_as_float<uint8_t>(p);
+    case PlyType::Int16: return load_as_float<int16_t>(p);
+    case PlyType::UInt16: return load_as_float<uint16_t>(p);
+    case PlyType::Int32: return load_as_float<int32_t>(p);
+    case PlyType::UInt32: return load_as_float<uint32_t>(p);
+    case PlyType::Float32: return load_as_float<float>(p);
+    case PlyType::Float64: return load_as_float<double>(p);
+    default: return 0.0f;
+    }
+}
+} // namespace detail
+
+inline bool LoadPly(SplatCloud &cloud, const std::string &filename, std::string &err) {
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) {
+        err = "Cannot open file: " + filename;
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(ifs, line) || line.compare(0, 3, "ply") != 0) {
+        err = "Not a PLY file: " + filename;
+        return false;
+    }
+
+    bool ascii = false;
+    bool in_vertex = false;
+    bool seen_vertex = false;
+    size_t vertex_count = 0;
+    std::vector<detail::PlyType> types;
+    cloud.properties.clear();
+    cloud.data.clear();
+
+    while (std::getline(ifs, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::istringstream iss(line);
+        std::string kw;
+        iss >> kw;
+        if (kw == "end_header") break;
+        if (kw == "format") {
+            std::string fmt;
+            iss >> fmt;
+            if (fmt == "ascii") {
+                ascii = true;
+            } else if (fmt != "binary_little_endian") {
+                err = "Unsupported PLY format: " + fmt;
+                return false;
+            }
+        } else if (kw == "element") {
+            std::string name;
+            size_t count = 0;
+            iss >> name >> count;
+            if (name == "vertex") {
+                in_vertex = true;
+                seen_vertex = true;
+                vertex_count = count;
+            } else {
+                if (!seen_vertex) {
+                    err = "PLY element before vertex is not supported: " + name;
+                    return false;
+                }
+                in_vertex = false; // trailing elements are ignored
+            }
+        } else if (kw == "property" && in_vertex) {
+            std::string type, name;
+            iss >> type;
+            if (type == "list") {
+                err = "List properties are not supported on vertices";
+                return false;
+            }
+            iss >> name;
+            detail::PlyType t = detail::parse_type(type);
+            if (t == detail::PlyType::Invalid) {
+                err = "Unknown PLY property type: " + type;
+                return false;
+            }
+            types.push_back(t);
+            cloud.properties.push_back(name);
+        }
+    }
+
+    if (!seen_vertex || cloud.properties.empty()) {
+        err = "PLY has no vertex properties: " + filename;
+        return false;
+    }
+
+    const size_t stride = cloud.properties.size();
+    size_t record = 0;
+    bool all_float = true;
+    for (auto t : types) {
+        record += detail::type_size(t);
+        all_float = all_float && t == detail::PlyType::Float32;
+    }
+
+    // The header's count is checked against the bytes that follow it before
+    // anything is allocated: a binary vertex takes record bytes, an ASCII
+    // value at least one character and a separator
+    const std::streamoff data_start = ifs.tellg();
+    ifs.seekg(0, std::ios::end);
+    const std::streamoff data_end = ifs.tellg();
+    ifs.seekg(data_start);
+    const size_t remaining = data_start >= 0 && data_end > data_start ? static_cast<size_t>(data_end - data_start) : 0;
+    if (vertex_count > (ascii ? (remaining + 1) / (2 * stride) : remaining / record)) {
+        err = "PLY vertex count exceeds the file size: " + filename;
+        return false;
+    }
+    cloud.data.resize(vertex_count * stride);
+
+    if (ascii) {
+        for (size_t i = 0; i < vertex_count * stride; ++i) {
+            double v = 0.0;
+            if (!(ifs >> v)) {
+                err = "Truncated ASCII PLY: " + filename;
+                return false;
+            }
+            cloud.data[i] = static_cast<float>(v);
+        }
+        return true;
+    }
+
+    if (all_float) {
+        // Fast path for the usual gaussian-splatting output
+        ifs.read(reinterpret_cast<char *>(cloud.data.data()), static_cast<std::streamsize>(cloud.data.size() * sizeof(float)));
+        if (static_cast<size_t>(ifs.gcount()) != cloud.data.size() * sizeof(float)) {
+            err = "Truncated binary PLY: " + filename;
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<unsigned char> buf(record);
+    for (size_t i = 0; i < vertex_count; ++i) {
+        ifs.read(reinterpret_cast<char *>(buf.data()), static_cast<std::streamsize>(record));
+        if (static_cast<size_t>(ifs.gcount()) != record) {
+            err = "Truncated binary PLY: " + filename;
+            return false;
+        }
+        const unsigned char *p = buf.data();
+        float *dst = cloud.splat(i);
+        for (size_t k = 0; k < stride; ++k) {
+            dst[k] = detail::decode(types[k], p);
+            p += detail::type_size(types[k]);
+        }
+    }
+    return true;
+}
+
+inline bool SavePly(const SplatCloud &cloud, const std::string &filename, std::string &err) {
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs) {
+        err = "Cannot write file: " + filename;
+        return false;
+    }
+    ofs << "ply\nformat binary_little_endian 1.0\n";
+    ofs << "element vertex " << cloud.size() << "\n";
+    for (const auto &p : cloud.properties) ofs << "property float " << p << "\n";
+    ofs << "end_header\n";
+    ofs.write(reinterpret_cast<const char *>(cloud.data.data()), static_cast<std::streamsize>(cloud.data.size() * sizeof(float)));
+    if (!ofs) {
+        err = "Write failed: " + filename;
+        return false;
+    }
+    return true;
+}
+
+} // namespace splat
@@ -0,0 +1,86 @@
+#pragma once
+// Replays command_buffer.h commands on the GL thread. Like gl_mesh.h this needs
+// a GL loader header included first.
+
+#include <vector>
+
+#include "command_buffer.h"
+#include "trace.h"
+
+namespace gx {
+
+// Program and vertex array bindings that are already current are skipped, also
+// across buffers replayed with the same state. Runs of draws with no state
+// change in between are submitted as one glMultiDrawElements. Instanced draws
+// go out one by one (GL 3.3 has no multi-draw for them).
+struct ReplayState {
+    int32_t program = -1;
+    int32_t vao = -1;
+    std::vector<GLsizei> counts; // pending draws
+    std::vector<const void *> offsets;
+};
+
+inline void flush_draws(ReplayState &state) {
+    if (state.counts.empty()) return;
+    if (state.counts.size() == 1) {
+        glDrawElements(GL_TRIANGLES, state.counts[0], GL_UNSIGNED_INT, state.offsets[0]);
+    } else {
+        glMultiDrawElements(GL_TRIANGLES, state.counts.data(), GL_UNSIGNED_INT, state.offsets.data(),
+                            static_cast<GLsizei>(state.counts.size()));
+    }
+    state.counts.clear();
+    state.offsets.clear();
+}
+
+inline void replay(const CommandBuffer &cb, ReplayState &state) {
+    for (const Command &c : cb.commands()) {
+        if (c.op != CommandOp::DrawElements) flush_draws(state);
+        switch (c.op) {
+        case CommandOp::UseProgram:
+            if (state.program != c.handle) glUseProgram(static_cast<GLuint>(state.program = c.handle));
+            break;
+        case CommandOp::BindVertexArray:
+            if (state.vao != c.handle) glBindVertexArray(static_cast<GLuint>(state.vao = c.handle));
+            break;
+        case CommandOp::UniformMatrix4:
+            glUniformMatrix4fv(c.handle, 1, GL_FALSE, cb.payload(c.a));
+            break;
+        case CommandOp::Uniform3f:
+            glUniform3fv(c.handle, 1, cb.payload(c.a));
+            break;
+        case CommandOp::Uniform4f:
+            glUniform4fv(c.handle, 1, cb.payload(c.a));
+            break;
+        case CommandOp::Uniform1f:
+            glUniform1f(c.handle, *cb.payload(c.a));
+            break;
+        case CommandOp::Uniform1i:
+            glUniform1i(c.handle, static_cast<GLint>(c.a));
+            break;
+        case CommandOp::DrawElements:
+            state.counts.push_back(static_cast<GLsizei>(c.a));
+            state.offsets.push_back((const void *)(static_cast<size_t>(c.b) * sizeof(GLuint)));
+            break;
+        case CommandOp::DrawElementsInstanced:
+            glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(c.a), GL_UNSIGNED_INT,
+                                    (const void *)(static_cast<size_t>(c.b) * sizeof(GLuint)), c.handle);
+            break;
+        }
+    }
+}
+
+inline void replay(const CommandBuffer &cb) {
+    ReplayState state;
+    replay(cb, state);
+    flush_draws(state);
+}
+
+// Replays every buffer of the recorder in chunk order.
+inline void replay(const ParallelRecorder &recorder) {
+    TRACE_SCOPE("replay_commands");
+    ReplayState state;
+    for (const CommandBuffer &cb : recorder) replay(cb, state);
+    flush_draws(state);
+}
+
+} // namespace gx
@@ -0,0 +1,150 @@
+#pragma once
+// Indexed mesh whose vertices change at runtime (deform.h). One VBO per frame
+// in flight plus one (each with its own VAO, sharing the index buffer) in
+// rotation: a frame's changes go into the next buffer, which also receives the
+// ranges it missed since it was last current. The FrameRing guarantees that
+// buffer is no longer read by the GPU. With ARB_buffer_storage the buffers are mapped
+// persistently and ranges are plain copies; otherwise every range is written
+// through an unsynchronized glMapBufferRange. Like gl_mesh.h this needs a GL
+// loader header (GLEW for the persistent path) first.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "deform.h"
+#include "gl_frame_ring.h"
+#include "gl_mesh.h"
+#include "mesh_utils.h"
+#include "trace.h"
+
+namespace gx {
+
+struct DynamicGpuMesh {
+    std::vector<GLuint> vao, vbo; // one per copy
+    GLuint ebo = 0;
+    GLsizei index_count = 0;
+    size_t bytes = 0;
+    std::vector<float *> mapped;                // persistent mappings
+    std::vector<uint64_t> retired;              // frame each copy stopped being current
+    std::vector<std::vector<DirtyRange>> pending; // changes a copy has not received
+    int current = 0;                            // copy to draw
+};
+
+inline bool persistent_mapping_supported() {
+#ifdef GLEW_ARB_buffer_storage
+    return GLEW_ARB_buffer_storage;
+#else
+    return false;
+#endif
+}
+
+// copies: FrameRing::copies() of the ring passed to update_dynamic_mesh.
+inline DynamicGpuMesh upload_dynamic_mesh(const pages::Vector<float> &interleaved, const pages::Vector<unsigned int> &indices,
+                                          int copies) {
+    TRACE_SCOPE("upload");
+    DynamicGpuMesh gpu;
+    const int n = std::max(copies, 1);
+    gpu.vao.resize(n);
+    gpu.vbo.resize(n);
+    gpu.mapped.assign(n, nullptr);
+    gpu.retired.assign(n, 0);
+    gpu.pending.resize(n);
+    gpu.index_count = static_cast<GLsizei>(indices.size());
+    gpu.bytes = interleaved.size() * sizeof(float);
+    const bool persistent = persistent_mapping_supported();
+    const GLbitfield map_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &gpu.ebo);
+    glGenBuffers(n, gpu.vbo.data());
+    glGenVertexArrays(n, gpu.vao.data());
+    for (int b = 0; b < n; ++b) {
+        glBindVertexArray(gpu.vao[b]);
+        glBindBuffer(GL_ARRAY_BUFFER, gpu.vbo[b]);
+        if (persistent) {
+            glBufferStorage(GL_ARRAY_BUFFER, gpu.bytes, interleaved.data(), map_flags);
+            gpu.mapped[b] = static_cast<float *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, gpu.bytes, map_flags));
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, gpu.bytes, interleaved.data(), GL_DYNAMIC_DRAW);
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.ebo);
+        if (b == 0) {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        }
+        const GLsizei stride = static_cast<GLsizei>(kVertexStride * sizeof(float));
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void *)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+    glVertexAttrib1f(kAoLocation, 1.0f); // deformed vertices have no baked AO
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return gpu;
+}
+
+// Publishes the changed vertex ranges of interleaved: uploads them, plus what
+// the next copy missed, into the next copy and makes it current. Returns the
+// bytes uploaded. Without changes the current copy stays as it is.
+inline size_t update_dynamic_mesh(DynamicGpuMesh &gpu, FrameRing &ring, const pages::Vector<float> &interleaved,
+                                  const std::vector<DirtyRange> &ranges) {
+    if (ranges.empty()) return 0;
+    TRACE_SCOPE("upload_ranges");
+    const int copies = static_cast<int>(gpu.vbo.size());
+    const int next = (gpu.current + 1) % copies;
+    for (auto &p : gpu.pending) p.insert(p.end(), ranges.begin(), ranges.end());
+
+    // Returns at once with FrameRing::copies() copies
+    ring.wait_for(gpu.retired[next]);
+
+    std::vector<DirtyRange> &todo = gpu.pending[next];
+    std::sort(todo.begin(), todo.end(), [](const DirtyRange &a, const DirtyRange &b) { return a.first < b.first; });
+    size_t merged = 0;
+    for (size_t i = 1; i < todo.size(); ++i) {
+        DirtyRange &last = todo[merged];
+        if (todo[i].first <= last.first + last.count) {
+            last.count = std::max(last.count, todo[i].first + todo[i].count - last.first);
+        } else {
+            todo[++merged] = todo[i];
+        }
+    }
+    todo.resize(todo.empty() ? 0 : merged + 1);
+
+    const size_t vertex_bytes = kVertexStride * sizeof(float);
+    size_t uploaded = 0;
+    if (!gpu.mapped[next]) glBindBuffer(GL_ARRAY_BUFFER, gpu.vbo[next]);
+    for (const DirtyRange &r : todo) {
+        const size_t offset = r.first * vertex_bytes, len = r.count * vertex_bytes;
+        const float *src = interleaved.data() + r.first * kVertexStride;
+        if (gpu.mapped[next]) {
+            std::memcpy(gpu.mapped[next] + r.first * kVertexStride, src, len);
+        } else if (void *dst = glMapBufferRange(GL_ARRAY_BUFFER, offset, len,
+                                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT)) {
+            std::memcpy(dst, src, len);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        uploaded += len;
+    }
+    if (!gpu.mapped[next]) glBindBuffer(GL_ARRAY_BUFFER, 0);
+    todo.clear();
+    gpu.retired[gpu.current] = ring.frame(); // may still be drawn this frame
+    gpu.current = next;
+    return uploaded;
+}
+
+inline void destroy_dynamic_mesh(DynamicGpuMesh &gpu) {
+    for (size_t b = 0; b < gpu.vbo.size(); ++b) {
+        if (gpu.mapped[b]) {
+            glBindBuffer(GL_ARRAY_BUFFER, gpu.vbo[b]);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(static_cast<GLsizei>(gpu.vbo.size()), gpu.vbo.data());
+    glDeleteBuffers(1, &gpu.ebo);
+    glDeleteVertexArrays(static_cast<GLsizei>(gpu.vao.size()), gpu.vao.data());
+    gpu = DynamicGpuMesh{};
+}
+
+} // namespace gx
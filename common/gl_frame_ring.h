@@ -0,0 +1,96 @@
+#pragma once
+// Frames in flight: the CPU may prepare up to N frames ahead of the GPU. Each
+// frame gets a fence when it has been submitted; begin_frame() waits for the
+// fence of the frame N back, so at most N frames are queued and everything
+// that frame used may be rewritten.
+//
+// Dynamic buffers keep copies_for(N) = N + 1 copies (or regions) and rotate
+// through them when their contents change (gl_dynamic_mesh.h, gl_splats.h,
+// gl_impostor.h). A copy replaced in frame F is still drawn in F, so it is
+// free once wait_for(F) returns. Updating every frame, the next copy was
+// replaced N frames back, whose fence begin_frame() has already waited for,
+// so wait_for does not block. With only N copies it would wait on the
+// previous frame and the ring would overlap a single frame.
+// Writes then go through unsynchronized mappings instead of making the driver
+// wait or orphan. Like gl_mesh.h this needs a GL loader header first.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "trace.h"
+
+namespace gx {
+
+class FrameRing {
+public:
+    static constexpr int kMaxFrames = 4;
+
+    explicit FrameRing(int frames = 2)
+        : frames_(std::clamp(frames, 1, kMaxFrames)), fences_(frames_, nullptr), serials_(frames_, 0) {}
+    ~FrameRing() {
+        for (GLsync f : fences_) {
+            if (f) glDeleteSync(f);
+        }
+    }
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    int frames() const { return frames_; }
+    // Copies a rotating buffer needs so that reusing one never waits
+    static int copies_for(int frames) { return std::clamp(frames, 1, kMaxFrames) + 1; }
+    int copies() const { return frames_ + 1; }
+    // Serial of the frame being prepared (starts at 1) and its slot
+    uint64_t frame() const { return frame_; }
+    int slot() const { return static_cast<int>(frame_ % frames_); }
+
+    // Waits until the frame that last used this slot has finished on the GPU.
+    // Returns the time spent waiting in milliseconds.
+    double begin_frame() {
+        const auto t0 = std::chrono::steady_clock::now();
+        wait_slot(slot());
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // Call after the frame's last GL command (after swapping buffers).
+    void end_frame() {
+        GLsync &fence = fences_[slot()];
+        if (fence) glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        serials_[slot()] = frame_;
+        ++frame_;
+    }
+
+    // Blocks until the GPU has finished frame serial. Frames that have not
+    // been submitted yet (the current one) are waited for with glFinish.
+    void wait_for(uint64_t serial) {
+        if (serial == 0 || serial + frames_ <= frame_) return; // completed: its slot was reused
+        if (serial >= frame_) {
+            TRACE_SCOPE("frame_ring_finish");
+            glFinish();
+            return;
+        }
+        const int s = static_cast<int>(serial % frames_);
+        if (serials_[s] == serial) wait_slot(s);
+    }
+
+private:
+    void wait_slot(int s) {
+        GLsync &fence = fences_[s];
+        if (!fence) return;
+        TRACE_SCOPE("frame_ring_wait");
+        // The flush makes sure the fence reaches the GPU; retry on timeouts
+        GLenum r = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+        while (r == GL_TIMEOUT_EXPIRED) r = glClientWaitSync(fence, 0, GLuint64(1000000000));
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    int frames_;
+    uint64_t frame_ = 1;
+    std::vector<GLsync> fences_;
+    std::vector<uint64_t> serials_; // frame each fence belongs to
+};
+
+} // namespace gx
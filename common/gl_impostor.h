@@ -0,0 +1,388 @@
+#pragma once
+// Impostors for distant copies of a mesh (GL 3.3). At load time the mesh is
+// rendered orthographically from views x views directions into an atlas, one
+// cell per direction. The directions are the cell centers of an octahedral
+// map of the sphere, so the nearest baked view of any direction is found by
+// encoding it and rounding to a cell. Each view is drawn inside a cleared
+// gutter of its cell and the mip chain is capped to match, so filtered
+// lookups stay within one view. The atlas keeps what the mesh shader needs
+// to light a pixel under any model rotation:
+//
+//   albedo        diffuse.rgb, coverage
+//   ambient       0.4 * diffuse + ambient (the view-independent terms)
+//   normal_depth  model-space normal * 0.5 + 0.5, height above the view plane
+//
+// A copy far enough away is drawn as one quad facing its nearest baked view;
+// the fragment shader relights it and writes the baked depth, so impostors and
+// meshes intersect correctly. Specular highlights are dropped. Copies are
+// model-space offsets streamed per frame into a ring of regions (one per frame
+// in flight plus one, see gl_frame_ring.h). Like gl_mesh.h this needs a GL loader
+// header first.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "gl_frame_ring.h"
+#include "gl_program.h"
+#include "math3d.h"
+#include "octahedral.h"
+#include "trace.h"
+
+namespace gx {
+
+// Direction of an octahedral map point (octahedral.h)
+inline Vec3 oct_direction(float u, float v) {
+    float n[3];
+    oct_decode(u, v, n);
+    return Vec3(n[0], n[1], n[2]);
+}
+
+// Camera position in model space, for modelviews built from rotations,
+// translations and one uniform scale (the inverse is the transpose over s^2).
+inline Vec3 eye_in_model(const Mat4 &modelview) {
+    const float *m = modelview.m;
+    const Vec3 t(m[12], m[13], m[14]);
+    const float s2 = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+    if (!(s2 > 0.0f)) return Vec3();
+    return Vec3(-dot(Vec3(m[0], m[1], m[2]), t), -dot(Vec3(m[4], m[5], m[6]), t), -dot(Vec3(m[8], m[9], m[10]), t)) / s2;
+}
+
+// Shared by the bake (C++) and the impostor shader (GLSL): the plane of a
+// view is spanned by right and up, dir points at the camera.
+inline void impostor_basis(const Vec3 &dir, Vec3 &right, Vec3 &up) {
+    const Vec3 ref = std::fabs(dir.y) < 0.99f ? Vec3(0.0f, 1.0f, 0.0f) : Vec3(0.0f, 0.0f, 1.0f);
+    right = normalize(cross(ref, dir));
+    up = cross(dir, right);
+}
+
+inline const char *kImpostorBakeVertexShader = R"( #version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 3) in float aAo; // baked AO (gl_mesh.h kAoLocation), else 1
+
+uniform mat4 u_mvp;
+
+out vec3 vPos;
+out vec3 vNormal;
+out float vAo;
+
+void main() {
+    vPos = aPos;
+    vNormal = aNormal;
+    vAo = aAo;
+    gl_Position = u_mvp * vec4(aPos, 1.0);
+}
+)";
+
+inline const char *kImpostorBakeFragmentShader = R"( #version 330 core
+in vec3 vPos;
+in vec3 vNormal;
+in float vAo;
+layout(location = 0) out vec4 Albedo;
+layout(location = 1) out vec4 Ambient;
+layout(location = 2) out vec4 NormalDepth;
+
+uniform samplerBuffer u_materials;
+uniform int u_material;
+uniform vec3 u_center;
+uniform vec3 u_dir;
+uniform float u_radius;
+
+void main() {
+    vec3 diffuse = texelFetch(u_materials, u_material * 3).rgb;
+    vec3 ambient = texelFetch(u_materials, u_material * 3 + 2).rgb;
+    float height = dot(vPos - u_center, u_dir) / u_radius;
+    Albedo = vec4(diffuse, 1.0);
+    Ambient = vec4((0.4 * diffuse + ambient) * vAo, 1.0);
+    NormalDepth = vec4(normalize(vNormal) * 0.5 + 0.5, clamp(height, -1.0, 1.0) * 0.5 + 0.5);
+}
+)";
+
+inline const char *kImpostorVertexShader = R"( #version 330 core
+layout(location = 0) in vec3 aOffset; // model-space position of the copy
+
+uniform mat4 u_mvp;
+uniform vec3 u_camera; // model space
+uniform vec3 u_center;
+uniform float u_radius;
+uniform int u_views;
+uniform float u_inset; // gutter around each view, fraction of a cell
+
+out vec2 vUv;
+out vec3 vPos;
+flat out vec3 vDir;
+
+vec2 oct_encode(vec3 d) {
+    vec2 p = d.xy / (abs(d.x) + abs(d.y) + abs(d.z));
+    if (d.z < 0.0) p = (1.0 - abs(p.yx)) * vec2(p.x >= 0.0 ? 1.0 : -1.0, p.y >= 0.0 ? 1.0 : -1.0);
+    return p;
+}
+
+vec3 oct_decode(vec2 p) {
+    vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+void main() {
+    vec3 center = u_center + aOffset;
+    ivec2 cell = clamp(ivec2(floor((oct_encode(normalize(u_camera - center)) * 0.5 + 0.5) * float(u_views))),
+                       ivec2(0), ivec2(u_views - 1));
+    vec3 dir = oct_decode((vec2(cell) + 0.5) / float(u_views) * 2.0 - 1.0);
+    vec3 right = normalize(cross(abs(dir.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(0.0, 0.0, 1.0), dir));
+    vec3 up = cross(dir, right);
+
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+    vUv = (vec2(cell) + u_inset + (corner * 0.5 + 0.5) * (1.0 - 2.0 * u_inset)) / float(u_views);
+    vPos = center + (right * corner.x + up * corner.y) * u_radius;
+    vDir = dir;
+    gl_Position = u_mvp * vec4(vPos, 1.0);
+}
+)";
+
+inline const char *kImpostorFragmentShader = R"( #version 330 core
+in vec2 vUv;
+in vec3 vPos;
+flat in vec3 vDir;
+out vec4 FragColor;
+
+uniform sampler2D u_albedo;
+uniform sampler2D u_ambient;
+uniform sampler2D u_normal_depth;
+uniform mat4 u_mvp;
+uniform mat4 u_model;
+uniform float u_radius;
+
+void main() {
+    vec4 albedo = texture(u_albedo, vUv);
+    if (albedo.a < 0.5) discard;
+    vec4 nd = texture(u_normal_depth, vUv);
+    vec4 clip = u_mvp * vec4(vPos + vDir * ((nd.w * 2.0 - 1.0) * u_radius), 1.0);
+    gl_FragDepth = clamp(clip.z / clip.w * 0.5 + 0.5, 0.0, 1.0);
+
+    // Lit like the mesh shader, without the highlight
+    vec3 N = normalize(mat3(u_model) * (nd.xyz * 2.0 - 1.0));
+    vec3 L = normalize(vec3(0.3, 1.0, 0.2));
+    float ndl = max(dot(N, L), 0.0);
+    vec3 color = texture(u_ambient, vUv).rgb + albedo.rgb * 0.6 * ndl;
+    FragColor = vec4(color, 1.0);
+}
+)";
+
+struct ImpostorAtlas {
+    GLuint albedo = 0, ambient = 0, normal_depth = 0;
+    GLuint program = 0; // kImpostorVertexShader / kImpostorFragmentShader
+    int views = 0;      // views x views directions
+    int cell = 0;       // pixels per view
+    int gutter = 0;     // cleared pixels around each view, inside its cell
+    Vec3 center;
+    float radius = 0.0f;
+    double bake_ms = 0.0;
+};
+
+// Renders the atlas around the bounding sphere (center, radius). draw(program)
+// issues the mesh's draw calls with the bake program bound and u_mvp set; it
+// sets u_material per range like the mesh shader, from the material table on
+// texture unit materials_unit (gl_materials.h). Leaves framebuffer 0 bound;
+// the caller restores the viewport.
+template <typename F>
+inline ImpostorAtlas bake_impostors(const Vec3 &center, float radius, GLint materials_unit, F &&draw, int views = 8,
+                                    int cell = 128) {
+    TRACE_SCOPE("bake_impostors");
+    const auto t0 = std::chrono::steady_clock::now();
+    ImpostorAtlas atlas;
+    atlas.views = views;
+    atlas.cell = cell;
+    // Mip levels stop where the gutter shrinks to one texel, so trilinear
+    // filtering never reaches into the neighbouring views
+    atlas.gutter = std::max(1, cell / 16);
+    int max_level = 0;
+    while ((atlas.gutter >> (max_level + 1)) > 0) ++max_level;
+    atlas.center = center;
+    atlas.radius = radius;
+    atlas.program = create_program(kImpostorVertexShader, kImpostorFragmentShader);
+    const GLuint bake = create_program(kImpostorBakeVertexShader, kImpostorBakeFragmentShader);
+    if (!atlas.program || !bake || !(radius > 0.0f)) {
+        if (bake) glDeleteProgram(bake);
+        return atlas;
+    }
+
+    const GLsizei size = views * cell;
+    GLuint *textures[3] = {&atlas.albedo, &atlas.ambient, &atlas.normal_depth};
+    GLuint fbo = 0, depth = 0;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    for (int i = 0; i < 3; ++i) {
+        glGenTextures(1, textures[i]);
+        glBindTexture(GL_TEXTURE_2D, *textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, max_level);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, *textures[i], 0);
+    }
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    const GLenum buffers[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+    glDrawBuffers(3, buffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+        const float clear_albedo[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        const float clear_normal[4] = {0.5f, 0.5f, 0.5f, 0.5f};
+        glClearBufferfv(GL_COLOR, 0, clear_albedo);
+        glClearBufferfv(GL_COLOR, 1, clear_albedo);
+        glClearBufferfv(GL_COLOR, 2, clear_normal);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        glUseProgram(bake);
+        glUniform1i(glGetUniformLocation(bake, "u_materials"), materials_unit);
+        glUniform3f(glGetUniformLocation(bake, "u_center"), center.x, center.y, center.z);
+        glUniform1f(glGetUniformLocation(bake, "u_radius"), radius);
+        const GLint loc_mvp = glGetUniformLocation(bake, "u_mvp");
+        const GLint loc_dir = glGetUniformLocation(bake, "u_dir");
+        for (int j = 0; j < views; ++j) {
+            for (int i = 0; i < views; ++i) {
+                const Vec3 dir = oct_direction((i + 0.5f) / views * 2.0f - 1.0f, (j + 0.5f) / views * 2.0f - 1.0f);
+                Vec3 right, up;
+                impostor_basis(dir, right, up);
+                // Orthographic onto the view plane: x along right, y along
+                // up, depth from +radius (nearest) to -radius along dir
+                const float s = 1.0f / radius;
+                const Mat4 mvp = {{right.x * s, up.x * s, -dir.x * s, 0.0f,
+                                   right.y * s, up.y * s, -dir.y * s, 0.0f,
+                                   right.z * s, up.z * s, -dir.z * s, 0.0f,
+                                   -dot(right, center) * s, -dot(up, center) * s, dot(dir, center) * s, 1.0f}};
+                const int g = atlas.gutter;
+                glViewport(i * cell + g, j * cell + g, cell - 2 * g, cell - 2 * g);
+                glUniformMatrix4fv(loc_mvp, 1, GL_FALSE, mvp.m);
+                glUniform3f(loc_dir, dir.x, dir.y, dir.z);
+                draw(bake);
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            glBindTexture(GL_TEXTURE_2D, *textures[i]);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+    } else {
+        std::cerr << "Impostor atlas framebuffer incomplete" << std::endl;
+        glDeleteProgram(atlas.program);
+        atlas.program = 0;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(1, &depth);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteProgram(bake);
+    glFinish();
+    atlas.bake_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return atlas;
+}
+
+// Model-space offsets of the copies drawn this frame: meshes first, then
+// impostors. The VAO draws impostors from its region; the mesh VAO gets the
+// same buffer as instanced attribute 2 (bind_instance_offsets).
+struct GpuInstances {
+    GLuint vao = 0, buffer = 0;
+    size_t capacity = 0;                 // offsets per region
+    int region = 0;                      // region written last
+    std::vector<uint64_t> retired;       // frame each region stopped being read
+};
+
+// regions: FrameRing::copies() of the ring passed to update_instances.
+inline GpuInstances create_instances(size_t capacity, int regions) {
+    GpuInstances gpu;
+    gpu.capacity = capacity;
+    gpu.retired.assign(std::max(regions, 1), 0);
+    glGenVertexArrays(1, &gpu.vao);
+    glGenBuffers(1, &gpu.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.buffer);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Vec3) * gpu.retired.size(), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return gpu;
+}
+
+// Writes offsets into the next region without synchronizing (the ring makes
+// sure no queued frame reads it); returns the region's byte offset.
+inline size_t update_instances(GpuInstances &gpu, FrameRing &ring, const std::vector<Vec3> &offsets) {
+    TRACE_SCOPE("upload_instances");
+    const int regions = static_cast<int>(gpu.retired.size());
+    const int next = (gpu.region + 1) % regions;
+    ring.wait_for(gpu.retired[next]);
+    const size_t bytes = std::min(offsets.size(), gpu.capacity) * sizeof(Vec3);
+    const size_t offset = static_cast<size_t>(next) * gpu.capacity * sizeof(Vec3);
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.buffer);
+    if (bytes) {
+        if (void *dst = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT)) {
+            std::memcpy(dst, offsets.data(), bytes);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    gpu.retired[gpu.region] = ring.frame();
+    gpu.region = next;
+    return offset;
+}
+
+// Points attribute location of vao at the offsets starting at byte offset,
+// advancing once per instance.
+inline void bind_instance_offsets(GLuint vao, GLuint location, const GpuInstances &gpu, size_t offset) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.buffer);
+    glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(Vec3), (void *)offset);
+    glVertexAttribDivisor(location, 1);
+    glEnableVertexAttribArray(location);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// count impostors from the offsets bound to gpu.vao; mvp and model as for the
+// mesh, camera from eye_in_model(modelview). Texture units first_unit..+2.
+inline void draw_impostors(const ImpostorAtlas &atlas, const GpuInstances &gpu, GLsizei count, const Mat4 &mvp,
+                           const Mat4 &model, const Vec3 &camera, GLuint first_unit = 2) {
+    if (!count || !atlas.program) return;
+    const GLuint p = atlas.program;
+    glUseProgram(p);
+    const GLuint textures[3] = {atlas.albedo, atlas.ambient, atlas.normal_depth};
+    const char *names[3] = {"u_albedo", "u_ambient", "u_normal_depth"};
+    for (GLuint i = 0; i < 3; ++i) {
+        glActiveTexture(GL_TEXTURE0 + first_unit + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glUniform1i(glGetUniformLocation(p, names[i]), static_cast<GLint>(first_unit + i));
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glUniformMatrix4fv(glGetUniformLocation(p, "u_mvp"), 1, GL_FALSE, mvp.m);
+    glUniformMatrix4fv(glGetUniformLocation(p, "u_model"), 1, GL_FALSE, model.m);
+    glUniform3f(glGetUniformLocation(p, "u_camera"), camera.x, camera.y, camera.z);
+    glUniform3f(glGetUniformLocation(p, "u_center"), atlas.center.x, atlas.center.y, atlas.center.z);
+    glUniform1f(glGetUniformLocation(p, "u_radius"), atlas.radius);
+    glUniform1i(glGetUniformLocation(p, "u_views"), atlas.views);
+    glUniform1f(glGetUniformLocation(p, "u_inset"), static_cast<float>(atlas.gutter) / static_cast<float>(atlas.cell));
+    glBindVertexArray(gpu.vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    glBindVertexArray(0);
+}
+
+inline void destroy_impostors(ImpostorAtlas &atlas) {
+    const GLuint textures[3] = {atlas.albedo, atlas.ambient, atlas.normal_depth};
+    glDeleteTextures(3, textures);
+    if (atlas.program) glDeleteProgram(atlas.program);
+    atlas = ImpostorAtlas{};
+}
+
+inline void destroy_instances(GpuInstances &gpu) {
+    glDeleteBuffers(1, &gpu.buffer);
+    glDeleteVertexArrays(1, &gpu.vao);
+    gpu = GpuInstances{};
+}
+
+} // namespace gx
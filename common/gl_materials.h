@@ -0,0 +1,56 @@
+#pragma once
+// OBJ/MTL materials as a texture buffer (GL 3.3 has no SSBOs). Every material
+// is kTexelsPerMaterial RGBA32F texels, which the shader fetches with
+// texelFetch(u_materials, u_material * 3 + k):
+//   0: diffuse.rgb, opacity   1: specular.rgb, shininess   2: ambient.rgb, 0
+// Like gl_mesh.h this needs a GL loader header included first.
+
+#include <vector>
+
+#include "tiny_obj_loader.h"
+#include "trace.h"
+
+namespace gx {
+
+constexpr int kTexelsPerMaterial = 3;
+
+struct GpuMaterials {
+    GLuint buffer = 0, texture = 0;
+    GLsizei count = 0;
+};
+
+inline GpuMaterials upload_materials(const std::vector<tinyobj::Material> &materials) {
+    TRACE_SCOPE("upload_materials");
+    std::vector<float> texels;
+    texels.reserve(materials.size() * kTexelsPerMaterial * 4);
+    for (const tinyobj::Material &m : materials) {
+        texels.insert(texels.end(), {m.diffuse[0], m.diffuse[1], m.diffuse[2], m.opacity});
+        texels.insert(texels.end(), {m.specular[0], m.specular[1], m.specular[2], m.shininess});
+        texels.insert(texels.end(), {m.ambient[0], m.ambient[1], m.ambient[2], 0.0f});
+    }
+    GpuMaterials gpu;
+    gpu.count = static_cast<GLsizei>(materials.size());
+    glGenBuffers(1, &gpu.buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, gpu.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(float), texels.data(), GL_STATIC_DRAW);
+    glGenTextures(1, &gpu.texture);
+    glBindTexture(GL_TEXTURE_BUFFER, gpu.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, gpu.buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    return gpu;
+}
+
+inline void bind_materials(const GpuMaterials &gpu, GLuint unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, gpu.texture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+inline void destroy_materials(GpuMaterials &gpu) {
+    glDeleteTextures(1, &gpu.texture);
+    glDeleteBuffers(1, &gpu.buffer);
+    gpu = GpuMaterials{};
+}
+
+} // namespace gx
@@ -0,0 +1,77 @@
+#pragma once
+// Static indexed mesh in GL buffers, laid out as interleaved kVertexStride
+// vertices (location 0: position, 1: normal) plus, when baked (ao_bake.h), a
+// second buffer with one ambient occlusion float per vertex (kAoLocation).
+// Without it the attribute reads the generic value 1 (no occlusion), so
+// shaders use aAo either way. Like gl_program.h this needs a GL loader
+// header included first.
+
+#include <vector>
+
+#include "alloc_tracker.h"
+#include "mesh_utils.h"
+#include "trace.h"
+
+namespace gx {
+
+constexpr GLuint kAoLocation = 3;
+
+struct GpuMesh {
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    GLuint ao_vbo = 0; // 0 without AO
+    GLsizei index_count = 0;
+};
+
+// vertex_count vertices of kVertexStride floats (also from a SharedMesh);
+// ao: vertex_count floats or null
+inline GpuMesh upload_mesh(const float *interleaved, size_t vertex_count, const unsigned int *indices,
+                           size_t index_count, const float *ao = nullptr) {
+    TRACE_SCOPE("upload");
+    ALLOC_PHASE("upload");
+    GpuMesh gpu;
+    gpu.index_count = static_cast<GLsizei>(index_count);
+    glGenVertexArrays(1, &gpu.vao);
+    glGenBuffers(1, &gpu.vbo);
+    glGenBuffers(1, &gpu.ebo);
+
+    glBindVertexArray(gpu.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertex_count * kVertexStride * sizeof(float), interleaved, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+
+    const GLsizei stride = static_cast<GLsizei>(kVertexStride * sizeof(float));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Generic attribute values are context state, not VAO state
+    glVertexAttrib1f(kAoLocation, 1.0f);
+    if (ao) {
+        glGenBuffers(1, &gpu.ao_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, gpu.ao_vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(float), ao, GL_STATIC_DRAW);
+        glVertexAttribPointer(kAoLocation, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void *)0);
+        glEnableVertexAttribArray(kAoLocation);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return gpu;
+}
+
+inline GpuMesh upload_mesh(const pages::Vector<float> &interleaved, const pages::Vector<unsigned int> &indices) {
+    return upload_mesh(interleaved.data(), interleaved.size() / kVertexStride, indices.data(), indices.size());
+}
+
+inline void destroy_mesh(GpuMesh &gpu) {
+    glDeleteBuffers(1, &gpu.vbo);
+    glDeleteBuffers(1, &gpu.ebo);
+    if (gpu.ao_vbo) glDeleteBuffers(1, &gpu.ao_vbo);
+    glDeleteVertexArrays(1, &gpu.vao);
+    gpu = GpuMesh{};
+}
+
+} // namespace gx
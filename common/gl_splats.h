@@ -0,0 +1,176 @@
+#pragma once
+// Gaussian splats drawn as instanced screen-aligned quads (GL 3.3). Per-splat
+// data (see splat_view.h) lives in a texture buffer; the only per-instance
+// attribute is the splat index, so publishing a new depth order is a single
+// index buffer upload, into one of a ring of regions (one per frame in flight
+// plus one, see gl_frame_ring.h). Like gl_mesh.h this needs a GL loader header first.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include "gl_frame_ring.h"
+#include "splat_view.h"
+#include "trace.h"
+
+namespace gx {
+
+// Projects each splat's 3D covariance through the local affine approximation
+// of the perspective (EWA splatting) and spans the quad over 3 sigma along the
+// eigenvectors of the resulting 2D covariance.
+inline const char *kSplatVertexShader = R"( #version 330 core
+layout(location = 0) in uint aIndex;
+
+uniform samplerBuffer u_splats;
+uniform mat4 u_modelview;
+uniform mat4 u_proj;
+uniform vec2 u_viewport; // pixels
+
+out vec4 vColor;
+out vec2 vOffset; // sigma units
+
+void main() {
+    int base = int(aIndex) * 4;
+    vec4 c0 = texelFetch(u_splats, base);
+    vec3 covA = texelFetch(u_splats, base + 1).xyz;
+    vec3 covB = texelFetch(u_splats, base + 2).xyz;
+    vColor = vec4(texelFetch(u_splats, base + 3).rgb, c0.w);
+
+    vec4 cam = u_modelview * vec4(c0.xyz, 1.0);
+    vec4 clip = u_proj * cam;
+    float d = -cam.z;
+    if (d <= 0.0 || any(greaterThan(abs(clip.xy), vec2(1.3 * clip.w)))) {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0); // behind or well outside: clipped
+        return;
+    }
+
+    mat3 cov = mat3(covA.x, covA.y, covA.z, covA.y, covB.x, covB.y, covA.z, covB.y, covB.z);
+    mat3 W = mat3(u_modelview);
+    mat3 V = W * cov * transpose(W);
+    vec2 focal = 0.5 * u_viewport * vec2(u_proj[0][0], u_proj[1][1]);
+    vec3 j0 = vec3(focal.x / d, 0.0, focal.x * cam.x / (d * d));
+    vec3 j1 = vec3(0.0, focal.y / d, focal.y * cam.y / (d * d));
+    float a = dot(j0, V * j0) + 0.3; // +0.3: at least about a pixel wide
+    float b = dot(j0, V * j1);
+    float c = dot(j1, V * j1) + 0.3;
+
+    float mid = 0.5 * (a + c);
+    float radius = length(vec2(0.5 * (a - c), b));
+    float l1 = mid + radius;
+    float l2 = max(mid - radius, 0.1);
+    vec2 axis = abs(b) > 1e-6 ? normalize(vec2(b, l1 - a)) : (a >= c ? vec2(1.0, 0.0) : vec2(0.0, 1.0));
+    vec2 major = min(3.0 * sqrt(l1), 1024.0) * axis;
+    vec2 minor = min(3.0 * sqrt(l2), 1024.0) * vec2(-axis.y, axis.x);
+
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+    vOffset = corner * 3.0;
+    vec2 px = corner.x * major + corner.y * minor;
+    gl_Position = vec4(clip.xy / clip.w + px * 2.0 / u_viewport, 0.0, 1.0);
+}
+)";
+
+inline const char *kSplatFragmentShader = R"( #version 330 core
+in vec4 vColor;
+in vec2 vOffset;
+out vec4 FragColor;
+
+void main() {
+    float alpha = vColor.a * exp(-0.5 * dot(vOffset, vOffset));
+    if (alpha < 1.0 / 255.0) discard;
+    FragColor = vec4(vColor.rgb, alpha);
+}
+)";
+
+struct GpuSplats {
+    GLuint vao = 0, data_buffer = 0, data_texture = 0, index_buffer = 0;
+    GLsizei count = 0;
+    int order_region = 0;                // region the VAO reads
+    std::vector<uint64_t> order_retired; // frame each region stopped being read
+};
+
+// regions: FrameRing::copies() of the ring passed to update_splat_order.
+inline GpuSplats upload_splats(const PackedSplats &splats, int regions) {
+    TRACE_SCOPE("upload");
+    GpuSplats gpu;
+    gpu.count = static_cast<GLsizei>(splats.size());
+    gpu.order_retired.assign(std::max(regions, 1), 0);
+
+    glGenBuffers(1, &gpu.data_buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, gpu.data_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, splats.data.size() * sizeof(float), splats.data.data(), GL_STATIC_DRAW);
+    glGenTextures(1, &gpu.data_texture);
+    glBindTexture(GL_TEXTURE_BUFFER, gpu.data_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, gpu.data_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // Unsorted until the sorter publishes its first order
+    std::vector<uint32_t> identity(splats.size());
+    std::iota(identity.begin(), identity.end(), 0u);
+    glGenVertexArrays(1, &gpu.vao);
+    glGenBuffers(1, &gpu.index_buffer);
+    glBindVertexArray(gpu.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.index_buffer);
+    const size_t region_bytes = identity.size() * sizeof(uint32_t);
+    glBufferData(GL_ARRAY_BUFFER, region_bytes * gpu.order_retired.size(), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, region_bytes, identity.data());
+    glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, 0, (void *)0);
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    return gpu;
+}
+
+// Replaces the draw order: writes it into the next region without
+// synchronizing (the ring makes sure no queued frame reads that region) and
+// points the VAO at it.
+inline void update_splat_order(GpuSplats &gpu, FrameRing &ring, const std::vector<uint32_t> &order) {
+    TRACE_SCOPE("upload_order");
+    const int regions = static_cast<int>(gpu.order_retired.size());
+    const int next = (gpu.order_region + 1) % regions;
+    ring.wait_for(gpu.order_retired[next]);
+    const size_t bytes = std::min<size_t>(order.size(), static_cast<size_t>(gpu.count)) * sizeof(uint32_t);
+    const size_t offset = static_cast<size_t>(next) * gpu.count * sizeof(uint32_t);
+    glBindVertexArray(gpu.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.index_buffer);
+    if (void *dst = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT)) {
+        std::memcpy(dst, order.data(), bytes);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, 0, (void *)offset);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    gpu.order_retired[gpu.order_region] = ring.frame();
+    gpu.order_region = next;
+}
+
+// Back-to-front "over" blending without depth writes; restores the mesh state.
+inline void draw_splats(const GpuSplats &gpu, GLuint program) {
+    glDepthMask(GL_FALSE);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, gpu.data_texture);
+    glUniform1i(glGetUniformLocation(program, "u_splats"), 0);
+    glBindVertexArray(gpu.vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, gpu.count);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+}
+
+inline void destroy_splats(GpuSplats &gpu) {
+    glDeleteTextures(1, &gpu.data_texture);
+    glDeleteBuffers(1, &gpu.data_buffer);
+    glDeleteBuffers(1, &gpu.index_buffer);
+    glDeleteVertexArrays(1, &gpu.vao);
+    gpu = GpuSplats{};
+}
+
+} // namespace gx
@@ -0,0 +1,106 @@
+#pragma once
+// A window-sized RGBA texture that is filled in tile by tile (TraceTile from
+// progressive_tracer.h) and blended over the frame with its alpha, so tiles
+// that have not arrived yet leave the raster image untouched (GL 3.3). Like
+// gl_mesh.h this needs a GL loader header first.
+
+#include <cstdint>
+#include <vector>
+
+#include "gl_program.h"
+#include "progressive_tracer.h"
+
+namespace gx {
+
+// One triangle covering the viewport, no vertex buffer
+inline const char *kTileOverlayVertexShader = R"( #version 330 core
+out vec2 vUv;
+
+void main() {
+    vec2 p = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    vUv = p;
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+inline const char *kTileOverlayFragmentShader = R"( #version 330 core
+in vec2 vUv;
+out vec4 FragColor;
+
+uniform sampler2D u_image;
+
+void main() {
+    FragColor = texture(u_image, vUv);
+}
+)";
+
+struct TileOverlay {
+    GLuint program = 0, vao = 0, texture = 0;
+    int width = 0, height = 0;
+};
+
+inline TileOverlay create_tile_overlay() {
+    TileOverlay overlay;
+    overlay.program = create_program(kTileOverlayVertexShader, kTileOverlayFragmentShader);
+    glGenVertexArrays(1, &overlay.vao);
+    glGenTextures(1, &overlay.texture);
+    glBindTexture(GL_TEXTURE_2D, overlay.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return overlay;
+}
+
+// Transparent everywhere, at the given size
+inline void clear_tile_overlay(TileOverlay &overlay, int width, int height) {
+    const std::vector<uint8_t> zeros(static_cast<size_t>(width) * height * 4, 0);
+    glBindTexture(GL_TEXTURE_2D, overlay.texture);
+    if (width != overlay.width || height != overlay.height) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, zeros.data());
+        overlay.width = width;
+        overlay.height = height;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, zeros.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+inline void update_tile_overlay(TileOverlay &overlay, const std::vector<TraceTile> &tiles) {
+    if (tiles.empty()) return;
+    glBindTexture(GL_TEXTURE_2D, overlay.texture);
+    for (const TraceTile &t : tiles) {
+        if (t.x + t.width > overlay.width || t.y + t.height > overlay.height) continue;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, t.x, t.y, t.width, t.height, GL_RGBA, GL_UNSIGNED_BYTE, t.rgba.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Over whatever is in the framebuffer, ignoring depth
+inline void draw_tile_overlay(const TileOverlay &overlay, GLuint unit = 0) {
+    if (!overlay.program || !overlay.width) return;
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(overlay.program);
+    glUniform1i(glGetUniformLocation(overlay.program, "u_image"), static_cast<GLint>(unit));
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, overlay.texture);
+    glBindVertexArray(overlay.vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
+
+inline void destroy_tile_overlay(TileOverlay &overlay) {
+    glDeleteTextures(1, &overlay.texture);
+    glDeleteVertexArrays(1, &overlay.vao);
+    if (overlay.program) glDeleteProgram(overlay.program);
+    overlay = TileOverlay{};
+}
+
+} // namespace gx
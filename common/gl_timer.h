@@ -0,0 +1,53 @@
+#pragma once
+// GPU time of a span of GL commands, from GL_TIME_ELAPSED queries (core in GL
+// 3.3). Results arrive a few frames after the span was submitted, so every
+// span gets its own query from a small ring and poll() hands the results back
+// in order once the GPU has finished them. With frames in flight bounded by a
+// FrameRing the oldest query in the ring is always finished by the time it is
+// reused; a result nobody polled is dropped then. Like gl_mesh.h this needs a
+// GL loader header first.
+
+#include <cstdint>
+
+#include "gl_frame_ring.h"
+
+namespace gx {
+
+class GpuTimer {
+public:
+    static constexpr int kQueries = FrameRing::kMaxFrames + 1;
+
+    GpuTimer() { glGenQueries(kQueries, queries_); }
+    ~GpuTimer() { glDeleteQueries(kQueries, queries_); }
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    void begin() {
+        if (next_ - read_ == kQueries) ++read_;
+        glBeginQuery(GL_TIME_ELAPSED, queries_[next_ % kQueries]);
+    }
+    void end() {
+        glEndQuery(GL_TIME_ELAPSED);
+        ++next_;
+    }
+
+    // Milliseconds of the oldest span not polled yet, once it has finished.
+    bool poll(double &ms) {
+        if (read_ == next_) return false;
+        const GLuint q = queries_[read_ % kQueries];
+        GLint ready = 0;
+        glGetQueryObjectiv(q, GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) return false;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(q, GL_QUERY_RESULT, &ns);
+        ++read_;
+        ms = static_cast<double>(ns) / 1e6;
+        return true;
+    }
+
+private:
+    GLuint queries_[kQueries] = {};
+    uint64_t next_ = 0, read_ = 0;
+};
+
+} // namespace gx
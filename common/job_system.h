@@ -0,0 +1,312 @@
+#pragma once
+// Process-wide work-stealing task pool.
+//
+// There is one JobSystem per process (JobSystem::instance()). Every worker owns
+// a deque: it pushes and pops its own tasks at the back while idle workers steal
+// from the front of the others. Threads that are not workers (main thread, GL
+// thread) share an injection queue and execute tasks while they wait, so
+// nested parallel_for calls and waits inside tasks cannot deadlock.
+//
+// Tasks may have dependencies: a task created with create() only becomes
+// runnable once submit() has been called and every task it depends on has
+// finished. then() and when_all() build continuations on top of that.
+// Tasks must not throw; parallel_for forwards the first exception to its caller.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "alloc_tracker.h"
+#include "trace.h"
+
+namespace jobs {
+
+class Task {
+public:
+    explicit Task(std::function<void()> fn) : fn_(std::move(fn)) {}
+    bool done() const { return done_.load(std::memory_order_acquire); }
+
+private:
+    friend class JobSystem;
+    std::function<void()> fn_;
+    std::atomic<int> pending_{1}; // unfinished dependencies, +1 until submitted
+    std::atomic<bool> done_{false};
+    std::mutex mutex_;            // guards successors_ and the transition to done
+    std::vector<std::shared_ptr<Task>> successors_;
+};
+
+using TaskHandle = std::shared_ptr<Task>;
+
+class JobSystem {
+public:
+    static JobSystem &instance() {
+        static JobSystem system;
+        return system;
+    }
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    ~JobSystem() {
+        stop_.store(true);
+        {
+            std::lock_guard<std::mutex> lk(sleep_mutex_);
+        }
+        sleep_cv_.notify_all();
+        for (auto &t : threads_) t.join();
+    }
+
+    size_t worker_count() const { return threads_.size(); }
+    // Workers plus the calling thread, which always helps.
+    size_t concurrency() const { return threads_.size() + 1; }
+    // 0 on non-worker threads, 1..worker_count() on workers.
+    static size_t current_index() { return tls_index(); }
+
+    TaskHandle create(std::function<void()> fn) {
+        if constexpr (alloc::kEnabled) {
+            // Allocations of the task count towards the creator's phase
+            if (const int phase = alloc::current_phase()) {
+                fn = [phase, fn = std::move(fn)] {
+                    alloc::PhaseScope scope(phase);
+                    fn();
+                };
+            }
+        }
+        return std::make_shared<Task>(std::move(fn));
+    }
+
+    // task will not start before on has finished; call before submit(task).
+    void depend(const TaskHandle &task, const TaskHandle &on) {
+        std::lock_guard<std::mutex> lk(on->mutex_);
+        if (on->done_.load(std::memory_order_relaxed)) return;
+        task->pending_.fetch_add(1, std::memory_order_relaxed);
+        on->successors_.push_back(task);
+    }
+
+    void submit(const TaskHandle &task) {
+        if (task->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) push(task);
+    }
+
+    TaskHandle run(std::function<void()> fn) {
+        TaskHandle t = create(std::move(fn));
+        submit(t);
+        return t;
+    }
+
+    // Continuation: fn runs once pred has finished.
+    TaskHandle then(const TaskHandle &pred, std::function<void()> fn) {
+        TaskHandle t = create(std::move(fn));
+        depend(t, pred);
+        submit(t);
+        return t;
+    }
+
+    TaskHandle when_all(const std::vector<TaskHandle> &preds, std::function<void()> fn) {
+        TaskHandle t = create(std::move(fn));
+        for (const auto &p : preds) depend(t, p);
+        submit(t);
+        return t;
+    }
+
+    // Executes other tasks until task has finished. With nothing left to
+    // steal it spins briefly, then sleeps until the task finishes or new work
+    // is queued, so long waits do not burn a core.
+    void wait(const TaskHandle &task) {
+        size_t self = tls_index();
+        int idle = 0;
+        while (!task->done()) {
+            if (TaskHandle t = find_work(self)) {
+                execute(t);
+                idle = 0;
+            } else if (++idle < kSpins) {
+                std::this_thread::yield();
+            } else {
+                std::unique_lock<std::mutex> lk(sleep_mutex_);
+                waiters_.fetch_add(1);
+                wait_cv_.wait(lk, [&] { return task->done_.load() || queued_.load() > 0; });
+                waiters_.fetch_sub(1);
+                idle = 0;
+            }
+        }
+    }
+
+    // Calls fn(lo, hi) over [begin, end) in chunks of at most grain elements.
+    // Chunks are handed out dynamically, so uneven chunk costs balance out.
+    template <typename F>
+    void parallel_for(size_t begin, size_t end, size_t grain, F &&fn) {
+        if (begin >= end) return;
+        grain = std::max<size_t>(grain, 1);
+        const size_t chunks = (end - begin + grain - 1) / grain;
+        if (chunks == 1 || threads_.empty()) {
+            fn(begin, end);
+            return;
+        }
+
+        std::atomic<size_t> next{0};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        auto body = [&]() {
+            for (;;) {
+                size_t c = next.fetch_add(1, std::memory_order_relaxed);
+                if (c >= chunks) break;
+                size_t lo = begin + c * grain;
+                size_t hi = std::min(end, lo + grain);
+                try {
+                    fn(lo, hi);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lk(error_mutex);
+                    if (!error) error = std::current_exception();
+                }
+            }
+        };
+
+        const size_t helpers = std::min(chunks, concurrency()) - 1;
+        std::vector<TaskHandle> tasks;
+        tasks.reserve(helpers);
+        for (size_t i = 0; i < helpers; ++i) tasks.push_back(run(body));
+        body();
+        for (const auto &t : tasks) wait(t);
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    static constexpr int kSpins = 64; // find_work attempts before sleeping
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<TaskHandle> items;
+    };
+
+    JobSystem() {
+        size_t threads = std::max(1u, std::thread::hardware_concurrency());
+        if (const char *env = std::getenv("JOBS_THREADS")) {
+            long n = std::strtol(env, nullptr, 10);
+            if (n > 0) threads = static_cast<size_t>(n);
+        }
+        // The calling thread helps, so spawn one worker less (but at least one
+        // so that fire-and-forget tasks make progress).
+        const size_t workers = std::max<size_t>(1, threads - 1);
+        queues_ = std::vector<Queue>(workers + 1);
+        threads_.reserve(workers);
+        for (size_t i = 0; i < workers; ++i) {
+            threads_.emplace_back([this, i] { worker_main(i + 1); });
+        }
+    }
+
+    static size_t &tls_index() {
+        static thread_local size_t index = 0;
+        return index;
+    }
+
+    void push(const TaskHandle &task) {
+        Queue &q = queues_[tls_index()];
+        {
+            // Count before the task is visible, so a thief's decrement can
+            // never run ahead of it
+            std::lock_guard<std::mutex> lk(q.mutex);
+            queued_.fetch_add(1);
+            q.items.push_back(task);
+        }
+        const bool sleepers = sleepers_.load() > 0, waiters = waiters_.load() > 0;
+        if (sleepers || waiters) {
+            {
+                std::lock_guard<std::mutex> lk(sleep_mutex_);
+            }
+            if (sleepers) sleep_cv_.notify_one();
+            if (waiters) wait_cv_.notify_all();
+        }
+    }
+
+    TaskHandle find_work(size_t self) {
+        if (queued_.load(std::memory_order_relaxed) == 0) return nullptr;
+        {
+            Queue &q = queues_[self];
+            std::lock_guard<std::mutex> lk(q.mutex);
+            if (!q.items.empty()) {
+                TaskHandle t = std::move(q.items.back());
+                q.items.pop_back();
+                queued_.fetch_sub(1);
+                return t;
+            }
+        }
+        const size_t n = queues_.size();
+        for (size_t k = 1; k < n; ++k) {
+            Queue &q = queues_[(self + k) % n];
+            std::lock_guard<std::mutex> lk(q.mutex);
+            if (!q.items.empty()) {
+                TaskHandle t = std::move(q.items.front());
+                q.items.pop_front();
+                queued_.fetch_sub(1);
+                return t;
+            }
+        }
+        return nullptr;
+    }
+
+    void execute(const TaskHandle &task) {
+        task->fn_();
+        task->fn_ = nullptr; // drop captures early
+        std::vector<TaskHandle> successors;
+        {
+            std::lock_guard<std::mutex> lk(task->mutex_);
+            task->done_.store(true); // seq_cst: pairs with waiters_ in wait()
+            successors.swap(task->successors_);
+        }
+        if (waiters_.load() > 0) {
+            {
+                std::lock_guard<std::mutex> lk(sleep_mutex_);
+            }
+            wait_cv_.notify_all();
+        }
+        for (const auto &s : successors) {
+            if (s->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) push(s);
+        }
+    }
+
+    void worker_main(size_t index) {
+        tls_index() = index;
+        TRACE_THREAD_NAME("worker " + std::to_string(index));
+        while (!stop_.load(std::memory_order_relaxed)) {
+            TaskHandle t = find_work(index);
+            for (int spin = 0; !t && spin < kSpins; ++spin) {
+                std::this_thread::yield();
+                t = find_work(index);
+            }
+            if (t) {
+                execute(t);
+                continue;
+            }
+            std::unique_lock<std::mutex> lk(sleep_mutex_);
+            sleepers_.fetch_add(1);
+            sleep_cv_.wait(lk, [this] { return stop_.load() || queued_.load() > 0; });
+            sleepers_.fetch_sub(1);
+        }
+    }
+
+    std::vector<Queue> queues_; // [0] is shared by all non-worker threads
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<int> sleepers_{0}; // idle workers
+    std::atomic<int> waiters_{0};  // threads asleep in wait()
+    std::atomic<bool> stop_{false};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_, wait_cv_;
+};
+
+template <typename F>
+inline void parallel_for(size_t begin, size_t end, size_t grain, F &&fn) {
+    JobSystem::instance().parallel_for(begin, end, grain, std::forward<F>(fn));
+}
+
+} // namespace jobs
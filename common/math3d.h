@@ -0,0 +1,66 @@
+#pragma once
+// Vector, matrix and quaternion helpers shared by the experiments.
+//
+// Matrices are column-major (OpenGL convention) and all angles are radians.
+// Vec3 operations are inline because the ray tracer calls them per pixel; the
+// Mat4/Quat builders live in src/math3d.cpp.
+
+#include <cmath>
+
+namespace gx {
+
+constexpr float kPi = 3.1415926f;
+
+struct Vec3 {
+    float x, y, z;
+    Vec3() : x(0), y(0), z(0) {}
+    Vec3(float X, float Y, float Z) : x(X), y(Y), z(Z) {}
+
+    Vec3 operator+(const Vec3 &o) const { return Vec3(x + o.x, y + o.y, z + o.z); }
+    Vec3 operator-(const Vec3 &o) const { return Vec3(x - o.x, y - o.y, z - o.z); }
+    Vec3 operator*(float s) const { return Vec3(x * s, y * s, z * s); }
+    Vec3 operator/(float s) const { return Vec3(x / s, y / s, z / s); }
+};
+
+inline Vec3 operator*(float s, const Vec3 &v) { return Vec3(v.x * s, v.y * s, v.z * s); }
+
+inline float dot(const Vec3 &a, const Vec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 cross(const Vec3 &a, const Vec3 &b) {
+    return Vec3(
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x);
+}
+inline float length(const Vec3 &v) { return std::sqrt(dot(v, v)); }
+inline Vec3 normalize(const Vec3 &v) {
+    float len2 = dot(v, v);
+    if (len2 <= 1e-8f) return Vec3(0, 0, 0);
+    float inv = 1.0f / std::sqrt(len2);
+    return v * inv;
+}
+
+struct Mat4 {
+    float m[16]; // column-major
+};
+
+Mat4 identity();
+Mat4 perspective(float fovy, float aspect, float znear, float zfar);
+Mat4 translate(float x, float y, float z);
+Mat4 translate(const Vec3 &t);
+Mat4 rotate_x(float angle_rad);
+Mat4 rotate_y(float angle_rad);
+Mat4 scale(float s);
+Mat4 multiply(const Mat4 &a, const Mat4 &b);
+
+struct Quat {
+    float w, x, y, z;
+};
+
+Quat quat_normalize(const Quat &q);
+Quat quat_from_axis_angle(const Vec3 &axis, float angle);
+float quat_dot(const Quat &a, const Quat &b);
+// Shortest-arc spherical interpolation; falls back to lerp for nearly equal inputs.
+Quat quat_slerp(Quat a, Quat b, float t);
+Mat4 quat_to_mat4(const Quat &q);
+
+} // namespace gx
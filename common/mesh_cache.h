@@ -0,0 +1,81 @@
+#pragma once
+// Cross-process cache of prepared meshes in POSIX shared memory, so several
+// viewers showing the same model share one copy of its vertex and index data.
+//
+// The first process to prepare a mesh publishes the interleaved vertices, the
+// indices, the bounds, the parts/ranges/materials and, when it baked them,
+// the per-vertex ambient occlusion (ao_bake.h) into a segment named
+// after a key of the source file (path, size, modification time, inode; see
+// mesh_cache_key). Later processes map it read-only and skip loading.
+//
+// Every process that maps a segment registers its pid in the segment; the
+// last one to let go unlinks it. Holders that died without releasing are
+// swept by the next open or release of the same key. A key that is never
+// opened again (its file was edited or replaced) is caught by the first
+// publish of every process, which unlinks all of the user's segments whose
+// holders and publisher are dead. That scan lists /dev/shm, so elsewhere such
+// segments stay until reboot. Without shm_open (non-POSIX) the cache is
+// disabled: open and publish return null and callers load as usual.
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bounds.h"
+#include "tiny_obj_loader.h"
+
+namespace gx {
+
+class SharedMesh {
+public:
+    static bool supported();
+
+    // Maps the published mesh for key, or null when there is none (yet).
+    static std::shared_ptr<const SharedMesh> open(const std::string &key);
+    // Copies the mesh into a new segment and maps it. Null when another
+    // process published (or is publishing) the same key, or on failure.
+    // ao: one float per vertex, or null.
+    static std::shared_ptr<const SharedMesh> publish(const std::string &key, const tinyobj::MeshData &mesh,
+                                                     const pages::Vector<float> &interleaved, const MeshBounds &bounds,
+                                                     const float *ao = nullptr);
+
+    ~SharedMesh();
+    SharedMesh(const SharedMesh &) = delete;
+    SharedMesh &operator=(const SharedMesh &) = delete;
+
+    const float *interleaved() const { return interleaved_; } // kVertexStride floats per vertex
+    size_t vertex_count() const { return vertex_count_; }
+    const unsigned int *indices() const { return indices_; }
+    const float *ao() const { return ao_; } // one per vertex; null when the publisher did not bake it
+    size_t index_count() const { return index_count_; }
+    const MeshBounds &bounds() const { return bounds_; }
+    size_t bytes() const { return size_; }  // whole segment
+    size_t holders() const;                 // processes mapping it, this one included
+
+    // Parts, ranges and materials (the small per-mesh tables) into mesh;
+    // false (and none of them) when the tables don't parse.
+    bool copy_tables(tinyobj::MeshData &mesh) const;
+
+private:
+    SharedMesh() = default;
+
+    std::string name_;
+    void *base_ = nullptr;
+    size_t size_ = 0;
+    const float *interleaved_ = nullptr;
+    const unsigned int *indices_ = nullptr;
+    const float *ao_ = nullptr;
+    size_t vertex_count_ = 0, index_count_ = 0;
+    MeshBounds bounds_;
+    const char *tables_ = nullptr;
+    size_t tables_size_ = 0;
+    void *header_ = nullptr; // read-write mapping of the header (holder slots)
+    int slot_ = -1;
+};
+
+// Key of the file's current contents from its metadata; empty when the file
+// does not exist or the cache is not supported.
+std::string mesh_cache_key(const std::string &path);
+
+} // namespace gx
@@ -0,0 +1,40 @@
+#pragma once
+// Compressed mesh files (.gxm) for tinyobj::MeshData.
+//
+// Attributes are quantized (positions and texture coordinates on their
+// bounding box, normals octahedrally) and predicted from the previous vertex,
+// which the loader's first-use vertex order keeps close. Indices are coded as
+// deltas to the same corner of the previous triangle or to the next unused
+// vertex, whichever is smaller for the chunk. Every residual becomes a
+// bit-length symbol, entropy coded with a static rANS coder, plus its low bits
+// stored raw.
+//
+// Vertices and triangles are split into chunks that are coded independently,
+// so encoding and decoding both run in parallel on the job system. Parts,
+// ranges and materials are stored as they are. Quantization makes the codec
+// lossy: positions are off by at most half a step of the bounding box divided
+// into 2^position_bits - 1 steps.
+
+#include <cstddef>
+#include <string>
+
+#include "tiny_obj_loader.h"
+
+namespace gx {
+
+struct CodecOptions {
+    int position_bits = 16; // per axis, 1 to 24
+    int normal_bits = 12;   // per octahedral coordinate, 1 to 24
+    int texcoord_bits = 14; // per coordinate, 1 to 24
+};
+
+std::string encode_mesh(const tinyobj::MeshData &mesh, const CodecOptions &opt = {});
+bool decode_mesh(const char *data, size_t size, tinyobj::MeshData &mesh, std::string &err);
+
+// True when data starts like an encode_mesh result.
+bool is_compressed_mesh(const char *data, size_t size);
+
+bool save_compressed_mesh(const tinyobj::MeshData &mesh, const std::string &path, std::string &err,
+                          const CodecOptions &opt = {});
+
+} // namespace gx
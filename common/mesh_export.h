@@ -0,0 +1,47 @@
+#pragma once
+// Writes tinyobj::MeshData back out as OBJ text (with its parts, materials and
+// an .mtl next to it) or as binary little-endian PLY.
+//
+// Numbers are formatted with std::to_chars (the shortest text that reads back
+// to the same float) into one buffer per chunk of vertices or faces on the job
+// system. OBJ chunks are written in file order with large sequential writes,
+// one batch at a time while the next batch is being formatted, so memory stays
+// bounded. PLY records have fixed sizes, so every chunk is written with pwrite
+// at its precomputed offset as soon as it is formatted.
+
+#include <cstddef>
+#include <string>
+
+#include "tiny_obj_loader.h"
+
+namespace gx {
+
+enum class MeshFormat { Obj, Ply, Gxm };
+
+struct ExportOptions {
+    bool normals = true;   // when the mesh has them
+    bool texcoords = true; // when the mesh has them
+    bool write_mtl = true; // OBJ with materials: <name>.mtl next to the file
+};
+
+struct ExportStats {
+    size_t bytes = 0; // mesh file only
+    double ms = 0.0;
+};
+
+// .ply is PLY, .gxm compressed (mesh_codec.h), anything else OBJ.
+MeshFormat format_from_path(const std::string &path);
+
+bool export_obj(const tinyobj::MeshData &mesh, const std::string &path, std::string &err,
+                const ExportOptions &opt = {}, ExportStats *stats = nullptr);
+bool export_ply(const tinyobj::MeshData &mesh, const std::string &path, std::string &err,
+                const ExportOptions &opt = {}, ExportStats *stats = nullptr);
+// Format from the extension; .gxm uses the default CodecOptions and, like the
+// others, leaves out the streams opt turns off.
+bool export_mesh(const tinyobj::MeshData &mesh, const std::string &path, std::string &err,
+                 const ExportOptions &opt = {}, ExportStats *stats = nullptr);
+
+// The OBJ text export_obj writes, without the mtllib line.
+std::string format_obj(const tinyobj::MeshData &mesh, const ExportOptions &opt = {});
+
+} // namespace gx
@@ -0,0 +1,256 @@
+#pragma once
+// Asynchronous OBJ/.gxm -> vertex buffer (and splat PLY -> splat buffer)
+// preparation for the viewers (C++20). The file is read on the I/O executor,
+// everything else runs on the job system, so the caller's thread stays free
+// for window and GL setup. OBJ chunks are parsed on the job system while the
+// rest of the file is still being read (io_uring where available, see
+// file_reader.h).
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "alloc_tracker.h"
+#include "ao_bake.h"
+#include "async.h"
+#include "file_reader.h"
+#include "gaussian_ply.h"
+#include "mesh_cache.h"
+#include "mesh_codec.h"
+#include "mesh_utils.h"
+#include "metrics.h"
+#include "perf_counters.h"
+#include "splat_view.h"
+#include "tiny_obj_loader.h"
+#include "trace.h"
+
+namespace gx {
+
+struct PreparedMesh {
+    bool ok = false;
+    std::string err;
+    tinyobj::MeshData mesh;
+    pages::Vector<float> interleaved; // kVertexStride floats per vertex
+    MeshBounds bounds;
+    // Set when the vertices and indices live in the shared mesh cache
+    // (mesh_cache.h); mesh then holds only the parts, ranges and materials
+    // and interleaved is empty. Use the accessors below either way.
+    std::shared_ptr<const SharedMesh> shared;
+    bool cache_hit = false; // mapped another process's copy
+    // Per-vertex ambient occlusion baked here (ao_rays); empty when it lives
+    // in the shared copy
+    pages::Vector<float> ao;
+    AoBakeStats ao_stats; // rays == 0: not baked here
+    // Wall time per stage, excluding the hops between threads. OBJ parsing
+    // starts during the read, parse_ms is the rest of it; prepare_ms includes
+    // the AO bake.
+    double read_ms = 0.0, parse_ms = 0.0, prepare_ms = 0.0;
+
+    const float *vertex_data() const { return shared ? shared->interleaved() : interleaved.data(); }
+    size_t vertex_count() const { return shared ? shared->vertex_count() : interleaved.size() / kVertexStride; }
+    const unsigned int *index_data() const { return shared ? shared->indices() : mesh.indices.data(); }
+    size_t index_count() const { return shared ? shared->index_count() : mesh.indices.size(); }
+    // One float per vertex, or null when neither this process nor the
+    // publisher of the shared copy baked it
+    const float *ao_data() const {
+        if (!ao.empty()) return ao.data();
+        return shared ? shared->ao() : nullptr;
+    }
+    PositionView positions() const {
+        return shared ? PositionView{shared->interleaved(), kVertexStride} : PositionView{mesh.positions.data(), 3};
+    }
+};
+
+namespace detail {
+
+inline double ms_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace detail
+
+// use_cache: map the mesh from the shared mesh cache when another process
+// published it, otherwise load it and publish it for the next one.
+// ao_rays: bake per-vertex ambient occlusion with this many rays per vertex
+// (ao_bake.h) unless the shared copy already has it; 0 = none.
+inline async::Task<PreparedMesh> load_mesh_async(async::Executor &io, std::string path, bool use_cache = false,
+                                                 uint32_t ao_rays = 0) {
+    AoBakeOptions ao_opt;
+    ao_opt.rays = ao_rays;
+    PreparedMesh out;
+    co_await io.schedule();
+    auto t0 = std::chrono::steady_clock::now();
+    const std::string key = use_cache ? mesh_cache_key(path) : std::string();
+    if (!key.empty()) {
+        std::shared_ptr<const SharedMesh> shared = SharedMesh::open(key);
+        if (shared && shared->copy_tables(out.mesh)) {
+            out.shared = std::move(shared);
+            out.bounds = out.shared->bounds();
+            out.cache_hit = true;
+            out.read_ms = detail::ms_since(t0);
+            if (ao_rays && !out.shared->ao()) {
+                co_await async::resume_on_pool();
+                t0 = std::chrono::steady_clock::now();
+                out.ao = bake_vertex_ao(out.vertex_data(), out.vertex_count(), out.index_data(), out.index_count(),
+                                        out.bounds.sphere.radius, ao_opt, &out.ao_stats);
+                out.prepare_ms = detail::ms_since(t0);
+            }
+            out.ok = true;
+            co_return out;
+        }
+    }
+    // .gxm files (mesh_codec.h) are recognized by their magic and decoded
+    // whole; OBJ text goes to the parser as it arrives
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(path, ec);
+    tinyobj::detail::StreamingParser parser(ec ? 0 : static_cast<size_t>(file_size));
+    std::string compressed;
+    bool first_block = true, is_gxm = false;
+    bool read_ok;
+    {
+        // Same counters as tinyobj::LoadObj; the parser charges its own
+        // chunk jobs to "parse"
+        PERF_SCOPE("obj_read_file");
+        ALLOC_PHASE("read");
+        read_ok = stream_file(path, [&](const char *data, size_t size) {
+            if (first_block) {
+                is_gxm = is_compressed_mesh(data, size);
+                if (is_gxm && !ec) compressed.reserve(static_cast<size_t>(file_size));
+            }
+            first_block = false;
+            if (is_gxm) {
+                compressed.append(data, size);
+            } else {
+                parser.feed(data, size);
+            }
+            return true;
+        }, out.err);
+    }
+    if (!read_ok) co_return out;
+    out.read_ms = detail::ms_since(t0);
+
+    co_await async::resume_on_pool();
+    t0 = std::chrono::steady_clock::now();
+    {
+        TRACE_SCOPE("load_obj");
+        const bool ok = is_gxm ? decode_mesh(compressed.data(), compressed.size(), out.mesh, out.err)
+                               : parser.finish(out.mesh, out.err, tinyobj::detail::base_dir(path));
+        if (!ok) co_return out;
+    }
+    out.parse_ms = detail::ms_since(t0);
+    if (out.mesh.indices.empty()) {
+        out.err = "OBJ has no faces: " + path;
+        co_return out;
+    }
+    t0 = std::chrono::steady_clock::now();
+    compute_normals_if_missing(out.mesh);
+    out.interleaved = interleave_vertices(out.mesh, &out.bounds);
+    if (ao_rays) {
+        out.ao = bake_vertex_ao(out.interleaved.data(), out.interleaved.size() / kVertexStride, out.mesh.indices.data(),
+                                out.mesh.indices.size(), out.bounds.sphere.radius, ao_opt, &out.ao_stats);
+    }
+    if (!key.empty()) {
+        // From here on this process uses the shared copy like everyone else
+        out.shared =
+            SharedMesh::publish(key, out.mesh, out.interleaved, out.bounds, out.ao.empty() ? nullptr : out.ao.data());
+        if (out.shared) {
+            out.interleaved = {};
+            out.ao = {};
+            out.mesh.positions = {};
+            out.mesh.normals = {};
+            out.mesh.texcoords = {};
+            out.mesh.indices = {};
+        }
+    }
+    out.prepare_ms = detail::ms_since(t0);
+    out.ok = true;
+    co_return out;
+}
+
+struct PreparedSplats {
+    bool ok = false;
+    std::string err;
+    PackedSplats splats;
+    MeshBounds bounds; // of the centers
+    double read_ms = 0.0, prepare_ms = 0.0;
+};
+
+inline async::Task<PreparedSplats> load_splats_async(async::Executor &io, std::string path) {
+    PreparedSplats out;
+    co_await io.schedule();
+    auto t0 = std::chrono::steady_clock::now();
+    splat::SplatCloud cloud;
+    {
+        TRACE_SCOPE("load_ply");
+        if (!splat::LoadPly(cloud, path, out.err)) co_return out;
+    }
+    out.read_ms = detail::ms_since(t0);
+    if (cloud.size() == 0) {
+        out.err = "PLY has no splats: " + path;
+        co_return out;
+    }
+
+    co_await async::resume_on_pool();
+    t0 = std::chrono::steady_clock::now();
+    {
+        TRACE_SCOPE("pack_splats");
+        if (!pack_splats(cloud, out.splats, out.err)) co_return out;
+    }
+    out.bounds = compute_bounds(out.splats.centers.data(), out.splats.size());
+    out.prepare_ms = detail::ms_since(t0);
+    out.ok = true;
+    co_return out;
+}
+
+// Exports load times and size estimates of a prepared and uploaded mesh (see
+// metrics.h). The GPU figure is the VBO + EBO payload, not driver overhead.
+inline void publish_mesh_metrics(const PreparedMesh &p, double upload_ms) {
+    auto &reg = metrics::Registry::instance();
+    const char *help = "Startup stage wall time";
+    reg.gauge("gx_load_seconds", help, R"(stage="read")").set(p.read_ms / 1e3);
+    reg.gauge("gx_load_seconds", help, R"(stage="parse")").set(p.parse_ms / 1e3);
+    reg.gauge("gx_load_seconds", help, R"(stage="prepare")").set(p.prepare_ms / 1e3);
+    reg.gauge("gx_load_seconds", help, R"(stage="upload")").set(upload_ms / 1e3);
+    if (p.ao_stats.rays) {
+        reg.gauge("gx_load_seconds", help, R"(stage="ao")").set(p.ao_stats.ms / 1e3);
+        reg.gauge("gx_ao_bake_rays_per_second", "Ambient occlusion bake throughput").set(p.ao_stats.rays_per_second());
+    }
+
+    const auto &m = p.mesh;
+    reg.gauge("gx_mesh_triangles", "Triangles in the loaded mesh").set(static_cast<double>(p.index_count() / 3));
+    reg.gauge("gx_mesh_vertices", "Unique vertices in the loaded mesh").set(static_cast<double>(p.vertex_count()));
+    const double cpu_bytes = static_cast<double>(
+        (m.positions.capacity() + m.normals.capacity() + m.texcoords.capacity() + p.interleaved.capacity() +
+         p.ao.capacity()) *
+            sizeof(float) +
+        m.indices.capacity() * sizeof(unsigned int));
+    const size_t vertex_floats = kVertexStride + (p.ao_data() ? 1 : 0);
+    const double gpu_bytes =
+        static_cast<double>(p.vertex_count() * vertex_floats * sizeof(float) + p.index_count() * sizeof(unsigned int));
+    reg.gauge("gx_memory_bytes", "Estimated mesh memory", R"(where="cpu")").set(cpu_bytes);
+    reg.gauge("gx_memory_bytes", "Estimated mesh memory", R"(where="gpu")").set(gpu_bytes);
+    // Mapped from the mesh cache, counted once per machine rather than per viewer
+    reg.gauge("gx_memory_bytes", "Estimated mesh memory", R"(where="shared")")
+        .set(p.shared ? static_cast<double>(p.shared->bytes()) : 0.0);
+}
+
+// Splat counterpart of publish_mesh_metrics; GPU bytes are the splat data
+// buffer plus the index (draw order) buffer.
+inline void publish_splat_metrics(const PreparedSplats &p, double upload_ms) {
+    auto &reg = metrics::Registry::instance();
+    const char *help = "Startup stage wall time";
+    reg.gauge("gx_load_seconds", help, R"(stage="read")").set(p.read_ms / 1e3);
+    reg.gauge("gx_load_seconds", help, R"(stage="prepare")").set(p.prepare_ms / 1e3);
+    reg.gauge("gx_load_seconds", help, R"(stage="upload")").set(upload_ms / 1e3);
+
+    const auto &s = p.splats;
+    reg.gauge("gx_splats", "Splats in the loaded capture").set(static_cast<double>(s.size()));
+    const double cpu_bytes = static_cast<double>((s.data.capacity() + s.centers.capacity()) * sizeof(float));
+    const double gpu_bytes = static_cast<double>(s.data.size() * sizeof(float) + s.size() * sizeof(uint32_t));
+    reg.gauge("gx_memory_bytes", "Estimated mesh memory", R"(where="cpu")").set(cpu_bytes);
+    reg.gauge("gx_memory_bytes", "Estimated mesh memory", R"(where="gpu")").set(gpu_bytes);
+}
+
+} // namespace gx
@@ -0,0 +1,31 @@
+#pragma once
+// CPU-side mesh preparation shared by the OBJ viewers.
+
+#include <cstddef>
+#include <vector>
+
+#include "bounds.h"
+#include "tiny_obj_loader.h"
+
+namespace gx {
+
+// Floats per interleaved vertex: position (3) + normal (3).
+constexpr size_t kVertexStride = 6;
+
+// Positions inside a vertex layout: vertex i starts at data + i * stride
+// (3 for MeshData::positions, kVertexStride for interleaved vertices).
+struct PositionView {
+    const float *data = nullptr;
+    size_t stride = 3;
+
+    const float *operator[](size_t i) const { return data + i * stride; }
+};
+
+// Smooth, area-weighted vertex normals for meshes that have none.
+void compute_normals_if_missing(tinyobj::MeshData &mesh);
+
+// Packs positions and normals into one kVertexStride-float array for the VBO.
+// With bounds, the bounding volumes are gathered in the same pass.
+pages::Vector<float> interleave_vertices(const tinyobj::MeshData &mesh, MeshBounds *bounds = nullptr);
+
+} // namespace gx
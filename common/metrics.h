@@ -0,0 +1,369 @@
+#pragma once
+// Prometheus metrics for long-running viewers, served on a loopback port.
+//
+// Metrics are registered once at startup and then updated from hot loops
+// through the returned references with relaxed atomic operations only; no
+// lock is shared with the scraper. A scrape (GET /metrics) walks the registry
+// on the exporter thread and formats text exposition format 0.0.4.
+//
+// Enable with the METRICS_PORT environment variable:
+//   METRICS_PORT=9464 ./obj_viewer model.obj
+//   curl http://127.0.0.1:9464/metrics
+//
+// The server binds to 127.0.0.1 only.
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define METRICS_HAVE_SOCKETS 1
+#endif
+
+namespace metrics {
+
+namespace detail {
+
+inline uint64_t to_bits(double v) {
+    uint64_t b;
+    std::memcpy(&b, &v, sizeof(b));
+    return b;
+}
+
+inline double from_bits(uint64_t b) {
+    double v;
+    std::memcpy(&v, &b, sizeof(v));
+    return v;
+}
+
+// Lock-free double accumulator (std::atomic<double>::fetch_add is C++20).
+class AtomicDouble {
+public:
+    void store(double v) { bits_.store(to_bits(v), std::memory_order_relaxed); }
+    double load() const { return from_bits(bits_.load(std::memory_order_relaxed)); }
+    void add(double v) {
+        uint64_t cur = bits_.load(std::memory_order_relaxed);
+        while (!bits_.compare_exchange_weak(cur, to_bits(from_bits(cur) + v), std::memory_order_relaxed)) {
+        }
+    }
+
+private:
+    std::atomic<uint64_t> bits_{0}; // bit pattern of 0.0
+};
+
+inline void append_double(std::string &out, double v, int precision = 17) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.*g", precision, v);
+    out += buf;
+}
+
+} // namespace detail
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+public:
+    void set(double v) { value_.store(v); }
+    void add(double v) { value_.add(v); }
+    double value() const { return value_.load(); }
+
+private:
+    detail::AtomicDouble value_;
+};
+
+// Fixed upper bounds chosen at registration; observe() is two relaxed atomic
+// updates plus a short linear scan over the bounds.
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds)
+        : bounds_(std::move(bounds)), buckets_(new std::atomic<uint64_t>[bounds_.size() + 1]) {
+        for (size_t i = 0; i <= bounds_.size(); ++i) buckets_[i].store(0, std::memory_order_relaxed);
+    }
+
+    void observe(double v) {
+        size_t i = 0;
+        while (i < bounds_.size() && v > bounds_[i]) ++i;
+        buckets_[i].fetch_add(1, std::memory_order_relaxed);
+        sum_.add(v);
+    }
+
+    const std::vector<double> &bounds() const { return bounds_; }
+    uint64_t bucket(size_t i) const { return buckets_[i].load(std::memory_order_relaxed); }
+    double sum() const { return sum_.load(); }
+
+private:
+    std::vector<double> bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets_; // last one is +Inf
+    detail::AtomicDouble sum_;
+};
+
+// Frame-time buckets in seconds, from 1 ms to 1 s (16.7/33.3 ms = 60/30 Hz).
+inline std::vector<double> frame_time_buckets() {
+    return {0.001, 0.002, 0.004, 0.008, 0.0167, 0.0333, 0.05, 0.1, 0.25, 0.5, 1.0};
+}
+
+class Registry {
+public:
+    static Registry &instance() {
+        static Registry r;
+        return r;
+    }
+
+    // labels are preformatted, e.g. R"(stage="parse")"; metrics sharing a name
+    // form one family and must share help text and type.
+    Counter &counter(const std::string &name, const std::string &help, const std::string &labels = "") {
+        auto m = std::make_unique<Counter>();
+        Counter &ref = *m;
+        add(Entry{kCounter, name, help, labels, std::move(m), nullptr, nullptr, {}});
+        return ref;
+    }
+
+    Gauge &gauge(const std::string &name, const std::string &help, const std::string &labels = "") {
+        auto m = std::make_unique<Gauge>();
+        Gauge &ref = *m;
+        add(Entry{kGauge, name, help, labels, nullptr, std::move(m), nullptr, {}});
+        return ref;
+    }
+
+    Histogram &histogram(const std::string &name, const std::string &help, std::vector<double> bounds,
+                         const std::string &labels = "") {
+        auto m = std::make_unique<Histogram>(std::move(bounds));
+        Histogram &ref = *m;
+        add(Entry{kHistogram, name, help, labels, nullptr, nullptr, std::move(m), {}});
+        return ref;
+    }
+
+    // Gauge evaluated at scrape time on the exporter thread; fn must be
+    // thread-safe (e.g. read /proc or an atomic).
+    void gauge_fn(const std::string &name, const std::string &help, std::function<double()> fn,
+                  const std::string &labels = "") {
+        add(Entry{kGauge, name, help, labels, nullptr, nullptr, nullptr, std::move(fn)});
+    }
+
+    std::string render() const {
+        std::lock_guard<std::mutex> lk(mutex_);
+        std::string out;
+        out.reserve(4096);
+        std::vector<bool> done(entries_.size(), false);
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (done[i]) continue;
+            const Entry &head = entries_[i];
+            out += "# HELP " + head.name + " " + head.help + "\n";
+            out += "# TYPE " + head.name + " " + type_name(head.kind) + "\n";
+            for (size_t j = i; j < entries_.size(); ++j) {
+                if (done[j] || entries_[j].name != head.name) continue;
+                done[j] = true;
+                render_entry(out, entries_[j]);
+            }
+        }
+        return out;
+    }
+
+private:
+    enum Kind { kCounter, kGauge, kHistogram };
+
+    struct Entry {
+        Kind kind;
+        std::string name, help, labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> fn;
+    };
+
+    Registry() = default;
+
+    void add(Entry e) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        entries_.push_back(std::move(e));
+    }
+
+    static const char *type_name(Kind k) {
+        return k == kCounter ? "counter" : k == kGauge ? "gauge" : "histogram";
+    }
+
+    static std::string with_labels(const std::string &labels, const std::string &extra = "") {
+        if (labels.empty() && extra.empty()) return "";
+        if (labels.empty()) return "{" + extra + "}";
+        if (extra.empty()) return "{" + labels + "}";
+        return "{" + labels + "," + extra + "}";
+    }
+
+    static void render_entry(std::string &out, const Entry &e) {
+        if (e.kind == kCounter) {
+            out += e.name + with_labels(e.labels) + " " + std::to_string(e.counter->value()) + "\n";
+        } else if (e.kind == kGauge) {
+            out += e.name + with_labels(e.labels) + " ";
+            detail::append_double(out, e.fn ? e.fn() : e.gauge->value());
+            out += "\n";
+        } else {
+            const Histogram &h = *e.histogram;
+            uint64_t cumulative = 0;
+            for (size_t b = 0; b <= h.bounds().size(); ++b) {
+                cumulative += h.bucket(b);
+                std::string le = "+Inf";
+                if (b < h.bounds().size()) {
+                    le.clear();
+                    detail::append_double(le, h.bounds()[b], 6);
+                }
+                out += e.name + "_bucket" + with_labels(e.labels, "le=\"" + le + "\"") + " " +
+                       std::to_string(cumulative) + "\n";
+            }
+            out += e.name + "_sum" + with_labels(e.labels) + " ";
+            detail::append_double(out, h.sum());
+            out += "\n" + e.name + "_count" + with_labels(e.labels) + " " + std::to_string(cumulative) + "\n";
+        }
+    }
+
+    mutable std::mutex mutex_; // registration and scrape only
+    std::vector<Entry> entries_;
+};
+
+// Resident set size from /proc/self/statm, 0 where unavailable.
+inline double process_resident_bytes() {
+#ifdef __linux__
+    std::FILE *f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0.0;
+    unsigned long long pages = 0, resident = 0;
+    int n = std::fscanf(f, "%llu %llu", &pages, &resident);
+    std::fclose(f);
+    return n == 2 ? static_cast<double>(resident) * static_cast<double>(sysconf(_SC_PAGESIZE)) : 0.0;
+#else
+    return 0.0;
+#endif
+}
+
+namespace detail {
+
+#ifdef METRICS_HAVE_SOCKETS
+class Server {
+public:
+    static Server &instance() {
+        // Statics are destroyed in reverse order of construction: building the
+        // registry first keeps it alive until the listener thread is joined
+        Registry::instance();
+        static Server s;
+        return s;
+    }
+
+    bool start(uint16_t port) {
+        if (thread_.joinable()) return true;
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(fd, 8) != 0) {
+            std::fprintf(stderr, "metrics: cannot listen on 127.0.0.1:%u (%s)\n", port, std::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+        listen_fd_ = fd;
+        Registry::instance().gauge_fn("process_resident_memory_bytes", "Resident set size", process_resident_bytes);
+        thread_ = std::thread([this] { loop(); });
+        std::fprintf(stderr, "metrics: serving http://127.0.0.1:%u/metrics\n", port);
+        return true;
+    }
+
+    ~Server() {
+        stop_.store(true);
+        if (thread_.joinable()) thread_.join();
+        if (listen_fd_ >= 0) ::close(listen_fd_);
+    }
+
+private:
+    void loop() {
+        while (!stop_.load()) {
+            pollfd p{listen_fd_, POLLIN, 0};
+            if (::poll(&p, 1, 200) <= 0) continue;
+            int client = ::accept(listen_fd_, nullptr, nullptr);
+            if (client < 0) continue;
+            handle(client);
+            ::close(client);
+        }
+    }
+
+    // One request per connection; the body is rendered only for /metrics.
+    static void handle(int client) {
+        timeval tv{1, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        char req[2048];
+        size_t len = 0;
+        while (len < sizeof(req) - 1) {
+            ssize_t n = ::recv(client, req + len, sizeof(req) - 1 - len, 0);
+            if (n <= 0) break;
+            len += static_cast<size_t>(n);
+            req[len] = '\0';
+            if (std::strstr(req, "\r\n\r\n") || std::strstr(req, "\n\n")) break;
+        }
+        req[len] = '\0';
+        const bool ok = std::strncmp(req, "GET /metrics", 12) == 0;
+        const std::string body = ok ? Registry::instance().render() : "not found, try /metrics\n";
+        std::string resp = ok ? "HTTP/1.0 200 OK\r\n" : "HTTP/1.0 404 Not Found\r\n";
+        resp += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+        resp += "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+        resp += body;
+        size_t sent = 0;
+        while (sent < resp.size()) {
+            ssize_t n = ::send(client, resp.data() + sent, resp.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    int listen_fd_ = -1;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+#endif
+
+} // namespace detail
+
+// Starts the exporter thread on 127.0.0.1:port.
+inline bool serve(uint16_t port) {
+#ifdef METRICS_HAVE_SOCKETS
+    return detail::Server::instance().start(port);
+#else
+    (void)port;
+    return false;
+#endif
+}
+
+// Serves metrics if METRICS_PORT is set; returns true when the exporter runs.
+inline bool init_from_env() {
+    const char *env = std::getenv("METRICS_PORT");
+    if (!env || !*env) return false;
+    long port = std::strtol(env, nullptr, 10);
+    if (port <= 0 || port > 65535) {
+        std::fprintf(stderr, "metrics: invalid METRICS_PORT=%s\n", env);
+        return false;
+    }
+    return serve(static_cast<uint16_t>(port));
+}
+
+} // namespace metrics
@@ -0,0 +1,96 @@
+#pragma once
+// Software occlusion culling for meshes made of many parts (OBJ o/g).
+//
+// MaskedDepthBuffer is a low-resolution masked depth buffer in the style of
+// Andersson et al., "Masked Software Occlusion Culling": every 8x4 pixel tile
+// stores a conservative far depth for the whole tile plus a working layer (a
+// coverage mask and its far depth) that is folded in once it covers the tile.
+// Triangles are rasterized four pixels at a time (SSE2 where available) and
+// a second level keeps the farthest depth per 4x4 tiles for quick rejects.
+// Depth is NDC z mapped to [0, 1], larger is farther.
+//
+// OcclusionCuller picks the few parts with the largest bounds as occluders
+// (at most kOccluderTriangles of their largest triangles each), rasterizes
+// them every frame and tests the bounding boxes of all parts against the
+// result in parallel. Skipping occluder triangles only makes culling less
+// effective, never wrong.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+#include "math3d.h"
+#include "mesh_utils.h"
+#include "tiny_obj_loader.h"
+
+namespace gx {
+
+// Bounds of every part of mesh (same order as mesh.parts).
+std::vector<Aabb> part_bounds(const tinyobj::MeshData &mesh);
+std::vector<Aabb> part_bounds(PositionView positions, const unsigned int *indices,
+                              const std::vector<tinyobj::MeshPart> &parts);
+
+class MaskedDepthBuffer {
+public:
+    static constexpr int kTileWidth = 8, kTileHeight = 4;
+    static constexpr int kBlockTiles = 4; // tiles per hierarchy block side
+
+    // Rounded up to whole tiles.
+    MaskedDepthBuffer(int width = 320, int height = 192);
+
+    void clear();
+    // Triangles as 9 floats each (three object-space positions).
+    void rasterize(const float *triangles, size_t count, const Mat4 &mvp);
+    // Call after rasterizing, before testing.
+    void update_hierarchy();
+    // False when the box is hidden or outside the view; boxes crossing the
+    // near plane are always visible.
+    bool test(const Aabb &box, const Mat4 &mvp) const;
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+private:
+    void rasterize_triangle(const float (*v)[3]);
+    void update_tile(size_t tile, uint32_t coverage, float depth);
+
+    int width_, height_, tiles_x_, tiles_y_, blocks_x_, blocks_y_;
+    std::vector<uint32_t> mask_;          // working layer coverage per tile
+    std::vector<float> zmax0_, zmax1_;    // whole tile / working layer
+    std::vector<float> block_zmax_;       // max of zmax0_ per block
+};
+
+struct OcclusionStats {
+    size_t parts = 0, visible = 0;
+    size_t occluders = 0, occluder_triangles = 0;
+    double raster_ms = 0.0, test_ms = 0.0;
+
+    double culled_ratio() const { return parts ? 1.0 - static_cast<double>(visible) / parts : 0.0; }
+};
+
+class OcclusionCuller {
+public:
+    static constexpr size_t kMaxOccluders = 8;
+    static constexpr size_t kOccluderTriangles = 4096;
+
+    explicit OcclusionCuller(const tinyobj::MeshData &mesh);
+    // Same from vertex data kept elsewhere (interleaved or shared, see mesh_cache.h)
+    OcclusionCuller(PositionView positions, const unsigned int *indices, const std::vector<tinyobj::MeshPart> &parts);
+
+    // Indices of the parts that may be visible with mvp, in part order.
+    const std::vector<uint32_t> &cull(const Mat4 &mvp);
+
+    const OcclusionStats &stats() const { return stats_; } // of the last cull
+    const std::vector<Aabb> &bounds() const { return bounds_; }
+
+private:
+    std::vector<Aabb> bounds_;
+    std::vector<float> occluder_triangles_; // 9 floats per triangle
+    MaskedDepthBuffer buffer_;
+    std::vector<uint8_t> flags_;
+    std::vector<uint32_t> visible_;
+    OcclusionStats stats_;
+};
+
+} // namespace gx
@@ -0,0 +1,43 @@
+#pragma once
+// Octahedral mapping of unit vectors onto [-1, 1]^2: the L1-normalized vector
+// is projected onto the xy plane and the lower hemisphere is folded over the
+// diagonals. Used for the compressed normals of mesh_codec.h and for the view
+// directions of the impostor atlas (gl_impostor.h, whose shaders carry GLSL
+// copies of the same two functions).
+
+#include <cmath>
+
+namespace gx {
+
+inline void oct_encode(const float *n, float &u, float &v) {
+    const float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    if (l1 <= 0.0f) {
+        u = v = 0.0f;
+        return;
+    }
+    u = n[0] / l1;
+    v = n[1] / l1;
+    if (n[2] < 0.0f) {
+        const float fu = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        const float fv = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = fu;
+        v = fv;
+    }
+}
+
+inline void oct_decode(float u, float v, float *n) {
+    const float z = 1.0f - std::fabs(u) - std::fabs(v);
+    if (z < 0.0f) {
+        const float fu = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        const float fv = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = fu;
+        v = fv;
+    }
+    const float len = std::sqrt(u * u + v * v + z * z);
+    const float s = len > 0.0f ? 1.0f / len : 0.0f;
+    n[0] = u * s;
+    n[1] = v * s;
+    n[2] = z * s;
+}
+
+} // namespace gx
@@ -0,0 +1,83 @@
+#pragma once
+// Page-level allocation policy for the large arrays (mesh attributes and
+// indices, interleaved vertices, frame buffers).
+//
+// pages::Vector<T> is a std::vector whose buffers of kMinBytes and more are
+// mapped directly, 2 MB aligned, instead of coming from malloc. What happens
+// to those mappings is a process-wide policy, set once at startup from the
+// command line (parse_flag) or the environment (init_from_env):
+//
+//   --huge-pages  GX_HUGE_PAGES=1  madvise(MADV_HUGEPAGE), so transparent huge
+//                                  pages back the buffer (one TLB entry per 2 MB)
+//   --prefault    GX_PREFAULT=1    populate the pages at allocation, in 2 MB
+//                                  slices on the job system, instead of one
+//                                  fault per page at first touch
+//
+// Smaller buffers, and every buffer where mmap is unavailable, use operator
+// new as usual. Mapped buffers are reported to the allocation tracker
+// (alloc_tracker.h) under the current phase, like heap blocks.
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace pages {
+
+constexpr size_t kHugePageSize = size_t(2) << 20;
+constexpr size_t kMinBytes = kHugePageSize;
+
+struct Policy {
+    bool huge = false;
+    bool prefault = false;
+};
+
+Policy &policy();
+
+// Applies --huge-pages / --prefault; false for any other argument.
+bool parse_flag(const std::string &arg);
+// GX_HUGE_PAGES / GX_PREFAULT set to anything but 0; returns the policy.
+const Policy &init_from_env();
+// "huge pages, prefault" style summary for startup logs.
+std::string describe(const Policy &p = policy());
+
+// bytes >= kMinBytes; throws std::bad_alloc.
+void *allocate(size_t bytes);
+void deallocate(void *p, size_t bytes) noexcept;
+
+// Anonymous memory of this process backed by transparent huge pages (Linux;
+// 0 elsewhere).
+size_t huge_page_bytes();
+
+template <typename T>
+class Allocator {
+public:
+    using value_type = T;
+
+    Allocator() noexcept = default;
+    template <typename U>
+    Allocator(const Allocator<U> &) noexcept {}
+
+    T *allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+        const size_t bytes = n * sizeof(T);
+        if (bytes >= kMinBytes) return static_cast<T *>(pages::allocate(bytes));
+        return static_cast<T *>(::operator new(bytes));
+    }
+    void deallocate(T *p, size_t n) noexcept {
+        if (n * sizeof(T) >= kMinBytes) {
+            pages::deallocate(p, n * sizeof(T));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    friend bool operator==(const Allocator &, const Allocator &) noexcept { return true; }
+    friend bool operator!=(const Allocator &, const Allocator &) noexcept { return false; }
+};
+
+template <typename T>
+using Vector = std::vector<T, Allocator<T>>;
+
+} // namespace pages
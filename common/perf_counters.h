@@ -0,0 +1,235 @@
+#pragma once
+// Hardware performance counters attributed to named code scopes.
+//
+// Each thread lazily opens one perf_event group (cycles, instructions, L1D read
+// misses, LLC references/misses, branch misses) that counts only that thread
+// in user space. A PerfScope reads the group on entry and exit and adds the
+// difference to a process-wide table keyed by scope name; the table is printed
+// with IPC and miss rates at exit.
+//
+// Enable with PERF_SCOPES=1. Reading the group is a syscall (~1 us), so place
+// scopes around loops and phases rather than around single calls like
+// intersect_sphere. If perf_event_open is not permitted (see
+// /proc/sys/kernel/perf_event_paranoid) the scopes stay disabled.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+enum Counter { kCycles, kInstructions, kL1DMisses, kLLCRefs, kLLCMisses, kBranchMisses, kCounterCount };
+
+struct Sample {
+    uint64_t value[kCounterCount] = {};
+};
+
+struct ScopeTotals {
+    uint64_t calls = 0;
+    double value[kCounterCount] = {};
+};
+
+namespace detail {
+
+struct State {
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> reported_failure{false};
+    std::mutex mutex;
+    std::map<std::string, ScopeTotals> scopes;
+    std::atomic<bool> supported[kCounterCount] = {}; // set by every thread that opens a group
+};
+
+inline State &state() {
+    static State s;
+    return s;
+}
+
+#ifdef __linux__
+struct ThreadGroup {
+    int leader = -1;
+    int slot[kCounterCount]; // position of each counter in the group read, -1 if unavailable
+    int members = 0;
+    int fds[kCounterCount];
+
+    ThreadGroup() {
+        std::fill(std::begin(slot), std::end(slot), -1);
+        const uint64_t cache_l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const struct {
+            uint32_t type;
+            uint64_t config;
+        } events[kCounterCount] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, cache_l1d_read_miss},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for (int c = 0; c < kCounterCount; ++c) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[c].type;
+            attr.config = events[c].config;
+            attr.disabled = leader < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) {
+                if (leader < 0) {
+                    report_failure();
+                    return; // without cycles there is no group to attach to
+                }
+                continue;
+            }
+            if (leader < 0) leader = fd;
+            fds[members] = fd;
+            slot[c] = members++;
+            state().supported[c].store(true, std::memory_order_relaxed);
+        }
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    ~ThreadGroup() {
+        for (int i = 0; i < members; ++i) close(fds[i]);
+    }
+
+    static void report_failure() {
+        if (!state().reported_failure.exchange(true)) {
+            std::fprintf(stderr, "perf: perf_event_open failed (%s); counters disabled. "
+                                 "The CPU may not expose a PMU (common in VMs) or "
+                                 "/proc/sys/kernel/perf_event_paranoid forbids access.\n",
+                         std::strerror(errno));
+        }
+    }
+
+    // Counts scaled for multiplexing; false if the group is unusable.
+    bool read(Sample &out) const {
+        if (leader < 0) return false;
+        uint64_t buf[3 + kCounterCount];
+        ssize_t n = ::read(leader, buf, sizeof(buf));
+        if (n < static_cast<ssize_t>(3 * sizeof(uint64_t))) return false;
+        const uint64_t nr = buf[0], enabled = buf[1], running = buf[2];
+        const double scale = running ? static_cast<double>(enabled) / static_cast<double>(running) : 0.0;
+        for (int c = 0; c < kCounterCount; ++c) {
+            out.value[c] = (slot[c] >= 0 && static_cast<uint64_t>(slot[c]) < nr)
+                               ? static_cast<uint64_t>(static_cast<double>(buf[3 + slot[c]]) * scale)
+                               : 0;
+        }
+        return true;
+    }
+};
+
+inline const ThreadGroup &thread_group() {
+    static thread_local ThreadGroup group;
+    return group;
+}
+#endif
+
+} // namespace detail
+
+inline bool enabled() { return detail::state().enabled.load(std::memory_order_relaxed); }
+
+inline void print_report(std::FILE *out) {
+    detail::State &s = detail::state();
+    std::lock_guard<std::mutex> lk(s.mutex);
+    if (s.scopes.empty()) return;
+    std::fprintf(out, "\n%-22s %8s %14s %14s %6s %9s %9s %9s %9s\n", "perf scope", "calls", "cycles", "instructions",
+                 "IPC", "L1D MPKI", "LLC miss%", "LLC MPKI", "br MPKI");
+    auto rate = [](bool ok, double num, double den, double k) { return ok && den > 0.0 ? num / den * k : -1.0; };
+    for (const auto &kv : s.scopes) {
+        const ScopeTotals &t = kv.second;
+        const double cyc = t.value[kCycles], ins = t.value[kInstructions];
+        bool ok[kCounterCount];
+        for (int c = 0; c < kCounterCount; ++c) ok[c] = s.supported[c].load(std::memory_order_relaxed);
+        const bool have_ins = ok[kInstructions];
+        double v[5] = {
+            rate(have_ins, ins, cyc, 1.0),
+            rate(have_ins && ok[kL1DMisses], t.value[kL1DMisses], ins, 1000.0),
+            rate(ok[kLLCRefs] && ok[kLLCMisses], t.value[kLLCMisses], t.value[kLLCRefs], 100.0),
+            rate(have_ins && ok[kLLCMisses], t.value[kLLCMisses], ins, 1000.0),
+            rate(have_ins && ok[kBranchMisses], t.value[kBranchMisses], ins, 1000.0),
+        };
+        std::fprintf(out, "%-22s %8llu %14.0f %14.0f", kv.first.c_str(), static_cast<unsigned long long>(t.calls),
+                     cyc, ins);
+        const int widths[5] = {6, 9, 9, 9, 9};
+        for (int i = 0; i < 5; ++i) {
+            if (v[i] < 0.0) {
+                std::fprintf(out, " %*s", widths[i], "n/a");
+            } else {
+                std::fprintf(out, " %*.2f", widths[i], v[i]);
+            }
+        }
+        std::fputc('\n', out);
+    }
+}
+
+// Enables counting if PERF_SCOPES is set to a non-zero value; the table is
+// printed to stderr at exit.
+inline bool init_from_env() {
+#ifdef __linux__
+    const char *env = std::getenv("PERF_SCOPES");
+    if (!env || !*env || std::strcmp(env, "0") == 0) return false;
+    detail::state().enabled.store(true, std::memory_order_relaxed);
+    std::atexit([] { print_report(stderr); });
+    return true;
+#else
+    return false;
+#endif
+}
+
+class PerfScope {
+public:
+    explicit PerfScope(const char *name) : name_(name) {
+#ifdef __linux__
+        active_ = enabled() && detail::thread_group().read(begin_);
+#endif
+    }
+
+    ~PerfScope() {
+#ifdef __linux__
+        if (!active_) return;
+        Sample end;
+        if (!detail::thread_group().read(end)) return;
+        detail::State &s = detail::state();
+        std::lock_guard<std::mutex> lk(s.mutex);
+        ScopeTotals &t = s.scopes[name_];
+        ++t.calls;
+        for (int c = 0; c < kCounterCount; ++c) {
+            t.value[c] += static_cast<double>(end.value[c] - std::min(end.value[c], begin_.value[c]));
+        }
+#endif
+    }
+
+    PerfScope(const PerfScope &) = delete;
+    PerfScope &operator=(const PerfScope &) = delete;
+
+private:
+    const char *name_;
+    bool active_ = false;
+    Sample begin_;
+};
+
+} // namespace perf
+
+#define PERF_CONCAT_INNER(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_INNER(a, b)
+#define PERF_SCOPE(name) ::perf::PerfScope PERF_CONCAT(perf_scope_, __LINE__)(name)
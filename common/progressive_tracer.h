@@ -0,0 +1,116 @@
+#pragma once
+// Progressive ray-traced stills of a mesh for obj_viewer's idle camera.
+//
+// start() traces the view again and again, one sample per pixel and pass,
+// and hands out every tile whose average got better (take()). Samples are
+// the viewer's shading (gl fragment shader: fixed light, Blinn-Phong, MTL
+// materials) with the light shadowed and the constant ambient floor scaled
+// by ambient occlusion, both from rays against a TriangleBvh. Pixels are
+// jittered within their footprint, so the average is antialiased as well.
+//
+// A dedicated thread builds the BVH once and then runs the passes; every
+// tile of a pass is its own job-system task, so a thread that helps out
+// while waiting (the viewer's main thread in the culler's parallel_for)
+// is held for at most one tile. cancel() returns at once; tasks of the old
+// view check it every row and stop, and their tiles are never handed out.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bvh.h"
+#include "math3d.h"
+#include "tiny_obj_loader.h"
+
+namespace gx {
+
+// The raster frame to reproduce (compute_matrices in obj_viewer)
+struct TraceView {
+    Mat4 model;     // model to world: lighting happens in world space
+    Mat4 modelview; // model to eye
+    Mat4 proj;
+    int width = 0, height = 0; // pixels
+};
+
+struct TraceTile {
+    int x = 0, y = 0, width = 0, height = 0; // pixels, y up from the bottom row
+    uint32_t samples = 0;
+    std::vector<uint8_t> rgba; // rows bottom to top; alpha fades the tile in over the first samples
+};
+
+struct TraceProgress {
+    bool bvh_ready = false;
+    size_t bvh_nodes = 0;
+    double bvh_ms = 0.0;
+    uint32_t samples = 0; // finished passes of the current view
+    uint64_t rays = 0;    // primary, shadow and occlusion rays of the current view
+    double ms = 0.0;      // since start()
+    bool converged = false;
+};
+
+struct TraceOptions {
+    uint32_t max_samples = 64;  // passes per view
+    uint32_t fade_samples = 4;  // passes until a tile covers the raster frame
+    float ao_distance = 0.3f;   // occlusion ray length, bounding radii
+};
+
+class ProgressiveTracer {
+public:
+    static constexpr int kTileSize = 32;
+
+    // vertices: kVertexStride floats each (position, normal), as uploaded;
+    // materials: one per MeshRange::material plus the default for
+    // kNoMaterial as the last entry. The mesh data must outlive the tracer.
+    ProgressiveTracer(const float *vertices, const unsigned int *indices, size_t index_count,
+                      const std::vector<tinyobj::MeshRange> &ranges, std::vector<tinyobj::Material> materials,
+                      float radius, const TraceOptions &opt = {});
+    ~ProgressiveTracer();
+
+    ProgressiveTracer(const ProgressiveTracer &) = delete;
+    ProgressiveTracer &operator=(const ProgressiveTracer &) = delete;
+
+    // Drops the current view and starts on this one.
+    void start(const TraceView &view);
+    // Stops the current view; never blocks.
+    void cancel();
+
+    // Appends the tiles finished since the last call. Never blocks: if a
+    // task is publishing right now, the tiles come with the next call.
+    bool take(std::vector<TraceTile> &tiles);
+    TraceProgress progress() const;
+
+private:
+    struct Job;
+
+    void loop();
+    void trace_tile(Job &job, size_t tile, uint32_t sample);
+
+    const float *vertices_;
+    const unsigned int *indices_;
+    size_t index_count_;
+    std::vector<uint32_t> triangle_material_;
+    std::vector<tinyobj::Material> materials_;
+    float radius_;
+    TraceOptions opt_;
+    TriangleBvh bvh_; // built by the thread
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::shared_ptr<Job> pending_;
+    std::shared_ptr<Job> current_; // guarded by mutex_ for progress()
+    TraceProgress bvh_progress_;
+    std::atomic<uint64_t> generation_{0};
+
+    std::mutex ready_mutex_;
+    std::vector<TraceTile> ready_;
+    std::atomic<bool> fresh_{false};
+
+    std::thread thread_;
+};
+
+} // namespace gx
@@ -0,0 +1,67 @@
+#pragma once
+// Ray/primitive intersection used by the ray tracer (and its benchmarks),
+// and hemisphere sampling for occlusion rays. Hits closer than kRayEpsilon
+// are ignored to avoid self-intersection.
+
+#include <algorithm>
+#include <cmath>
+
+#include "math3d.h"
+
+namespace gx {
+
+constexpr float kRayEpsilon = 1e-4f;
+
+struct Ray {
+    Vec3 o; // origin
+    Vec3 d; // direction (normalized)
+};
+
+// Nearest hit in front of the origin; normal points away from the center.
+inline bool intersect_sphere(const Ray &ray, const Vec3 &center, float radius, float &t, Vec3 &normal) {
+    Vec3 oc = ray.o - center;
+    float a = dot(ray.d, ray.d);
+    float b = 2.0f * dot(oc, ray.d);
+    float c = dot(oc, oc) - radius * radius;
+    float disc = b * b - 4 * a * c;
+    if (disc < 0.0f) return false;
+    float sqrt_disc = std::sqrt(disc);
+    float t0 = (-b - sqrt_disc) / (2 * a);
+    float t1 = (-b + sqrt_disc) / (2 * a);
+    float t_hit = t0;
+    if (t_hit < kRayEpsilon) t_hit = t1;
+    if (t_hit < kRayEpsilon) return false;
+    t = t_hit;
+    Vec3 hitPoint = ray.o + ray.d * t;
+    normal = normalize(hitPoint - center);
+    return true;
+}
+
+// Infinite plane n·p + d = 0.
+inline bool intersect_plane(const Ray &ray, const Vec3 &n, float d, float &t) {
+    float denom = dot(n, ray.d);
+    if (std::fabs(denom) < 1e-6f) return false; // 平行
+    float num = -(dot(n, ray.o) + d);
+    float t_hit = num / denom;
+    if (t_hit < kRayEpsilon) return false;
+    t = t_hit;
+    return true;
+}
+
+// Orthonormal basis around the unit vector n (Duff et al.)
+inline void orthonormal_basis(const Vec3 &n, Vec3 &t, Vec3 &b) {
+    const float sign = std::copysign(1.0f, n.z);
+    const float a = -1.0f / (sign + n.z);
+    const float c = n.x * n.y * a;
+    t = Vec3(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+    b = Vec3(c, sign + n.y * n.y * a, -n.y);
+}
+
+// Cosine-weighted direction in the hemisphere around n (basis t, b) for
+// r1, r2 uniform in [0, 1)
+inline Vec3 cosine_direction(const Vec3 &n, const Vec3 &t, const Vec3 &b, float r1, float r2) {
+    const float radius = std::sqrt(r1), phi = 2.0f * kPi * r2;
+    return t * (radius * std::cos(phi)) + b * (radius * std::sin(phi)) + n * std::sqrt(std::max(0.0f, 1.0f - r1));
+}
+
+} // namespace gx
@@ -0,0 +1,208 @@
+#pragma once
+// CPU side of obj_viewer's splat mode: packing Gaussian splats for the GPU and
+// sorting them back to front on a worker thread.
+//
+// SplatSorter never makes the render thread wait. The renderer posts the
+// current view with request() and picks up whichever order finished last with
+// take(); while the camera moves the drawn order lags by a frame or two, which
+// is invisible for alpha-blended splats at interactive rates.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gaussian_ply.h"
+#include "job_system.h"
+#include "trace.h"
+
+namespace gx {
+
+// Texels (RGBA32F) per splat in the splat data buffer:
+//   0: center.xyz, opacity   1: cov xx, xy, xz   2: cov yy, yz, zz   3: rgb
+constexpr size_t kSplatTexels = 4;
+constexpr size_t kSplatStride = kSplatTexels * 4;
+
+struct PackedSplats {
+    std::vector<float> data; // kSplatStride floats per splat
+    std::vector<float> centers; // x,y,z per splat, read by the sorter
+    size_t size() const { return centers.size() / 3; }
+};
+
+// Converts a gaussian-splatting capture: log-scales and rotation become a 3D
+// covariance, the DC spherical harmonic becomes the colour (plain red/green/
+// blue properties are used otherwise) and the opacity logit goes through a
+// sigmoid.
+inline bool pack_splats(const splat::SplatCloud &cloud, PackedSplats &out, std::string &err) {
+    const splat::SplatLayout layout = splat::SplatLayout::from(cloud);
+    if (!layout.valid()) {
+        err = "PLY is not a Gaussian splat capture (needs x/y/z, scale_*, rot_*, opacity)";
+        return false;
+    }
+    const int dc[3] = {cloud.find("f_dc_0"), cloud.find("f_dc_1"), cloud.find("f_dc_2")};
+    const int rgb[3] = {cloud.find("red"), cloud.find("green"), cloud.find("blue")};
+    const size_t n = cloud.size();
+    out.data.resize(n * kSplatStride);
+    out.centers.resize(n * 3);
+
+    jobs::parallel_for(0, n, 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const float *s = cloud.splat(i);
+            float *d = out.data.data() + i * kSplatStride;
+            for (int k = 0; k < 3; ++k) d[k] = out.centers[i * 3 + k] = s[layout.pos[k]];
+            d[3] = 1.0f / (1.0f + std::exp(-s[layout.opacity]));
+
+            float w = s[layout.rot[0]], x = s[layout.rot[1]], y = s[layout.rot[2]], z = s[layout.rot[3]];
+            float len = std::sqrt(w * w + x * x + y * y + z * z);
+            if (len < 1e-12f) {
+                w = 1.0f;
+                x = y = z = 0.0f;
+            } else {
+                w /= len, x /= len, y /= len, z /= len;
+            }
+            const float r[9] = {1 - 2 * (y * y + z * z), 2 * (x * y - w * z),     2 * (x * z + w * y),
+                                2 * (x * y + w * z),     1 - 2 * (x * x + z * z), 2 * (y * z - w * x),
+                                2 * (x * z - w * y),     2 * (y * z + w * x),     1 - 2 * (x * x + y * y)};
+            float s2[3];
+            for (int k = 0; k < 3; ++k) {
+                float sk = std::exp(s[layout.scale[k]]);
+                s2[k] = sk * sk;
+            }
+            // cov = R diag(s^2) R^T
+            auto cov = [&](int a, int b) {
+                return r[a * 3 + 0] * r[b * 3 + 0] * s2[0] + r[a * 3 + 1] * r[b * 3 + 1] * s2[1] +
+                       r[a * 3 + 2] * r[b * 3 + 2] * s2[2];
+            };
+            d[4] = cov(0, 0), d[5] = cov(0, 1), d[6] = cov(0, 2), d[7] = 0.0f;
+            d[8] = cov(1, 1), d[9] = cov(1, 2), d[10] = cov(2, 2), d[11] = 0.0f;
+
+            for (int k = 0; k < 3; ++k) {
+                float c = 0.5f;
+                if (dc[k] >= 0) {
+                    c = 0.5f + 0.28209479f * s[dc[k]]; // SH band 0
+                } else if (rgb[k] >= 0) {
+                    c = s[rgb[k]] / 255.0f;
+                }
+                d[12 + k] = std::clamp(c, 0.0f, 1.0f);
+            }
+            d[15] = 0.0f;
+        }
+    });
+    return true;
+}
+
+// Back-to-front ordering of splat centers on a dedicated thread. Depths are
+// computed on the job system, then ordered with a 16-bit counting sort, which
+// is linear in the splat count and precise enough for blending.
+class SplatSorter {
+public:
+    explicit SplatSorter(std::vector<float> centers) : centers_(std::move(centers)), thread_([this] { loop(); }) {}
+
+    ~SplatSorter() {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    SplatSorter(const SplatSorter &) = delete;
+    SplatSorter &operator=(const SplatSorter &) = delete;
+
+    // Sorts for view-space depth z = dot(row, (p, 1)), i.e. the third row of
+    // the model-view matrix. Superseded requests are dropped.
+    void request(const float row[4]) {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            std::copy(row, row + 4, pending_row_);
+            ++pending_seq_;
+        }
+        cv_.notify_one();
+    }
+
+    // Swaps the newest finished order into order (far to near) if there is
+    // one. Never blocks: if the worker is publishing right now, the caller
+    // keeps its current order for this frame.
+    bool take(std::vector<uint32_t> &order) {
+        if (!fresh_.load(std::memory_order_acquire)) return false;
+        std::unique_lock<std::mutex> lk(ready_mutex_, std::try_to_lock);
+        if (!lk.owns_lock()) return false;
+        order.swap(ready_);
+        fresh_.store(false, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    void loop() {
+        TRACE_THREAD_NAME("splat_sort");
+        uint64_t done_seq = 0;
+        std::vector<uint32_t> order;
+        for (;;) {
+            float row[4];
+            {
+                std::unique_lock<std::mutex> lk(mutex_);
+                cv_.wait(lk, [&] { return stop_ || pending_seq_ != done_seq; });
+                if (stop_) return;
+                std::copy(pending_row_, pending_row_ + 4, row);
+                done_seq = pending_seq_;
+            }
+            sort(row, order);
+            std::lock_guard<std::mutex> lk(ready_mutex_);
+            ready_.swap(order);
+            fresh_.store(true, std::memory_order_release);
+        }
+    }
+
+    void sort(const float row[4], std::vector<uint32_t> &order) {
+        TRACE_SCOPE("splat_sort");
+        const size_t n = centers_.size() / 3;
+        depth_.resize(n);
+        jobs::parallel_for(0, n, 16384, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const float *p = &centers_[i * 3];
+                depth_[i] = row[0] * p[0] + row[1] * p[1] + row[2] * p[2] + row[3];
+            }
+        });
+        float lo = 0.0f, hi = 0.0f;
+        if (n > 0) {
+            auto [mn, mx] = std::minmax_element(depth_.begin(), depth_.end());
+            lo = *mn, hi = *mx;
+        }
+        // GL looks down -z: the most negative depth is the farthest
+        const float scale = hi > lo ? 65535.0f / (hi - lo) : 0.0f;
+        keys_.resize(n);
+        counts_.assign(65536 + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            keys_[i] = static_cast<uint16_t>((depth_[i] - lo) * scale);
+            ++counts_[keys_[i] + 1];
+        }
+        for (size_t k = 1; k < counts_.size(); ++k) counts_[k] += counts_[k - 1];
+        order.resize(n);
+        for (size_t i = 0; i < n; ++i) order[counts_[keys_[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    const std::vector<float> centers_;
+    std::vector<float> depth_;
+    std::vector<uint16_t> keys_;
+    std::vector<uint32_t> counts_;
+
+    std::mutex mutex_; // pending request
+    std::condition_variable cv_;
+    float pending_row_[4] = {0, 0, 0, 0};
+    uint64_t pending_seq_ = 0;
+    bool stop_ = false;
+
+    std::mutex ready_mutex_; // published order
+    std::vector<uint32_t> ready_;
+    std::atomic<bool> fresh_{false};
+
+    std::thread thread_; // last: starts after the members above exist
+};
+
+} // namespace gx
@@ -0,0 +1,88 @@
+#include "ao_bake.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "bvh.h"
+#include "job_system.h"
+#include "mesh_utils.h"
+#include "trace.h"
+
+namespace gx {
+
+namespace {
+
+constexpr float kOffset = 2e-4f; // ray origins off the surface, bounding radii
+
+// Van der Corput radical inverse in base 2
+float radical_inverse(uint32_t i) {
+    i = (i << 16) | (i >> 16);
+    i = ((i & 0x55555555u) << 1) | ((i & 0xaaaaaaaau) >> 1);
+    i = ((i & 0x33333333u) << 2) | ((i & 0xccccccccu) >> 2);
+    i = ((i & 0x0f0f0f0fu) << 4) | ((i & 0xf0f0f0f0u) >> 4);
+    i = ((i & 0x00ff00ffu) << 8) | ((i & 0xff00ff00u) >> 8);
+    return static_cast<float>(i >> 8) * (1.0f / 16777216.0f);
+}
+
+float wrap(float x) { return x >= 1.0f ? x - 1.0f : x; }
+
+} // namespace
+
+pages::Vector<float> bake_vertex_ao(const float *vertices, size_t vertex_count, const unsigned int *indices,
+                                    size_t index_count, float radius, const AoBakeOptions &opt, AoBakeStats *stats) {
+    TRACE_SCOPE("bake_ao");
+    const auto t0 = std::chrono::steady_clock::now();
+    pages::Vector<float> ao(vertex_count, 1.0f);
+    const TriangleBvh bvh(PositionView{vertices, kVertexStride}, indices, index_count);
+
+    const uint32_t rays = std::max<uint32_t>(4, (opt.rays + 3) / 4 * 4);
+    std::vector<float> r1(rays), r2(rays);
+    for (uint32_t i = 0; i < rays; ++i) {
+        r1[i] = (static_cast<float>(i) + 0.5f) / static_cast<float>(rays);
+        r2[i] = radical_inverse(i);
+    }
+    const float eps = kOffset * radius, distance = opt.distance * radius;
+    std::atomic<uint64_t> traced{0};
+    if (!bvh.empty()) {
+        jobs::parallel_for(0, vertex_count, 1024, [&](size_t lo, size_t hi) {
+            uint64_t local = 0;
+            for (size_t i = lo; i < hi; ++i) {
+                const float *v = &vertices[i * kVertexStride];
+                const Vec3 n(v[3], v[4], v[5]);
+                const float len = length(n);
+                if (!(len > 0.0f)) continue;
+                const Vec3 normal = n / len;
+                Vec3 t, b;
+                orthonormal_basis(normal, t, b);
+                const Vec3 origin = Vec3(v[0], v[1], v[2]) + normal * eps;
+                // R2 sequence offsets decorrelate neighbouring vertices
+                const float s1 = static_cast<float>(std::fmod(static_cast<double>(i) * 0.7548776662, 1.0));
+                const float s2 = static_cast<float>(std::fmod(static_cast<double>(i) * 0.5698402910, 1.0));
+                uint32_t blocked = 0;
+                for (uint32_t r = 0; r < rays; r += 4) {
+                    Ray packet[4];
+                    for (uint32_t k = 0; k < 4; ++k) {
+                        packet[k] = Ray{origin, cosine_direction(normal, t, b, wrap(r1[r + k] + s1), wrap(r2[r + k] + s2))};
+                    }
+                    const unsigned mask = bvh.occluded4(packet, 0.0f, distance);
+                    blocked += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+                }
+                ao[i] = 1.0f - static_cast<float>(blocked) / static_cast<float>(rays);
+                local += rays;
+            }
+            traced.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+    if (stats) {
+        stats->rays = traced.load();
+        stats->bvh_ms = bvh.build_ms();
+        stats->ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        stats->threads = jobs::JobSystem::instance().concurrency();
+    }
+    return ao;
+}
+
+} // namespace gx
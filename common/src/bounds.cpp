@@ -0,0 +1,245 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GX_BOUNDS_SSE2 1
+#endif
+
+#include "job_system.h"
+#include "trace.h"
+
+namespace gx {
+
+namespace {
+
+constexpr size_t kGrain = 16384;
+constexpr float kMax = std::numeric_limits<float>::max();
+
+// Eigenvectors of a symmetric 3x3 matrix (cyclic Jacobi), as the columns of
+// v, sorted by decreasing eigenvalue.
+void symmetric_eigen(double a[3][3], double v[3][3]) {
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) v[i][j] = i == j ? 1.0 : 0.0;
+    }
+    for (int sweep = 0; sweep < 32; ++sweep) {
+        const double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        const double diag = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+        if (off <= 1e-24 * diag || off == 0.0) break;
+        for (int p = 0; p < 2; ++p) {
+            for (int q = p + 1; q < 3; ++q) {
+                if (a[p][q] == 0.0) continue;
+                const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                const double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+                for (int k = 0; k < 3; ++k) { // A = A J
+                    const double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; ++k) { // A = J^T A
+                    const double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    const double vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    // Selection sort of the columns by eigenvalue
+    for (int i = 0; i < 2; ++i) {
+        int best = i;
+        for (int j = i + 1; j < 3; ++j) {
+            if (a[j][j] > a[best][best]) best = j;
+        }
+        if (best == i) continue;
+        std::swap(a[i][i], a[best][best]);
+        for (int k = 0; k < 3; ++k) std::swap(v[k][i], v[k][best]);
+    }
+}
+
+} // namespace
+
+BoundsAccumulator::BoundsAccumulator(const float *positions, size_t count, size_t grain)
+    : positions_(positions), count_(count), grain_(std::max<size_t>(grain, 1)),
+      blocks_((count + grain_ - 1) / grain_) {
+    if (count) std::copy(positions, positions + 3, ref_);
+}
+
+void BoundsAccumulator::add(size_t lo, size_t hi) {
+    // Single-threaded pools run the whole range at once
+    while (lo < hi) {
+        const size_t end = std::min(hi, (lo / grain_ + 1) * grain_);
+        add_block(lo, end);
+        lo = end;
+    }
+}
+
+void BoundsAccumulator::add_block(size_t lo, size_t hi) {
+    Block &b = blocks_[lo / grain_];
+    const float *p = positions_;
+    size_t i = lo;
+#ifdef GX_BOUNDS_SSE2
+    // One point per register (x, y, z, next x); lane 3 is ignored
+    const __m128 ref = _mm_loadu_ps(ref_);
+    __m128 vmin = _mm_set1_ps(kMax), vmax = _mm_set1_ps(-kMax);
+    __m128 sum = _mm_setzero_ps(), sq = _mm_setzero_ps(), cross = _mm_setzero_ps();
+    const size_t simd_end = std::min(hi, count_ - 1); // the last point has no 4th float
+    for (; i < simd_end; ++i) {
+        const __m128 v = _mm_loadu_ps(p + i * 3);
+        vmin = _mm_min_ps(vmin, v);
+        vmax = _mm_max_ps(vmax, v);
+        const __m128 d = _mm_sub_ps(v, ref);
+        sum = _mm_add_ps(sum, d);
+        sq = _mm_add_ps(sq, _mm_mul_ps(d, d));
+        cross = _mm_add_ps(cross, _mm_mul_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 0, 2, 1))));
+    }
+    float lanes[5][4];
+    _mm_storeu_ps(lanes[0], vmin);
+    _mm_storeu_ps(lanes[1], vmax);
+    _mm_storeu_ps(lanes[2], sum);
+    _mm_storeu_ps(lanes[3], sq);
+    _mm_storeu_ps(lanes[4], cross);
+    for (int k = 0; k < 3; ++k) {
+        b.min[k] = std::min(b.min[k], lanes[0][k]);
+        b.max[k] = std::max(b.max[k], lanes[1][k]);
+        b.sum[k] += lanes[2][k];
+        b.sq[k] += lanes[3][k];
+        b.cross[k] += lanes[4][k];
+    }
+#endif
+    float fsum[3] = {0, 0, 0}, fsq[3] = {0, 0, 0}, fcross[3] = {0, 0, 0};
+    for (; i < hi; ++i) {
+        float d[3];
+        for (int k = 0; k < 3; ++k) {
+            const float v = p[i * 3 + k];
+            b.min[k] = std::min(b.min[k], v);
+            b.max[k] = std::max(b.max[k], v);
+            d[k] = v - ref_[k];
+        }
+        for (int k = 0; k < 3; ++k) {
+            fsum[k] += d[k];
+            fsq[k] += d[k] * d[k];
+            fcross[k] += d[k] * d[(k + 1) % 3];
+        }
+    }
+    for (int k = 0; k < 3; ++k) {
+        b.sum[k] += fsum[k];
+        b.sq[k] += fsq[k];
+        b.cross[k] += fcross[k];
+    }
+    b.count += hi - lo;
+}
+
+MeshBounds BoundsAccumulator::finish() const {
+    TRACE_SCOPE("bounds");
+    MeshBounds out;
+    double sum[3] = {0, 0, 0}, sq[3] = {0, 0, 0}, mixed[3] = {0, 0, 0};
+    float lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+    bool first = true;
+    for (const Block &b : blocks_) {
+        if (!b.count) continue;
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = first ? b.min[k] : std::min(lo[k], b.min[k]);
+            hi[k] = first ? b.max[k] : std::max(hi[k], b.max[k]);
+            sum[k] += b.sum[k];
+            sq[k] += b.sq[k];
+            mixed[k] += b.cross[k];
+        }
+        first = false;
+        out.count += b.count;
+    }
+    if (!out.count) return out;
+    out.box = Aabb{Vec3(lo[0], lo[1], lo[2]), Vec3(hi[0], hi[1], hi[2])};
+    const Vec3 c = (out.box.min + out.box.max) * 0.5f;
+
+    // Principal axes
+    const double n = static_cast<double>(out.count);
+    const double m[3] = {sum[0] / n, sum[1] / n, sum[2] / n};
+    double cov[3][3], axes[3][3];
+    for (int k = 0; k < 3; ++k) {
+        cov[k][k] = sq[k] / n - m[k] * m[k];
+        const int j = (k + 1) % 3;
+        cov[k][j] = cov[j][k] = mixed[k] / n - m[k] * m[j];
+    }
+    symmetric_eigen(cov, axes);
+    Vec3 axis[3];
+    for (int a = 0; a < 3; ++a) axis[a] = Vec3(float(axes[0][a]), float(axes[1][a]), float(axes[2][a]));
+    axis[2] = normalize(cross(axis[0], axis[1])); // right-handed, exactly orthogonal
+
+    // Second pass: distance to the box center and extents along the axes
+    struct Extent {
+        float max_d2 = 0.0f;
+        float lo[4] = {kMax, kMax, kMax, kMax}, hi[4] = {-kMax, -kMax, -kMax, -kMax};
+    };
+    std::vector<Extent> extents(blocks_.size());
+    const float *p = positions_;
+    jobs::parallel_for(0, count_, grain_, [&](size_t b, size_t e) {
+        Extent &x = extents[b / grain_];
+        size_t i = b;
+#ifdef GX_BOUNDS_SSE2
+        // q = R (v - c) with the axes as rows of R; |q| = |v - c|
+        const __m128 center = _mm_setr_ps(c.x, c.y, c.z, 0.0f);
+        const __m128 c0 = _mm_setr_ps(axis[0].x, axis[1].x, axis[2].x, 0.0f);
+        const __m128 c1 = _mm_setr_ps(axis[0].y, axis[1].y, axis[2].y, 0.0f);
+        const __m128 c2 = _mm_setr_ps(axis[0].z, axis[1].z, axis[2].z, 0.0f);
+        __m128 qmin = _mm_loadu_ps(x.lo), qmax = _mm_loadu_ps(x.hi), d2max = _mm_setzero_ps();
+        for (const size_t end = std::min(e, count_ - 1); i < end; ++i) {
+            const __m128 d = _mm_sub_ps(_mm_loadu_ps(p + i * 3), center);
+            const __m128 q = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(d, d, 0x00), c0),
+                                                   _mm_mul_ps(_mm_shuffle_ps(d, d, 0x55), c1)),
+                                        _mm_mul_ps(_mm_shuffle_ps(d, d, 0xAA), c2));
+            qmin = _mm_min_ps(qmin, q);
+            qmax = _mm_max_ps(qmax, q);
+            __m128 s = _mm_mul_ps(q, q);
+            s = _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 3, 0, 1)));
+            s = _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+            d2max = _mm_max_ps(d2max, s);
+        }
+        _mm_storeu_ps(x.lo, qmin);
+        _mm_storeu_ps(x.hi, qmax);
+        x.max_d2 = _mm_cvtss_f32(d2max);
+#endif
+        for (; i < e; ++i) {
+            const Vec3 d = Vec3(p[i * 3], p[i * 3 + 1], p[i * 3 + 2]) - c;
+            for (int a = 0; a < 3; ++a) {
+                const float q = dot(axis[a], d);
+                x.lo[a] = std::min(x.lo[a], q);
+                x.hi[a] = std::max(x.hi[a], q);
+            }
+            x.max_d2 = std::max(x.max_d2, dot(d, d));
+        }
+    });
+
+    float max_d2 = 0.0f, qlo[3] = {kMax, kMax, kMax}, qhi[3] = {-kMax, -kMax, -kMax};
+    for (const Extent &x : extents) {
+        max_d2 = std::max(max_d2, x.max_d2);
+        for (int a = 0; a < 3; ++a) {
+            qlo[a] = std::min(qlo[a], x.lo[a]);
+            qhi[a] = std::max(qhi[a], x.hi[a]);
+        }
+    }
+    out.sphere = Sphere{c, std::sqrt(max_d2)};
+    out.obb.center = c;
+    for (int a = 0; a < 3; ++a) {
+        out.obb.axis[a] = axis[a];
+        out.obb.center = out.obb.center + axis[a] * (0.5f * (qlo[a] + qhi[a]));
+    }
+    out.obb.half = Vec3(0.5f * (qhi[0] - qlo[0]), 0.5f * (qhi[1] - qlo[1]), 0.5f * (qhi[2] - qlo[2]));
+    return out;
+}
+
+MeshBounds compute_bounds(const float *positions, size_t count) {
+    BoundsAccumulator acc(positions, count, kGrain);
+    jobs::parallel_for(0, count, kGrain, [&](size_t lo, size_t hi) { acc.add(lo, hi); });
+    return acc.finish();
+}
+
+} // namespace gx
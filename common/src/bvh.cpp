@@ -0,0 +1,378 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "job_system.h"
+#include "trace.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GX_BVH_SSE2 1
+#endif
+
+namespace gx {
+
+namespace {
+
+constexpr float kInf = std::numeric_limits<float>::infinity();
+// Below this depth only median splits, which halve the triangle count: trees
+// stay within kStackSize levels for any input
+constexpr int kSahDepth = 64;
+constexpr int kStackSize = 128;
+
+float half_area(const float *lo, const float *hi) {
+    const float dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+    return dx * dy + dy * dz + dz * dx;
+}
+
+void grow(float *lo, float *hi, const float *box_lo, const float *box_hi) {
+    for (int k = 0; k < 3; ++k) {
+        lo[k] = std::min(lo[k], box_lo[k]);
+        hi[k] = std::max(hi[k], box_hi[k]);
+    }
+}
+
+// Ray with the reciprocal direction for the slab tests; zero components are
+// nudged so that the reciprocal stays finite
+struct RayData {
+    float o[3], d[3], inv[3];
+
+    explicit RayData(const Ray &ray) : o{ray.o.x, ray.o.y, ray.o.z}, d{ray.d.x, ray.d.y, ray.d.z} {
+        for (int k = 0; k < 3; ++k) {
+            const float dk = std::fabs(d[k]) > 1e-20f ? d[k] : std::copysign(1e-20f, d[k]);
+            inv[k] = 1.0f / dk;
+        }
+    }
+};
+
+// Entry distance into the box, or infinity when the ray misses it within
+// [t_min, t_max]
+template <typename Node>
+float enter(const Node &n, const RayData &r, float t_min, float t_max) {
+    float t0 = t_min, t1 = t_max;
+    for (int k = 0; k < 3; ++k) {
+        float a = (n.min[k] - r.o[k]) * r.inv[k];
+        float b = (n.max[k] - r.o[k]) * r.inv[k];
+        if (a > b) std::swap(a, b);
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+    }
+    return t0 <= t1 ? t0 : kInf;
+}
+
+// Möller-Trumbore against a triangle stored as v0, e1, e2
+bool hit_triangle(const float *tri, const RayData &r, float t_min, float t_max, float &t, float &u, float &v) {
+    const float *v0 = tri, *e1 = tri + 3, *e2 = tri + 6;
+    const float p[3] = {r.d[1] * e2[2] - r.d[2] * e2[1], r.d[2] * e2[0] - r.d[0] * e2[2], r.d[0] * e2[1] - r.d[1] * e2[0]};
+    const float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    if (std::fabs(det) < 1e-20f) return false;
+    const float inv = 1.0f / det;
+    const float s[3] = {r.o[0] - v0[0], r.o[1] - v0[1], r.o[2] - v0[2]};
+    u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+    if (u < 0.0f || u > 1.0f) return false;
+    const float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+    v = (r.d[0] * q[0] + r.d[1] * q[1] + r.d[2] * q[2]) * inv;
+    if (v < 0.0f || u + v > 1.0f) return false;
+    t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+    return t > t_min && t < t_max;
+}
+
+} // namespace
+
+TriangleBvh::TriangleBvh(PositionView positions, const unsigned int *indices, size_t index_count) {
+    TRACE_SCOPE("bvh_build");
+    const auto t0 = std::chrono::steady_clock::now();
+    const size_t count = index_count / 3;
+    if (count == 0) return;
+
+    // Bounds and centroid per triangle
+    pages::Vector<float> boxes(count * 6), centroids(count * 3);
+    jobs::parallel_for(0, count, 16384, [&](size_t lo, size_t hi) {
+        for (size_t t = lo; t < hi; ++t) {
+            const float *p[3] = {positions[indices[t * 3]], positions[indices[t * 3 + 1]], positions[indices[t * 3 + 2]]};
+            for (int k = 0; k < 3; ++k) {
+                const float a = std::min({p[0][k], p[1][k], p[2][k]}), b = std::max({p[0][k], p[1][k], p[2][k]});
+                boxes[t * 6 + k] = a;
+                boxes[t * 6 + 3 + k] = b;
+                centroids[t * 3 + k] = 0.5f * (a + b);
+            }
+        }
+    });
+    pages::Vector<uint32_t> order(count);
+    for (uint32_t t = 0; t < count; ++t) order[t] = t;
+    nodes_.reserve(2 * count / kMaxLeaf + 1);
+    build(order, 0, count, boxes, centroids, 0);
+
+    // Leaf-order copies of the triangles
+    ids_ = std::move(order);
+    triangles_.resize(count * 9);
+    jobs::parallel_for(0, count, 16384, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            const unsigned int *idx = &indices[static_cast<size_t>(ids_[i]) * 3];
+            const float *a = positions[idx[0]], *b = positions[idx[1]], *c = positions[idx[2]];
+            float *out = &triangles_[i * 9];
+            for (int k = 0; k < 3; ++k) {
+                out[k] = a[k];
+                out[3 + k] = b[k] - a[k];
+                out[6 + k] = c[k] - a[k];
+            }
+        }
+    });
+    build_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+uint32_t TriangleBvh::build(pages::Vector<uint32_t> &order, size_t begin, size_t end, const pages::Vector<float> &boxes,
+                            const pages::Vector<float> &centroids, int depth) {
+    const uint32_t index = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+    float lo[3] = {kInf, kInf, kInf}, hi[3] = {-kInf, -kInf, -kInf};
+    float clo[3] = {kInf, kInf, kInf}, chi[3] = {-kInf, -kInf, -kInf};
+    for (size_t i = begin; i < end; ++i) {
+        grow(lo, hi, &boxes[order[i] * 6], &boxes[order[i] * 6 + 3]);
+        const float *c = &centroids[order[i] * 3];
+        grow(clo, chi, c, c);
+    }
+    {
+        Node &node = nodes_[index];
+        std::copy(lo, lo + 3, node.min);
+        std::copy(hi, hi + 3, node.max);
+    }
+    const size_t n = end - begin;
+    const auto make_leaf = [&] {
+        nodes_[index].index = static_cast<uint32_t>(begin);
+        nodes_[index].count = static_cast<uint32_t>(n);
+        return index;
+    };
+    if (n <= 1) return make_leaf();
+
+    int axis = 0;
+    for (int k = 1; k < 3; ++k) {
+        if (chi[k] - clo[k] > chi[axis] - clo[axis]) axis = k;
+    }
+    const float extent = chi[axis] - clo[axis];
+    size_t mid = begin;
+    if (extent > 0.0f && depth < kSahDepth) {
+        // Binned SAH: cost of each split between bins, relative to the parent
+        struct Bin {
+            float lo[3] = {kInf, kInf, kInf}, hi[3] = {-kInf, -kInf, -kInf};
+            size_t count = 0;
+        } bins[kBins];
+        const float scale = kBins / extent;
+        const auto bin_of = [&](uint32_t t) {
+            return std::min(kBins - 1, static_cast<int>((centroids[t * 3 + axis] - clo[axis]) * scale));
+        };
+        for (size_t i = begin; i < end; ++i) {
+            Bin &b = bins[bin_of(order[i])];
+            grow(b.lo, b.hi, &boxes[order[i] * 6], &boxes[order[i] * 6 + 3]);
+            ++b.count;
+        }
+        float right_area[kBins];
+        size_t right_count[kBins];
+        float rlo[3] = {kInf, kInf, kInf}, rhi[3] = {-kInf, -kInf, -kInf};
+        size_t rn = 0;
+        for (int b = kBins - 1; b > 0; --b) {
+            grow(rlo, rhi, bins[b].lo, bins[b].hi);
+            rn += bins[b].count;
+            right_area[b] = rn ? half_area(rlo, rhi) : 0.0f;
+            right_count[b] = rn;
+        }
+        float llo[3] = {kInf, kInf, kInf}, lhi[3] = {-kInf, -kInf, -kInf};
+        size_t ln = 0;
+        float best_cost = kInf;
+        int best = -1;
+        for (int b = 0; b < kBins - 1; ++b) {
+            grow(llo, lhi, bins[b].lo, bins[b].hi);
+            ln += bins[b].count;
+            if (ln == 0 || right_count[b + 1] == 0) continue;
+            const float cost = half_area(llo, lhi) * ln + right_area[b + 1] * right_count[b + 1];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = b;
+            }
+        }
+        // A leaf costs one intersection per triangle, a split one box test
+        // plus the expected intersections of both children
+        const float parent = half_area(lo, hi);
+        const float split_cost = parent > 0.0f ? 1.0f + best_cost / parent : kInf;
+        if (n <= kMaxLeaf && !(split_cost < static_cast<float>(n))) return make_leaf();
+        if (best >= 0) {
+            mid = static_cast<size_t>(
+                std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t t) { return bin_of(t) <= best; }) -
+                order.begin());
+        }
+    } else if (n <= kMaxLeaf) {
+        return make_leaf();
+    }
+    if (mid == begin || mid == end) {
+        // Median split by centroid
+        mid = begin + n / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&](uint32_t a, uint32_t b) { return centroids[a * 3 + axis] < centroids[b * 3 + axis]; });
+    }
+
+    build(order, begin, mid, boxes, centroids, depth + 1);
+    const uint32_t right = build(order, mid, end, boxes, centroids, depth + 1);
+    nodes_[index].index = right;
+    nodes_[index].count = 0;
+    return index;
+}
+
+Aabb TriangleBvh::bounds() const {
+    if (nodes_.empty()) return {};
+    const Node &root = nodes_[0];
+    return {Vec3(root.min[0], root.min[1], root.min[2]), Vec3(root.max[0], root.max[1], root.max[2])};
+}
+
+bool TriangleBvh::intersect(const Ray &ray, float t_min, float t_max, RayHit &hit) const {
+    if (nodes_.empty()) return false;
+    const RayData r(ray);
+    if (enter(nodes_[0], r, t_min, t_max) == kInf) return false;
+    bool found = false;
+    uint32_t stack[kStackSize];
+    int top = 0;
+    uint32_t node = 0;
+    for (;;) {
+        const Node &n = nodes_[node];
+        if (n.count) {
+            for (uint32_t i = n.index; i < n.index + n.count; ++i) {
+                float t, u, v;
+                if (hit_triangle(&triangles_[static_cast<size_t>(i) * 9], r, t_min, t_max, t, u, v)) {
+                    t_max = t;
+                    hit = {t, u, v, ids_[i]};
+                    found = true;
+                }
+            }
+        } else {
+            // Nearer child first, the other one later if it is still in reach
+            uint32_t a = node + 1, b = n.index;
+            float ta = enter(nodes_[a], r, t_min, t_max), tb = enter(nodes_[b], r, t_min, t_max);
+            if (tb < ta) {
+                std::swap(a, b);
+                std::swap(ta, tb);
+            }
+            if (ta != kInf) {
+                if (tb != kInf) stack[top++] = b;
+                node = a;
+                continue;
+            }
+        }
+        // Pop, skipping nodes beyond the nearest hit so far
+        for (;;) {
+            if (top == 0) return found;
+            node = stack[--top];
+            if (enter(nodes_[node], r, t_min, t_max) != kInf) break;
+        }
+    }
+}
+
+bool TriangleBvh::occluded(const Ray &ray, float t_min, float t_max) const {
+    if (nodes_.empty()) return false;
+    const RayData r(ray);
+    uint32_t stack[kStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top) {
+        const uint32_t node = stack[--top];
+        const Node &n = nodes_[node];
+        if (enter(n, r, t_min, t_max) == kInf) continue;
+        if (n.count) {
+            for (uint32_t i = n.index; i < n.index + n.count; ++i) {
+                float t, u, v;
+                if (hit_triangle(&triangles_[static_cast<size_t>(i) * 9], r, t_min, t_max, t, u, v)) return true;
+            }
+        } else {
+            stack[top++] = n.index;
+            stack[top++] = node + 1;
+        }
+    }
+    return false;
+}
+
+unsigned TriangleBvh::occluded4(const Ray rays[4], float t_min, float t_max) const {
+    if (nodes_.empty()) return 0;
+#ifdef GX_BVH_SSE2
+    // Component k of the four rays in one register each
+    __m128 o[3], d[3], inv[3];
+    {
+        const RayData r[4] = {RayData(rays[0]), RayData(rays[1]), RayData(rays[2]), RayData(rays[3])};
+        for (int k = 0; k < 3; ++k) {
+            o[k] = _mm_setr_ps(r[0].o[k], r[1].o[k], r[2].o[k], r[3].o[k]);
+            d[k] = _mm_setr_ps(r[0].d[k], r[1].d[k], r[2].d[k], r[3].d[k]);
+            inv[k] = _mm_setr_ps(r[0].inv[k], r[1].inv[k], r[2].inv[k], r[3].inv[k]);
+        }
+    }
+    const __m128 lo = _mm_set1_ps(t_min), hi = _mm_set1_ps(t_max);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), eps = _mm_set1_ps(1e-20f);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const auto cross = [](const __m128 *a, const float *b, __m128 *out) {
+        const __m128 b0 = _mm_set1_ps(b[0]), b1 = _mm_set1_ps(b[1]), b2 = _mm_set1_ps(b[2]);
+        out[0] = _mm_sub_ps(_mm_mul_ps(a[1], b2), _mm_mul_ps(a[2], b1));
+        out[1] = _mm_sub_ps(_mm_mul_ps(a[2], b0), _mm_mul_ps(a[0], b2));
+        out[2] = _mm_sub_ps(_mm_mul_ps(a[0], b1), _mm_mul_ps(a[1], b0));
+    };
+    const auto dot = [](const __m128 *a, const __m128 *b) {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])), _mm_mul_ps(a[2], b[2]));
+    };
+    const auto dot1 = [](const float *a, const __m128 *b) {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), b[0]), _mm_mul_ps(_mm_set1_ps(a[1]), b[1])),
+                          _mm_mul_ps(_mm_set1_ps(a[2]), b[2]));
+    };
+
+    unsigned blocked = 0;
+    uint32_t stack[kStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top) {
+        const uint32_t node = stack[--top];
+        const Node &n = nodes_[node];
+        __m128 t0 = lo, t1 = hi;
+        for (int k = 0; k < 3; ++k) {
+            const __m128 a = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n.min[k]), o[k]), inv[k]);
+            const __m128 b = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n.max[k]), o[k]), inv[k]);
+            t0 = _mm_max_ps(t0, _mm_min_ps(a, b));
+            t1 = _mm_min_ps(t1, _mm_max_ps(a, b));
+        }
+        // Only rays that are still open need the node
+        if (!(static_cast<unsigned>(_mm_movemask_ps(_mm_cmple_ps(t0, t1))) & ~blocked)) continue;
+        if (n.count) {
+            for (uint32_t i = n.index; i < n.index + n.count; ++i) {
+                // Möller-Trumbore as in hit_triangle; a ray that misses the
+                // node cannot hit its triangles within [t_min, t_max]
+                const float *tri = &triangles_[static_cast<size_t>(i) * 9];
+                __m128 p[3], s[3], q[3];
+                cross(d, tri + 6, p);
+                const __m128 det = dot1(tri + 3, p);
+                const __m128 inv_det = _mm_div_ps(one, det);
+                for (int k = 0; k < 3; ++k) s[k] = _mm_sub_ps(o[k], _mm_set1_ps(tri[k]));
+                const __m128 u = _mm_mul_ps(dot(s, p), inv_det);
+                cross(s, tri + 3, q);
+                const __m128 v = _mm_mul_ps(dot(d, q), inv_det);
+                const __m128 t = _mm_mul_ps(dot1(tri + 6, q), inv_det);
+                __m128 hit = _mm_cmpge_ps(_mm_and_ps(det, abs_mask), eps);
+                hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+                hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+                hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+                hit = _mm_and_ps(hit, _mm_cmpgt_ps(t, lo));
+                hit = _mm_and_ps(hit, _mm_cmplt_ps(t, hi));
+                blocked |= static_cast<unsigned>(_mm_movemask_ps(hit));
+            }
+            if (blocked == 0xf) return blocked;
+        } else {
+            stack[top++] = n.index;
+            stack[top++] = node + 1;
+        }
+    }
+    return blocked;
+#else
+    unsigned blocked = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (occluded(rays[i], t_min, t_max)) blocked |= 1u << i;
+    }
+    return blocked;
+#endif
+}
+
+} // namespace gx
@@ -0,0 +1,292 @@
+#include "deform.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GX_DEFORM_SSE2 1
+#endif
+
+#include "job_system.h"
+#include "mesh_utils.h"
+#include "trace.h"
+
+namespace gx {
+
+namespace {
+
+constexpr size_t kBlock = 4096;  // vertices per job, multiple of 4
+constexpr uint32_t kMergeGap = 32; // vertices between ranges that are merged
+
+float smoothstep01(float h) {
+    h = std::min(std::max(h, 0.0f), 1.0f);
+    return h * h * (3.0f - 2.0f * h);
+}
+
+#ifdef GX_DEFORM_SSE2
+// sin and cos of four angles: reduction to [-pi, pi], folding to
+// [-pi/2, pi/2] and Taylor polynomials (error below 1e-7 there).
+inline void sincos4(__m128 x, __m128 &s, __m128 &c) {
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 k = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.15915494f))));
+    x = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(6.28318531f)));
+
+    // sin(pi - x) = sin(x), cos(pi - x) = -cos(x)
+    const __m128 sign = _mm_and_ps(x, sign_mask);
+    __m128 ax = _mm_andnot_ps(sign_mask, x);
+    const __m128 fold = _mm_cmpgt_ps(ax, _mm_set1_ps(1.57079633f));
+    ax = _mm_or_ps(_mm_and_ps(fold, _mm_sub_ps(_mm_set1_ps(3.14159265f), ax)), _mm_andnot_ps(fold, ax));
+    const __m128 xr = _mm_or_ps(ax, sign);
+    const __m128 x2 = _mm_mul_ps(xr, xr);
+
+    __m128 ps = _mm_set1_ps(-2.5052108e-8f);
+    ps = _mm_add_ps(_mm_mul_ps(ps, x2), _mm_set1_ps(2.7557319e-6f));
+    ps = _mm_add_ps(_mm_mul_ps(ps, x2), _mm_set1_ps(-1.9841270e-4f));
+    ps = _mm_add_ps(_mm_mul_ps(ps, x2), _mm_set1_ps(8.3333333e-3f));
+    ps = _mm_add_ps(_mm_mul_ps(ps, x2), _mm_set1_ps(-1.6666667e-1f));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, x2), xr), xr);
+
+    __m128 pc = _mm_set1_ps(2.0876757e-9f);
+    pc = _mm_add_ps(_mm_mul_ps(pc, x2), _mm_set1_ps(-2.7557319e-7f));
+    pc = _mm_add_ps(_mm_mul_ps(pc, x2), _mm_set1_ps(2.4801587e-5f));
+    pc = _mm_add_ps(_mm_mul_ps(pc, x2), _mm_set1_ps(-1.3888889e-3f));
+    pc = _mm_add_ps(_mm_mul_ps(pc, x2), _mm_set1_ps(4.1666667e-2f));
+    pc = _mm_add_ps(_mm_mul_ps(pc, x2), _mm_set1_ps(-0.5f));
+    c = _mm_add_ps(_mm_mul_ps(pc, x2), _mm_set1_ps(1.0f));
+    c = _mm_xor_ps(c, _mm_and_ps(fold, sign_mask));
+}
+#endif
+
+} // namespace
+
+MeshDeformer::MeshDeformer(const tinyobj::MeshData &mesh)
+    : vertex_count_(mesh.positions.size() / 3), indices_(mesh.indices.begin(), mesh.indices.end()) {
+    padded_ = (vertex_count_ + 3) & ~size_t(3);
+    float lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+    for (int k = 0; k < 3; ++k) {
+        rest_[k].assign(padded_, 0.0f);
+        for (size_t v = 0; v < vertex_count_; ++v) rest_[k][v] = mesh.positions[v * 3 + k];
+        if (vertex_count_ > 0) {
+            auto [mn, mx] = std::minmax_element(rest_[k].begin(), rest_[k].begin() + vertex_count_);
+            lo[k] = *mn, hi[k] = *mx;
+        }
+        cur_[k] = rest_[k];
+    }
+    min_y_ = lo[1];
+    height_ = std::max(hi[1] - lo[1], 1e-6f);
+    center_x_ = 0.5f * (lo[0] + hi[0]);
+    center_z_ = 0.5f * (lo[2] + hi[2]);
+
+    // Vertex -> face lists as in compute_normals_if_missing
+    const size_t tri_count = indices_.size() / 3;
+    offsets_.assign(vertex_count_ + 1, 0);
+    vertex_faces_.resize(tri_count * 3);
+    for (size_t i = 0; i < tri_count * 3; ++i) ++offsets_[indices_[i] + 1];
+    for (size_t v = 0; v < vertex_count_; ++v) offsets_[v + 1] += offsets_[v];
+    std::vector<unsigned int> cursor(offsets_.begin(), offsets_.end() - 1);
+    for (size_t i = 0; i < tri_count * 3; ++i) vertex_faces_[cursor[indices_[i]]++] = static_cast<unsigned int>(i / 3);
+
+    face_normals_.resize(tri_count * 3);
+    dirty_faces_.resize(tri_count);
+    for (size_t f = 0; f < tri_count; ++f) dirty_faces_[f] = static_cast<uint32_t>(f);
+    update_face_normals();
+    dirty_faces_.clear();
+    face_mark_.assign(tri_count, 0);
+    vertex_mark_.assign(vertex_count_, 0);
+    block_moved_.resize((padded_ + kBlock - 1) / kBlock);
+}
+
+size_t MeshDeformer::add_morph_target(const std::vector<float> &deltas) {
+    std::vector<float> soa(3 * padded_, 0.0f);
+    for (size_t v = 0; v < vertex_count_ && v * 3 + 2 < deltas.size(); ++v) {
+        for (int k = 0; k < 3; ++k) soa[k * padded_ + v] = deltas[v * 3 + k];
+    }
+    targets_.push_back(std::move(soa));
+    return targets_.size() - 1;
+}
+
+// Writes the deformed positions of [lo, hi) to cur_ and appends the vertices
+// that moved since the previous update.
+void MeshDeformer::deform_range(const DeformParams &p, size_t lo, size_t hi, std::vector<uint32_t> &moved) {
+    const float band_y = min_y_ + p.band_lo * height_;
+    const float inv_band = 1.0f / std::max((p.band_hi - p.band_lo) * height_, 1e-6f);
+    size_t i = lo;
+#ifdef GX_DEFORM_SSE2
+    const __m128 v_band_y = _mm_set1_ps(band_y), v_inv_band = _mm_set1_ps(inv_band);
+    const __m128 v_cx = _mm_set1_ps(center_x_), v_cz = _mm_set1_ps(center_z_);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), three = _mm_set1_ps(3.0f), two = _mm_set1_ps(2.0f);
+    for (; i + 4 <= hi; i += 4) {
+        __m128 x = _mm_loadu_ps(&rest_[0][i]);
+        __m128 y = _mm_loadu_ps(&rest_[1][i]);
+        __m128 z = _mm_loadu_ps(&rest_[2][i]);
+        // Ramp from the rest height, so the band does not move with the morph
+        __m128 h = _mm_mul_ps(_mm_sub_ps(y, v_band_y), v_inv_band);
+        h = _mm_min_ps(_mm_max_ps(h, zero), one);
+        const __m128 ramp = _mm_mul_ps(_mm_mul_ps(h, h), _mm_sub_ps(three, _mm_mul_ps(two, h)));
+
+        for (size_t t = 0; t < targets_.size() && t < p.morph_weights.size(); ++t) {
+            if (p.morph_weights[t] == 0.0f) continue;
+            const __m128 w = _mm_set1_ps(p.morph_weights[t]);
+            const float *d = targets_[t].data();
+            x = _mm_add_ps(x, _mm_mul_ps(w, _mm_loadu_ps(d + i)));
+            y = _mm_add_ps(y, _mm_mul_ps(w, _mm_loadu_ps(d + padded_ + i)));
+            z = _mm_add_ps(z, _mm_mul_ps(w, _mm_loadu_ps(d + 2 * padded_ + i)));
+        }
+        __m128 s, c;
+        if (p.twist != 0.0f) {
+            sincos4(_mm_mul_ps(ramp, _mm_set1_ps(p.twist)), s, c);
+            const __m128 dx = _mm_sub_ps(x, v_cx), dz = _mm_sub_ps(z, v_cz);
+            x = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c, dx), _mm_mul_ps(s, dz)), v_cx);
+            z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s, dx), _mm_mul_ps(c, dz)), v_cz);
+        }
+        if (p.bend != 0.0f) {
+            sincos4(_mm_mul_ps(ramp, _mm_set1_ps(p.bend)), s, c);
+            const __m128 dy = _mm_sub_ps(y, v_band_y), dz = _mm_sub_ps(z, v_cz);
+            y = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c, dy), _mm_mul_ps(s, dz)), v_band_y);
+            z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s, dy), _mm_mul_ps(c, dz)), v_cz);
+        }
+
+        const __m128 changed = _mm_or_ps(_mm_or_ps(_mm_cmpneq_ps(x, _mm_loadu_ps(&cur_[0][i])),
+                                                   _mm_cmpneq_ps(y, _mm_loadu_ps(&cur_[1][i]))),
+                                         _mm_cmpneq_ps(z, _mm_loadu_ps(&cur_[2][i])));
+        int mask = _mm_movemask_ps(changed);
+        if (!mask) continue;
+        _mm_storeu_ps(&cur_[0][i], x);
+        _mm_storeu_ps(&cur_[1][i], y);
+        _mm_storeu_ps(&cur_[2][i], z);
+        for (int lane = 0; lane < 4; ++lane) {
+            if (((mask >> lane) & 1) && i + lane < vertex_count_) moved.push_back(static_cast<uint32_t>(i + lane));
+        }
+    }
+#endif
+    for (; i < hi; ++i) {
+        float x = rest_[0][i], y = rest_[1][i], z = rest_[2][i];
+        const float ramp = smoothstep01((y - band_y) * inv_band);
+        for (size_t t = 0; t < targets_.size() && t < p.morph_weights.size(); ++t) {
+            const float w = p.morph_weights[t];
+            const float *d = targets_[t].data();
+            x += w * d[i];
+            y += w * d[padded_ + i];
+            z += w * d[2 * padded_ + i];
+        }
+        if (p.twist != 0.0f) {
+            const float a = ramp * p.twist, s = std::sin(a), c = std::cos(a);
+            const float dx = x - center_x_, dz = z - center_z_;
+            x = c * dx - s * dz + center_x_;
+            z = s * dx + c * dz + center_z_;
+        }
+        if (p.bend != 0.0f) {
+            const float a = ramp * p.bend, s = std::sin(a), c = std::cos(a);
+            const float dy = y - band_y, dz = z - center_z_;
+            y = c * dy - s * dz + band_y;
+            z = s * dy + c * dz + center_z_;
+        }
+        if (x == cur_[0][i] && y == cur_[1][i] && z == cur_[2][i]) continue;
+        cur_[0][i] = x, cur_[1][i] = y, cur_[2][i] = z;
+        if (i < vertex_count_) moved.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+void MeshDeformer::update_face_normals() {
+    jobs::parallel_for(0, dirty_faces_.size(), 4096, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            const uint32_t f = dirty_faces_[i];
+            const unsigned int a = indices_[f * 3], b = indices_[f * 3 + 1], c = indices_[f * 3 + 2];
+            const float ux = cur_[0][b] - cur_[0][a], uy = cur_[1][b] - cur_[1][a], uz = cur_[2][b] - cur_[2][a];
+            const float vx = cur_[0][c] - cur_[0][a], vy = cur_[1][c] - cur_[1][a], vz = cur_[2][c] - cur_[2][a];
+            face_normals_[f * 3 + 0] = uy * vz - uz * vy;
+            face_normals_[f * 3 + 1] = uz * vx - ux * vz;
+            face_normals_[f * 3 + 2] = ux * vy - uy * vx;
+        }
+    });
+}
+
+const std::vector<DirtyRange> &MeshDeformer::update(const DeformParams &p, pages::Vector<float> &interleaved) {
+    TRACE_SCOPE("deform");
+    ranges_.clear();
+    if (++epoch_ == 0) { // wrapped: marks from 2^32 updates ago would match
+        std::fill(face_mark_.begin(), face_mark_.end(), 0);
+        std::fill(vertex_mark_.begin(), vertex_mark_.end(), 0);
+        epoch_ = 1;
+    }
+
+    {
+        TRACE_SCOPE("deform_vertices");
+        jobs::parallel_for(0, padded_, kBlock, [&](size_t lo, size_t hi) {
+            std::vector<uint32_t> &moved = block_moved_[lo / kBlock];
+            moved.clear();
+            deform_range(p, lo, hi, moved);
+        });
+    }
+    moved_.clear();
+    for (const auto &b : block_moved_) moved_.insert(moved_.end(), b.begin(), b.end());
+    touched_.clear();
+    if (moved_.empty()) return ranges_;
+
+    // Faces around moved vertices, then every vertex of those faces
+    TRACE_SCOPE("deform_normals");
+    dirty_faces_.clear();
+    for (uint32_t v : moved_) {
+        for (unsigned int k = offsets_[v]; k < offsets_[v + 1]; ++k) {
+            const unsigned int f = vertex_faces_[k];
+            if (face_mark_[f] != epoch_) {
+                face_mark_[f] = epoch_;
+                dirty_faces_.push_back(f);
+            }
+        }
+        if (vertex_mark_[v] != epoch_) { // also covers vertices without faces
+            vertex_mark_[v] = epoch_;
+            touched_.push_back(v);
+        }
+    }
+    for (uint32_t f : dirty_faces_) {
+        for (int k = 0; k < 3; ++k) {
+            const unsigned int v = indices_[f * 3 + k];
+            if (vertex_mark_[v] != epoch_) {
+                vertex_mark_[v] = epoch_;
+                touched_.push_back(v);
+            }
+        }
+    }
+
+    update_face_normals();
+
+    jobs::parallel_for(0, touched_.size(), 4096, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            const uint32_t v = touched_[i];
+            float nx = 0.0f, ny = 0.0f, nz = 0.0f;
+            for (unsigned int k = offsets_[v]; k < offsets_[v + 1]; ++k) {
+                const float *fn = &face_normals_[vertex_faces_[k] * 3];
+                nx += fn[0];
+                ny += fn[1];
+                nz += fn[2];
+            }
+            float len = std::sqrt(nx * nx + ny * ny + nz * nz);
+            if (len > 1e-6f) {
+                nx /= len;
+                ny /= len;
+                nz /= len;
+            }
+            float *dst = &interleaved[static_cast<size_t>(v) * kVertexStride];
+            dst[0] = cur_[0][v];
+            dst[1] = cur_[1][v];
+            dst[2] = cur_[2][v];
+            dst[3] = nx;
+            dst[4] = ny;
+            dst[5] = nz;
+        }
+    });
+
+    std::sort(touched_.begin(), touched_.end());
+    for (uint32_t v : touched_) {
+        if (!ranges_.empty() && v <= ranges_.back().first + ranges_.back().count + kMergeGap) {
+            ranges_.back().count = v + 1 - ranges_.back().first;
+        } else {
+            ranges_.push_back(DirtyRange{v, 1});
+        }
+    }
+    return ranges_;
+}
+
+} // namespace gx
@@ -0,0 +1,380 @@
+#include "file_reader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GX_HAVE_MMAP 1
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+// IORING_OP_READ and the features below arrived with Linux 5.6
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define GX_HAVE_IO_URING 1
+#endif
+#endif
+
+#include "trace.h"
+
+namespace gx {
+
+namespace {
+
+double ms_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+#ifdef GX_HAVE_IO_URING
+
+// The submission and completion rings of one io_uring instance, mapped from
+// the kernel. Only this thread produces submissions and consumes completions,
+// so the rings need acquire/release on the shared indices and nothing else.
+class Uring {
+public:
+    Uring() = default;
+    Uring(const Uring &) = delete;
+    Uring &operator=(const Uring &) = delete;
+    ~Uring() {
+        if (sqes_) ::munmap(sqes_, sqes_size_);
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_) ::munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_) ::munmap(sq_ptr_, sq_size_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if (fd_ < 0) return false;
+        features_ = p.features;
+        entries_ = p.sq_entries;
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        sq_ptr_ = map(sq_size_, IORING_OFF_SQ_RING);
+        if (!sq_ptr_) return false;
+        cq_ptr_ = single ? sq_ptr_ : map(cq_size_, IORING_OFF_CQ_RING);
+        if (!cq_ptr_) return false;
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe *>(map(sqes_size_, IORING_OFF_SQES));
+        if (!sqes_) return false;
+
+        char *sq = static_cast<char *>(sq_ptr_), *cq = static_cast<char *>(cq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    unsigned features() const { return features_; }
+
+    bool register_buffers(const iovec *iov, unsigned n) {
+        return ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iov, n) == 0;
+    }
+
+    // Queues a read of len bytes at off into buf; buf_index >= 0 reads into
+    // that registered buffer. False when the submission ring is full.
+    bool queue_read(int file, char *buf, unsigned len, uint64_t off, uint64_t user_data, int buf_index) {
+        const unsigned tail = *sq_tail_;
+        if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= entries_) return false;
+        const unsigned idx = tail & sq_mask_;
+        io_uring_sqe &sqe = sqes_[idx];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = buf_index >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe.fd = file;
+        sqe.addr = reinterpret_cast<uint64_t>(buf);
+        sqe.len = len;
+        sqe.off = off;
+        sqe.user_data = user_data;
+        if (buf_index >= 0) sqe.buf_index = static_cast<uint16_t>(buf_index);
+        sq_array_[idx] = idx;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        ++pending_;
+        return true;
+    }
+
+    // Submits the queued reads and waits for at least min_complete
+    // completions; 0 or -errno.
+    int enter(unsigned min_complete) {
+        for (;;) {
+            const long r = ::syscall(__NR_io_uring_enter, fd_, pending_, min_complete,
+                                     min_complete ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if (r >= 0) {
+                pending_ -= static_cast<unsigned>(r);
+                return 0;
+            }
+            if (errno != EINTR) return -errno;
+        }
+    }
+
+    // Calls fn(cqe) for every completion that has arrived.
+    template <typename F>
+    void reap(F &&fn) {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) fn(cqes_[head & cq_mask_]);
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    void *map(size_t size, off_t offset) {
+        void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    int fd_ = -1;
+    unsigned features_ = 0, entries_ = 0, pending_ = 0;
+    void *sq_ptr_ = nullptr, *cq_ptr_ = nullptr;
+    size_t sq_size_ = 0, cq_size_ = 0, sqes_size_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    unsigned *sq_head_ = nullptr, *sq_tail_ = nullptr, *sq_array_ = nullptr;
+    unsigned *cq_head_ = nullptr, *cq_tail_ = nullptr;
+    unsigned sq_mask_ = 0, cq_mask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+};
+
+struct FreeAligned {
+    void operator()(char *p) const { std::free(p); }
+};
+
+// Block i of the file always lives in buffer i % depth: blocks are handed out
+// and their buffers requeued in file order.
+bool stream_uring(int file, size_t size, const std::string &path,
+                  const std::function<bool(const char *, size_t)> &on_block, std::string &err, const ReadOptions &opt,
+                  ReadStats &stats) {
+    const size_t block = std::max<size_t>(opt.block_size, 4096) / 4096 * 4096;
+    const size_t blocks = (size + block - 1) / block;
+    const unsigned depth = static_cast<unsigned>(std::clamp<size_t>(opt.queue_depth, 1, std::max<size_t>(blocks, 1)));
+
+    void *mem = nullptr;
+    if (::posix_memalign(&mem, 4096, block * depth) != 0) {
+        err = "Out of memory reading: " + path;
+        return false;
+    }
+    std::unique_ptr<char, FreeAligned> buffers(static_cast<char *>(mem));
+    Uring ring; // unregisters the buffers when closed, before they are freed
+    if (!ring.init(depth)) return false;
+    std::vector<iovec> iov(depth);
+    for (unsigned i = 0; i < depth; ++i) iov[i] = iovec{buffers.get() + i * block, block};
+    stats.fixed_buffers = ring.register_buffers(iov.data(), depth);
+    stats.uring = true;
+    ::posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    struct Slot {
+        size_t filled = 0, len = 0;
+        bool done = false;
+    };
+    std::vector<Slot> slots(depth);
+    size_t next_block = 0, delivered = 0;
+    unsigned in_flight = 0;
+    auto queue = [&](size_t b) {
+        Slot &s = slots[b % depth];
+        const uint64_t off = static_cast<uint64_t>(b) * block + s.filled;
+        ring.queue_read(file, buffers.get() + (b % depth) * block + s.filled, static_cast<unsigned>(s.len - s.filled),
+                        off, b, stats.fixed_buffers ? static_cast<int>(b % depth) : -1);
+        ++in_flight;
+        stats.max_in_flight = std::max(stats.max_in_flight, in_flight);
+    };
+    auto start = [&](size_t b) {
+        slots[b % depth] = Slot{0, std::min(block, size - b * block), false};
+        queue(b);
+    };
+    // The kernel writes into the buffers until every read has completed
+    auto drain = [&]() {
+        while (in_flight && ring.enter(1) == 0) ring.reap([&](const io_uring_cqe &) { --in_flight; });
+    };
+
+    for (; next_block < blocks && next_block < depth; ++next_block) start(next_block);
+    while (delivered < blocks) {
+        if (const int r = ring.enter(1); r < 0) {
+            err = "Read failed: " + path + " (" + std::strerror(-r) + ")";
+            drain();
+            return false;
+        }
+        ring.reap([&](const io_uring_cqe &cqe) {
+            --in_flight;
+            const size_t b = static_cast<size_t>(cqe.user_data);
+            Slot &s = slots[b % depth];
+            if (cqe.res == -EAGAIN || cqe.res == -EINTR) {
+                queue(b);
+            } else if (cqe.res < 0) {
+                if (err.empty()) err = "Read failed: " + path + " (" + std::strerror(-cqe.res) + ")";
+            } else if (cqe.res == 0) {
+                if (err.empty()) err = "Read failed: " + path + " (file shrank while reading)";
+            } else if ((s.filled += static_cast<size_t>(cqe.res)) < s.len) {
+                queue(b); // short read: the rest of the block
+            } else {
+                s.done = true;
+            }
+        });
+        if (!err.empty()) {
+            drain();
+            return false;
+        }
+        for (; delivered < blocks && slots[delivered % depth].done; ++delivered) {
+            const Slot &s = slots[delivered % depth];
+            if (!on_block(buffers.get() + (delivered % depth) * block, s.len)) {
+                drain();
+                return false;
+            }
+            stats.bytes += s.len;
+            if (next_block < blocks) start(next_block++);
+        }
+    }
+    return true;
+}
+
+#endif
+
+bool stream_sync(const std::string &path, const std::function<bool(const char *, size_t)> &on_block,
+                 std::string &err, const ReadOptions &opt, ReadStats &stats) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        err = "Cannot open file: " + path;
+        return false;
+    }
+    std::vector<char> block(std::max<size_t>(opt.block_size, 4096));
+    for (;;) {
+        ifs.read(block.data(), static_cast<std::streamsize>(block.size()));
+        const size_t n = static_cast<size_t>(ifs.gcount());
+        if (n == 0) break;
+        if (!on_block(block.data(), n)) return false;
+        stats.bytes += n;
+    }
+    if (ifs.bad()) {
+        err = "Read failed: " + path;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool uring_available() {
+#ifdef GX_HAVE_IO_URING
+    static const bool available = [] {
+        Uring ring;
+        return ring.init(2) && (ring.features() & IORING_FEAT_RW_CUR_POS) != 0;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+bool stream_file(const std::string &path, const std::function<bool(const char *, size_t)> &on_block,
+                 std::string &err, const ReadOptions &opt, ReadStats *stats) {
+    TRACE_SCOPE("stream_file");
+    const auto t0 = std::chrono::steady_clock::now();
+    ReadStats local;
+    ReadStats &s = stats ? *stats : local;
+    s = ReadStats{};
+    err.clear();
+    bool ok = false, done = false;
+#ifdef GX_HAVE_IO_URING
+    if (opt.uring && uring_available()) {
+        const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0) {
+            err = "Cannot open file: " + path;
+            return false;
+        }
+        struct stat st;
+        if (::fstat(file, &st) == 0 && S_ISREG(st.st_mode)) {
+            ok = stream_uring(file, static_cast<size_t>(st.st_size), path, on_block, err, opt, s);
+            done = s.uring; // else the ring could not be set up: read synchronously
+        }
+        ::close(file);
+    }
+#endif
+    if (!done) {
+        s = ReadStats{};
+        err.clear();
+        ok = stream_sync(path, on_block, err, opt, s);
+    }
+    s.ms = ms_since(t0);
+    return ok;
+}
+
+bool read_file_streamed(const std::string &path, std::string &buffer, std::string &err, const ReadOptions &opt,
+                        ReadStats *stats) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    buffer.clear();
+    if (!ec) buffer.reserve(static_cast<size_t>(size));
+    return stream_file(path, [&](const char *data, size_t n) {
+        buffer.append(data, n);
+        return true;
+    }, err, opt, stats);
+}
+
+bool read_file_mmap(const std::string &path, std::string &buffer, std::string &err) {
+#ifdef GX_HAVE_MMAP
+    TRACE_SCOPE("read_file_mmap");
+    const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        err = "Cannot open file: " + path;
+        return false;
+    }
+    struct stat st;
+    if (::fstat(file, &st) != 0) {
+        ::close(file);
+        err = "Read failed: " + path;
+        return false;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    buffer.clear();
+    if (size == 0) {
+        ::close(file);
+        return true;
+    }
+    void *p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (p == MAP_FAILED) {
+        err = "Read failed: " + path;
+        return false;
+    }
+    ::madvise(p, size, MADV_SEQUENTIAL);
+    buffer.assign(static_cast<const char *>(p), size);
+    ::munmap(p, size);
+    return true;
+#else
+    err = "mmap is not available: " + path;
+    return false;
+#endif
+}
+
+bool load_obj_streaming(const std::string &path, tinyobj::MeshData &mesh, std::string &err, const ReadOptions &opt,
+                        ReadStats *stats) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    tinyobj::detail::StreamingParser parser(ec ? 0 : static_cast<size_t>(size));
+    if (!stream_file(path, [&](const char *data, size_t n) {
+            parser.feed(data, n);
+            return true;
+        }, err, opt, stats)) {
+        return false;
+    }
+    return parser.finish(mesh, err, tinyobj::detail::base_dir(path));
+}
+
+} // namespace gx
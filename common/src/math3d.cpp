@@ -0,0 +1,139 @@
+#include "math3d.h"
+
+namespace gx {
+
+Mat4 identity() {
+    Mat4 r{};
+    r.m[0] = r.m[5] = r.m[10] = r.m[15] = 1.0f;
+    return r;
+}
+
+Mat4 perspective(float fovy, float aspect, float znear, float zfar) {
+    float f = 1.0f / std::tan(fovy * 0.5f);
+    Mat4 r{};
+    r.m[0] = f / aspect;
+    r.m[5] = f;
+    r.m[10] = (zfar + znear) / (znear - zfar);
+    r.m[11] = -1.0f;
+    r.m[14] = (2.0f * zfar * znear) / (znear - zfar);
+    return r;
+}
+
+Mat4 translate(float x, float y, float z) {
+    Mat4 r = identity();
+    r.m[12] = x;
+    r.m[13] = y;
+    r.m[14] = z;
+    return r;
+}
+
+Mat4 translate(const Vec3 &t) { return translate(t.x, t.y, t.z); }
+
+Mat4 rotate_x(float angle_rad) {
+    Mat4 r = identity();
+    float c = std::cos(angle_rad);
+    float s = std::sin(angle_rad);
+    r.m[5] = c;
+    r.m[6] = s;
+    r.m[9] = -s;
+    r.m[10] = c;
+    return r;
+}
+
+Mat4 rotate_y(float angle_rad) {
+    Mat4 r = identity();
+    float c = std::cos(angle_rad);
+    float s = std::sin(angle_rad);
+    r.m[0] = c;
+    r.m[2] = s;
+    r.m[8] = -s;
+    r.m[10] = c;
+    return r;
+}
+
+Mat4 scale(float s) {
+    Mat4 r{};
+    r.m[0] = r.m[5] = r.m[10] = s;
+    r.m[15] = 1.0f;
+    return r;
+}
+
+Mat4 multiply(const Mat4 &a, const Mat4 &b) {
+    Mat4 r{};
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            r.m[col * 4 + row] =
+                a.m[0 * 4 + row] * b.m[col * 4 + 0] +
+                a.m[1 * 4 + row] * b.m[col * 4 + 1] +
+                a.m[2 * 4 + row] * b.m[col * 4 + 2] +
+                a.m[3 * 4 + row] * b.m[col * 4 + 3];
+        }
+    }
+    return r;
+}
+
+// 四元数工具
+Quat quat_normalize(const Quat &q) {
+    float len = std::sqrt(q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z);
+    if (len < 1e-6f) return Quat{1,0,0,0};
+    float inv = 1.0f / len;
+    return Quat{q.w*inv, q.x*inv, q.y*inv, q.z*inv};
+}
+
+Quat quat_from_axis_angle(const Vec3 &axis, float angle) {
+    float half = angle * 0.5f;
+    float s = std::sin(half);
+    Vec3 na = axis;
+    float len = std::sqrt(na.x*na.x + na.y*na.y + na.z*na.z);
+    if (len < 1e-6f) return Quat{1,0,0,0};
+    na.x /= len; na.y /= len; na.z /= len;
+    return quat_normalize(Quat{std::cos(half), na.x*s, na.y*s, na.z*s});
+}
+
+float quat_dot(const Quat &a, const Quat &b) {
+    return a.w*b.w + a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+Quat quat_slerp(Quat a, Quat b, float t) {
+    a = quat_normalize(a);
+    b = quat_normalize(b);
+    float cos_om = quat_dot(a, b);
+    if (cos_om < 0.0f) { b.w = -b.w; b.x = -b.x; b.y = -b.y; b.z = -b.z; cos_om = -cos_om; }
+    const float EPS = 1e-5f;
+    float k0, k1;
+    if (1.0f - cos_om < EPS) {
+        k0 = 1.0f - t;
+        k1 = t;
+    } else {
+        float om = std::acos(cos_om);
+        float inv_sin = 1.0f / std::sin(om);
+        k0 = std::sin((1.0f - t) * om) * inv_sin;
+        k1 = std::sin(t * om) * inv_sin;
+    }
+    return Quat{
+        k0*a.w + k1*b.w,
+        k0*a.x + k1*b.x,
+        k0*a.y + k1*b.y,
+        k0*a.z + k1*b.z
+    };
+}
+
+Mat4 quat_to_mat4(const Quat &q_in) {
+    Quat q = quat_normalize(q_in);
+    float w = q.w, x = q.x, y = q.y, z = q.z;
+    Mat4 r = identity();
+    r.m[0] = 1 - 2*y*y - 2*z*z;
+    r.m[1] = 2*x*y + 2*w*z;
+    r.m[2] = 2*x*z - 2*w*y;
+
+    r.m[4] = 2*x*y - 2*w*z;
+    r.m[5] = 1 - 2*x*x - 2*z*z;
+    r.m[6] = 2*y*z + 2*w*x;
+
+    r.m[8] = 2*x*z + 2*w*y;
+    r.m[9] = 2*y*z - 2*w*x;
+    r.m[10] = 1 - 2*x*x - 2*y*y;
+    return r;
+}
+
+} // namespace gx
@@ -0,0 +1,425 @@
+#include "mesh_cache.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GX_MESH_CACHE_SHM 1
+#endif
+#ifdef __linux__
+#include <dirent.h> // POSIX shared memory is listed in /dev/shm
+#endif
+
+#include "mesh_utils.h"
+#include "trace.h"
+
+namespace gx {
+
+namespace {
+
+constexpr char kMagic[8] = {'g', 'x', 'm', 'e', 's', 'h', '2', 0};
+constexpr uint32_t kBuilding = 0, kReady = 1;
+constexpr int kMaxHolders = 64;
+constexpr size_t kAlign = 64;
+
+static_assert(std::atomic<int32_t>::is_always_lock_free, "shared memory counters must be lock-free");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared memory counters must be lock-free");
+
+// At offset 0 of every segment; offsets are from the segment start
+struct SegmentHeader {
+    char magic[8];
+    std::atomic<uint32_t> state;
+    int32_t builder; // pid of the publisher
+    std::atomic<int32_t> holders[kMaxHolders]; // pids, 0 = free
+    uint64_t key_offset, key_size;
+    uint64_t tables_offset, tables_size;
+    uint64_t interleaved_offset, indices_offset;
+    uint64_t ao_offset; // 0 = no ambient occlusion
+    uint64_t vertex_count, index_count;
+    uint64_t total_size;
+    MeshBounds bounds;
+};
+
+size_t align_up(size_t v) { return (v + kAlign - 1) / kAlign * kAlign; }
+
+uint64_t fnv1a(const std::string &s) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Short enough for every platform's shm name limit
+std::string segment_name(const std::string &key) {
+    static const char hex[] = "0123456789abcdef";
+    const uint64_t h = fnv1a(key);
+    std::string name = "/gxmesh_";
+    for (int i = 60; i >= 0; i -= 4) name.push_back(hex[(h >> i) & 15]);
+    return name;
+}
+
+template <typename T>
+void put(std::string &out, const T &v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+void put_string(std::string &out, const std::string &s) {
+    put<uint64_t>(out, s.size());
+    out += s;
+}
+
+// Bounds-checked reads of the tables written by serialize_tables
+class TableReader {
+public:
+    TableReader(const char *p, size_t size) : p_(p), end_(p + size) {}
+    bool ok() const { return ok_; }
+
+    template <typename T>
+    T get() {
+        T v{};
+        if (static_cast<size_t>(end_ - p_) < sizeof(T)) {
+            ok_ = false;
+            return v;
+        }
+        std::memcpy(&v, p_, sizeof(T));
+        p_ += sizeof(T);
+        return v;
+    }
+    std::string get_string() {
+        const uint64_t n = get<uint64_t>();
+        if (static_cast<uint64_t>(end_ - p_) < n) {
+            ok_ = false;
+            return {};
+        }
+        std::string s(p_, static_cast<size_t>(n));
+        p_ += n;
+        return s;
+    }
+    // Element counts can't exceed the bytes left
+    size_t get_count() {
+        const uint64_t n = get<uint64_t>();
+        if (n > static_cast<uint64_t>(end_ - p_)) ok_ = false;
+        return ok_ ? static_cast<size_t>(n) : 0;
+    }
+
+private:
+    const char *p_, *end_;
+    bool ok_ = true;
+};
+
+std::string serialize_tables(const tinyobj::MeshData &mesh) {
+    std::string out;
+    put<uint64_t>(out, mesh.parts.size());
+    for (const tinyobj::MeshPart &p : mesh.parts) {
+        put_string(out, p.name);
+        put<uint64_t>(out, p.first_index);
+        put<uint64_t>(out, p.index_count);
+    }
+    put<uint64_t>(out, mesh.ranges.size());
+    for (const tinyobj::MeshRange &r : mesh.ranges) {
+        put<uint64_t>(out, r.first_index);
+        put<uint64_t>(out, r.index_count);
+        put<uint32_t>(out, r.part);
+        put<uint32_t>(out, r.material);
+    }
+    put<uint64_t>(out, mesh.materials.size());
+    for (const tinyobj::Material &m : mesh.materials) {
+        put_string(out, m.name);
+        out.append(reinterpret_cast<const char *>(m.ambient), sizeof(m.ambient));
+        out.append(reinterpret_cast<const char *>(m.diffuse), sizeof(m.diffuse));
+        out.append(reinterpret_cast<const char *>(m.specular), sizeof(m.specular));
+        put(out, m.shininess);
+        put(out, m.opacity);
+    }
+    return out;
+}
+
+#ifdef GX_MESH_CACHE_SHM
+
+bool process_alive(int32_t pid) { return pid > 0 && (::kill(pid, 0) == 0 || errno == EPERM); }
+
+// Frees the slots of dead holders; returns the live ones
+int sweep_holders(SegmentHeader &h) {
+    int live = 0;
+    for (std::atomic<int32_t> &slot : h.holders) {
+        int32_t pid = slot.load(std::memory_order_acquire);
+        if (!pid) continue;
+        if (process_alive(pid)) {
+            ++live;
+        } else {
+            slot.compare_exchange_strong(pid, 0, std::memory_order_acq_rel);
+        }
+    }
+    return live;
+}
+
+int claim_slot(SegmentHeader &h, int32_t pid) {
+    for (int i = 0; i < kMaxHolders; ++i) {
+        int32_t expected = 0;
+        if (h.holders[i].compare_exchange_strong(expected, pid, std::memory_order_acq_rel)) return i;
+    }
+    return -1;
+}
+
+// Unlinks this user's segments that nobody alive holds or is still building.
+// open() and ~SharedMesh sweep only their own key, and a key whose source
+// file changed is never opened again, so a segment left by a crashed viewer
+// would otherwise stay until reboot. Linux only (needs /dev/shm to list them).
+void sweep_stale_segments() {
+#ifdef __linux__
+    TRACE_SCOPE("mesh_cache_sweep");
+    DIR *dir = ::opendir("/dev/shm");
+    if (!dir) return;
+    while (const dirent *e = ::readdir(dir)) {
+        if (std::strncmp(e->d_name, "gxmesh_", 7) != 0) continue;
+        const std::string name = std::string("/") + e->d_name;
+        const int fd = ::shm_open(name.c_str(), O_RDWR, 0); // other users' segments fail here (0600)
+        if (fd < 0) continue;
+        struct stat st;
+        void *hp = MAP_FAILED;
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(SegmentHeader)) {
+            hp = ::mmap(nullptr, sizeof(SegmentHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (hp == MAP_FAILED) continue;
+        auto *h = static_cast<SegmentHeader *>(hp);
+        // Without its magic a segment is still being created; a live builder
+        // may be between publishing and claiming its own slot
+        if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) == 0 && !process_alive(h->builder) &&
+            sweep_holders(*h) == 0) {
+            ::shm_unlink(name.c_str());
+        }
+        ::munmap(hp, sizeof(SegmentHeader));
+    }
+    ::closedir(dir);
+#endif
+}
+
+#endif
+
+} // namespace
+
+#ifdef GX_MESH_CACHE_SHM
+
+bool SharedMesh::supported() { return true; }
+
+std::string mesh_cache_key(const std::string &path) {
+    char resolved[PATH_MAX];
+    struct stat st;
+    if (!::realpath(path.c_str(), resolved) || ::stat(resolved, &st) != 0) return {};
+#ifdef __APPLE__
+    const auto &mtime = st.st_mtimespec;
+#else
+    const auto &mtime = st.st_mtim;
+#endif
+    // The layout of the cached data is part of the key
+    return "v2:" + std::to_string(kVertexStride) + ":" + resolved + ":" + std::to_string(st.st_size) + ":" +
+           std::to_string(mtime.tv_sec) + "." + std::to_string(mtime.tv_nsec) + ":" + std::to_string(st.st_ino) +
+           ":" + std::to_string(st.st_dev);
+}
+
+std::shared_ptr<const SharedMesh> SharedMesh::open(const std::string &key) {
+    if (key.empty()) return nullptr;
+    TRACE_SCOPE("mesh_cache_open");
+    const std::string name = segment_name(key);
+    const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+        ::close(fd);
+        return nullptr;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    const size_t header_size = sizeof(SegmentHeader);
+    void *hp = ::mmap(nullptr, header_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    void *base = hp == MAP_FAILED ? MAP_FAILED : ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        if (hp != MAP_FAILED) ::munmap(hp, header_size);
+        return nullptr;
+    }
+    auto *h = static_cast<SegmentHeader *>(hp);
+    auto fail = [&]() -> std::shared_ptr<const SharedMesh> {
+        ::munmap(hp, header_size);
+        ::munmap(base, size);
+        return nullptr;
+    };
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0) return fail(); // still being created
+    if (h->state.load(std::memory_order_acquire) != kReady) {
+        // A publisher that died half way leaves the name taken for good
+        if (!process_alive(h->builder)) ::shm_unlink(name.c_str());
+        return fail();
+    }
+    if (h->total_size != size || h->key_offset + h->key_size > size || h->tables_offset + h->tables_size > size ||
+        h->interleaved_offset + h->vertex_count * kVertexStride * sizeof(float) > size ||
+        h->indices_offset + h->index_count * sizeof(unsigned int) > size ||
+        (h->ao_offset && h->ao_offset + h->vertex_count * sizeof(float) > size)) {
+        return fail();
+    }
+    const char *bytes = static_cast<const char *>(base);
+    if (std::string(bytes + h->key_offset, h->key_size) != key) return fail(); // name collision
+
+    sweep_holders(*h);
+    const int slot = claim_slot(*h, static_cast<int32_t>(::getpid()));
+    if (slot < 0) return fail();
+
+    auto *mesh = new SharedMesh();
+    mesh->name_ = name;
+    mesh->base_ = base;
+    mesh->size_ = size;
+    mesh->interleaved_ = reinterpret_cast<const float *>(bytes + h->interleaved_offset);
+    mesh->indices_ = reinterpret_cast<const unsigned int *>(bytes + h->indices_offset);
+    mesh->ao_ = h->ao_offset ? reinterpret_cast<const float *>(bytes + h->ao_offset) : nullptr;
+    mesh->vertex_count_ = static_cast<size_t>(h->vertex_count);
+    mesh->index_count_ = static_cast<size_t>(h->index_count);
+    mesh->bounds_ = h->bounds;
+    mesh->tables_ = bytes + h->tables_offset;
+    mesh->tables_size_ = static_cast<size_t>(h->tables_size);
+    mesh->header_ = h;
+    mesh->slot_ = slot;
+    return std::shared_ptr<const SharedMesh>(mesh);
+}
+
+std::shared_ptr<const SharedMesh> SharedMesh::publish(const std::string &key, const tinyobj::MeshData &mesh,
+                                                      const pages::Vector<float> &interleaved, const MeshBounds &bounds,
+                                                      const float *ao) {
+    if (key.empty()) return nullptr;
+    TRACE_SCOPE("mesh_cache_publish");
+    static std::once_flag swept;
+    std::call_once(swept, sweep_stale_segments);
+    const std::string name = segment_name(key);
+    const std::string tables = serialize_tables(mesh);
+    const size_t key_offset = sizeof(SegmentHeader);
+    const size_t tables_offset = key_offset + key.size();
+    const size_t interleaved_offset = align_up(tables_offset + tables.size());
+    const size_t indices_offset = align_up(interleaved_offset + interleaved.size() * sizeof(float));
+    const size_t vertex_count = interleaved.size() / kVertexStride;
+    const size_t ao_offset = ao ? align_up(indices_offset + mesh.indices.size() * sizeof(unsigned int)) : 0;
+    const size_t total = ao ? ao_offset + vertex_count * sizeof(float)
+                            : indices_offset + mesh.indices.size() * sizeof(unsigned int);
+
+    // Only the owner may map it (0600); O_EXCL makes exactly one publisher win
+    const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        if (errno == EEXIST) open(key); // sweeps a segment left half-built by a dead publisher
+        return nullptr;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(total)) != 0) {
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+    void *p = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+    auto *h = new (p) SegmentHeader();
+    h->state.store(kBuilding, std::memory_order_relaxed);
+    h->builder = static_cast<int32_t>(::getpid());
+    h->key_offset = key_offset;
+    h->key_size = key.size();
+    h->tables_offset = tables_offset;
+    h->tables_size = tables.size();
+    h->interleaved_offset = interleaved_offset;
+    h->indices_offset = indices_offset;
+    h->ao_offset = ao_offset;
+    h->vertex_count = vertex_count;
+    h->index_count = mesh.indices.size();
+    h->total_size = total;
+    h->bounds = bounds;
+    char *bytes = static_cast<char *>(p);
+    std::memcpy(bytes + key_offset, key.data(), key.size());
+    std::memcpy(bytes + tables_offset, tables.data(), tables.size());
+    std::memcpy(bytes + interleaved_offset, interleaved.data(), interleaved.size() * sizeof(float));
+    std::memcpy(bytes + indices_offset, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+    if (ao) std::memcpy(bytes + ao_offset, ao, vertex_count * sizeof(float));
+    std::memcpy(h->magic, kMagic, sizeof(kMagic));
+    h->state.store(kReady, std::memory_order_release);
+
+    // Map it again the way readers do (data read-only) and let this mapping go
+    std::shared_ptr<const SharedMesh> shared = open(key);
+    ::munmap(p, total);
+    if (!shared) ::shm_unlink(name.c_str());
+    return shared;
+}
+
+SharedMesh::~SharedMesh() {
+    auto *h = static_cast<SegmentHeader *>(header_);
+    if (!h) return;
+    int32_t self = static_cast<int32_t>(::getpid());
+    h->holders[slot_].compare_exchange_strong(self, 0, std::memory_order_acq_rel);
+    // Last one out removes the name; processes still mapping it keep their data
+    if (sweep_holders(*h) == 0) ::shm_unlink(name_.c_str());
+    ::munmap(header_, sizeof(SegmentHeader));
+    ::munmap(base_, size_);
+}
+
+size_t SharedMesh::holders() const {
+    const auto *h = static_cast<const SegmentHeader *>(header_);
+    size_t n = 0;
+    for (const std::atomic<int32_t> &slot : h->holders) n += process_alive(slot.load(std::memory_order_relaxed));
+    return n;
+}
+
+#else
+
+bool SharedMesh::supported() { return false; }
+std::string mesh_cache_key(const std::string &) { return {}; }
+std::shared_ptr<const SharedMesh> SharedMesh::open(const std::string &) { return nullptr; }
+std::shared_ptr<const SharedMesh> SharedMesh::publish(const std::string &, const tinyobj::MeshData &,
+                                                      const pages::Vector<float> &, const MeshBounds &, const float *) {
+    return nullptr;
+}
+SharedMesh::~SharedMesh() = default;
+size_t SharedMesh::holders() const { return 0; }
+
+#endif
+
+bool SharedMesh::copy_tables(tinyobj::MeshData &mesh) const {
+    TableReader r(tables_, tables_size_);
+    mesh.parts.resize(r.get_count());
+    for (tinyobj::MeshPart &p : mesh.parts) {
+        p.name = r.get_string();
+        p.first_index = static_cast<size_t>(r.get<uint64_t>());
+        p.index_count = static_cast<size_t>(r.get<uint64_t>());
+    }
+    mesh.ranges.resize(r.get_count());
+    for (tinyobj::MeshRange &range : mesh.ranges) {
+        range.first_index = static_cast<size_t>(r.get<uint64_t>());
+        range.index_count = static_cast<size_t>(r.get<uint64_t>());
+        range.part = r.get<uint32_t>();
+        range.material = r.get<uint32_t>();
+    }
+    mesh.materials.resize(r.get_count());
+    for (tinyobj::Material &m : mesh.materials) {
+        m.name = r.get_string();
+        for (float &v : m.ambient) v = r.get<float>();
+        for (float &v : m.diffuse) v = r.get<float>();
+        for (float &v : m.specular) v = r.get<float>();
+        m.shininess = r.get<float>();
+        m.opacity = r.get<float>();
+    }
+    if (!r.ok()) {
+        mesh.parts.clear();
+        mesh.ranges.clear();
+        mesh.materials.clear();
+    }
+    return r.ok();
+}
+
+} // namespace gx
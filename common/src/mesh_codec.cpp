@@ -0,0 +1,666 @@
+#include "mesh_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include "job_system.h"
+#include "octahedral.h"
+#include "trace.h"
+
+namespace gx {
+
+namespace {
+
+// File layout (integers are LEB128 varints unless noted):
+//   "GXM" 0x01, flags, vertex count, triangle count, 3 x bits (u8),
+//   position min/extent (6 x f32), texcoord min/extent (4 x f32),
+//   parts, materials, ranges, chunk counts and sizes, chunk payloads.
+// A vertex chunk holds one stream per attribute component, a triangle chunk
+// its index mode, the state the mode starts from and one stream of indices.
+constexpr char kMagic[4] = {'G', 'X', 'M', 1};
+constexpr uint32_t kHasNormals = 1, kHasTexcoords = 2;
+constexpr size_t kVertexChunk = 65536;
+constexpr size_t kTriangleChunk = 65536;
+constexpr uint32_t kMaxCount = 1u << 31;
+
+// rANS with 12-bit probabilities and byte-wise renormalization (as in
+// ryg_rans); the alphabet is the bit length of the residual, 0 to 32
+constexpr uint32_t kProbBits = 12, kProbScale = 1u << kProbBits;
+constexpr uint32_t kRansLow = 1u << 23;
+constexpr int kSymbols = 33;
+
+enum IndexMode : uint32_t { kPreviousCorner = 0, kNextVertex = 1 };
+
+inline uint32_t zigzag(uint32_t delta) {
+    const int32_t d = static_cast<int32_t>(delta);
+    return (static_cast<uint32_t>(d) << 1) ^ static_cast<uint32_t>(d >> 31);
+}
+inline uint32_t unzigzag(uint32_t z) { return (z >> 1) ^ (0u - (z & 1)); }
+
+inline int bit_length(uint32_t v) {
+    int n = 0;
+    while (v) {
+        ++n;
+        v >>= 1;
+    }
+    return n;
+}
+
+class ByteWriter {
+public:
+    explicit ByteWriter(std::string &out) : out_(out) {}
+    void u8(uint32_t v) { out_.push_back(static_cast<char>(v)); }
+    void varint(uint64_t v) {
+        while (v >= 0x80) {
+            u8(static_cast<uint32_t>(v & 0x7f) | 0x80);
+            v >>= 7;
+        }
+        u8(static_cast<uint32_t>(v));
+    }
+    void f32(float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        for (int i = 0; i < 4; ++i) u8(bits >> (8 * i));
+    }
+    void bytes(const void *data, size_t size) { out_.append(static_cast<const char *>(data), size); }
+    void str(const std::string &s) {
+        varint(s.size());
+        bytes(s.data(), s.size());
+    }
+
+private:
+    std::string &out_;
+};
+
+// Reads past the end return zeros and clear ok.
+class ByteReader {
+public:
+    ByteReader(const uint8_t *p, size_t size) : p_(p), end_(p + size) {}
+    bool ok() const { return ok_; }
+    size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+    const uint8_t *pos() const { return p_; }
+
+    uint32_t u8() {
+        if (p_ == end_) {
+            ok_ = false;
+            return 0;
+        }
+        return *p_++;
+    }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint32_t b = u8();
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok_ = false;
+        return 0;
+    }
+    float f32() {
+        uint32_t bits = 0;
+        for (int i = 0; i < 4; ++i) bits |= u8() << (8 * i);
+        float v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    const uint8_t *skip(size_t size) {
+        if (size > remaining()) {
+            ok_ = false;
+            p_ = end_;
+            return end_;
+        }
+        const uint8_t *p = p_;
+        p_ += size;
+        return p;
+    }
+    std::string str() {
+        const size_t n = static_cast<size_t>(varint());
+        const uint8_t *p = skip(n);
+        return ok_ ? std::string(reinterpret_cast<const char *>(p), n) : std::string();
+    }
+
+private:
+    const uint8_t *p_, *end_;
+    bool ok_ = true;
+};
+
+class BitWriter {
+public:
+    void put(uint32_t v, int bits) {
+        acc_ |= static_cast<uint64_t>(v) << count_;
+        count_ += bits;
+        while (count_ >= 8) {
+            bytes_.push_back(static_cast<uint8_t>(acc_));
+            acc_ >>= 8;
+            count_ -= 8;
+        }
+    }
+    const std::vector<uint8_t> &finish() {
+        if (count_ > 0) bytes_.push_back(static_cast<uint8_t>(acc_));
+        acc_ = 0;
+        count_ = 0;
+        return bytes_;
+    }
+
+private:
+    std::vector<uint8_t> bytes_;
+    uint64_t acc_ = 0;
+    int count_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t *p, size_t size) : p_(p), end_(p + size) {}
+    uint32_t get(int bits) {
+        while (count_ < bits) {
+            acc_ |= static_cast<uint64_t>(p_ < end_ ? *p_++ : 0) << count_;
+            count_ += 8;
+        }
+        const uint32_t v = static_cast<uint32_t>(acc_ & ((uint64_t(1) << bits) - 1));
+        acc_ >>= bits;
+        count_ -= bits;
+        return v;
+    }
+
+private:
+    const uint8_t *p_, *end_;
+    uint64_t acc_ = 0;
+    int count_ = 0;
+};
+
+// Scales symbol counts to frequencies summing to kProbScale, keeping every
+// used symbol at least 1.
+void normalize_frequencies(const uint64_t *counts, uint64_t total, uint32_t *freq) {
+    uint32_t sum = 0;
+    int largest = 0;
+    for (int s = 0; s < kSymbols; ++s) {
+        freq[s] = counts[s] ? std::max<uint32_t>(1, static_cast<uint32_t>(counts[s] * kProbScale / total)) : 0;
+        sum += freq[s];
+        if (counts[s] > counts[largest]) largest = s;
+    }
+    freq[largest] = static_cast<uint32_t>(static_cast<int64_t>(freq[largest]) + kProbScale - sum);
+}
+
+// One stream: [symbol count][frequencies][raw size][rANS size][raw bits][rANS bytes]
+void encode_stream(const uint32_t *values, size_t count, std::string &out) {
+    if (!count) return;
+    std::vector<uint8_t> symbols(count);
+    uint64_t counts[kSymbols] = {};
+    BitWriter raw;
+    for (size_t i = 0; i < count; ++i) {
+        const int s = bit_length(values[i]);
+        symbols[i] = static_cast<uint8_t>(s);
+        ++counts[s];
+        if (s > 1) raw.put(values[i] & ((1u << (s - 1)) - 1), s - 1); // top bit implicit
+    }
+    uint32_t freq[kSymbols], start[kSymbols];
+    normalize_frequencies(counts, count, freq);
+    for (int s = 0, c = 0; s < kSymbols; c += freq[s++]) start[s] = c;
+
+    // Symbols are encoded in reverse so the decoder reads forward
+    std::vector<uint8_t> buf(count * 2 + 8);
+    uint8_t *const end = buf.data() + buf.size();
+    uint8_t *ptr = end;
+    uint32_t x = kRansLow;
+    for (size_t i = count; i-- > 0;) {
+        const uint32_t f = freq[symbols[i]];
+        const uint32_t x_max = ((kRansLow >> kProbBits) << 8) * f;
+        while (x >= x_max) {
+            *--ptr = static_cast<uint8_t>(x);
+            x >>= 8;
+        }
+        x = ((x / f) << kProbBits) + (x % f) + start[symbols[i]];
+    }
+    ptr -= 4;
+    for (int k = 0; k < 4; ++k) ptr[k] = static_cast<uint8_t>(x >> (8 * k));
+
+    int used = kSymbols;
+    while (used > 0 && !freq[used - 1]) --used;
+    ByteWriter w(out);
+    w.u8(static_cast<uint32_t>(used));
+    for (int s = 0; s < used; ++s) w.varint(freq[s]);
+    const std::vector<uint8_t> &bits = raw.finish();
+    w.varint(bits.size());
+    w.varint(static_cast<size_t>(end - ptr));
+    w.bytes(bits.data(), bits.size());
+    w.bytes(ptr, static_cast<size_t>(end - ptr));
+}
+
+bool decode_stream(ByteReader &r, size_t count, uint32_t *values) {
+    if (!count) return true;
+    const int used = static_cast<int>(r.u8());
+    if (used > kSymbols) return false;
+    uint32_t freq[kSymbols] = {}, start[kSymbols] = {}, sum = 0;
+    for (int s = 0; s < used; ++s) {
+        freq[s] = static_cast<uint32_t>(r.varint());
+        start[s] = sum;
+        sum += std::min(freq[s], kProbScale + 1);
+    }
+    if (!r.ok() || sum != kProbScale) return false;
+    uint8_t lut[kProbScale];
+    for (int s = 0; s < used; ++s) std::memset(lut + start[s], s, freq[s]);
+
+    const size_t raw_size = static_cast<size_t>(r.varint()), rans_size = static_cast<size_t>(r.varint());
+    const uint8_t *raw = r.skip(raw_size);
+    const uint8_t *p = r.skip(rans_size);
+    if (!r.ok() || rans_size < 4) return false;
+    const uint8_t *const end = p + rans_size;
+    BitReader bits(raw, raw_size);
+    uint32_t x = uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    p += 4;
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t slot = x & (kProbScale - 1);
+        const uint32_t s = lut[slot];
+        x = freq[s] * (x >> kProbBits) + slot - start[s];
+        while (x < kRansLow && p < end) x = (x << 8) | *p++;
+        values[i] = s > 1 ? (1u << (s - 1)) | bits.get(static_cast<int>(s) - 1) : s;
+    }
+    return true;
+}
+
+// Quantization of one component on [min, min + extent]
+struct Quantizer {
+    float min = 0.0f, extent = 0.0f;
+    uint32_t max_q = 0;
+
+    uint32_t encode(float v) const {
+        if (extent <= 0.0f) return 0;
+        const double q = std::round((static_cast<double>(v) - min) / extent * max_q);
+        return static_cast<uint32_t>(std::clamp(q, 0.0, static_cast<double>(max_q)));
+    }
+    float decode(uint32_t q) const {
+        return extent > 0.0f ? static_cast<float>(min + static_cast<double>(q) * extent / max_q) : min;
+    }
+};
+
+Quantizer fit(const pages::Vector<float> &v, size_t stride, size_t k, int bits) {
+    Quantizer q;
+    q.max_q = (1u << bits) - 1;
+    if (v.empty()) return q;
+    float lo = std::numeric_limits<float>::max(), hi = -lo;
+    for (size_t i = k; i < v.size(); i += stride) {
+        lo = std::min(lo, v[i]);
+        hi = std::max(hi, v[i]);
+    }
+    q.min = lo;
+    q.extent = hi - lo;
+    return q;
+}
+
+struct Header {
+    uint32_t flags = 0;
+    size_t vertices = 0, triangles = 0;
+    int bits[3] = {16, 12, 14}; // position, normal, texcoord
+    Quantizer position[3], texcoord[2], normal;
+};
+
+// Residual streams of one attribute, one per component
+void encode_components(const std::vector<uint32_t> &q, size_t components, size_t count, std::string &out) {
+    std::vector<uint32_t> residuals(count);
+    for (size_t k = 0; k < components; ++k) {
+        uint32_t prev = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t v = q[i * components + k];
+            residuals[i] = zigzag(v - prev);
+            prev = v;
+        }
+        encode_stream(residuals.data(), count, out);
+    }
+}
+
+bool decode_components(ByteReader &r, size_t components, size_t count, std::vector<uint32_t> &q) {
+    std::vector<uint32_t> residuals(count);
+    q.resize(count * components);
+    for (size_t k = 0; k < components; ++k) {
+        if (!decode_stream(r, count, residuals.data())) return false;
+        uint32_t prev = 0;
+        for (size_t i = 0; i < count; ++i) q[i * components + k] = prev += unzigzag(residuals[i]);
+    }
+    return true;
+}
+
+void encode_vertex_chunk(const tinyobj::MeshData &mesh, const Header &h, size_t b, size_t e, std::string &out) {
+    const size_t n = e - b;
+    std::vector<uint32_t> q(n * 3);
+    for (size_t i = 0; i < n; ++i) {
+        for (int k = 0; k < 3; ++k) q[i * 3 + k] = h.position[k].encode(mesh.positions[(b + i) * 3 + k]);
+    }
+    encode_components(q, 3, n, out);
+    if (h.flags & kHasNormals) {
+        for (size_t i = 0; i < n; ++i) {
+            float u, v;
+            oct_encode(&mesh.normals[(b + i) * 3], u, v);
+            q[i * 2] = h.normal.encode(u);
+            q[i * 2 + 1] = h.normal.encode(v);
+        }
+        encode_components(q, 2, n, out);
+    }
+    if (h.flags & kHasTexcoords) {
+        for (size_t i = 0; i < n; ++i) {
+            for (int k = 0; k < 2; ++k) q[i * 2 + k] = h.texcoord[k].encode(mesh.texcoords[(b + i) * 2 + k]);
+        }
+        encode_components(q, 2, n, out);
+    }
+}
+
+bool decode_vertex_chunk(ByteReader &r, const Header &h, size_t b, size_t e, tinyobj::MeshData &mesh) {
+    const size_t n = e - b;
+    std::vector<uint32_t> q;
+    if (!decode_components(r, 3, n, q)) return false;
+    for (size_t i = 0; i < n; ++i) {
+        for (int k = 0; k < 3; ++k) mesh.positions[(b + i) * 3 + k] = h.position[k].decode(q[i * 3 + k]);
+    }
+    if (h.flags & kHasNormals) {
+        if (!decode_components(r, 2, n, q)) return false;
+        for (size_t i = 0; i < n; ++i) {
+            oct_decode(h.normal.decode(q[i * 2]), h.normal.decode(q[i * 2 + 1]), &mesh.normals[(b + i) * 3]);
+        }
+    }
+    if (h.flags & kHasTexcoords) {
+        if (!decode_components(r, 2, n, q)) return false;
+        for (size_t i = 0; i < n; ++i) {
+            for (int k = 0; k < 2; ++k) mesh.texcoords[(b + i) * 2 + k] = h.texcoord[k].decode(q[i * 2 + k]);
+        }
+    }
+    return true;
+}
+
+// Residuals of triangles [b, e) in one mode; next_vertex is the one past the
+// largest index before b
+void index_residuals(const unsigned int *idx, size_t b, size_t e, IndexMode mode, uint32_t next_vertex,
+                     std::vector<uint32_t> &out) {
+    out.resize((e - b) * 3);
+    uint32_t prev[3] = {0, 0, 0};
+    for (size_t t = b; t < e; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t i = idx[t * 3 + k];
+            uint32_t &r = out[(t - b) * 3 + k];
+            if (mode == kPreviousCorner) {
+                r = zigzag(i - prev[k]);
+                prev[k] = i;
+            } else {
+                r = zigzag(next_vertex - i);
+                next_vertex = std::max(next_vertex, i + 1);
+            }
+        }
+    }
+}
+
+void encode_triangle_chunk(const pages::Vector<unsigned int> &indices, size_t b, size_t e, uint32_t next_vertex,
+                           std::string &out) {
+    std::vector<uint32_t> residuals;
+    std::string best;
+    uint32_t best_mode = 0;
+    for (IndexMode mode : {kPreviousCorner, kNextVertex}) {
+        std::string coded;
+        index_residuals(indices.data(), b, e, mode, next_vertex, residuals);
+        encode_stream(residuals.data(), residuals.size(), coded);
+        if (best.empty() || coded.size() < best.size()) {
+            best.swap(coded);
+            best_mode = mode;
+        }
+    }
+    ByteWriter w(out);
+    w.varint(best_mode);
+    w.varint(next_vertex);
+    w.bytes(best.data(), best.size());
+}
+
+bool decode_triangle_chunk(ByteReader &r, size_t b, size_t e, size_t vertices, tinyobj::MeshData &mesh) {
+    const uint32_t mode = static_cast<uint32_t>(r.varint());
+    uint32_t next_vertex = static_cast<uint32_t>(r.varint());
+    std::vector<uint32_t> residuals((e - b) * 3);
+    if (mode > kNextVertex || !decode_stream(r, residuals.size(), residuals.data())) return false;
+    uint32_t prev[3] = {0, 0, 0};
+    unsigned int *idx = mesh.indices.data();
+    bool in_range = true;
+    for (size_t t = b; t < e; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t d = unzigzag(residuals[(t - b) * 3 + k]);
+            uint32_t i;
+            if (mode == kPreviousCorner) {
+                i = prev[k] += d;
+            } else {
+                i = next_vertex - d;
+                next_vertex = std::max(next_vertex, i + 1);
+            }
+            in_range = in_range && i < vertices;
+            idx[t * 3 + k] = i;
+        }
+    }
+    return in_range;
+}
+
+void write_header(const tinyobj::MeshData &mesh, const Header &h, std::string &out) {
+    ByteWriter w(out);
+    w.bytes(kMagic, sizeof(kMagic));
+    w.varint(h.flags);
+    w.varint(h.vertices);
+    w.varint(h.triangles);
+    for (int b : h.bits) w.u8(static_cast<uint32_t>(b));
+    for (const Quantizer &q : h.position) {
+        w.f32(q.min);
+        w.f32(q.extent);
+    }
+    for (const Quantizer &q : h.texcoord) {
+        w.f32(q.min);
+        w.f32(q.extent);
+    }
+    w.varint(mesh.parts.size());
+    for (const tinyobj::MeshPart &p : mesh.parts) {
+        w.str(p.name);
+        w.varint(p.first_index);
+        w.varint(p.index_count);
+    }
+    w.varint(mesh.materials.size());
+    for (const tinyobj::Material &m : mesh.materials) {
+        w.str(m.name);
+        for (float v : m.ambient) w.f32(v);
+        for (float v : m.diffuse) w.f32(v);
+        for (float v : m.specular) w.f32(v);
+        w.f32(m.shininess);
+        w.f32(m.opacity);
+    }
+    w.varint(mesh.ranges.size());
+    for (const tinyobj::MeshRange &r : mesh.ranges) {
+        w.varint(r.first_index);
+        w.varint(r.index_count);
+        w.varint(r.part);
+        w.varint(r.material == tinyobj::kNoMaterial ? 0 : uint64_t(r.material) + 1);
+    }
+}
+
+bool read_header(ByteReader &r, tinyobj::MeshData &mesh, Header &h) {
+    const uint8_t *magic = r.skip(sizeof(kMagic));
+    if (!r.ok() || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) return false;
+    h.flags = static_cast<uint32_t>(r.varint());
+    const uint64_t vertices = r.varint(), triangles = r.varint();
+    if (vertices > kMaxCount || triangles > kMaxCount / 3) return false;
+    h.vertices = static_cast<size_t>(vertices);
+    h.triangles = static_cast<size_t>(triangles);
+    for (int &b : h.bits) {
+        b = static_cast<int>(r.u8());
+        if (b < 1 || b > 24) return false;
+    }
+    for (Quantizer &q : h.position) {
+        q.min = r.f32();
+        q.extent = r.f32();
+        q.max_q = (1u << h.bits[0]) - 1;
+    }
+    for (Quantizer &q : h.texcoord) {
+        q.min = r.f32();
+        q.extent = r.f32();
+        q.max_q = (1u << h.bits[2]) - 1;
+    }
+    h.normal = Quantizer{-1.0f, 2.0f, (1u << h.bits[1]) - 1};
+
+    mesh.parts.resize(std::min<uint64_t>(r.varint(), r.remaining()));
+    for (tinyobj::MeshPart &p : mesh.parts) {
+        p.name = r.str();
+        p.first_index = static_cast<size_t>(r.varint());
+        p.index_count = static_cast<size_t>(r.varint());
+    }
+    mesh.materials.resize(std::min<uint64_t>(r.varint(), r.remaining()));
+    for (tinyobj::Material &m : mesh.materials) {
+        m.name = r.str();
+        for (float &v : m.ambient) v = r.f32();
+        for (float &v : m.diffuse) v = r.f32();
+        for (float &v : m.specular) v = r.f32();
+        m.shininess = r.f32();
+        m.opacity = r.f32();
+    }
+    mesh.ranges.resize(std::min<uint64_t>(r.varint(), r.remaining()));
+    for (tinyobj::MeshRange &range : mesh.ranges) {
+        range.first_index = static_cast<size_t>(r.varint());
+        range.index_count = static_cast<size_t>(r.varint());
+        // Checked here, before the narrowing casts could wrap them into range
+        const uint64_t part = r.varint(), material = r.varint();
+        if (part >= mesh.parts.size() || material > mesh.materials.size()) return false;
+        range.part = static_cast<unsigned int>(part);
+        range.material = material ? static_cast<unsigned int>(material - 1) : tinyobj::kNoMaterial;
+    }
+    return r.ok();
+}
+
+} // namespace
+
+bool is_compressed_mesh(const char *data, size_t size) {
+    return size >= sizeof(kMagic) && std::memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+std::string encode_mesh(const tinyobj::MeshData &mesh, const CodecOptions &opt) {
+    TRACE_SCOPE("encode_mesh");
+    Header h;
+    h.vertices = mesh.positions.size() / 3;
+    h.triangles = mesh.indices.size() / 3;
+    // Like the exporter, attributes that do not cover every vertex are dropped
+    if (!mesh.normals.empty() && mesh.normals.size() == mesh.positions.size()) h.flags |= kHasNormals;
+    if (!mesh.texcoords.empty() && mesh.texcoords.size() / 2 == h.vertices) h.flags |= kHasTexcoords;
+    h.bits[0] = std::clamp(opt.position_bits, 1, 24);
+    h.bits[1] = std::clamp(opt.normal_bits, 1, 24);
+    h.bits[2] = std::clamp(opt.texcoord_bits, 1, 24);
+    for (int k = 0; k < 3; ++k) h.position[k] = fit(mesh.positions, 3, k, h.bits[0]);
+    for (int k = 0; k < 2; ++k) {
+        h.texcoord[k] = (h.flags & kHasTexcoords) ? fit(mesh.texcoords, 2, k, h.bits[2]) : fit({}, 2, k, h.bits[2]);
+    }
+    h.normal = Quantizer{-1.0f, 2.0f, (1u << h.bits[1]) - 1};
+
+    const size_t vertex_chunks = (h.vertices + kVertexChunk - 1) / kVertexChunk;
+    const size_t triangle_chunks = (h.triangles + kTriangleChunk - 1) / kTriangleChunk;
+    // Index state at the start of every triangle chunk
+    std::vector<uint32_t> next_vertex(triangle_chunks, 0);
+    for (size_t c = 1; c < triangle_chunks; ++c) {
+        uint32_t next = next_vertex[c - 1];
+        for (size_t i = (c - 1) * kTriangleChunk * 3; i < c * kTriangleChunk * 3; ++i) {
+            next = std::max(next, mesh.indices[i] + 1);
+        }
+        next_vertex[c] = next;
+    }
+
+    std::vector<std::string> chunks(vertex_chunks + triangle_chunks);
+    jobs::parallel_for(0, chunks.size(), 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c) {
+            if (c < vertex_chunks) {
+                const size_t b = c * kVertexChunk;
+                encode_vertex_chunk(mesh, h, b, std::min(h.vertices, b + kVertexChunk), chunks[c]);
+            } else {
+                const size_t t = c - vertex_chunks, b = t * kTriangleChunk;
+                encode_triangle_chunk(mesh.indices, b, std::min(h.triangles, b + kTriangleChunk), next_vertex[t],
+                                      chunks[c]);
+            }
+        }
+    });
+
+    std::string out;
+    write_header(mesh, h, out);
+    ByteWriter w(out);
+    w.varint(vertex_chunks);
+    w.varint(triangle_chunks);
+    for (const std::string &c : chunks) w.varint(c.size());
+    for (const std::string &c : chunks) w.bytes(c.data(), c.size());
+    return out;
+}
+
+bool decode_mesh(const char *data, size_t size, tinyobj::MeshData &mesh, std::string &err) {
+    TRACE_SCOPE("decode_mesh");
+    mesh = tinyobj::MeshData{};
+    ByteReader r(reinterpret_cast<const uint8_t *>(data), size);
+    Header h;
+    if (!read_header(r, mesh, h)) {
+        err = "Not a compressed mesh or corrupt header";
+        return false;
+    }
+    const size_t vertex_chunks = static_cast<size_t>(r.varint()), triangle_chunks = static_cast<size_t>(r.varint());
+    if (!r.ok() || vertex_chunks != (h.vertices + kVertexChunk - 1) / kVertexChunk ||
+        triangle_chunks != (h.triangles + kTriangleChunk - 1) / kTriangleChunk) {
+        err = "Corrupt compressed mesh: chunk table";
+        return false;
+    }
+    std::vector<size_t> offsets(vertex_chunks + triangle_chunks + 1, 0);
+    for (size_t c = 0; c + 1 < offsets.size(); ++c) offsets[c + 1] = offsets[c] + static_cast<size_t>(r.varint());
+    if (!r.ok() || offsets.back() > r.remaining()) {
+        err = "Corrupt compressed mesh: chunk table";
+        return false;
+    }
+    const uint8_t *payload = r.pos();
+
+    mesh.positions.resize(h.vertices * 3);
+    if (h.flags & kHasNormals) mesh.normals.resize(h.vertices * 3);
+    if (h.flags & kHasTexcoords) mesh.texcoords.resize(h.vertices * 2);
+    mesh.indices.resize(h.triangles * 3);
+    std::vector<uint8_t> failed(offsets.size() - 1, 0);
+    jobs::parallel_for(0, failed.size(), 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c) {
+            ByteReader chunk(payload + offsets[c], offsets[c + 1] - offsets[c]);
+            bool ok;
+            if (c < vertex_chunks) {
+                const size_t b = c * kVertexChunk;
+                ok = decode_vertex_chunk(chunk, h, b, std::min(h.vertices, b + kVertexChunk), mesh);
+            } else {
+                const size_t b = (c - vertex_chunks) * kTriangleChunk;
+                ok = decode_triangle_chunk(chunk, b, std::min(h.triangles, b + kTriangleChunk), h.vertices, mesh);
+            }
+            failed[c] = !ok || !chunk.ok();
+        }
+    });
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+        err = "Corrupt compressed mesh: chunk data";
+        return false;
+    }
+    // Written so that crafted counts cannot wrap the sums around
+    const size_t n = mesh.indices.size();
+    for (const tinyobj::MeshPart &p : mesh.parts) {
+        if (p.first_index > n || p.index_count > n - p.first_index) {
+            err = "Corrupt compressed mesh: parts";
+            return false;
+        }
+    }
+    for (const tinyobj::MeshRange &range : mesh.ranges) {
+        if (range.first_index > n || range.index_count > n - range.first_index || range.part >= mesh.parts.size() ||
+            (range.material != tinyobj::kNoMaterial && range.material >= mesh.materials.size())) {
+            err = "Corrupt compressed mesh: ranges";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool save_compressed_mesh(const tinyobj::MeshData &mesh, const std::string &path, std::string &err,
+                          const CodecOptions &opt) {
+    const std::string data = encode_mesh(mesh, opt);
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!ofs) {
+        err = "Cannot write file: " + path;
+        return false;
+    }
+    return true;
+}
+
+} // namespace gx
@@ -0,0 +1,488 @@
+#include "mesh_export.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#define GX_EXPORT_PWRITE 1
+#else
+#include <mutex>
+#endif
+
+#include "job_system.h"
+#include "mesh_codec.h"
+#include "trace.h"
+
+namespace gx {
+
+namespace {
+
+constexpr size_t kChunk = 65536;          // vertices or faces per formatting job
+constexpr size_t kBatchBytes = 64u << 20; // OBJ text formatted ahead of the writes
+constexpr size_t kFloatChars = 16;        // "-1.17549435e-38" and a separator
+constexpr size_t kFaceChars = 112;        // "f a/a/a b/b/b c/c/c\n" with 10-digit indices
+
+double ms_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Appends and positioned writes; write_at may be called from several threads.
+class OutputFile {
+public:
+    OutputFile() = default;
+    OutputFile(const OutputFile &) = delete;
+    OutputFile &operator=(const OutputFile &) = delete;
+    ~OutputFile() {
+        std::string ignored;
+        close(ignored);
+    }
+
+    bool open(const std::string &path, std::string &err) {
+        path_ = path;
+#ifdef GX_EXPORT_PWRITE
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+#else
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        if (!file_) {
+#endif
+            err = "Cannot write file: " + path;
+            return false;
+        }
+        return true;
+    }
+
+    bool append(const char *data, size_t size) {
+        const size_t offset = end_;
+        end_ += size;
+        return write_at(data, size, offset);
+    }
+
+    bool write_at(const char *data, size_t size, size_t offset) {
+#ifdef GX_EXPORT_PWRITE
+        while (size) {
+            const ssize_t n = ::pwrite(fd_, data, size, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+            offset += static_cast<size_t>(n);
+        }
+        return true;
+#else
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_.seekp(static_cast<std::streamoff>(offset));
+        file_.write(data, static_cast<std::streamsize>(size));
+        return static_cast<bool>(file_);
+#endif
+    }
+
+    bool close(std::string &err) {
+        bool ok = true;
+#ifdef GX_EXPORT_PWRITE
+        if (fd_ < 0) return true;
+        ok = ::close(fd_) == 0;
+        fd_ = -1;
+#else
+        if (!file_.is_open()) return true;
+        file_.close();
+        ok = !file_.fail();
+#endif
+        if (!ok) err = "Write failed: " + path_;
+        return ok;
+    }
+
+private:
+    std::string path_;
+    size_t end_ = 0;
+#ifdef GX_EXPORT_PWRITE
+    int fd_ = -1;
+#else
+    std::ofstream file_;
+    std::mutex mutex_;
+#endif
+};
+
+inline char *put_float(char *p, float v) { return std::to_chars(p, p + kFloatChars, v).ptr; }
+inline char *put_uint(char *p, uint32_t v) { return std::to_chars(p, p + 10, v).ptr; }
+
+inline char *put_text(char *p, const char *s) {
+    const size_t n = std::strlen(s);
+    std::memcpy(p, s, n);
+    return p + n;
+}
+
+// Little endian whatever the host
+inline char *put_le32(char *p, uint32_t v) {
+    p[0] = static_cast<char>(v);
+    p[1] = static_cast<char>(v >> 8);
+    p[2] = static_cast<char>(v >> 16);
+    p[3] = static_cast<char>(v >> 24);
+    return p + 4;
+}
+
+inline char *put_f32(char *p, float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return put_le32(p, bits);
+}
+
+struct Attributes {
+    bool normals, texcoords;
+};
+
+Attributes attributes(const tinyobj::MeshData &mesh, const ExportOptions &opt) {
+    return Attributes{opt.normals && !mesh.normals.empty() && mesh.normals.size() == mesh.positions.size(),
+                      opt.texcoords && !mesh.texcoords.empty() &&
+                          mesh.texcoords.size() / 2 == mesh.positions.size() / 3};
+}
+
+// A run of OBJ lines of one kind, formatted by one job; prefix holds the
+// o/usemtl lines (or the file header) that precede it.
+struct TextChunk {
+    enum Kind { Positions, Texcoords, Normals, Faces } kind;
+    size_t begin, end; // vertices or triangles
+    std::string prefix;
+
+    size_t max_bytes() const {
+        const size_t per = kind == Faces ? kFaceChars : kind == Texcoords ? 3 + 2 * kFloatChars : 3 + 3 * kFloatChars;
+        return prefix.size() + (end - begin) * per;
+    }
+};
+
+std::vector<TextChunk> obj_chunks(const tinyobj::MeshData &mesh, Attributes attr, std::string header) {
+    std::vector<TextChunk> chunks;
+    chunks.push_back(TextChunk{TextChunk::Positions, 0, 0, std::move(header)});
+    const size_t vertices = mesh.positions.size() / 3;
+    auto add_vertex_chunks = [&](TextChunk::Kind kind) {
+        for (size_t b = 0; b < vertices; b += kChunk) chunks.push_back(TextChunk{kind, b, std::min(vertices, b + kChunk), {}});
+    };
+    add_vertex_chunks(TextChunk::Positions);
+    if (attr.texcoords) add_vertex_chunks(TextChunk::Texcoords);
+    if (attr.normals) add_vertex_chunks(TextChunk::Normals);
+
+    // Meshes built in code may have parts without ranges, or neither
+    std::vector<tinyobj::MeshRange> ranges = mesh.ranges;
+    if (ranges.empty()) {
+        for (unsigned int p = 0; p < mesh.parts.size(); ++p) {
+            ranges.push_back(tinyobj::MeshRange{mesh.parts[p].first_index, mesh.parts[p].index_count, p});
+        }
+        if (mesh.parts.empty()) ranges.push_back(tinyobj::MeshRange{0, mesh.indices.size(), 0});
+    }
+    unsigned int part = ~0u, material = tinyobj::kNoMaterial;
+    for (const tinyobj::MeshRange &r : ranges) {
+        std::string prefix;
+        if (r.part != part && r.part < mesh.parts.size()) {
+            part = r.part;
+            const std::string &name = mesh.parts[part].name;
+            if (!name.empty()) {
+                prefix += "o " + name + "\n";
+            } else if (mesh.parts.size() > 1) {
+                prefix += "o part" + std::to_string(part) + "\n";
+            }
+        }
+        const unsigned int range_material = r.material < mesh.materials.size() ? r.material : tinyobj::kNoMaterial;
+        if (range_material != material) {
+            material = range_material;
+            // Faces without a material after a material range need a reset
+            prefix += "usemtl " +
+                      (material == tinyobj::kNoMaterial ? std::string(tinyobj::kDefaultMaterialName)
+                                                        : mesh.materials[material].name) +
+                      "\n";
+        }
+        const size_t t0 = r.first_index / 3, t1 = t0 + r.index_count / 3;
+        for (size_t b = t0; b < t1 || (b == t0 && !prefix.empty()); b += kChunk) {
+            chunks.push_back(TextChunk{TextChunk::Faces, b, std::min(t1, b + kChunk), std::move(prefix)});
+            prefix.clear();
+        }
+    }
+    return chunks;
+}
+
+void format_chunk(const tinyobj::MeshData &mesh, Attributes attr, const TextChunk &c, std::string &out) {
+    out.resize(c.max_bytes());
+    char *const start = &out[0];
+    char *p = start;
+    std::memcpy(p, c.prefix.data(), c.prefix.size());
+    p += c.prefix.size();
+    switch (c.kind) {
+    case TextChunk::Positions:
+    case TextChunk::Normals: {
+        const float *v = c.kind == TextChunk::Positions ? mesh.positions.data() : mesh.normals.data();
+        const char *tag = c.kind == TextChunk::Positions ? "v " : "vn ";
+        for (size_t i = c.begin; i < c.end; ++i) {
+            p = put_text(p, tag);
+            p = put_float(p, v[i * 3]);
+            *p++ = ' ';
+            p = put_float(p, v[i * 3 + 1]);
+            *p++ = ' ';
+            p = put_float(p, v[i * 3 + 2]);
+            *p++ = '\n';
+        }
+        break;
+    }
+    case TextChunk::Texcoords:
+        for (size_t i = c.begin; i < c.end; ++i) {
+            p = put_text(p, "vt ");
+            p = put_float(p, mesh.texcoords[i * 2]);
+            *p++ = ' ';
+            p = put_float(p, mesh.texcoords[i * 2 + 1]);
+            *p++ = '\n';
+        }
+        break;
+    case TextChunk::Faces: {
+        // OBJ indices are 1-based; every attribute shares the vertex index
+        for (size_t t = c.begin; t < c.end; ++t) {
+            *p++ = 'f';
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t idx = mesh.indices[t * 3 + k] + 1;
+                *p++ = ' ';
+                p = put_uint(p, idx);
+                if (attr.texcoords) {
+                    *p++ = '/';
+                    p = put_uint(p, idx);
+                }
+                if (attr.normals) {
+                    *p++ = '/';
+                    if (!attr.texcoords) *p++ = '/';
+                    p = put_uint(p, idx);
+                }
+            }
+            *p++ = '\n';
+        }
+        break;
+    }
+    }
+    out.resize(static_cast<size_t>(p - start));
+}
+
+// First chunk after begin whose estimated text no longer fits in a batch
+size_t batch_end(const std::vector<TextChunk> &chunks, size_t begin) {
+    size_t end = begin, bytes = 0;
+    while (end < chunks.size() && (end == begin || bytes + chunks[end].max_bytes() <= kBatchBytes)) {
+        bytes += chunks[end++].max_bytes();
+    }
+    return end;
+}
+
+void format_batch(const tinyobj::MeshData &mesh, Attributes attr, const std::vector<TextChunk> &chunks, size_t begin,
+                  size_t end, std::vector<std::string> &out) {
+    TRACE_SCOPE("format_obj");
+    out.resize(end - begin);
+    jobs::parallel_for(begin, end, 1, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) format_chunk(mesh, attr, chunks[i], out[i - begin]);
+    });
+}
+
+std::string format_float(float v) {
+    char buf[kFloatChars];
+    return std::string(buf, put_float(buf, v));
+}
+
+bool write_mtl(const std::vector<tinyobj::Material> &materials, const std::string &path, std::string &err) {
+    std::string text;
+    for (const tinyobj::Material &m : materials) {
+        text += "newmtl " + m.name + "\n";
+        auto color = [&](const char *key, const float *c) {
+            text += std::string(key) + " " + format_float(c[0]) + " " + format_float(c[1]) + " " + format_float(c[2]) + "\n";
+        };
+        color("Ka", m.ambient);
+        color("Kd", m.diffuse);
+        color("Ks", m.specular);
+        text += "Ns " + format_float(m.shininess) + "\nd " + format_float(m.opacity) + "\n\n";
+    }
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(text.data(), static_cast<std::streamsize>(text.size()));
+    if (!ofs) {
+        err = "Cannot write file: " + path;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+MeshFormat format_from_path(const std::string &path) {
+    const size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) return MeshFormat::Obj;
+    std::string ext = path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (ext == "ply") return MeshFormat::Ply;
+    return ext == "gxm" ? MeshFormat::Gxm : MeshFormat::Obj;
+}
+
+std::string format_obj(const tinyobj::MeshData &mesh, const ExportOptions &opt) {
+    const Attributes attr = attributes(mesh, opt);
+    const std::vector<TextChunk> chunks = obj_chunks(mesh, attr, {});
+    std::vector<std::string> parts;
+    format_batch(mesh, attr, chunks, 0, chunks.size(), parts);
+    size_t size = 0;
+    for (const std::string &s : parts) size += s.size();
+    std::string text;
+    text.reserve(size);
+    for (const std::string &s : parts) text += s;
+    return text;
+}
+
+bool export_obj(const tinyobj::MeshData &mesh, const std::string &path, std::string &err, const ExportOptions &opt,
+                ExportStats *stats) {
+    TRACE_SCOPE("export_obj");
+    const auto t0 = std::chrono::steady_clock::now();
+    std::string header;
+    if (opt.write_mtl && !mesh.materials.empty()) {
+        const size_t slash = path.find_last_of("/\\"), dot = path.find_last_of('.');
+        const std::string stem = dot != std::string::npos && (slash == std::string::npos || dot > slash) ? path.substr(0, dot) : path;
+        if (!write_mtl(mesh.materials, stem + ".mtl", err)) return false;
+        header = "mtllib " + stem.substr(slash == std::string::npos ? 0 : slash + 1) + ".mtl\n";
+    }
+
+    OutputFile file;
+    if (!file.open(path, err)) return false;
+    const Attributes attr = attributes(mesh, opt);
+    const std::vector<TextChunk> chunks = obj_chunks(mesh, attr, std::move(header));
+
+    // The next batch is formatted on the job system while this thread writes
+    std::vector<std::string> current, next;
+    size_t end = batch_end(chunks, 0), bytes = 0;
+    format_batch(mesh, attr, chunks, 0, end, current);
+    bool ok = true;
+    for (;;) {
+        const size_t next_begin = end, next_end = batch_end(chunks, end);
+        jobs::TaskHandle pending;
+        if (next_begin < chunks.size()) {
+            pending = jobs::JobSystem::instance().run(
+                [&, next_begin, next_end] { format_batch(mesh, attr, chunks, next_begin, next_end, next); });
+        }
+        {
+            TRACE_SCOPE("write_obj");
+            for (const std::string &s : current) {
+                ok = ok && file.append(s.data(), s.size());
+                bytes += s.size();
+            }
+        }
+        if (pending) jobs::JobSystem::instance().wait(pending);
+        if (!ok || !pending) break;
+        std::swap(current, next);
+        end = next_end;
+    }
+    if (!ok) {
+        err = "Write failed: " + path;
+        return false;
+    }
+    if (!file.close(err)) return false;
+    if (stats) *stats = ExportStats{bytes, ms_since(t0)};
+    return true;
+}
+
+bool export_ply(const tinyobj::MeshData &mesh, const std::string &path, std::string &err, const ExportOptions &opt,
+                ExportStats *stats) {
+    TRACE_SCOPE("export_ply");
+    const auto t0 = std::chrono::steady_clock::now();
+    const Attributes attr = attributes(mesh, opt);
+    const size_t vertices = mesh.positions.size() / 3, faces = mesh.indices.size() / 3;
+    std::string header = "ply\nformat binary_little_endian 1.0\nelement vertex " + std::to_string(vertices) +
+                         "\nproperty float x\nproperty float y\nproperty float z\n";
+    if (attr.normals) header += "property float nx\nproperty float ny\nproperty float nz\n";
+    if (attr.texcoords) header += "property float s\nproperty float t\n";
+    header += "element face " + std::to_string(faces) + "\nproperty list uchar int vertex_indices\nend_header\n";
+
+    // Fixed record sizes: every chunk knows its offset up front
+    const size_t vertex_size = 4 * (3 + (attr.normals ? 3 : 0) + (attr.texcoords ? 2 : 0)), face_size = 1 + 3 * 4;
+    const size_t vertex_chunks = (vertices + kChunk - 1) / kChunk, face_chunks = (faces + kChunk - 1) / kChunk;
+    const size_t face_base = header.size() + vertices * vertex_size;
+
+    OutputFile file;
+    if (!file.open(path, err)) return false;
+    bool ok = file.append(header.data(), header.size());
+    std::vector<uint8_t> failed(vertex_chunks + face_chunks, 0);
+    jobs::parallel_for(0, vertex_chunks + face_chunks, 1, [&](size_t lo, size_t hi) {
+        std::vector<char> buf;
+        for (size_t c = lo; c < hi; ++c) {
+            size_t offset;
+            char *p;
+            if (c < vertex_chunks) {
+                const size_t b = c * kChunk, e = std::min(vertices, b + kChunk);
+                buf.resize((e - b) * vertex_size);
+                p = buf.data();
+                for (size_t i = b; i < e; ++i) {
+                    for (int k = 0; k < 3; ++k) p = put_f32(p, mesh.positions[i * 3 + k]);
+                    if (attr.normals) {
+                        for (int k = 0; k < 3; ++k) p = put_f32(p, mesh.normals[i * 3 + k]);
+                    }
+                    if (attr.texcoords) {
+                        p = put_f32(p, mesh.texcoords[i * 2]);
+                        p = put_f32(p, mesh.texcoords[i * 2 + 1]);
+                    }
+                }
+                offset = header.size() + b * vertex_size;
+            } else {
+                const size_t b = (c - vertex_chunks) * kChunk, e = std::min(faces, b + kChunk);
+                buf.resize((e - b) * face_size);
+                p = buf.data();
+                for (size_t t = b; t < e; ++t) {
+                    *p++ = 3;
+                    for (int k = 0; k < 3; ++k) p = put_le32(p, mesh.indices[t * 3 + k]);
+                }
+                offset = face_base + b * face_size;
+            }
+            failed[c] = !file.write_at(buf.data(), buf.size(), offset);
+        }
+    });
+    ok = ok && std::find(failed.begin(), failed.end(), 1) == failed.end();
+    if (!ok) {
+        err = "Write failed: " + path;
+        return false;
+    }
+    if (!file.close(err)) return false;
+    if (stats) *stats = ExportStats{face_base + faces * face_size, ms_since(t0)};
+    return true;
+}
+
+bool export_mesh(const tinyobj::MeshData &mesh, const std::string &path, std::string &err, const ExportOptions &opt,
+                 ExportStats *stats) {
+    switch (format_from_path(path)) {
+    case MeshFormat::Ply:
+        return export_ply(mesh, path, err, opt, stats);
+    case MeshFormat::Gxm: {
+        const auto t0 = std::chrono::steady_clock::now();
+        // Streams the options leave out are dropped from a copy (mtl files
+        // do not apply: materials are stored inside)
+        const Attributes attr = attributes(mesh, opt);
+        const bool strip = attr.normals != !mesh.normals.empty() || attr.texcoords != !mesh.texcoords.empty();
+        tinyobj::MeshData stripped;
+        if (strip) {
+            stripped.positions = mesh.positions;
+            if (attr.normals) stripped.normals = mesh.normals;
+            if (attr.texcoords) stripped.texcoords = mesh.texcoords;
+            stripped.indices = mesh.indices;
+            stripped.parts = mesh.parts;
+            stripped.materials = mesh.materials;
+            stripped.ranges = mesh.ranges;
+        }
+        const std::string data = encode_mesh(strip ? stripped : mesh);
+        OutputFile file;
+        if (!file.open(path, err)) return false;
+        if (!file.append(data.data(), data.size())) {
+            err = "Write failed: " + path;
+            return false;
+        }
+        if (!file.close(err)) return false;
+        if (stats) *stats = ExportStats{data.size(), ms_since(t0)};
+        return true;
+    }
+    case MeshFormat::Obj:
+        break;
+    }
+    return export_obj(mesh, path, err, opt, stats);
+}
+
+} // namespace gx
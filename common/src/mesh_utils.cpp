@@ -0,0 +1,100 @@
+#include "mesh_utils.h"
+
+#include <cmath>
+
+#include "alloc_tracker.h"
+#include "job_system.h"
+#include "perf_counters.h"
+#include "trace.h"
+
+namespace gx {
+
+void compute_normals_if_missing(tinyobj::MeshData &mesh) {
+    if (!mesh.normals.empty()) return;
+    TRACE_SCOPE("compute_normals");
+    ALLOC_PHASE("normals");
+    const size_t vertex_count = mesh.positions.size() / 3;
+    const size_t tri_count = mesh.indices.size() / 3;
+
+    // Unnormalized (area weighted) face normals
+    std::vector<float> face_normals(tri_count * 3);
+    jobs::parallel_for(0, tri_count, 4096, [&](size_t lo, size_t hi) {
+        PERF_SCOPE("normals_faces");
+        for (size_t f = lo; f < hi; ++f) {
+            const float *a = &mesh.positions[mesh.indices[f * 3 + 0] * 3];
+            const float *b = &mesh.positions[mesh.indices[f * 3 + 1] * 3];
+            const float *c = &mesh.positions[mesh.indices[f * 3 + 2] * 3];
+            float ux = b[0] - a[0];
+            float uy = b[1] - a[1];
+            float uz = b[2] - a[2];
+            float vx = c[0] - a[0];
+            float vy = c[1] - a[1];
+            float vz = c[2] - a[2];
+            face_normals[f * 3 + 0] = uy * vz - uz * vy;
+            face_normals[f * 3 + 1] = uz * vx - ux * vz;
+            face_normals[f * 3 + 2] = ux * vy - uy * vx;
+        }
+    });
+
+    // Vertex -> face lists (counting sort), so each vertex gathers its own sum
+    // without atomics and in the same order as a sequential scatter.
+    std::vector<unsigned int> offsets(vertex_count + 1, 0);
+    std::vector<unsigned int> vertex_faces(tri_count * 3);
+    {
+        PERF_SCOPE("normals_adjacency");
+        for (size_t i = 0; i < tri_count * 3; ++i) ++offsets[mesh.indices[i] + 1];
+        for (size_t v = 0; v < vertex_count; ++v) offsets[v + 1] += offsets[v];
+        std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < tri_count * 3; ++i) {
+            vertex_faces[cursor[mesh.indices[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+    }
+
+    mesh.normals.assign(mesh.positions.size(), 0.0f);
+    jobs::parallel_for(0, vertex_count, 8192, [&](size_t lo, size_t hi) {
+        PERF_SCOPE("normals_gather");
+        for (size_t v = lo; v < hi; ++v) {
+            float nx = 0.0f, ny = 0.0f, nz = 0.0f;
+            for (unsigned int k = offsets[v]; k < offsets[v + 1]; ++k) {
+                const float *fn = &face_normals[vertex_faces[k] * 3];
+                nx += fn[0];
+                ny += fn[1];
+                nz += fn[2];
+            }
+            float len = std::sqrt(nx * nx + ny * ny + nz * nz);
+            if (len > 1e-6f) {
+                nx /= len;
+                ny /= len;
+                nz /= len;
+            }
+            mesh.normals[v * 3 + 0] = nx;
+            mesh.normals[v * 3 + 1] = ny;
+            mesh.normals[v * 3 + 2] = nz;
+        }
+    });
+}
+
+pages::Vector<float> interleave_vertices(const tinyobj::MeshData &mesh, MeshBounds *bounds) {
+    TRACE_SCOPE("interleave");
+    ALLOC_PHASE("interleave");
+    const size_t vertex_count = mesh.positions.size() / 3;
+    const size_t grain = 16384;
+    pages::Vector<float> interleaved(vertex_count * kVertexStride);
+    BoundsAccumulator acc(mesh.positions.data(), bounds ? vertex_count : 0, grain);
+    jobs::parallel_for(0, vertex_count, grain, [&](size_t lo, size_t hi) {
+        if (bounds) acc.add(lo, hi);
+        for (size_t i = lo; i < hi; ++i) {
+            float *dst = &interleaved[i * kVertexStride];
+            dst[0] = mesh.positions[i * 3 + 0];
+            dst[1] = mesh.positions[i * 3 + 1];
+            dst[2] = mesh.positions[i * 3 + 2];
+            dst[3] = mesh.normals[i * 3 + 0];
+            dst[4] = mesh.normals[i * 3 + 1];
+            dst[5] = mesh.normals[i * 3 + 2];
+        }
+    });
+    if (bounds) *bounds = acc.finish();
+    return interleaved;
+}
+
+} // namespace gx
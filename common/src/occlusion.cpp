@@ -0,0 +1,322 @@
+#include "occlusion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GX_OCCLUSION_SSE2 1
+#endif
+
+#include "job_system.h"
+#include "trace.h"
+
+namespace gx {
+
+namespace {
+
+constexpr float kMinW = 1e-5f;
+constexpr uint32_t kFullTile = 0xffffffffu; // 8x4 pixels, bit = row * 8 + column
+
+struct Clip {
+    float x, y, z, w;
+};
+
+inline Clip transform(const Mat4 &mvp, const float *p) {
+    const float *m = mvp.m;
+    return Clip{m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12], m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13],
+                m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14], m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15]};
+}
+
+// In front of the near plane (GL clip space)
+inline bool in_front(const Clip &c) { return c.w > kMinW && c.z >= -c.w; }
+
+double ms_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+std::vector<Aabb> part_bounds(const tinyobj::MeshData &mesh) {
+    return part_bounds(PositionView{mesh.positions.data(), 3}, mesh.indices.data(), mesh.parts);
+}
+
+std::vector<Aabb> part_bounds(PositionView positions, const unsigned int *indices,
+                              const std::vector<tinyobj::MeshPart> &parts) {
+    std::vector<Aabb> bounds(parts.size());
+    for (size_t p = 0; p < parts.size(); ++p) {
+        const tinyobj::MeshPart &part = parts[p];
+        Aabb box{Vec3(1e30f, 1e30f, 1e30f), Vec3(-1e30f, -1e30f, -1e30f)};
+        for (size_t i = part.first_index; i < part.first_index + part.index_count; ++i) {
+            const float *v = positions[indices[i]];
+            box.min = Vec3(std::min(box.min.x, v[0]), std::min(box.min.y, v[1]), std::min(box.min.z, v[2]));
+            box.max = Vec3(std::max(box.max.x, v[0]), std::max(box.max.y, v[1]), std::max(box.max.z, v[2]));
+        }
+        bounds[p] = box;
+    }
+    return bounds;
+}
+
+MaskedDepthBuffer::MaskedDepthBuffer(int width, int height) {
+    tiles_x_ = (std::max(width, 1) + kTileWidth - 1) / kTileWidth;
+    tiles_y_ = (std::max(height, 1) + kTileHeight - 1) / kTileHeight;
+    width_ = tiles_x_ * kTileWidth;
+    height_ = tiles_y_ * kTileHeight;
+    blocks_x_ = (tiles_x_ + kBlockTiles - 1) / kBlockTiles;
+    blocks_y_ = (tiles_y_ + kBlockTiles - 1) / kBlockTiles;
+    const size_t tiles = static_cast<size_t>(tiles_x_) * tiles_y_;
+    mask_.resize(tiles);
+    zmax0_.resize(tiles);
+    zmax1_.resize(tiles);
+    block_zmax_.resize(static_cast<size_t>(blocks_x_) * blocks_y_);
+    clear();
+}
+
+void MaskedDepthBuffer::clear() {
+    std::fill(mask_.begin(), mask_.end(), 0u);
+    std::fill(zmax0_.begin(), zmax0_.end(), 1.0f);
+    std::fill(zmax1_.begin(), zmax1_.end(), 0.0f);
+    std::fill(block_zmax_.begin(), block_zmax_.end(), 1.0f);
+}
+
+void MaskedDepthBuffer::rasterize(const float *triangles, size_t count, const Mat4 &mvp) {
+    TRACE_SCOPE("occluder_raster");
+    const float sx = 0.5f * width_, sy = 0.5f * height_;
+    for (size_t t = 0; t < count; ++t) {
+        float screen[3][3];
+        bool clipped = false;
+        for (int k = 0; k < 3; ++k) {
+            const Clip c = transform(mvp, triangles + t * 9 + k * 3);
+            // Occluders crossing the near plane are skipped rather than clipped
+            if (!in_front(c)) {
+                clipped = true;
+                break;
+            }
+            const float inv_w = 1.0f / c.w;
+            screen[k][0] = (c.x * inv_w + 1.0f) * sx;
+            screen[k][1] = (c.y * inv_w + 1.0f) * sy;
+            screen[k][2] = c.z * inv_w * 0.5f + 0.5f;
+        }
+        if (!clipped) rasterize_triangle(screen);
+    }
+}
+
+// Two-layer tile update from the paper: the working layer is discarded when
+// the triangle is farther from it than it is from the tile layer, and folded
+// into the tile layer once its mask is full.
+void MaskedDepthBuffer::update_tile(size_t tile, uint32_t coverage, float depth) {
+    float &z0 = zmax0_[tile], &z1 = zmax1_[tile];
+    uint32_t &mask = mask_[tile];
+    if (depth >= z0) return;
+    if (mask && std::fabs(depth - z1) > z0 - z1) {
+        mask = 0;
+        z1 = 0.0f;
+    }
+    z1 = mask ? std::max(z1, depth) : depth;
+    mask |= coverage;
+    if (mask == kFullTile) {
+        z0 = std::min(z0, z1);
+        mask = 0;
+        z1 = 0.0f;
+    }
+}
+
+void MaskedDepthBuffer::rasterize_triangle(const float (*v)[3]) {
+    const float x0 = v[0][0], y0 = v[0][1], x1 = v[1][0], y1 = v[1][1], x2 = v[2][0], y2 = v[2][1];
+    const float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    if (!(std::fabs(area) > 1e-6f)) return; // degenerate (or NaN)
+
+    const float zmin = std::min({v[0][2], v[1][2], v[2][2]});
+    const float zmax = std::min(std::max({v[0][2], v[1][2], v[2][2]}), 1.0f);
+    if (zmin >= 1.0f) return;
+
+    // Pixel bounds, clamped to the buffer
+    const float bx0 = std::max(std::min({x0, x1, x2}), 0.0f);
+    const float by0 = std::max(std::min({y0, y1, y2}), 0.0f);
+    const float bx1 = std::min(std::max({x0, x1, x2}), static_cast<float>(width_));
+    const float by1 = std::min(std::max({y0, y1, y2}), static_cast<float>(height_));
+    if (bx0 >= bx1 || by0 >= by1) return;
+    const int tx0 = static_cast<int>(bx0) / kTileWidth, tx1 = std::min(static_cast<int>(bx1) / kTileWidth, tiles_x_ - 1);
+    const int ty0 = static_cast<int>(by0) / kTileHeight, ty1 = std::min(static_cast<int>(by1) / kTileHeight, tiles_y_ - 1);
+
+    // Edge functions, positive inside: E = A x + B y + C
+    const float sign = area > 0.0f ? 1.0f : -1.0f;
+    float ea[3], eb[3], ec[3];
+    for (int i = 0; i < 3; ++i) {
+        const float *a = v[i], *b = v[(i + 1) % 3];
+        ea[i] = sign * (a[1] - b[1]);
+        eb[i] = sign * (b[0] - a[0]);
+        ec[i] = sign * (a[0] * b[1] - a[1] * b[0]);
+    }
+    // Depth plane
+    const float dzdx = ((v[1][2] - v[0][2]) * (y2 - y0) - (v[2][2] - v[0][2]) * (y1 - y0)) / area;
+    const float dzdy = ((v[2][2] - v[0][2]) * (x1 - x0) - (v[1][2] - v[0][2]) * (x2 - x0)) / area;
+
+#ifdef GX_OCCLUSION_SSE2
+    const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f), zero = _mm_setzero_ps();
+#endif
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        const float py = static_cast<float>(ty * kTileHeight);
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            const float px = static_cast<float>(tx * kTileWidth);
+            uint32_t coverage = 0;
+#ifdef GX_OCCLUSION_SSE2
+            __m128 row[3], step_y[3], half[3];
+            for (int i = 0; i < 3; ++i) {
+                row[i] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[i]), _mm_add_ps(_mm_set1_ps(px), lane)),
+                                    _mm_set1_ps(eb[i] * (py + 0.5f) + ec[i]));
+                step_y[i] = _mm_set1_ps(eb[i]);
+                half[i] = _mm_set1_ps(4.0f * ea[i]);
+            }
+            for (int r = 0; r < kTileHeight; ++r) {
+                __m128 left = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(row[0], zero), _mm_cmpge_ps(row[1], zero)),
+                                         _mm_cmpge_ps(row[2], zero));
+                __m128 right = _mm_and_ps(
+                    _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(row[0], half[0]), zero),
+                               _mm_cmpge_ps(_mm_add_ps(row[1], half[1]), zero)),
+                    _mm_cmpge_ps(_mm_add_ps(row[2], half[2]), zero));
+                coverage |= static_cast<uint32_t>(_mm_movemask_ps(left) | (_mm_movemask_ps(right) << 4)) << (r * 8);
+                for (int i = 0; i < 3; ++i) row[i] = _mm_add_ps(row[i], step_y[i]);
+            }
+#else
+            for (int r = 0; r < kTileHeight; ++r) {
+                for (int c = 0; c < kTileWidth; ++c) {
+                    const float x = px + c + 0.5f, y = py + r + 0.5f;
+                    bool inside = true;
+                    for (int i = 0; i < 3; ++i) inside = inside && ea[i] * x + eb[i] * y + ec[i] >= 0.0f;
+                    if (inside) coverage |= 1u << (r * 8 + c);
+                }
+            }
+#endif
+            if (!coverage) continue;
+            // Farthest depth of the plane over the tile part inside the bounds
+            const float cx = dzdx > 0.0f ? std::min(px + kTileWidth, bx1) : std::max(px, bx0);
+            const float cy = dzdy > 0.0f ? std::min(py + kTileHeight, by1) : std::max(py, by0);
+            const float depth = std::min(v[0][2] + dzdx * (cx - x0) + dzdy * (cy - y0), zmax);
+            update_tile(static_cast<size_t>(ty) * tiles_x_ + tx, coverage, depth);
+        }
+    }
+}
+
+void MaskedDepthBuffer::update_hierarchy() {
+    for (int by = 0; by < blocks_y_; ++by) {
+        for (int bx = 0; bx < blocks_x_; ++bx) {
+            float z = 0.0f;
+            for (int ty = by * kBlockTiles; ty < std::min((by + 1) * kBlockTiles, tiles_y_); ++ty) {
+                for (int tx = bx * kBlockTiles; tx < std::min((bx + 1) * kBlockTiles, tiles_x_); ++tx) {
+                    z = std::max(z, zmax0_[static_cast<size_t>(ty) * tiles_x_ + tx]);
+                }
+            }
+            block_zmax_[static_cast<size_t>(by) * blocks_x_ + bx] = z;
+        }
+    }
+}
+
+bool MaskedDepthBuffer::test(const Aabb &box, const Mat4 &mvp) const {
+    float x0 = 1e30f, y0 = 1e30f, x1 = -1e30f, y1 = -1e30f, zmin = 1e30f;
+    for (int corner = 0; corner < 8; ++corner) {
+        const float p[3] = {corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y,
+                            corner & 4 ? box.max.z : box.min.z};
+        const Clip c = transform(mvp, p);
+        if (!in_front(c)) return true;
+        const float inv_w = 1.0f / c.w;
+        const float x = (c.x * inv_w + 1.0f) * 0.5f * width_, y = (c.y * inv_w + 1.0f) * 0.5f * height_;
+        x0 = std::min(x0, x);
+        x1 = std::max(x1, x);
+        y0 = std::min(y0, y);
+        y1 = std::max(y1, y);
+        zmin = std::min(zmin, c.z * inv_w * 0.5f + 0.5f);
+    }
+    if (x1 < 0.0f || y1 < 0.0f || x0 >= width_ || y0 >= height_ || zmin > 1.0f) return false; // outside the view
+
+    const int tx0 = static_cast<int>(std::max(x0, 0.0f)) / kTileWidth;
+    const int ty0 = static_cast<int>(std::max(y0, 0.0f)) / kTileHeight;
+    const int tx1 = static_cast<int>(std::min(x1, width_ - 1.0f)) / kTileWidth;
+    const int ty1 = static_cast<int>(std::min(y1, height_ - 1.0f)) / kTileHeight;
+
+    // Coarse level first: hidden if every block is nearer than the box
+    bool maybe_visible = false;
+    for (int by = ty0 / kBlockTiles; by <= ty1 / kBlockTiles && !maybe_visible; ++by) {
+        for (int bx = tx0 / kBlockTiles; bx <= tx1 / kBlockTiles; ++bx) {
+            if (block_zmax_[static_cast<size_t>(by) * blocks_x_ + bx] >= zmin) {
+                maybe_visible = true;
+                break;
+            }
+        }
+    }
+    if (!maybe_visible) return false;
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            if (zmax0_[static_cast<size_t>(ty) * tiles_x_ + tx] >= zmin) return true;
+        }
+    }
+    return false;
+}
+
+OcclusionCuller::OcclusionCuller(const tinyobj::MeshData &mesh)
+    : OcclusionCuller(PositionView{mesh.positions.data(), 3}, mesh.indices.data(), mesh.parts) {}
+
+OcclusionCuller::OcclusionCuller(PositionView positions, const unsigned int *indices,
+                                 const std::vector<tinyobj::MeshPart> &parts)
+    : bounds_(part_bounds(positions, indices, parts)) {
+    stats_.parts = bounds_.size();
+
+    // Occluders: the parts with the largest bounds (surface area)
+    std::vector<uint32_t> order(bounds_.size());
+    for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+    auto surface = [&](uint32_t i) {
+        const Vec3 d = bounds_[i].max - bounds_[i].min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    };
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return surface(a) > surface(b); });
+    order.resize(std::min(order.size(), kMaxOccluders));
+
+    auto corner = [&](size_t i) { return Vec3(positions[i][0], positions[i][1], positions[i][2]); };
+    for (uint32_t p : order) {
+        const tinyobj::MeshPart &part = parts[p];
+        // Largest triangles first when the part is over budget
+        std::vector<std::pair<float, size_t>> tris;
+        for (size_t i = part.first_index; i + 2 < part.first_index + part.index_count; i += 3) {
+            const Vec3 a = corner(indices[i]), b = corner(indices[i + 1]), c = corner(indices[i + 2]);
+            tris.emplace_back(dot(cross(b - a, c - a), cross(b - a, c - a)), i);
+        }
+        if (tris.size() > kOccluderTriangles) {
+            std::nth_element(tris.begin(), tris.begin() + kOccluderTriangles, tris.end(),
+                             [](const auto &a, const auto &b) { return a.first > b.first; });
+            tris.resize(kOccluderTriangles);
+        }
+        for (const auto &t : tris) {
+            for (int k = 0; k < 3; ++k) {
+                const float *v = positions[indices[t.second + k]];
+                occluder_triangles_.insert(occluder_triangles_.end(), v, v + 3);
+            }
+        }
+        ++stats_.occluders;
+    }
+    stats_.occluder_triangles = occluder_triangles_.size() / 9;
+}
+
+const std::vector<uint32_t> &OcclusionCuller::cull(const Mat4 &mvp) {
+    TRACE_SCOPE("occlusion_cull");
+    auto t0 = std::chrono::steady_clock::now();
+    buffer_.clear();
+    buffer_.rasterize(occluder_triangles_.data(), stats_.occluder_triangles, mvp);
+    buffer_.update_hierarchy();
+    stats_.raster_ms = ms_since(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    flags_.resize(bounds_.size());
+    jobs::parallel_for(0, bounds_.size(), 64, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) flags_[i] = buffer_.test(bounds_[i], mvp);
+    });
+    visible_.clear();
+    for (uint32_t i = 0; i < flags_.size(); ++i) {
+        if (flags_[i]) visible_.push_back(i);
+    }
+    stats_.test_ms = ms_since(t0);
+    stats_.visible = visible_.size();
+    return visible_;
+}
+
+} // namespace gx
@@ -0,0 +1,132 @@
+#include "page_alloc.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define GX_HAVE_MMAP 1
+#endif
+
+#include "alloc_tracker.h"
+#include "job_system.h"
+#include "trace.h"
+
+namespace pages {
+
+namespace {
+
+size_t round_up(size_t v, size_t to) { return (v + to - 1) / to * to; }
+
+bool env_flag(const char *name) {
+    const char *v = std::getenv(name);
+    return v && *v && std::strcmp(v, "0") != 0;
+}
+
+#ifdef GX_HAVE_MMAP
+
+// Faults in [p, p + bytes) in 2 MB slices on the job system. MADV_POPULATE_WRITE
+// (Linux 5.14) does a slice in one call; elsewhere every page is written once.
+void prefault(char *p, size_t bytes) {
+    TRACE_SCOPE_ARG("prefault", "bytes", static_cast<int64_t>(bytes));
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t slices = (bytes + kHugePageSize - 1) / kHugePageSize;
+    jobs::parallel_for(0, slices, 1, [&](size_t lo, size_t hi) {
+        for (size_t s = lo; s < hi; ++s) {
+            char *b = p + s * kHugePageSize;
+            const size_t len = std::min(kHugePageSize, bytes - s * kHugePageSize);
+#ifdef MADV_POPULATE_WRITE
+            if (::madvise(b, len, MADV_POPULATE_WRITE) == 0) continue;
+#endif
+            for (size_t off = 0; off < len; off += page) static_cast<volatile char *>(b)[off] = 0;
+        }
+    });
+}
+
+#endif
+
+} // namespace
+
+Policy &policy() {
+    static Policy p;
+    return p;
+}
+
+bool parse_flag(const std::string &arg) {
+    if (arg == "--huge-pages") {
+        policy().huge = true;
+    } else if (arg == "--prefault") {
+        policy().prefault = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const Policy &init_from_env() {
+    Policy &p = policy();
+    p.huge = p.huge || env_flag("GX_HUGE_PAGES");
+    p.prefault = p.prefault || env_flag("GX_PREFAULT");
+    return p;
+}
+
+std::string describe(const Policy &p) {
+    std::string s = p.huge ? "huge pages" : "4 KB pages";
+    s += p.prefault ? ", prefault" : ", fault on first touch";
+    return s;
+}
+
+#ifdef GX_HAVE_MMAP
+
+void *allocate(size_t bytes) {
+    // Over-map by one huge page and trim to a 2 MB aligned range, so that the
+    // buffer can be backed by huge pages from its first byte
+    const size_t size = round_up(bytes, kHugePageSize);
+    const size_t reserve = size + kHugePageSize;
+    void *m = ::mmap(nullptr, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) throw std::bad_alloc();
+    char *base = static_cast<char *>(m);
+    char *p = reinterpret_cast<char *>(round_up(reinterpret_cast<uintptr_t>(base), kHugePageSize));
+    if (p > base) ::munmap(base, static_cast<size_t>(p - base));
+    if (base + reserve > p + size) ::munmap(p + size, static_cast<size_t>(base + reserve - (p + size)));
+
+    const Policy &pol = policy();
+#ifdef MADV_HUGEPAGE
+    if (pol.huge) ::madvise(p, size, MADV_HUGEPAGE);
+#endif
+    if (pol.prefault) prefault(p, bytes);
+    alloc::note_mapped(p, bytes);
+    return p;
+}
+
+void deallocate(void *p, size_t bytes) noexcept {
+    if (!p) return;
+    alloc::note_unmapped(p, bytes);
+    ::munmap(p, round_up(bytes, kHugePageSize));
+}
+
+#else
+
+void *allocate(size_t bytes) { return ::operator new(bytes); }
+void deallocate(void *p, size_t) noexcept { ::operator delete(p); }
+
+#endif
+
+size_t huge_page_bytes() {
+#ifdef __linux__
+    std::ifstream in("/proc/self/smaps_rollup");
+    std::string key;
+    size_t kb = 0;
+    while (in >> key) {
+        if (key == "AnonHugePages:" && in >> kb) return kb * 1024;
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+#endif
+    return 0;
+}
+
+} // namespace pages
@@ -0,0 +1,314 @@
+#include "progressive_tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "job_system.h"
+#include "mesh_utils.h"
+#include "trace.h"
+
+namespace gx {
+
+namespace {
+
+constexpr float kBackground[3] = {0.07f, 0.08f, 0.10f}; // obj_viewer's clear colour
+constexpr float kOffset = 2e-4f; // secondary ray origins off the surface, bounding radii
+
+uint32_t hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Uniform in [0, 1) from a running hash
+float next_float(uint32_t &state) {
+    state = hash(state + 0x9e3779b9u);
+    return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+}
+
+Vec3 mat3_mul(const float *m, const Vec3 &v) { // column-major 3x3 in a 4x4
+    return Vec3(m[0] * v.x + m[4] * v.y + m[8] * v.z, m[1] * v.x + m[5] * v.y + m[9] * v.z,
+                m[2] * v.x + m[6] * v.y + m[10] * v.z);
+}
+
+Vec3 mat3_mul_transposed(const float *m, const Vec3 &v) {
+    return Vec3(m[0] * v.x + m[1] * v.y + m[2] * v.z, m[4] * v.x + m[5] * v.y + m[6] * v.z,
+                m[8] * v.x + m[9] * v.y + m[10] * v.z);
+}
+
+// Inverse of the upper 3x3 of a 4x4, column-major into a 4x4 layout
+Mat4 inverse3(const Mat4 &a) {
+    const float *m = a.m;
+    const float c00 = m[5] * m[10] - m[9] * m[6], c01 = m[9] * m[2] - m[1] * m[10], c02 = m[1] * m[6] - m[5] * m[2];
+    const float det = m[0] * c00 + m[4] * c01 + m[8] * c02;
+    const float s = std::fabs(det) > 1e-30f ? 1.0f / det : 0.0f;
+    Mat4 r = identity();
+    r.m[0] = c00 * s;
+    r.m[1] = c01 * s;
+    r.m[2] = c02 * s;
+    r.m[4] = (m[8] * m[6] - m[4] * m[10]) * s;
+    r.m[5] = (m[0] * m[10] - m[8] * m[2]) * s;
+    r.m[6] = (m[4] * m[2] - m[0] * m[6]) * s;
+    r.m[8] = (m[4] * m[9] - m[8] * m[5]) * s;
+    r.m[9] = (m[8] * m[1] - m[0] * m[9]) * s;
+    r.m[10] = (m[0] * m[5] - m[4] * m[1]) * s;
+    return r;
+}
+
+// normalize() treats short vectors as zero, which edge cross products of
+// small triangles are
+Vec3 unit(const Vec3 &v) {
+    const float len = length(v);
+    return len > 0.0f ? v / len : Vec3(0.0f, 0.0f, 1.0f);
+}
+
+uint8_t to_byte(float v) { return static_cast<uint8_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); }
+
+double ms_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+// One view: the camera and light in model space (rays are traced against the
+// untransformed mesh) and the running sums
+struct ProgressiveTracer::Job {
+    TraceView view;
+    uint64_t generation = 0;
+    Mat4 to_model;        // eye-space directions to model space
+    Vec3 eye, light, half; // model space; light and half vector normalized
+    int tiles_x = 0, tiles_y = 0;
+    std::vector<uint32_t> tiles; // centre first
+    std::vector<float> sum;      // rgb per pixel
+    std::chrono::steady_clock::time_point t0;
+    std::atomic<uint32_t> samples{0};
+    std::atomic<uint64_t> rays{0};
+    std::atomic<bool> converged{false};
+    std::atomic<double> converged_ms{0.0};
+};
+
+ProgressiveTracer::ProgressiveTracer(const float *vertices, const unsigned int *indices, size_t index_count,
+                                     const std::vector<tinyobj::MeshRange> &ranges,
+                                     std::vector<tinyobj::Material> materials, float radius, const TraceOptions &opt)
+    : vertices_(vertices), indices_(indices), index_count_(index_count), materials_(std::move(materials)),
+      radius_(radius > 0.0f ? radius : 1.0f), opt_(opt) {
+    if (materials_.empty()) materials_.emplace_back();
+    const uint32_t fallback = static_cast<uint32_t>(materials_.size() - 1);
+    triangle_material_.assign(index_count / 3, fallback);
+    for (const tinyobj::MeshRange &range : ranges) {
+        if (range.material == tinyobj::kNoMaterial || range.material >= fallback) continue;
+        const size_t first = range.first_index / 3, end = std::min(triangle_material_.size(), first + range.index_count / 3);
+        for (size_t t = first; t < end; ++t) triangle_material_[t] = range.material;
+    }
+    opt_.max_samples = std::max(opt_.max_samples, 1u);
+    opt_.fade_samples = std::max(opt_.fade_samples, 1u);
+    thread_ = std::thread([this] { loop(); });
+}
+
+ProgressiveTracer::~ProgressiveTracer() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+        ++generation_;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void ProgressiveTracer::start(const TraceView &view) {
+    auto job = std::make_shared<Job>();
+    job->view = view;
+    job->t0 = std::chrono::steady_clock::now();
+    // Eye-space directions go to model space through the inverse model-view;
+    // the viewer lights in world space, so the light and the half vector go
+    // back through the model matrix (uniform scale: the transpose will do)
+    job->to_model = inverse3(view.modelview);
+    const float *mv = view.modelview.m;
+    job->eye = mat3_mul(job->to_model.m, Vec3(-mv[12], -mv[13], -mv[14]));
+    const Vec3 light = normalize(Vec3(0.3f, 1.0f, 0.2f));
+    job->light = normalize(mat3_mul_transposed(view.model.m, light));
+    job->half = normalize(mat3_mul_transposed(view.model.m, normalize(light + Vec3(0.0f, 0.0f, 1.0f))));
+    job->tiles_x = (std::max(view.width, 0) + kTileSize - 1) / kTileSize;
+    job->tiles_y = (std::max(view.height, 0) + kTileSize - 1) / kTileSize;
+    job->tiles.resize(static_cast<size_t>(job->tiles_x) * job->tiles_y);
+    for (uint32_t i = 0; i < job->tiles.size(); ++i) job->tiles[i] = i;
+    const auto centre_distance = [&](uint32_t i) {
+        const float dx = (static_cast<float>(i % job->tiles_x) + 0.5f) * kTileSize - 0.5f * view.width;
+        const float dy = (static_cast<float>(i / job->tiles_x) + 0.5f) * kTileSize - 0.5f * view.height;
+        return dx * dx + dy * dy;
+    };
+    std::sort(job->tiles.begin(), job->tiles.end(),
+              [&](uint32_t a, uint32_t b) { return centre_distance(a) < centre_distance(b); });
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        job->generation = ++generation_;
+        pending_ = std::move(job);
+        current_.reset();
+    }
+    {
+        std::lock_guard<std::mutex> lk(ready_mutex_);
+        ready_.clear();
+    }
+    cv_.notify_one();
+}
+
+void ProgressiveTracer::cancel() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    ++generation_;
+    pending_.reset();
+    current_.reset();
+}
+
+bool ProgressiveTracer::take(std::vector<TraceTile> &tiles) {
+    if (!fresh_.load(std::memory_order_acquire)) return false;
+    std::unique_lock<std::mutex> lk(ready_mutex_, std::try_to_lock);
+    if (!lk.owns_lock()) return false;
+    for (TraceTile &tile : ready_) tiles.push_back(std::move(tile));
+    ready_.clear();
+    fresh_.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+TraceProgress ProgressiveTracer::progress() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    TraceProgress p = bvh_progress_;
+    if (current_) {
+        p.samples = current_->samples.load();
+        p.rays = current_->rays.load();
+        p.converged = current_->converged.load();
+        p.ms = p.converged ? current_->converged_ms.load() : ms_since(current_->t0);
+    }
+    return p;
+}
+
+void ProgressiveTracer::loop() {
+    TRACE_THREAD_NAME("tracer");
+    {
+        TriangleBvh bvh(PositionView{vertices_, kVertexStride}, indices_, index_count_);
+        std::lock_guard<std::mutex> lk(mutex_);
+        bvh_ = std::move(bvh);
+        bvh_progress_.bvh_ready = true;
+        bvh_progress_.bvh_nodes = bvh_.node_count();
+        bvh_progress_.bvh_ms = bvh_.build_ms();
+    }
+    jobs::JobSystem &js = jobs::JobSystem::instance();
+    std::vector<jobs::TaskHandle> tasks;
+    for (;;) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lk(mutex_);
+            cv_.wait(lk, [&] { return stop_ || pending_; });
+            if (stop_) return;
+            job = std::move(pending_);
+            current_ = job;
+        }
+        TRACE_SCOPE("trace_view");
+        job->sum.assign(static_cast<size_t>(job->view.width) * job->view.height * 3, 0.0f);
+        for (uint32_t sample = 0; sample < opt_.max_samples; ++sample) {
+            tasks.clear();
+            for (uint32_t tile : job->tiles) {
+                tasks.push_back(js.run([this, job, tile, sample] { trace_tile(*job, tile, sample); }));
+            }
+            for (const jobs::TaskHandle &task : tasks) js.wait(task);
+            if (generation_.load() != job->generation) break;
+            job->samples.store(sample + 1);
+        }
+        if (job->samples.load() == opt_.max_samples) {
+            job->converged_ms.store(ms_since(job->t0));
+            job->converged.store(true);
+        }
+    }
+}
+
+void ProgressiveTracer::trace_tile(Job &job, size_t tile, uint32_t sample) {
+    if (generation_.load(std::memory_order_relaxed) != job.generation) return;
+    const TraceView &view = job.view;
+    const int x0 = static_cast<int>(tile % job.tiles_x) * kTileSize, y0 = static_cast<int>(tile / job.tiles_x) * kTileSize;
+    const int w = std::min(kTileSize, view.width - x0), h = std::min(kTileSize, view.height - y0);
+    const float *p = view.proj.m;
+    const float eps = kOffset * radius_, ao_distance = opt_.ao_distance * radius_;
+    uint64_t rays = 0;
+
+    for (int y = y0; y < y0 + h; ++y) {
+        if (generation_.load(std::memory_order_relaxed) != job.generation) return;
+        for (int x = x0; x < x0 + w; ++x) {
+            const size_t pixel = static_cast<size_t>(y) * view.width + x;
+            uint32_t rng = hash(static_cast<uint32_t>(pixel) * 0x9e3779b1u ^ hash(sample));
+            // Primary ray through a jittered point of the pixel
+            const float ndc_x = (static_cast<float>(x) + next_float(rng)) / view.width * 2.0f - 1.0f;
+            const float ndc_y = (static_cast<float>(y) + next_float(rng)) / view.height * 2.0f - 1.0f;
+            const Vec3 dir_eye((ndc_x + p[8]) / p[0], (ndc_y + p[9]) / p[5], -1.0f);
+            const Ray primary{job.eye, normalize(mat3_mul(job.to_model.m, dir_eye))};
+            RayHit hit;
+            ++rays;
+            float rgb[3] = {kBackground[0], kBackground[1], kBackground[2]};
+            if (bvh_.intersect(primary, 0.0f, 1e30f, hit)) {
+                const unsigned int *idx = &indices_[static_cast<size_t>(hit.triangle) * 3];
+                const float *v[3] = {&vertices_[idx[0] * kVertexStride], &vertices_[idx[1] * kVertexStride],
+                                     &vertices_[idx[2] * kVertexStride]};
+                const Vec3 p0(v[0][0], v[0][1], v[0][2]);
+                Vec3 ng = unit(cross(Vec3(v[1][0], v[1][1], v[1][2]) - p0, Vec3(v[2][0], v[2][1], v[2][2]) - p0));
+                if (dot(ng, primary.d) > 0.0f) ng = ng * -1.0f; // towards the eye
+                const float b0 = 1.0f - hit.u - hit.v;
+                Vec3 n = normalize(Vec3(b0 * v[0][3] + hit.u * v[1][3] + hit.v * v[2][3],
+                                        b0 * v[0][4] + hit.u * v[1][4] + hit.v * v[2][4],
+                                        b0 * v[0][5] + hit.u * v[1][5] + hit.v * v[2][5]));
+                if (dot(n, n) == 0.0f) n = ng;
+                const Vec3 origin = primary.o + primary.d * hit.t + ng * eps;
+
+                // The viewer's shading, with the light shadowed and the
+                // ambient floor occluded
+                const tinyobj::Material &m = materials_[triangle_material_[hit.triangle]];
+                const float ndl = std::max(dot(n, job.light), 0.0f);
+                float lit = 0.0f;
+                if (ndl > 0.0f) {
+                    ++rays;
+                    lit = bvh_.occluded(Ray{origin, job.light}, 0.0f, 1e30f) ? 0.0f : 1.0f;
+                }
+                // One cosine-weighted occlusion ray per sample
+                Vec3 t, b;
+                orthonormal_basis(ng, t, b);
+                const float r1 = next_float(rng), r2 = next_float(rng);
+                const Vec3 ao_dir = cosine_direction(ng, t, b, r1, r2);
+                ++rays;
+                const float ao = bvh_.occluded(Ray{origin, ao_dir}, 0.0f, ao_distance) ? 0.0f : 1.0f;
+                const float spec =
+                    ndl > 0.0f ? std::pow(std::max(dot(n, job.half), 0.0f), std::max(m.shininess, 1.0f)) : 0.0f;
+                for (int k = 0; k < 3; ++k) {
+                    rgb[k] = m.diffuse[k] * (0.4f * ao + 0.6f * ndl * lit) + m.ambient[k] * ao + m.specular[k] * spec * lit;
+                }
+            }
+            float *sum = &job.sum[pixel * 3];
+            for (int k = 0; k < 3; ++k) sum[k] += std::clamp(rgb[k], 0.0f, 1.0f);
+        }
+    }
+    job.rays.fetch_add(rays, std::memory_order_relaxed);
+
+    TraceTile out;
+    out.x = x0;
+    out.y = y0;
+    out.width = w;
+    out.height = h;
+    out.samples = sample + 1;
+    out.rgba.resize(static_cast<size_t>(w) * h * 4);
+    const float scale = 1.0f / static_cast<float>(sample + 1);
+    const uint8_t alpha = to_byte(static_cast<float>(sample + 1) / static_cast<float>(opt_.fade_samples));
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            const float *sum = &job.sum[(static_cast<size_t>(y0 + y) * view.width + x0 + x) * 3];
+            uint8_t *o = &out.rgba[(static_cast<size_t>(y) * w + x) * 4];
+            for (int k = 0; k < 3; ++k) o[k] = to_byte(sum[k] * scale);
+            o[3] = alpha;
+        }
+    }
+    std::lock_guard<std::mutex> lk(ready_mutex_);
+    if (generation_.load() != job.generation) return;
+    ready_.push_back(std::move(out));
+    fresh_.store(true, std::memory_order_release);
+}
+
+} // namespace gx
@@ -0,0 +1,300 @@
+#include "thumbnail.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+#ifdef GX_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "math3d.h"
+#include "trace.h"
+
+namespace gx {
+
+namespace {
+
+constexpr float kFovY = 45.0f * kPi / 180.0f; // as obj_viewer
+constexpr float kBackground[3] = {0.07f, 0.08f, 0.10f};
+
+// The obj_viewer fragment shader: light fixed in view space, half-lit floor
+// of 0.4, Blinn-Phong highlight for a viewer along +z.
+void shade(const float *n, const tinyobj::Material &m, float *rgb) {
+    const Vec3 N = normalize(Vec3(n[0], n[1], n[2]));
+    const Vec3 L = normalize(Vec3(0.3f, 1.0f, 0.2f));
+    const float ndl = std::max(dot(N, L), 0.0f);
+    const float brightness = 0.4f + 0.6f * ndl;
+    const Vec3 H = normalize(L + Vec3(0.0f, 0.0f, 1.0f));
+    const float spec = ndl > 0.0f ? std::pow(std::max(dot(N, H), 0.0f), std::max(m.shininess, 1.0f)) : 0.0f;
+    for (int k = 0; k < 3; ++k) rgb[k] = m.diffuse[k] * brightness + m.ambient[k] + m.specular[k] * spec;
+}
+
+inline uint8_t to_byte(float v) { return static_cast<uint8_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); }
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+void put_u32(std::string &out, uint32_t v) {
+    const char b[4] = {static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8),
+                       static_cast<char>(v)};
+    out.append(b, 4);
+}
+
+void put_chunk(std::string &out, const char *type, const std::string &data) {
+    put_u32(out, static_cast<uint32_t>(data.size()));
+    const size_t start = out.size();
+    out.append(type, 4);
+    out += data;
+    put_u32(out, crc32(reinterpret_cast<const uint8_t *>(out.data() + start), out.size() - start));
+}
+
+// zlib stream of raw
+std::string deflate(const std::string &raw) {
+#ifdef GX_HAVE_ZLIB
+    uLongf size = compressBound(static_cast<uLong>(raw.size()));
+    std::string packed(size, '\0');
+    if (compress2(reinterpret_cast<Bytef *>(packed.data()), &size, reinterpret_cast<const Bytef *>(raw.data()),
+                  static_cast<uLong>(raw.size()), 6) == Z_OK) {
+        packed.resize(size);
+        return packed;
+    }
+#endif
+    // Stored blocks of at most 65535 bytes
+    std::string out = "\x78\x01";
+    size_t pos = 0;
+    do {
+        const size_t len = std::min<size_t>(raw.size() - pos, 65535);
+        const bool last = pos + len == raw.size();
+        const char header[5] = {static_cast<char>(last ? 1 : 0), static_cast<char>(len & 0xff),
+                                static_cast<char>(len >> 8), static_cast<char>(~len & 0xff),
+                                static_cast<char>((~len >> 8) & 0xff)};
+        out.append(header, 5);
+        out.append(raw, pos, len);
+        pos += len;
+    } while (pos < raw.size());
+    uint32_t a = 1, b = 0;
+    for (unsigned char c : raw) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_u32(out, (b << 16) | a);
+    return out;
+}
+
+} // namespace
+
+ThumbnailRenderer::ThumbnailRenderer(const ThumbnailOptions &opt) : opt_(opt) {
+    opt_.size = std::max(opt_.size, 1);
+    opt_.supersample = std::clamp(opt_.supersample, 1, 8);
+    width_ = opt_.size * opt_.supersample;
+    const size_t samples = static_cast<size_t>(width_) * width_;
+    depth_.resize(samples);
+    sample_normal_.resize(samples * 3);
+    sample_material_.resize(samples);
+}
+
+void ThumbnailRenderer::render(const tinyobj::MeshData &mesh, Image &out) {
+    TRACE_SCOPE("render_thumbnail");
+    std::fill(depth_.begin(), depth_.end(), std::numeric_limits<float>::infinity());
+
+    // Bounding sphere centered on the box, like MeshBounds::sphere (serially:
+    // batches run one thumbnail per thread)
+    const size_t vertex_count = mesh.positions.size() / 3;
+    Vec3 lo(1e30f, 1e30f, 1e30f), hi(-1e30f, -1e30f, -1e30f);
+    for (size_t v = 0; v < vertex_count; ++v) {
+        const float *p = &mesh.positions[v * 3];
+        lo = Vec3(std::min(lo.x, p[0]), std::min(lo.y, p[1]), std::min(lo.z, p[2]));
+        hi = Vec3(std::max(hi.x, p[0]), std::max(hi.y, p[1]), std::max(hi.z, p[2]));
+    }
+    const Vec3 center = (lo + hi) * 0.5f;
+    float r2 = 0.0f;
+    for (size_t v = 0; v < vertex_count; ++v) {
+        const Vec3 d = Vec3(mesh.positions[v * 3], mesh.positions[v * 3 + 1], mesh.positions[v * 3 + 2]) - center;
+        r2 = std::max(r2, dot(d, d));
+    }
+    const float radius = std::sqrt(r2);
+
+    if (radius > 0.0f && !mesh.indices.empty()) {
+        // obj_viewer's frame_bounds and compute_matrices
+        const float distance = 1.1f * radius / std::sin(0.5f * kFovY);
+        const float r = radius * 1.1f;
+        const float zfar = distance + r;
+        const float znear = std::max(distance - r, zfar * 1e-4f);
+        const Mat4 model = multiply(rotate_x(opt_.pitch), multiply(rotate_y(opt_.yaw), translate(center * -1.0f)));
+        const Mat4 mvp = multiply(multiply(perspective(kFovY, 1.0f, znear, zfar), translate(0.0f, 0.0f, -distance)), model);
+
+        // Vertices to pixels (top row first) and normals to world space
+        const float *m = mvp.m, *w = model.m;
+        const float half = 0.5f * static_cast<float>(width_);
+        const bool smooth = mesh.normals.size() == mesh.positions.size();
+        clip_.resize(vertex_count * 4);
+        normals_.resize(smooth ? vertex_count * 3 : 0);
+        for (size_t v = 0; v < vertex_count; ++v) {
+            const float *p = &mesh.positions[v * 3];
+            const float cx = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+            const float cy = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+            const float cz = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+            const float cw = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+            const float inv_w = cw > 1e-6f ? 1.0f / cw : 0.0f;
+            float *c = &clip_[v * 4];
+            c[0] = (cx * inv_w + 1.0f) * half;
+            c[1] = (1.0f - cy * inv_w) * half;
+            c[2] = cz * inv_w;
+            c[3] = inv_w;
+            if (smooth) {
+                const float *n = &mesh.normals[v * 3];
+                float *o = &normals_[v * 3];
+                for (int k = 0; k < 3; ++k) o[k] = w[k] * n[0] + w[4 + k] * n[1] + w[8 + k] * n[2];
+            }
+        }
+
+        // Ranges carry the material; without usemtl the viewer's green default
+        const uint32_t fallback = static_cast<uint32_t>(mesh.materials.size());
+        const auto raster_range = [&](size_t first, size_t count, uint32_t material) {
+            for (size_t t = first; t + 3 <= first + count; t += 3) {
+                const unsigned *idx = &mesh.indices[t];
+                const float *v[3] = {&clip_[idx[0] * 4], &clip_[idx[1] * 4], &clip_[idx[2] * 4]};
+                float face[3];
+                const float *n[3];
+                if (smooth) {
+                    for (int k = 0; k < 3; ++k) n[k] = &normals_[idx[k] * 3];
+                } else {
+                    const float *p0 = &mesh.positions[idx[0] * 3], *p1 = &mesh.positions[idx[1] * 3],
+                                *p2 = &mesh.positions[idx[2] * 3];
+                    const Vec3 fn = cross(Vec3(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]),
+                                          Vec3(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]));
+                    for (int k = 0; k < 3; ++k) face[k] = w[k] * fn.x + w[4 + k] * fn.y + w[8 + k] * fn.z;
+                    n[0] = n[1] = n[2] = face;
+                }
+                raster_triangle(v, n, material);
+            }
+        };
+        if (mesh.ranges.empty()) {
+            raster_range(0, mesh.indices.size(), fallback);
+        }
+        for (const tinyobj::MeshRange &range : mesh.ranges) {
+            raster_range(range.first_index, range.index_count,
+                         range.material == tinyobj::kNoMaterial ? fallback : range.material);
+        }
+    }
+
+    // Shade every covered sample once, then average down
+    std::vector<tinyobj::Material> materials = mesh.materials;
+    tinyobj::Material &green = materials.emplace_back();
+    green.diffuse[0] = green.diffuse[2] = 0.0f;
+    green.diffuse[1] = 1.0f;
+    const int size = opt_.size, ss = opt_.supersample;
+    const float inv_samples = 1.0f / static_cast<float>(ss * ss);
+    out.width = out.height = size;
+    out.rgb.resize(static_cast<size_t>(size) * size * 3);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            float sum[3] = {0.0f, 0.0f, 0.0f};
+            for (int sy = 0; sy < ss; ++sy) {
+                for (int sx = 0; sx < ss; ++sx) {
+                    const size_t s = static_cast<size_t>(y * ss + sy) * width_ + (x * ss + sx);
+                    float rgb[3] = {kBackground[0], kBackground[1], kBackground[2]};
+                    if (depth_[s] != std::numeric_limits<float>::infinity()) {
+                        shade(&sample_normal_[s * 3], materials[std::min<size_t>(sample_material_[s], materials.size() - 1)], rgb);
+                    }
+                    for (int k = 0; k < 3; ++k) sum[k] += std::clamp(rgb[k], 0.0f, 1.0f);
+                }
+            }
+            uint8_t *o = &out.rgb[(static_cast<size_t>(y) * size + x) * 3];
+            for (int k = 0; k < 3; ++k) o[k] = to_byte(sum[k] * inv_samples);
+        }
+    }
+}
+
+void ThumbnailRenderer::raster_triangle(const float *const v[3], const float *const n[3], uint32_t material) {
+    if (v[0][3] == 0.0f || v[1][3] == 0.0f || v[2][3] == 0.0f) return; // behind the eye
+    const float x0 = v[0][0], y0 = v[0][1], x1 = v[1][0], y1 = v[1][1], x2 = v[2][0], y2 = v[2][1];
+    const float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    if (!(std::fabs(area) > 1e-12f)) return; // degenerate (or NaN)
+    const float inv_area = 1.0f / area;
+
+    // Samples whose centers lie inside the bounds
+    const float limit = static_cast<float>(width_ - 1);
+    const int ix0 = static_cast<int>(std::max(std::ceil(std::min({x0, x1, x2}) - 0.5f), 0.0f));
+    const int iy0 = static_cast<int>(std::max(std::ceil(std::min({y0, y1, y2}) - 0.5f), 0.0f));
+    const int ix1 = static_cast<int>(std::min(std::floor(std::max({x0, x1, x2}) - 0.5f), limit));
+    const int iy1 = static_cast<int>(std::min(std::floor(std::max({y0, y1, y2}) - 0.5f), limit));
+    if (ix0 > ix1 || iy0 > iy1) return;
+
+    for (int y = iy0; y <= iy1; ++y) {
+        const float py = static_cast<float>(y) + 0.5f;
+        float *depth = &depth_[static_cast<size_t>(y) * width_];
+        for (int x = ix0; x <= ix1; ++x) {
+            const float px = static_cast<float>(x) + 0.5f;
+            const float b0 = ((x2 - x1) * (py - y1) - (px - x1) * (y2 - y1)) * inv_area;
+            const float b1 = ((x0 - x2) * (py - y2) - (px - x2) * (y0 - y2)) * inv_area;
+            const float b2 = 1.0f - b0 - b1;
+            if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f) continue;
+            // NDC depth is affine in screen space
+            const float z = b0 * v[0][2] + b1 * v[1][2] + b2 * v[2][2];
+            if (z < -1.0f || z > 1.0f || z >= depth[x]) continue;
+            depth[x] = z;
+            // Normals perspective-correct: weights over w
+            const float p0 = b0 * v[0][3], p1 = b1 * v[1][3], p2 = b2 * v[2][3];
+            const float inv = 1.0f / (p0 + p1 + p2);
+            const size_t s = static_cast<size_t>(y) * width_ + x;
+            for (int k = 0; k < 3; ++k) sample_normal_[s * 3 + k] = (p0 * n[0][k] + p1 * n[1][k] + p2 * n[2][k]) * inv;
+            sample_material_[s] = material;
+        }
+    }
+}
+
+void encode_png(const Image &image, std::string &out) {
+    TRACE_SCOPE("encode_png");
+    const size_t row = static_cast<size_t>(image.width) * 3;
+    // Every scanline with the Sub filter (difference to the pixel on the left)
+    std::string raw;
+    raw.resize((row + 1) * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        const uint8_t *src = &image.rgb[y * row];
+        char *dst = &raw[y * (row + 1)];
+        dst[0] = 1;
+        for (size_t i = 0; i < row; ++i) dst[1 + i] = static_cast<char>(src[i] - (i >= 3 ? src[i - 3] : 0));
+    }
+
+    out.assign("\x89PNG\r\n\x1a\n", 8);
+    std::string ihdr;
+    put_u32(ihdr, static_cast<uint32_t>(image.width));
+    put_u32(ihdr, static_cast<uint32_t>(image.height));
+    ihdr += std::string("\x08\x02\x00\x00\x00", 5); // 8-bit RGB, deflate, adaptive filters, no interlace
+    put_chunk(out, "IHDR", ihdr);
+    put_chunk(out, "IDAT", deflate(raw));
+    put_chunk(out, "IEND", std::string());
+}
+
+bool write_png(const std::string &path, const Image &image, std::string &err) {
+    std::string data;
+    encode_png(image, data);
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        err = "Cannot open file: " + path;
+        return false;
+    }
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        err = "Write failed: " + path;
+        return false;
+    }
+    return true;
+}
+
+} // namespace gx
@@ -0,0 +1,575 @@
+#pragma once
+// Minimal OBJ loader for small samples (positions, normals, texcoords, triangles,
+// o/g parts, usemtl/mtllib materials with their colors).
+// Not a full replacement for the official tinyobjloader; meant for simple previews.
+// Public domain / CC0-style.
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+
+#include "alloc_tracker.h"
+#include "job_system.h"
+#include "page_alloc.h"
+#include "perf_counters.h"
+#include "trace.h"
+
+namespace tinyobj {
+
+// Triangles of one "o"/"g" section; faces before the first one form an
+// unnamed part. Parts without faces are dropped.
+struct MeshPart {
+    std::string name;
+    size_t first_index = 0; // into indices
+    size_t index_count = 0;
+};
+
+// MTL parameters; names used without a definition keep the defaults.
+struct Material {
+    std::string name;
+    float ambient[3] = {0.0f, 0.0f, 0.0f};   // Ka
+    float diffuse[3] = {0.8f, 0.8f, 0.8f};   // Kd
+    float specular[3] = {0.0f, 0.0f, 0.0f};  // Ks
+    float shininess = 0.0f;                  // Ns
+    float opacity = 1.0f;                    // d (or 1 - Tr)
+};
+
+// Faces without usemtl
+constexpr unsigned int kNoMaterial = ~0u;
+// "usemtl default" with no library defining it switches back to kNoMaterial
+// (what the exporters write after a material range)
+constexpr const char *kDefaultMaterialName = "default";
+
+// Triangles of one part that share a material. Within each part the indices
+// are sorted by material at load time, so these are contiguous.
+struct MeshRange {
+    size_t first_index = 0;
+    size_t index_count = 0;
+    unsigned int part = 0;
+    unsigned int material = kNoMaterial;
+};
+
+struct MeshData {
+    // The large arrays allocate through the page policy (page_alloc.h)
+    pages::Vector<float> positions; // x,y,z per vertex
+    pages::Vector<float> normals;   // nx,ny,nz per vertex (may be empty)
+    pages::Vector<float> texcoords; // u,v per vertex (may be empty)
+    pages::Vector<unsigned int> indices; // triangle indices
+    std::vector<MeshPart> parts;       // cover indices in order
+    std::vector<Material> materials;
+    std::vector<MeshRange> ranges;     // cover indices in order
+};
+
+namespace detail {
+inline bool starts_with(const std::string &s, const char *prefix) {
+    const size_t len = std::char_traits<char>::length(prefix);
+    return s.size() >= len && s.compare(0, len, prefix) == 0;
+}
+
+inline void trim(std::string &s) {
+    const char *ws = " \t\r\n";
+    auto b = s.find_first_not_of(ws);
+    auto e = s.find_last_not_of(ws);
+    if (b == std::string::npos) {
+        s.clear();
+        return;
+    }
+    s = s.substr(b, e - b + 1);
+}
+
+inline int to_index(int idx, size_t count) {
+    if (idx > 0) return idx - 1;           // OBJ is 1-based
+    if (idx < 0) return static_cast<int>(count) + idx; // negative indices
+    return -1; // zero is invalid
+}
+
+// One worker's share of the file: attributes in file order plus the raw face
+// corners. Indices are resolved and validated later, once the number of
+// attributes defined by all earlier chunks is known.
+struct ObjChunk {
+    struct Corner {
+        int v, t, n;           // OBJ indices as written (0 = absent)
+    };
+    struct Face {
+        size_t first_corner;
+        unsigned int corner_count;
+        size_t v_count, t_count, n_count; // attributes defined before the face, chunk-local
+    };
+    struct Group {
+        size_t first_face; // chunk-local
+        std::string name;
+    };
+
+    std::vector<std::array<float, 3>> positions;
+    std::vector<std::array<float, 3>> normals;
+    std::vector<std::array<float, 2>> texcoords;
+    std::vector<Corner> corners;
+    std::vector<Face> faces;
+    std::vector<Group> groups;
+    std::vector<Group> usemtl;           // same layout: material from first_face on
+    std::vector<std::string> mtllibs;
+    std::string err;
+};
+
+inline const char *skip_blanks(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    return p;
+}
+
+// Reads up to n floats from [p, end); missing values stay 0 like a failed iss >> f.
+inline void parse_floats(const char *p, const char *end, float *out, int n) {
+    for (int i = 0; i < n; ++i) {
+        p = skip_blanks(p, end);
+        if (p < end && *p == '+') ++p;
+        float v = 0.0f;
+        auto res = std::from_chars(p, end, v);
+        if (res.ec != std::errc()) return;
+        out[i] = v;
+        p = res.ptr;
+    }
+}
+
+// "v", "v/t", "v//n", "v/t/n"; returns false on non-numeric fields.
+inline bool parse_corner(const char *p, const char *end, ObjChunk::Corner &c) {
+    int fields[3] = {0, 0, 0};
+    int field = 0;
+    while (p < end && field < 3) {
+        if (*p == '/') {
+            ++field;
+            ++p;
+            continue;
+        }
+        if (*p == '+') ++p;
+        auto res = std::from_chars(p, end, fields[field]);
+        if (res.ec != std::errc()) return false;
+        p = res.ptr;
+        if (p < end && *p != '/') return false;
+    }
+    c.v = fields[0];
+    c.t = fields[1];
+    c.n = fields[2];
+    return true;
+}
+
+inline void parse_chunk(const char *begin, const char *end, ObjChunk &chunk) {
+    const char *line = begin;
+    while (line < end) {
+        const char *eol = static_cast<const char *>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+        if (!eol) eol = end;
+        const char *b = line;
+        const char *e = eol;
+        line = eol + 1;
+
+        // trim " \t\r"
+        while (b < e && (*b == ' ' || *b == '\t' || *b == '\r')) ++b;
+        while (e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) --e;
+        if (b == e || *b == '#') continue;
+        const size_t len = static_cast<size_t>(e - b);
+
+        if (len >= 2 && b[0] == 'v' && b[1] == ' ') {
+            std::array<float, 3> v{};
+            parse_floats(b + 1, e, v.data(), 3);
+            chunk.positions.push_back(v);
+        } else if (len >= 3 && b[0] == 'v' && b[1] == 'n' && b[2] == ' ') {
+            std::array<float, 3> n{};
+            parse_floats(b + 2, e, n.data(), 3);
+            chunk.normals.push_back(n);
+        } else if (len >= 3 && b[0] == 'v' && b[1] == 't' && b[2] == ' ') {
+            std::array<float, 2> t{};
+            parse_floats(b + 2, e, t.data(), 2);
+            chunk.texcoords.push_back(t);
+        } else if (len >= 2 && b[0] == 'f' && b[1] == ' ') {
+            ObjChunk::Face face{chunk.corners.size(), 0, chunk.positions.size(), chunk.texcoords.size(),
+                                chunk.normals.size()};
+            const char *p = b + 1;
+            for (;;) {
+                p = skip_blanks(p, e);
+                if (p >= e) break;
+                const char *tok_end = p;
+                while (tok_end < e && *tok_end != ' ' && *tok_end != '\t') ++tok_end;
+                ObjChunk::Corner c{};
+                if (!parse_corner(p, tok_end, c)) {
+                    chunk.err = "Invalid face token: " + std::string(p, tok_end);
+                    return;
+                }
+                chunk.corners.push_back(c);
+                ++face.corner_count;
+                p = tok_end;
+            }
+            if (face.corner_count < 3) {
+                chunk.corners.resize(face.first_corner);
+                continue;
+            }
+            chunk.faces.push_back(face);
+        } else if ((b[0] == 'o' || b[0] == 'g') && (len == 1 || b[1] == ' ' || b[1] == '\t')) {
+            const char *name = skip_blanks(b + 1, e);
+            chunk.groups.push_back(ObjChunk::Group{chunk.faces.size(), std::string(name, e)});
+        } else if (len > 7 && std::strncmp(b, "usemtl", 6) == 0 && (b[6] == ' ' || b[6] == '\t')) {
+            chunk.usemtl.push_back(ObjChunk::Group{chunk.faces.size(), std::string(skip_blanks(b + 6, e), e)});
+        } else if (len > 7 && std::strncmp(b, "mtllib", 6) == 0 && (b[6] == ' ' || b[6] == '\t')) {
+            for (const char *p = skip_blanks(b + 6, e); p < e;) {
+                const char *q = p;
+                while (q < e && *q != ' ' && *q != '\t') ++q;
+                chunk.mtllibs.emplace_back(p, q);
+                p = skip_blanks(q, e);
+            }
+        }
+    }
+}
+
+// Splits the buffer into newline-aligned chunks and parses them in parallel.
+inline std::vector<ObjChunk> parse_chunks(const char *data, size_t size) {
+    auto &pool = jobs::JobSystem::instance();
+    const size_t min_chunk = size_t(1) << 20;
+    const size_t chunk_count = std::max<size_t>(1, std::min(size / min_chunk, pool.concurrency() * 4));
+
+    // Chunk boundaries fall right after a newline
+    std::vector<size_t> bounds(chunk_count + 1, size);
+    bounds[0] = 0;
+    for (size_t c = 1; c < chunk_count; ++c) {
+        size_t pos = std::max(bounds[c - 1], size * c / chunk_count);
+        const void *nl = pos < size ? std::memchr(data + pos, '\n', size - pos) : nullptr;
+        bounds[c] = nl ? static_cast<size_t>(static_cast<const char *>(nl) - data) + 1 : size;
+    }
+
+    TRACE_SCOPE("parse");
+    ALLOC_PHASE("parse");
+    std::vector<ObjChunk> chunks(chunk_count);
+    jobs::parallel_for(0, chunk_count, 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c) {
+            TRACE_SCOPE_ARG("parse_chunk", "chunk", static_cast<int64_t>(c));
+            PERF_SCOPE("obj_parse_chunk");
+            parse_chunk(data + bounds[c], data + bounds[c + 1], chunks[c]);
+        }
+    });
+    return chunks;
+}
+
+inline bool read_file(const std::string &filename, std::string &buffer, std::string &err) {
+    TRACE_SCOPE("read_file");
+    PERF_SCOPE("obj_read_file");
+    ALLOC_PHASE("read");
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) {
+        err = "Cannot open file: " + filename;
+        return false;
+    }
+    ifs.seekg(0, std::ios::end);
+    std::streamoff size = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+    buffer.clear();
+    if (size > 0) {
+        buffer.resize(static_cast<size_t>(size));
+        ifs.read(&buffer[0], size);
+        buffer.resize(static_cast<size_t>(ifs.gcount()));
+    }
+    return true;
+}
+
+// Appends the materials of an MTL file; unknown statements are skipped.
+inline bool parse_mtl(const std::string &text, std::vector<Material> &materials) {
+    std::istringstream in(text);
+    std::string line;
+    Material *m = nullptr;
+    while (std::getline(in, line)) {
+        trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        const char *b = line.data(), *e = b + line.size();
+        const char *key_end = b;
+        while (key_end < e && *key_end != ' ' && *key_end != '\t') ++key_end;
+        const std::string key(b, key_end);
+        if (key == "newmtl") {
+            materials.emplace_back();
+            m = &materials.back();
+            m->name = std::string(skip_blanks(key_end, e), e);
+        } else if (!m) {
+            continue;
+        } else if (key == "Ka") {
+            parse_floats(key_end, e, m->ambient, 3);
+        } else if (key == "Kd") {
+            parse_floats(key_end, e, m->diffuse, 3);
+        } else if (key == "Ks") {
+            parse_floats(key_end, e, m->specular, 3);
+        } else if (key == "Ns") {
+            parse_floats(key_end, e, &m->shininess, 1);
+        } else if (key == "d") {
+            parse_floats(key_end, e, &m->opacity, 1);
+        } else if (key == "Tr") {
+            float tr = 0.0f;
+            parse_floats(key_end, e, &tr, 1);
+            m->opacity = 1.0f - tr;
+        }
+    }
+    return true;
+}
+
+// Directory part of a path, with its trailing separator ("" for none).
+inline std::string base_dir(const std::string &path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// Stable sort of each part's triangles by material, then one range per run.
+inline void sort_by_material(MeshData &mesh, const std::vector<unsigned int> &tri_material) {
+    TRACE_SCOPE("sort_materials");
+    std::vector<unsigned int> order, sorted;
+    for (unsigned int p = 0; p < mesh.parts.size(); ++p) {
+        const MeshPart &part = mesh.parts[p];
+        const size_t t0 = part.first_index / 3, t1 = t0 + part.index_count / 3;
+        bool mixed = false;
+        for (size_t t = t0 + 1; t < t1 && !mixed; ++t) mixed = tri_material[t] != tri_material[t0];
+        if (mixed) {
+            order.resize(t1 - t0);
+            for (size_t t = t0; t < t1; ++t) order[t - t0] = static_cast<unsigned int>(t);
+            std::stable_sort(order.begin(), order.end(),
+                             [&](unsigned int a, unsigned int b) { return tri_material[a] < tri_material[b]; });
+            sorted.resize(part.index_count);
+            for (size_t i = 0; i < order.size(); ++i) {
+                std::copy_n(&mesh.indices[static_cast<size_t>(order[i]) * 3], 3, &sorted[i * 3]);
+            }
+            std::copy(sorted.begin(), sorted.end(), mesh.indices.begin() + part.first_index);
+        }
+        for (size_t i = 0; i < part.index_count / 3;) {
+            const unsigned int mat = tri_material[mixed ? order[i] : t0 + i];
+            size_t j = i + 1;
+            while (j < part.index_count / 3 && tri_material[mixed ? order[j] : t0 + j] == mat) ++j;
+            mesh.ranges.push_back(MeshRange{part.first_index + i * 3, (j - i) * 3, p, mat});
+            i = j;
+        }
+    }
+}
+
+// Resolves face indices against the attributes of all preceding chunks,
+// deduplicates v/t/n triples and fan-triangulates, in file order. Material
+// libraries are read relative to dir.
+inline bool assemble_mesh(const std::vector<ObjChunk> &chunks, MeshData &mesh, std::string &err,
+                          const std::string &dir = std::string()) {
+    TRACE_SCOPE("dedup");
+    PERF_SCOPE("obj_dedup");
+    ALLOC_PHASE("dedup");
+
+    std::vector<std::array<float, 3>> v_positions;
+    std::vector<std::array<float, 3>> v_normals;
+    std::vector<std::array<float, 2>> v_texcoords;
+    for (const auto &chunk : chunks) {
+        if (!chunk.err.empty()) {
+            err = chunk.err;
+            return false;
+        }
+        v_positions.insert(v_positions.end(), chunk.positions.begin(), chunk.positions.end());
+        v_normals.insert(v_normals.end(), chunk.normals.begin(), chunk.normals.end());
+        v_texcoords.insert(v_texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+    }
+
+    // Materials: the libraries first, then names that no library defines.
+    // A missing library is not an error; its materials keep the defaults.
+    std::unordered_map<std::string, unsigned int> material_ids;
+    for (const auto &chunk : chunks) {
+        for (const auto &lib : chunk.mtllibs) {
+            std::string text, lib_err;
+            if (!read_file(dir + lib, text, lib_err)) continue;
+            parse_mtl(text, mesh.materials);
+        }
+    }
+    for (unsigned int i = 0; i < mesh.materials.size(); ++i) material_ids.emplace(mesh.materials[i].name, i);
+    auto material_id = [&](const std::string &name) {
+        auto it = material_ids.find(name);
+        if (it != material_ids.end()) return it->second;
+        if (name == kDefaultMaterialName) return kNoMaterial;
+        mesh.materials.emplace_back();
+        mesh.materials.back().name = name;
+        const auto id = static_cast<unsigned int>(mesh.materials.size() - 1);
+        material_ids.emplace(name, id);
+        return id;
+    };
+    unsigned int material = kNoMaterial;
+    std::vector<unsigned int> tri_material;
+
+    std::unordered_map<std::string, unsigned int> vertex_map;
+
+    auto add_vertex = [&](int vi, int ti, int ni) -> unsigned int {
+        std::ostringstream key;
+        key << vi << "/" << ti << "/" << ni;
+        auto it = vertex_map.find(key.str());
+        if (it != vertex_map.end()) return it->second;
+
+        unsigned int new_index = static_cast<unsigned int>(mesh.positions.size() / 3);
+        const auto &p = v_positions.at(static_cast<size_t>(vi));
+        mesh.positions.insert(mesh.positions.end(), {p[0], p[1], p[2]});
+
+        if (ni >= 0 && ni < static_cast<int>(v_normals.size())) {
+            const auto &n = v_normals.at(static_cast<size_t>(ni));
+            mesh.normals.insert(mesh.normals.end(), {n[0], n[1], n[2]});
+        }
+
+        if (ti >= 0 && ti < static_cast<int>(v_texcoords.size())) {
+            const auto &t = v_texcoords.at(static_cast<size_t>(ti));
+            mesh.texcoords.insert(mesh.texcoords.end(), {t[0], t[1]});
+        }
+
+        vertex_map.emplace(key.str(), new_index);
+        return new_index;
+    };
+
+    // Only attributes defined before a face may be referenced by it
+    auto resolve = [](int idx, size_t count) -> int {
+        int r = to_index(idx, count);
+        return r < static_cast<int>(count) ? r : -1;
+    };
+
+    // A new part starts at the current index; one that got no faces is renamed
+    mesh.parts.push_back(MeshPart{});
+    auto begin_part = [&](const std::string &name) {
+        if (mesh.parts.back().index_count != 0) mesh.parts.push_back(MeshPart{{}, mesh.indices.size(), 0});
+        mesh.parts.back().name = name;
+    };
+
+    size_t v_base = 0, t_base = 0, n_base = 0;
+    std::vector<unsigned int> face_indices;
+    for (const auto &chunk : chunks) {
+        size_t next_group = 0, next_mtl = 0;
+        for (size_t f = 0; f < chunk.faces.size(); ++f) {
+            while (next_group < chunk.groups.size() && chunk.groups[next_group].first_face == f) {
+                begin_part(chunk.groups[next_group++].name);
+            }
+            while (next_mtl < chunk.usemtl.size() && chunk.usemtl[next_mtl].first_face == f) {
+                material = material_id(chunk.usemtl[next_mtl++].name);
+            }
+            const auto &face = chunk.faces[f];
+            const size_t v_count = v_base + face.v_count;
+            const size_t t_count = t_base + face.t_count;
+            const size_t n_count = n_base + face.n_count;
+            face_indices.clear();
+            for (unsigned int k = 0; k < face.corner_count; ++k) {
+                const auto &c = chunk.corners[face.first_corner + k];
+                int vi = c.v ? to_index(c.v, v_count) : -1;
+                if (vi < 0 || vi >= static_cast<int>(v_count)) {
+                    err = "Invalid vertex index in face";
+                    return false;
+                }
+                int ti = c.t ? resolve(c.t, t_count) : -1;
+                int ni = c.n ? resolve(c.n, n_count) : -1;
+                face_indices.push_back(add_vertex(vi, ti, ni));
+            }
+
+            // Triangulate (fan)
+            for (size_t i = 1; i + 1 < face_indices.size(); ++i) {
+                mesh.indices.push_back(face_indices[0]);
+                mesh.indices.push_back(face_indices[i]);
+                mesh.indices.push_back(face_indices[i + 1]);
+                tri_material.push_back(material);
+            }
+            mesh.parts.back().index_count = mesh.indices.size() - mesh.parts.back().first_index;
+        }
+        while (next_group < chunk.groups.size()) begin_part(chunk.groups[next_group++].name);
+        while (next_mtl < chunk.usemtl.size()) material = material_id(chunk.usemtl[next_mtl++].name);
+        v_base += chunk.positions.size();
+        t_base += chunk.texcoords.size();
+        n_base += chunk.normals.size();
+    }
+    if (mesh.parts.back().index_count == 0) mesh.parts.pop_back();
+    sort_by_material(mesh, tri_material);
+
+    return true;
+}
+
+// Parses an OBJ while it is still being read: feed() the file in order, and
+// every newline-aligned stretch of at least chunk_size bytes is handed to the
+// job system right away, so parsing overlaps the remaining reads. finish()
+// parses the tail and assembles the mesh like LoadObjFromBuffer.
+class StreamingParser {
+public:
+    static constexpr size_t kChunkSize = size_t(2) << 20;
+
+    // size_hint: the file size, so the text never moves under running jobs
+    explicit StreamingParser(size_t size_hint = 0, size_t chunk_size = kChunkSize) : chunk_size_(chunk_size) {
+        text_.reserve(size_hint);
+    }
+    ~StreamingParser() { wait_all(); }
+    StreamingParser(const StreamingParser &) = delete;
+    StreamingParser &operator=(const StreamingParser &) = delete;
+
+    void feed(const char *data, size_t size) {
+        if (text_.size() + size > text_.capacity()) {
+            wait_all(); // the jobs point into text_
+            text_.reserve(std::max(text_.capacity() * 2, text_.size() + size));
+        }
+        text_.append(data, size);
+        while (text_.size() - dispatched_ >= chunk_size_) {
+            const void *nl = std::memchr(text_.data() + dispatched_ + chunk_size_ - 1, '\n',
+                                         text_.size() - dispatched_ - chunk_size_ + 1);
+            if (!nl) break;
+            dispatch(static_cast<size_t>(static_cast<const char *>(nl) - text_.data()) + 1);
+        }
+    }
+
+    bool finish(MeshData &mesh, std::string &err, const std::string &dir = std::string()) {
+        ALLOC_PHASE("parse");
+        if (dispatched_ < text_.size() || chunks_.empty()) dispatch(text_.size());
+        {
+            TRACE_SCOPE("parse");
+            wait_all();
+        }
+        std::vector<ObjChunk> chunks;
+        chunks.reserve(chunks_.size());
+        for (auto &c : chunks_) chunks.push_back(std::move(*c));
+        chunks_.clear();
+        text_ = std::string();
+        return assemble_mesh(chunks, mesh, err, dir);
+    }
+
+    size_t bytes() const { return text_.size(); }
+
+private:
+    // Jobs inherit the phase they are created under (job_system.h)
+    void dispatch(size_t end) {
+        ALLOC_PHASE("parse");
+        chunks_.push_back(std::make_unique<ObjChunk>());
+        ObjChunk *chunk = chunks_.back().get();
+        const char *b = text_.data() + dispatched_, *e = text_.data() + end;
+        const auto index = static_cast<int64_t>(chunks_.size() - 1);
+        jobs_.push_back(jobs::JobSystem::instance().run([chunk, b, e, index] {
+            TRACE_SCOPE_ARG("parse_chunk", "chunk", index);
+            PERF_SCOPE("obj_parse_chunk");
+            parse_chunk(b, e, *chunk);
+        }));
+        dispatched_ = end;
+    }
+    void wait_all() {
+        for (const auto &job : jobs_) jobs::JobSystem::instance().wait(job);
+        jobs_.clear();
+    }
+
+    size_t chunk_size_;
+    std::string text_;
+    size_t dispatched_ = 0;
+    std::vector<std::unique_ptr<ObjChunk>> chunks_;
+    std::vector<jobs::TaskHandle> jobs_;
+};
+
+} // namespace detail
+
+// Parses an OBJ held in memory. Lines are parsed in parallel chunks on the job
+// system; vertex deduplication and triangulation then run in file order, so the
+// result is identical to a sequential parse. mtllib paths are relative to
+// base_dir (with its trailing separator; default: the working directory).
+inline bool LoadObjFromBuffer(MeshData &mesh, const char *data, size_t size, std::string &err,
+                              const std::string &base_dir = std::string()) {
+    return detail::assemble_mesh(detail::parse_chunks(data, size), mesh, err, base_dir);
+}
+
+inline bool LoadObj(MeshData &mesh, const std::string &filename, std::string &err) {
+    std::string buffer;
+    if (!detail::read_file(filename, buffer, err)) return false;
+    return LoadObjFromBuffer(mesh, buffer.data(), buffer.size(), err, detail::base_dir(filename));
+}
+
+} // namespace tinyobj
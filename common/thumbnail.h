@@ -0,0 +1,59 @@
+#pragma once
+// Headless mesh thumbnails: a CPU rasterizer with the OBJ viewer's shading
+// (Blinn-Phong over the MTL material table, the fixed light, the green default
+// material and the background colour of obj_viewer), framed the way the
+// viewer frames a model on load.
+//
+// One thumbnail renders on the calling thread; a batch gets its parallelism
+// from rendering many files at once (thumbnail_tool). Triangles are rasterized
+// into a supersampled depth/normal/material buffer, every covered sample is
+// shaded once and the samples are averaged down to the output size.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+
+namespace gx {
+
+struct ThumbnailOptions {
+    int size = 256;        // output edge, pixels
+    int supersample = 2;   // samples per pixel along each axis
+    float yaw = 0.6f;      // radians about y, then
+    float pitch = 0.45f;   // about x: a three-quarter view from above
+};
+
+// 8-bit RGB, rows top to bottom.
+struct Image {
+    int width = 0, height = 0;
+    std::vector<uint8_t> rgb;
+};
+
+class ThumbnailRenderer {
+public:
+    explicit ThumbnailRenderer(const ThumbnailOptions &opt = {});
+
+    // mesh without normals is shaded flat per triangle (compute_normals_if_missing
+    // gives the viewer's smooth normals). The buffers are reused between calls.
+    void render(const tinyobj::MeshData &mesh, Image &out);
+
+    const ThumbnailOptions &options() const { return opt_; }
+
+private:
+    void raster_triangle(const float *const v[3], const float *const n[3], uint32_t material);
+
+    ThumbnailOptions opt_;
+    int width_ = 0; // supersampled edge
+    std::vector<float> clip_;       // x, y, z (NDC depth), 1/w per vertex, in pixels
+    std::vector<float> normals_;    // world space per vertex
+    std::vector<float> depth_;      // per sample
+    std::vector<float> sample_normal_;
+    std::vector<uint32_t> sample_material_;
+};
+
+// PNG (deflate through zlib when gx_core was built with it, else stored blocks).
+void encode_png(const Image &image, std::string &out);
+bool write_png(const std::string &path, const Image &image, std::string &err);
+
+} // namespace gx
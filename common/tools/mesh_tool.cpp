@@ -0,0 +1,91 @@
+// Converts meshes between the formats gx_core reads and writes:
+//
+//   mesh_tool input.(obj|gxm) output.(obj|ply|gxm) [--normals] [--no-normals] [--no-texcoords]
+//             [--huge-pages] [--prefault]
+//
+// .gxm is the compressed format of mesh_codec.h.
+// --normals generates smooth normals when the input has none (as obj_viewer
+// does). --huge-pages and --prefault set the page policy of the mesh arrays
+// (page_alloc.h). Prints the time of each stage and the write throughput.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "file_reader.h"
+#include "job_system.h"
+#include "mesh_codec.h"
+#include "mesh_export.h"
+#include "mesh_utils.h"
+#include "page_alloc.h"
+#include "tiny_obj_loader.h"
+#include "trace.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+int main(int argc, char **argv) {
+    std::string input, output;
+    bool generate_normals = false;
+    gx::ExportOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--normals") {
+            generate_normals = true;
+        } else if (arg == "--no-normals") {
+            opt.normals = false;
+        } else if (arg == "--no-texcoords") {
+            opt.texcoords = false;
+        } else if (pages::parse_flag(arg)) {
+            // --huge-pages / --prefault
+        } else if (input.empty()) {
+            input = arg;
+        } else if (output.empty()) {
+            output = arg;
+        } else {
+            std::fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+    if (output.empty()) {
+        std::fprintf(stderr, "usage: mesh_tool input.(obj|gxm) output.(obj|ply|gxm) [--normals] [--no-normals] "
+                             "[--no-texcoords] [--huge-pages] [--prefault]\n");
+        return 1;
+    }
+    tracing::init_from_env();
+    pages::init_from_env();
+
+    auto t0 = Clock::now();
+    tinyobj::MeshData mesh;
+    std::string buffer, err;
+    bool ok = gx::read_file_streamed(input, buffer, err);
+    if (ok && gx::is_compressed_mesh(buffer.data(), buffer.size())) {
+        ok = gx::decode_mesh(buffer.data(), buffer.size(), mesh, err);
+    } else if (ok) {
+        ok = tinyobj::LoadObjFromBuffer(mesh, buffer.data(), buffer.size(), err, tinyobj::detail::base_dir(input));
+    }
+    if (!ok) {
+        std::fprintf(stderr, "Failed to load %s: %s\n", input.c_str(), err.c_str());
+        return 1;
+    }
+    std::printf("load: %.1f ms, %zu vertices, %zu triangles, %zu parts, %zu materials\n", ms_since(t0),
+                mesh.positions.size() / 3, mesh.indices.size() / 3, mesh.parts.size(), mesh.materials.size());
+    if (generate_normals) {
+        t0 = Clock::now();
+        gx::compute_normals_if_missing(mesh);
+        std::printf("normals: %.1f ms\n", ms_since(t0));
+    }
+
+    gx::ExportStats stats;
+    if (!gx::export_mesh(mesh, output, err, opt, &stats)) {
+        std::fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+    }
+    std::printf("write %s: %.1f ms, %.1f MB (%.0f MB/s, %zu job threads)\n", output.c_str(), stats.ms,
+                static_cast<double>(stats.bytes) / 1e6, static_cast<double>(stats.bytes) / 1e3 / stats.ms,
+                jobs::JobSystem::instance().concurrency());
+    return 0;
+}
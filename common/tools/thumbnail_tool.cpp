@@ -0,0 +1,230 @@
+// Renders PNG thumbnails of OBJ files on the CPU, for libraries far too large
+// to open one by one:
+//
+//   thumbnail_tool (file.obj | directory | @list.txt)... -o out_dir [--size N] [--supersample N]
+//                  [--prefetch N] [--skip-existing] [--huge-pages] [--prefault]
+//
+// Directories are searched recursively for .obj files; @list.txt names one
+// path per line. Every thumbnail goes to out_dir/<path relative to its input
+// directory>.png (files named directly: their file name), rendered with the
+// obj_viewer shading and framing (thumbnail.h). When two inputs map to the
+// same name, the later ones get a _2, _3, ... suffix.
+//
+// The main thread reads files ahead (--prefetch of them, 4 per job thread by
+// default) while the job system parses, renders, encodes and writes the ones
+// already read, one file per job. When the window is full the main thread
+// works on jobs too. Prints the throughput per minute at the end.
+
+#include <algorithm>
+#include <cctype>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <unordered_set>
+#include <vector>
+
+#include "file_reader.h"
+#include "job_system.h"
+#include "mesh_utils.h"
+#include "page_alloc.h"
+#include "thumbnail.h"
+#include "tiny_obj_loader.h"
+#include "trace.h"
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Input {
+    fs::path path;
+    fs::path relative; // output name below out_dir, without extension
+};
+
+bool is_obj(const fs::path &p) {
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".obj";
+}
+
+void collect(const std::string &arg, std::vector<Input> &inputs) {
+    if (!arg.empty() && arg[0] == '@') {
+        std::ifstream list(arg.substr(1));
+        if (!list) std::fprintf(stderr, "Cannot open file: %s\n", arg.c_str() + 1);
+        for (std::string line; std::getline(list, line);) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) collect(line, inputs);
+        }
+        return;
+    }
+    std::error_code ec;
+    const fs::path root(arg);
+    if (fs::is_directory(root, ec)) {
+        for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+             it != end; it.increment(ec)) {
+            if (ec) break;
+            if (it->is_regular_file(ec) && is_obj(it->path())) {
+                inputs.push_back({it->path(), fs::relative(it->path(), root, ec).replace_extension()});
+            }
+        }
+    } else {
+        inputs.push_back({root, root.filename().replace_extension()});
+    }
+}
+
+// Gives inputs that collide in out_dir (a/model.obj and b/model.obj named
+// directly, overlapping directories) distinct names, in input order.
+void disambiguate(std::vector<Input> &inputs) {
+    std::unordered_set<std::string> names, used;
+    bool collides = false;
+    for (const Input &input : inputs) collides |= !names.insert(input.relative.generic_string()).second;
+    if (!collides) return;
+    for (Input &input : inputs) {
+        const std::string name = input.relative.generic_string();
+        if (used.insert(name).second) continue;
+        std::string renamed;
+        for (int n = 2;; ++n) {
+            renamed = name + "_" + std::to_string(n);
+            if (!names.count(renamed) && used.insert(renamed).second) break;
+        }
+        std::fprintf(stderr, "%s: %s.png is taken, writing %s.png\n", input.path.string().c_str(), name.c_str(),
+                     renamed.c_str());
+        input.relative = fs::path(renamed);
+    }
+}
+
+int64_t us_since(Clock::time_point t0) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<std::string> args;
+    std::string out_dir;
+    gx::ThumbnailOptions opt;
+    size_t prefetch = 0;
+    bool skip_existing = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (arg == "--size" && i + 1 < argc) {
+            opt.size = std::clamp(std::atoi(argv[++i]), 8, 4096);
+        } else if (arg == "--supersample" && i + 1 < argc) {
+            opt.supersample = std::clamp(std::atoi(argv[++i]), 1, 8);
+        } else if (arg == "--prefetch" && i + 1 < argc) {
+            prefetch = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--skip-existing") {
+            skip_existing = true;
+        } else if (pages::parse_flag(arg)) {
+            // --huge-pages / --prefault
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty() || out_dir.empty()) {
+        std::fprintf(stderr, "usage: thumbnail_tool (file.obj | directory | @list.txt)... -o out_dir [--size N] "
+                             "[--supersample N] [--prefetch N] [--skip-existing] [--huge-pages] [--prefault]\n");
+        return 1;
+    }
+    tracing::init_from_env();
+    pages::init_from_env();
+
+    const auto t0 = Clock::now();
+    std::vector<Input> inputs;
+    for (const std::string &arg : args) collect(arg, inputs);
+    disambiguate(inputs);
+    jobs::JobSystem &js = jobs::JobSystem::instance();
+    if (prefetch == 0) prefetch = 4 * js.concurrency();
+    std::printf("%zu files, %d px thumbnails (%dx supersampled), %zu job threads, %zu files read ahead\n", inputs.size(),
+                opt.size, opt.supersample, js.concurrency(), prefetch);
+
+    std::atomic<size_t> done{0}, failed{0}, skipped{0};
+    std::atomic<int64_t> parse_us{0}, render_us{0}, write_us{0};
+    int64_t read_us = 0;
+    // Small files: one synchronous read each; the window hides the latency
+    gx::ReadOptions read_opt;
+    read_opt.uring = false;
+
+    std::deque<jobs::TaskHandle> window;
+    for (const Input &input : inputs) {
+        fs::path out_path = fs::path(out_dir) / input.relative;
+        out_path += ".png";
+        std::error_code ec;
+        if (skip_existing && fs::exists(out_path, ec)) {
+            ++skipped;
+            continue;
+        }
+        while (window.size() >= prefetch) {
+            js.wait(window.front());
+            window.pop_front();
+        }
+
+        auto t_read = Clock::now();
+        auto buffer = std::make_shared<std::string>();
+        std::string err;
+        if (!gx::read_file_streamed(input.path.string(), *buffer, err, read_opt)) {
+            std::fprintf(stderr, "%s\n", err.c_str());
+            ++failed;
+            continue;
+        }
+        read_us += us_since(t_read);
+
+        window.push_back(js.run([&, buffer, path = input.path, out_path] {
+            auto t = Clock::now();
+            tinyobj::MeshData mesh;
+            std::string err;
+            if (!tinyobj::LoadObjFromBuffer(mesh, buffer->data(), buffer->size(), err,
+                                            tinyobj::detail::base_dir(path.string()))) {
+                std::fprintf(stderr, "Failed to load %s: %s\n", path.string().c_str(), err.c_str());
+                ++failed;
+                return;
+            }
+            buffer->clear();
+            buffer->shrink_to_fit();
+            gx::compute_normals_if_missing(mesh);
+            parse_us += us_since(t);
+
+            t = Clock::now();
+            // One renderer per thread keeps its sample buffers between files
+            thread_local gx::ThumbnailRenderer renderer(opt);
+            gx::Image image;
+            renderer.render(mesh, image);
+            render_us += us_since(t);
+
+            t = Clock::now();
+            std::error_code dir_ec;
+            fs::create_directories(out_path.parent_path(), dir_ec); // may race with other jobs: checked by the write
+            if (!gx::write_png(out_path.string(), image, err)) {
+                std::fprintf(stderr, "%s\n", err.c_str());
+                ++failed;
+                return;
+            }
+            write_us += us_since(t);
+            const size_t n = ++done;
+            if (n % 1000 == 0) {
+                std::printf("%zu thumbnails, %.0f per minute\n", n, n * 60e6 / static_cast<double>(us_since(t0)));
+                std::fflush(stdout);
+            }
+        }));
+    }
+    for (const jobs::TaskHandle &task : window) js.wait(task);
+
+    const double seconds = static_cast<double>(us_since(t0)) / 1e6;
+    const size_t n = done.load();
+    std::printf("%zu thumbnails in %.2f s (%.0f per minute), %zu failed, %zu skipped\n", n, seconds,
+                seconds > 0.0 ? n * 60.0 / seconds : 0.0, failed.load(), skipped.load());
+    if (n) {
+        std::printf("per thumbnail: read %.2f ms (main thread), parse %.2f ms, render %.2f ms, encode+write %.2f ms\n",
+                    read_us / 1e3 / n, parse_us.load() / 1e3 / n, render_us.load() / 1e3 / n, write_us.load() / 1e3 / n);
+    }
+    return failed.load() ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+#pragma once
+// Scoped trace events written as Chrome trace JSON (open in ui.perfetto.dev or
+// chrome://tracing).
+//
+// Every thread appends complete events to its own chain of fixed-size chunks,
+// so recording takes no locks; a chunk's count is published with release
+// semantics and read by the writer at exit. When tracing is off a scope costs
+// one relaxed atomic load. Define TRACE_DISABLED to compile all macros out.
+//
+// Enable with the TRACE_FILE environment variable:
+//   TRACE_FILE=obj_viewer.json ./obj_viewer model.obj
+//
+// Event names must be string literals (or otherwise outlive the process).
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace tracing {
+
+struct Event {
+    const char *name;
+    const char *arg_name; // optional integer argument, nullptr if unused
+    int64_t arg;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+};
+
+namespace detail {
+
+constexpr size_t kChunkEvents = 4096;
+
+struct Chunk {
+    Event events[kChunkEvents];
+    std::atomic<size_t> count{0};
+    std::atomic<Chunk *> next{nullptr};
+};
+
+struct ThreadBuffer {
+    uint32_t tid = 0;
+    std::string name; // set by the owning thread only
+    Chunk *head = nullptr;
+    Chunk *tail = nullptr;
+    ThreadBuffer *next = nullptr; // registry list, never unlinked
+};
+
+struct State {
+    std::atomic<bool> enabled{false};
+    std::atomic<ThreadBuffer *> threads{nullptr};
+    std::atomic<uint32_t> next_tid{1};
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    std::string path;
+};
+
+inline State &state() {
+    static State s;
+    return s;
+}
+
+// Buffers are leaked on purpose: they must outlive their threads so that the
+// events of finished workers still reach the file.
+inline ThreadBuffer &thread_buffer() {
+    static thread_local ThreadBuffer *buffer = [] {
+        auto *b = new ThreadBuffer;
+        State &s = state();
+        b->tid = s.next_tid.fetch_add(1, std::memory_order_relaxed);
+        b->head = b->tail = new Chunk;
+        ThreadBuffer *head = s.threads.load(std::memory_order_relaxed);
+        do {
+            b->next = head;
+        } while (!s.threads.compare_exchange_weak(head, b, std::memory_order_release, std::memory_order_relaxed));
+        return b;
+    }();
+    return *buffer;
+}
+
+inline void append(const Event &e) {
+    ThreadBuffer &b = thread_buffer();
+    Chunk *c = b.tail;
+    size_t n = c->count.load(std::memory_order_relaxed);
+    if (n == kChunkEvents) {
+        Chunk *fresh = new Chunk;
+        c->next.store(fresh, std::memory_order_release);
+        b.tail = c = fresh;
+        n = 0;
+    }
+    c->events[n] = e;
+    c->count.store(n + 1, std::memory_order_release);
+}
+
+inline void write_escaped(std::FILE *f, const char *s) {
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') std::fputc('\\', f);
+        std::fputc(*s, f);
+    }
+}
+
+} // namespace detail
+
+inline bool enabled() { return detail::state().enabled.load(std::memory_order_relaxed); }
+
+inline uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - detail::state().epoch)
+                                     .count());
+}
+
+// Names the calling thread in the timeline.
+inline void set_thread_name(const std::string &name) {
+    if (enabled()) detail::thread_buffer().name = name;
+}
+
+// Writes everything recorded so far. Safe to call while other threads trace;
+// events published after the snapshot are simply not included.
+inline bool write(const std::string &path) {
+    std::FILE *f = std::fopen(path.c_str(), "w");
+    if (!f) {
+        std::fprintf(stderr, "trace: cannot write %s\n", path.c_str());
+        return false;
+    }
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+    bool first = true;
+    for (detail::ThreadBuffer *b = detail::state().threads.load(std::memory_order_acquire); b; b = b->next) {
+        std::fprintf(f, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"",
+                     first ? "" : ",\n", b->tid);
+        if (!b->name.empty()) {
+            detail::write_escaped(f, b->name.c_str());
+        } else {
+            std::fprintf(f, "thread %u", b->tid);
+        }
+        std::fputs("\"}}", f);
+        first = false;
+        for (detail::Chunk *c = b->head; c; c = c->next.load(std::memory_order_acquire)) {
+            size_t n = c->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; ++i) {
+                const Event &e = c->events[i];
+                std::fprintf(f, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":\"", b->tid,
+                             e.begin_ns * 1e-3, (e.end_ns - e.begin_ns) * 1e-3);
+                detail::write_escaped(f, e.name);
+                std::fputc('"', f);
+                if (e.arg_name) {
+                    std::fputs(",\"args\":{\"", f);
+                    detail::write_escaped(f, e.arg_name);
+                    std::fprintf(f, "\":%lld}", static_cast<long long>(e.arg));
+                }
+                std::fputc('}', f);
+            }
+        }
+    }
+    std::fputs("\n]}\n", f);
+    std::fclose(f);
+    return true;
+}
+
+// Starts recording if TRACE_FILE is set; the file is written at exit.
+// Returns true when tracing is on.
+inline bool init_from_env() {
+    const char *path = std::getenv("TRACE_FILE");
+    if (!path || !*path) return false;
+    detail::State &s = detail::state();
+    s.path = path;
+    s.epoch = std::chrono::steady_clock::now();
+    s.enabled.store(true, std::memory_order_relaxed);
+    std::atexit([] {
+        detail::State &st = detail::state();
+        st.enabled.store(false, std::memory_order_relaxed);
+        if (write(st.path)) std::fprintf(stderr, "trace: wrote %s\n", st.path.c_str());
+    });
+    return true;
+}
+
+class Scope {
+public:
+    explicit Scope(const char *name, const char *arg_name = nullptr, int64_t arg = 0)
+        : name_(name), arg_name_(arg_name), arg_(arg), begin_(enabled() ? now_ns() : 0) {}
+    ~Scope() { end(); }
+
+    // Closes the event early, for phases that do not map onto a C++ block.
+    void end() {
+        if (begin_) detail::append(Event{name_, arg_name_, arg_, begin_, now_ns()});
+        begin_ = 0;
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *name_;
+    const char *arg_name_;
+    int64_t arg_;
+    uint64_t begin_;
+};
+
+} // namespace tracing
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef TRACE_DISABLED
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_ARG(name, arg_name, arg) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#else
+#define TRACE_SCOPE(name) ::tracing::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg_name, arg) ::tracing::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name, arg_name, arg)
+#define TRACE_THREAD_NAME(name) ::tracing::set_thread_name(name)
+#endif
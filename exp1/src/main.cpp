@@ -2,84 +2,45 @@
 #include <GLFW/glfw3.h>
 
 #include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 
-#include "../third_party/tiny_obj_loader.h"
+#define ALLOC_TRACKER_IMPLEMENTATION
+#include "alloc_tracker.h"
+#include "async.h"
+#include "command_buffer.h"
+#include "deform.h"
+#include "gl_commands.h"
+#include "gl_dynamic_mesh.h"
+#include "gl_frame_ring.h"
+#include "gl_impostor.h"
+#include "gl_materials.h"
+#include "gl_mesh.h"
+#include "gl_program.h"
+#include "gl_splats.h"
+#include "gl_tile_overlay.h"
+#include "gl_timer.h"
+#include "job_system.h"
+#include "math3d.h"
+#include "mesh_pipeline.h"
+#include "metrics.h"
+#include "occlusion.h"
+#include "page_alloc.h"
+#include "perf_counters.h"
+#include "progressive_tracer.h"
+#include "trace.h"
 
-struct Mat4 {
-    float m[16]; // column-major
-};
-
-static Mat4 identity() {
-    Mat4 r{};
-    r.m[0] = r.m[5] = r.m[10] = r.m[15] = 1.0f;
-    return r;
-}
-
-static Mat4 perspective(float fovy, float aspect, float znear, float zfar) {
-    float f = 1.0f / std::tan(fovy * 0.5f);
-    Mat4 r{};
-    r.m[0] = f / aspect;
-    r.m[5] = f;
-    r.m[10] = (zfar + znear) / (znear - zfar);
-    r.m[11] = -1.0f;
-    r.m[14] = (2.0f * zfar * znear) / (znear - zfar);
-    return r;
-}
-
-static Mat4 translate(float x, float y, float z) {
-    Mat4 r = identity();
-    r.m[12] = x;
-    r.m[13] = y;
-    r.m[14] = z;
-    return r;
-}
-
-static Mat4 rotate_y(float angle_rad) {
-    Mat4 r = identity();
-    float c = std::cos(angle_rad);
-    float s = std::sin(angle_rad);
-    r.m[0] = c;
-    r.m[2] = s;
-    r.m[8] = -s;
-    r.m[10] = c;
-    return r;
-}
-
-static Mat4 rotate_x(float angle_rad) {
-    Mat4 r = identity();
-    float c = std::cos(angle_rad);
-    float s = std::sin(angle_rad);
-    r.m[5] = c;
-    r.m[6] = s;
-    r.m[9] = -s;
-    r.m[10] = c;
-    return r;
-}
-
-static Mat4 scale(float s) {
-    Mat4 r{};
-    r.m[0] = r.m[5] = r.m[10] = s;
-    r.m[15] = 1.0f;
-    return r;
-}
-
-static Mat4 multiply(const Mat4 &a, const Mat4 &b) {
-    Mat4 r{};
-    for (int col = 0; col < 4; ++col) {
-        for (int row = 0; row < 4; ++row) {
-            r.m[col * 4 + row] =
-                a.m[0 * 4 + row] * b.m[col * 4 + 0] +
-                a.m[1 * 4 + row] * b.m[col * 4 + 1] +
-                a.m[2 * 4 + row] * b.m[col * 4 + 2] +
-                a.m[3 * 4 + row] * b.m[col * 4 + 3];
-        }
-    }
-    return r;
-}
+using gx::Mat4;
+using gx::multiply;
 
 struct InteractionState {
     bool rotating = false;
@@ -92,91 +53,37 @@ struct InteractionState {
     float pan_y = 0.0f;
     float distance = 3.0f;
     float model_scale = 1.0f;
+    // Set from the bounds on load (frame_bounds): the model turns about the
+    // center and near/far enclose the sphere, widened by clip_margin
+    gx::Vec3 center;
+    float radius = 1.0f;
+    float clip_margin = 1.1f;
+    float min_distance = 0.5f, max_distance = 50.0f;
+    gx::DeformParams deform; // --deform
 };
 
-static GLuint compile_shader(GLenum type, const char *src) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &src, nullptr);
-    glCompileShader(shader);
-    GLint ok = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
-    if (!ok) {
-        GLint len = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &len);
-        std::string log(len, '\0');
-        glGetShaderInfoLog(shader, len, nullptr, log.data());
-        std::cerr << "Shader compile error: " << log << std::endl;
-        glDeleteShader(shader);
-        return 0;
-    }
-    return shader;
-}
-
-static GLuint create_program(const char *vs_src, const char *fs_src) {
-    GLuint vs = compile_shader(GL_VERTEX_SHADER, vs_src);
-    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fs_src);
-    if (!vs || !fs) return 0;
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, vs);
-    glAttachShader(prog, fs);
-    glLinkProgram(prog);
-    GLint ok = 0;
-    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-    if (!ok) {
-        GLint len = 0;
-        glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &len);
-        std::string log(len, '\0');
-        glGetProgramInfoLog(prog, len, nullptr, log.data());
-        std::cerr << "Program link error: " << log << std::endl;
-        glDeleteProgram(prog);
-        prog = 0;
-    }
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-    return prog;
-}
+// Side-by-side stereo: --stereo draws both eyes in one instanced pass,
+// --stereo-two-pass draws the scene once per eye (the baseline; T switches
+// between the two while running)
+enum class StereoMode { Off, SinglePass, TwoPass };
 
-static void compute_normals_if_missing(tinyobj::MeshData &mesh) {
-    if (!mesh.normals.empty()) return;
-    mesh.normals.assign(mesh.positions.size(), 0.0f);
-    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
-        unsigned int ia = mesh.indices[i];
-        unsigned int ib = mesh.indices[i + 1];
-        unsigned int ic = mesh.indices[i + 2];
-        const float *a = &mesh.positions[ia * 3];
-        const float *b = &mesh.positions[ib * 3];
-        const float *c = &mesh.positions[ic * 3];
-        float ux = b[0] - a[0];
-        float uy = b[1] - a[1];
-        float uz = b[2] - a[2];
-        float vx = c[0] - a[0];
-        float vy = c[1] - a[1];
-        float vz = c[2] - a[2];
-        float nx = uy * vz - uz * vy;
-        float ny = uz * vx - ux * vz;
-        float nz = ux * vy - uy * vx;
-        mesh.normals[ia * 3 + 0] += nx;
-        mesh.normals[ia * 3 + 1] += ny;
-        mesh.normals[ia * 3 + 2] += nz;
-        mesh.normals[ib * 3 + 0] += nx;
-        mesh.normals[ib * 3 + 1] += ny;
-        mesh.normals[ib * 3 + 2] += nz;
-        mesh.normals[ic * 3 + 0] += nx;
-        mesh.normals[ic * 3 + 1] += ny;
-        mesh.normals[ic * 3 + 2] += nz;
-    }
-    for (size_t i = 0; i + 2 < mesh.normals.size(); i += 3) {
-        float nx = mesh.normals[i];
-        float ny = mesh.normals[i + 1];
-        float nz = mesh.normals[i + 2];
-        float len = std::sqrt(nx * nx + ny * ny + nz * nz);
-        if (len > 1e-6f) {
-            mesh.normals[i] /= len;
-            mesh.normals[i + 1] /= len;
-            mesh.normals[i + 2] /= len;
-        }
-    }
-}
+struct ViewerOptions {
+    std::string path = "assets/cube.obj";
+    bool sequential = false;
+    bool splat_mode = false; // .ply: Gaussian splat capture
+    bool deform = false;     // dynamic VBO and deformation keys
+    bool occlusion = true;   // cull hidden parts of multi-part meshes
+    bool mesh_cache = true;  // share vertex data with other viewers (mesh_cache.h)
+    int frames_in_flight = 2; // dynamic buffers keep one copy per frame, plus one
+    StereoMode stereo = StereoMode::Off;
+    float eye_separation = 1.0f / 30.0f; // fraction of the viewing distance
+    size_t instances = 0;          // --instances N: copies of the mesh on a grid
+    float impostor_distance = 16.0f; // model radii; farther copies are impostors (0: never)
+    bool still = true;               // ray-traced stills while the camera rests (--no-still)
+    float still_delay = 0.4f;        // seconds without input before tracing starts
+    uint32_t still_samples = 64;     // passes per still
+    uint32_t ao_rays = 0;            // --ao [N]: bake per-vertex ambient occlusion with N rays per vertex
+};
 
 static void glfw_error_callback(int code, const char *desc) {
     std::cerr << "GLFW error " << code << ": " << desc << std::endl;
@@ -219,106 +126,140 @@ static void scroll_callback(GLFWwindow *window, double /*xoffset*/, double yoffs
     auto *state = static_cast<InteractionState *>(glfwGetWindowUserPointer(window));
     if (!state) return;
     float scale = std::exp(static_cast<float>(-yoffset) * 0.1f);
-    state->distance = std::clamp(state->distance * scale, 0.5f, 50.0f);
+    state->distance = std::clamp(state->distance * scale, state->min_distance, state->max_distance);
 }
 
-static std::pair<Mat4, Mat4> compute_matrices(const InteractionState &st, float aspect) {
-    Mat4 proj = perspective(45.0f * 3.1415926f / 180.0f, aspect, 0.05f, 200.0f);
-    Mat4 view = translate(0.0f, 0.0f, -st.distance);
-    Mat4 t = translate(st.pan_x, st.pan_y, 0.0f);
-    Mat4 ry = rotate_y(st.yaw);
-    Mat4 rx = rotate_x(st.pitch);
-    Mat4 s = scale(st.model_scale);
+struct FrameMatrices {
+    Mat4 mvp, model, modelview, proj;
+};
 
-    Mat4 model = multiply(t, multiply(ry, multiply(rx, s)));
-    Mat4 vp = multiply(proj, view);
-    Mat4 mvp = multiply(vp, model);
-    return {mvp, model};
+constexpr float kFovY = 45.0f * gx::kPi / 180.0f;
+
+// Puts the bounding sphere in the middle of the view, filling most of the
+// vertical field of view, and scales the zoom limits with it.
+static void frame_bounds(InteractionState &st, const gx::MeshBounds &b) {
+    if (b.count == 0 || !(b.sphere.radius > 0.0f)) return;
+    st.center = b.sphere.center;
+    st.radius = b.sphere.radius;
+    st.distance = 1.1f * st.radius / std::sin(0.5f * kFovY);
+    st.min_distance = 0.05f * st.distance;
+    st.max_distance = 20.0f * st.distance;
 }
 
-int main(int argc, char **argv) {
-    std::string obj_path = (argc > 1) ? argv[1] : "assets/cube.obj";
+static FrameMatrices compute_matrices(const InteractionState &st, float aspect) {
+    // Near and far planes hug the sphere (panning moves it sideways only);
+    // the near plane is kept at a 1e4 depth range when the camera is inside
+    const float r = st.radius * st.model_scale * st.clip_margin;
+    const float zfar = st.distance + r;
+    const float znear = std::max(st.distance - r, zfar * 1e-4f);
+    Mat4 proj = gx::perspective(kFovY, aspect, znear, zfar);
+    Mat4 view = gx::translate(0.0f, 0.0f, -st.distance);
+    Mat4 t = gx::translate(st.pan_x, st.pan_y, 0.0f);
+    Mat4 ry = gx::rotate_y(st.yaw);
+    Mat4 rx = gx::rotate_x(st.pitch);
+    Mat4 s = gx::scale(st.model_scale);
+    Mat4 c = gx::translate(st.center * -1.0f);
 
-    tinyobj::MeshData mesh;
-    std::string err;
-    if (!tinyobj::LoadObj(mesh, obj_path, err)) {
-        std::cerr << "Failed to load OBJ: " << err << std::endl;
-        return 1;
-    }
-    if (mesh.indices.empty()) {
-        std::cerr << "OBJ has no faces: " << obj_path << std::endl;
-        return 1;
-    }
+    Mat4 model = multiply(t, multiply(ry, multiply(rx, multiply(s, c))));
+    Mat4 vp = multiply(proj, view);
+    Mat4 mvp = multiply(vp, model);
+    return {mvp, model, multiply(view, model), proj};
+}
 
-    compute_normals_if_missing(mesh);
-
-    // Interleave position and normal (6 floats per vertex)
-    std::vector<float> interleaved;
-    interleaved.reserve(mesh.positions.size() * 2);
-    size_t vertex_count = mesh.positions.size() / 3;
-    for (size_t i = 0; i < vertex_count; ++i) {
-        interleaved.push_back(mesh.positions[i * 3 + 0]);
-        interleaved.push_back(mesh.positions[i * 3 + 1]);
-        interleaved.push_back(mesh.positions[i * 3 + 2]);
-        interleaved.push_back(mesh.normals[i * 3 + 0]);
-        interleaved.push_back(mesh.normals[i * 3 + 1]);
-        interleaved.push_back(mesh.normals[i * 3 + 2]);
-    }
-
-    glfwSetErrorCallback(glfw_error_callback);
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
-        return 1;
+// Eye views for side-by-side stereo, derived from compute_matrices with the
+// aspect of one half of the window. The eyes sit separation * distance apart
+// and look parallel to the camera; their frusta are shifted (off-axis) so that
+// the plane through the model center has no parallax. The model matrix is
+// shared; only mvp, modelview and proj differ per eye (0 left, 1 right).
+static std::array<FrameMatrices, 2> compute_eye_matrices(const InteractionState &st, float aspect, float separation) {
+    const FrameMatrices m = compute_matrices(st, aspect);
+    std::array<FrameMatrices, 2> eyes;
+    for (int e = 0; e < 2; ++e) {
+        const float offset = (e == 0 ? -0.5f : 0.5f) * separation * st.distance;
+        Mat4 proj = m.proj;
+        proj.m[8] = -proj.m[0] * offset / st.distance;
+        const Mat4 modelview = multiply(gx::translate(-offset, 0.0f, 0.0f), m.modelview);
+        eyes[e] = {multiply(proj, modelview), m.model, modelview, proj};
     }
+    return eyes;
+}
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+static const char *kVertexShader = R"( #version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec3 aOffset; // --instances: per copy, else (0, 0, 0)
+layout(location = 3) in float aAo;    // --ao: baked per vertex, else 1 (gl_mesh.h)
 
-    GLFWwindow *window = glfwCreateWindow(1280, 720, "OBJ Preview", nullptr, nullptr);
-    if (!window) {
-        std::cerr << "Failed to create window" << std::endl;
-        glfwTerminate();
-        return 1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSwapInterval(1);
+uniform mat4 u_mvp;
+uniform mat4 u_model;
 
-    InteractionState state;
-    glfwSetWindowUserPointer(window, &state);
-    glfwSetMouseButtonCallback(window, mouse_button_callback);
-    glfwSetCursorPosCallback(window, cursor_pos_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-
-    glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK) {
-        std::cerr << "Failed to initialize GLEW" << std::endl;
-        return 1;
-    }
+out vec3 vNormal;
+out float vAo;
 
-    glEnable(GL_DEPTH_TEST);
+void main() {
+    vNormal = mat3(u_model) * aNormal;
+    vAo = aAo;
+    gl_Position = u_mvp * vec4(aPos + aOffset, 1.0);
+}
+)";
 
-    const char *vs_src = R"( #version 330 core
+// Single-pass stereo: every draw is instanced twice and gl_InstanceID picks
+// the eye. With viewport arrays the instance goes to the eye's viewport; on
+// plain GL 3.3 both eyes share the window viewport, so the instance is squeezed
+// into its half of clip space and a clip plane cuts it off at the middle.
+static const char *kStereoVertexShader = R"(
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
+layout(location = 3) in float aAo;
 
-uniform mat4 u_mvp;
+uniform mat4 u_eye_mvp[2];
 uniform mat4 u_model;
 
 out vec3 vNormal;
+out float vAo;
 
 void main() {
+    int eye = gl_InstanceID;
     vNormal = mat3(u_model) * aNormal;
-    gl_Position = u_mvp * vec4(aPos, 1.0);
+    vAo = aAo;
+    vec4 pos = u_eye_mvp[eye] * vec4(aPos, 1.0);
+#ifdef VIEWPORT_ARRAY
+    gl_ViewportIndex = eye;
+#else
+    // x in [-w, w] to [-w, 0] (left) or [0, w] (right)
+    float side = eye == 0 ? -1.0 : 1.0;
+    pos.x = 0.5 * (pos.x + side * pos.w);
+    gl_ClipDistance[0] = side * pos.x;
+#endif
+    gl_Position = pos;
 }
 )";
 
-    const char *fs_src = R"( #version 330 core
+// Writing gl_ViewportIndex from the vertex shader needs one of two extensions
+// on top of ARB_viewport_array; empty when neither is there.
+static const char *viewport_index_extension() {
+    if (!GLEW_ARB_viewport_array) return "";
+    if (GLEW_ARB_shader_viewport_layer_array) return "GL_ARB_shader_viewport_layer_array";
+    if (GLEW_AMD_vertex_shader_viewport_index) return "GL_AMD_vertex_shader_viewport_index";
+    return "";
+}
+
+static std::string stereo_vertex_shader(const std::string &viewport_extension) {
+    std::string src = "#version 330 core\n";
+    if (!viewport_extension.empty()) {
+        src += "#extension " + viewport_extension + " : require\n#define VIEWPORT_ARRAY\n";
+    }
+    return src + kStereoVertexShader;
+}
+
+static const char *kFragmentShader = R"( #version 330 core
 in vec3 vNormal;
+in float vAo;
 out vec4 FragColor;
 
-// 纯绿色物体
-uniform vec3 u_color = vec3(0.0, 1.0, 0.0);
+// Material table (gl_materials.h); faces without usemtl use the last, green entry
+uniform samplerBuffer u_materials;
+uniform int u_material;
 
 void main() {
     // 归一化法线和光方向（光源固定在世界/摄像机空间）
@@ -328,37 +269,562 @@ void main() {
     // 单侧漫反射，法线转到背面时亮度减弱
     float ndl = max(dot(N, L), 0.0);
 
-    // 保证没有完全黑的面：亮度范围 [0.4, 1.0]
-    float brightness = 0.4 + 0.6 * ndl;
+    // 保证没有完全黑的面：亮度范围 [0.4, 1.0]；环境部分乘以烘焙的遮蔽（--ao）
+    float brightness = 0.4 * vAo + 0.6 * ndl;
 
-    vec3 color = u_color * brightness;
+    vec4 diffuse = texelFetch(u_materials, u_material * 3);
+    vec4 specular = texelFetch(u_materials, u_material * 3 + 1);
+    vec3 ambient = texelFetch(u_materials, u_material * 3 + 2).rgb;
+
+    // Blinn-Phong highlight, viewer along +z
+    vec3 H = normalize(L + vec3(0.0, 0.0, 1.0));
+    float spec = ndl > 0.0 ? pow(max(dot(N, H), 0.0), max(specular.a, 1.0)) : 0.0;
+
+    vec3 color = diffuse.rgb * brightness + ambient * vAo + specular.rgb * spec;
     FragColor = vec4(color, 1.0);
 }
 )";
 
-    GLuint program = create_program(vs_src, fs_src);
-    if (!program) return 1;
+struct GlContext {
+    GLFWwindow *window = nullptr;
+    GLuint program = 0;
+    GLuint stereo_program = 0;  // with stereo: both eyes in one instanced pass
+    bool viewport_array = false; // stereo_program routes eyes to viewports 0/1
+};
+
+// The material table as drawn: faces without usemtl get the green default,
+// appended as the last entry
+static std::vector<tinyobj::Material> with_default_material(std::vector<tinyobj::Material> materials) {
+    tinyobj::Material &fallback = materials.emplace_back();
+    fallback.diffuse[0] = fallback.diffuse[2] = 0.0f;
+    fallback.diffuse[1] = 1.0f;
+    return materials;
+}
+
+// Either a mesh (OBJ) or a Gaussian splat capture (PLY) is loaded
+struct Startup {
+    gx::PreparedMesh mesh;
+    gx::PreparedSplats splats;
+    GlContext gl;
+    gx::GpuMesh gpu;
+    gx::DynamicGpuMesh dynamic; // instead of gpu with --deform
+    gx::GpuSplats gpu_splats;
+    gx::GpuMaterials materials; // mesh.materials plus the default for kNoMaterial
+    double upload_ms = 0.0;
+};
+
+// Window, context and shaders. GLFW requires the main thread, which owns the
+// GL context and drives the gl executor.
+static async::Task<GlContext> init_gl_async(async::Executor &gl, InteractionState *state, bool splat_mode,
+                                            bool stereo = false) {
+    co_await gl.schedule();
+    GlContext ctx;
+    {
+        TRACE_SCOPE("gl_init");
+        glfwSetErrorCallback(glfw_error_callback);
+        if (!glfwInit()) {
+            std::cerr << "Failed to initialize GLFW" << std::endl;
+            co_return ctx;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        ctx.window = glfwCreateWindow(1280, 720, "OBJ Preview", nullptr, nullptr);
+        if (!ctx.window) {
+            std::cerr << "Failed to create window" << std::endl;
+            glfwTerminate();
+            co_return ctx;
+        }
+        glfwMakeContextCurrent(ctx.window);
+        glfwSwapInterval(1);
+
+        glfwSetWindowUserPointer(ctx.window, state);
+        glfwSetMouseButtonCallback(ctx.window, mouse_button_callback);
+        glfwSetCursorPosCallback(ctx.window, cursor_pos_callback);
+        glfwSetScrollCallback(ctx.window, scroll_callback);
+
+        glewExperimental = GL_TRUE;
+        if (glewInit() != GLEW_OK) {
+            std::cerr << "Failed to initialize GLEW" << std::endl;
+            co_return ctx;
+        }
+
+        glEnable(GL_DEPTH_TEST);
+    }
+    {
+        TRACE_SCOPE("compile_shaders");
+        ctx.program = splat_mode ? gx::create_program(gx::kSplatVertexShader, gx::kSplatFragmentShader)
+                                 : gx::create_program(kVertexShader, kFragmentShader);
+        if (stereo) {
+            const std::string extension = viewport_index_extension();
+            ctx.stereo_program = gx::create_program(stereo_vertex_shader(extension).c_str(), kFragmentShader);
+            ctx.viewport_array = ctx.stereo_program && !extension.empty();
+        }
+    }
+    co_return ctx;
+}
+
+// Runs load and GL init concurrently, or one after the other with sequential.
+template <typename T>
+static async::Task<std::tuple<T, GlContext>> load_and_init(async::Task<T> load, async::Task<GlContext> init,
+                                                           bool sequential) {
+    if (!sequential) co_return co_await async::when_all(std::move(load), std::move(init));
+    T data = co_await load;
+    GlContext ctx = co_await init;
+    co_return std::tuple<T, GlContext>(std::move(data), ctx);
+}
+
+// Loading (I/O thread, then workers) overlaps window creation and shader
+// compilation (GL thread); the upload waits for both. --sequential runs the
+// same stages one after the other for comparison.
+static async::Task<Startup> startup_async(async::Executor &gl, async::Executor &io, ViewerOptions opt,
+                                          InteractionState *state) {
+    Startup s;
+    if (opt.splat_mode) {
+        std::tie(s.splats, s.gl) =
+            co_await load_and_init(gx::load_splats_async(io, opt.path), init_gl_async(gl, state, true), opt.sequential);
+        if (!s.splats.ok || !s.gl.program) co_return s;
+    } else {
+        std::tie(s.mesh, s.gl) =
+            co_await load_and_init(gx::load_mesh_async(io, opt.path, opt.mesh_cache, opt.ao_rays),
+                                   init_gl_async(gl, state, false, opt.stereo != StereoMode::Off), opt.sequential);
+        if (!s.mesh.ok || !s.gl.program) co_return s;
+    }
+    co_await gl.schedule();
+    const auto t0 = std::chrono::steady_clock::now();
+    if (opt.splat_mode) {
+        s.gpu_splats = gx::upload_splats(s.splats.splats, gx::FrameRing::copies_for(opt.frames_in_flight));
+    } else if (opt.deform) {
+        s.dynamic = gx::upload_dynamic_mesh(s.mesh.interleaved, s.mesh.mesh.indices,
+                                            gx::FrameRing::copies_for(opt.frames_in_flight));
+    } else {
+        s.gpu = gx::upload_mesh(s.mesh.vertex_data(), s.mesh.vertex_count(), s.mesh.index_data(), s.mesh.index_count(),
+                                opt.ao_rays ? s.mesh.ao_data() : nullptr);
+    }
+    if (!opt.splat_mode) s.materials = gx::upload_materials(with_default_material(s.mesh.mesh.materials));
+    s.upload_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    co_return s;
+}
 
-    GLuint vao = 0, vbo = 0, ebo = 0;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
+// Morph target for --deform: pushes the vertices around the top of the mesh
+// outwards along their normals (sparse, so updates stay partial).
+static std::vector<float> make_bulge_target(const tinyobj::MeshData &mesh) {
+    const size_t n = mesh.positions.size() / 3;
+    std::vector<float> deltas(n * 3, 0.0f);
+    if (n == 0 || mesh.normals.size() != mesh.positions.size()) return deltas;
+    size_t top = 0;
+    float lo[3] = {1e30f, 1e30f, 1e30f}, hi[3] = {-1e30f, -1e30f, -1e30f};
+    for (size_t v = 0; v < n; ++v) {
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], mesh.positions[v * 3 + k]);
+            hi[k] = std::max(hi[k], mesh.positions[v * 3 + k]);
+        }
+        if (mesh.positions[v * 3 + 1] > mesh.positions[top * 3 + 1]) top = v;
+    }
+    const float size = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]});
+    const float radius = 0.3f * size;
+    for (size_t v = 0; v < n; ++v) {
+        float d2 = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            float d = mesh.positions[v * 3 + k] - mesh.positions[top * 3 + k];
+            d2 += d * d;
+        }
+        if (d2 >= radius * radius) continue;
+        const float falloff = 1.0f - std::sqrt(d2) / radius;
+        for (int k = 0; k < 3; ++k) deltas[v * 3 + k] = mesh.normals[v * 3 + k] * 0.15f * size * falloff * falloff;
+    }
+    return deltas;
+}
 
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, interleaved.size() * sizeof(float), interleaved.data(), GL_STATIC_DRAW);
+int main(int argc, char **argv) {
+    const auto start_time = std::chrono::steady_clock::now();
+    ViewerOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sequential") {
+            opt.sequential = true;
+        } else if (arg == "--deform") {
+            opt.deform = true;
+        } else if (arg == "--no-occlusion") {
+            opt.occlusion = false;
+        } else if (arg == "--no-mesh-cache") {
+            opt.mesh_cache = false;
+        } else if (arg == "--stereo") {
+            opt.stereo = StereoMode::SinglePass;
+        } else if (arg == "--stereo-two-pass") {
+            opt.stereo = StereoMode::TwoPass;
+        } else if (arg == "--eye-separation" && i + 1 < argc) {
+            opt.eye_separation = std::clamp(static_cast<float>(std::atof(argv[++i])), 0.0f, 0.5f);
+        } else if (arg == "--instances" && i + 1 < argc) {
+            opt.instances = static_cast<size_t>(std::max(0L, std::strtol(argv[++i], nullptr, 10)));
+        } else if (arg == "--impostor-distance" && i + 1 < argc) {
+            opt.impostor_distance = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        } else if (arg == "--no-still") {
+            opt.still = false;
+        } else if (arg == "--still-delay" && i + 1 < argc) {
+            opt.still_delay = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        } else if (arg == "--still-samples" && i + 1 < argc) {
+            opt.still_samples = static_cast<uint32_t>(std::clamp(std::atoi(argv[++i]), 1, 4096));
+        } else if (arg == "--ao") {
+            opt.ao_rays = 64;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                opt.ao_rays = static_cast<uint32_t>(std::clamp(std::atoi(argv[++i]), 1, 4096) + 3) / 4 * 4;
+            }
+        } else if (arg == "--frames-in-flight" && i + 1 < argc) {
+            opt.frames_in_flight = std::clamp(std::atoi(argv[++i]), 1, gx::FrameRing::kMaxFrames);
+        } else if (pages::parse_flag(arg)) {
+            // --huge-pages / --prefault (page_alloc.h)
+        } else {
+            opt.path = arg;
+        }
+    }
+    // Gaussian splat captures (gaussian-splatting PLY) are drawn as splats
+    opt.splat_mode = opt.path.size() >= 4 && opt.path.compare(opt.path.size() - 4, 4, ".ply") == 0;
+    opt.deform = opt.deform && !opt.splat_mode;
+    if (opt.splat_mode) opt.stereo = StereoMode::Off; // meshes only
+    // --instances draws copies of the static mesh with the mono shader
+    if (opt.splat_mode) opt.instances = 0;
+    if (opt.instances) {
+        opt.deform = false;
+        opt.stereo = StereoMode::Off;
+    }
+    // Baked AO belongs to the rest pose; --deform shades without it
+    if (opt.splat_mode || opt.deform) opt.ao_rays = 0;
+    // --deform edits its own copy of the vertices
+    opt.mesh_cache = opt.mesh_cache && !opt.deform && gx::SharedMesh::supported();
+    const bool splat_mode = opt.splat_mode, sequential = opt.sequential;
+    tracing::init_from_env();
+    perf::init_from_env();
+    metrics::init_from_env();
+    alloc::init();
+    if (const pages::Policy &p = pages::init_from_env(); p.huge || p.prefault) {
+        std::cout << "pages: " << pages::describe() << std::endl;
+    }
+    TRACE_THREAD_NAME("main");
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+    InteractionState state;
+    async::Executor gl_thread; // driven by this thread, which owns the GL context
+    async::ThreadExecutor io_thread("io");
+    Startup startup = async::run_until_complete(gl_thread, startup_async(gl_thread, io_thread, opt, &state));
+    if (splat_mode ? !startup.splats.ok : !startup.mesh.ok) {
+        std::cerr << (splat_mode ? "Failed to load PLY: " + startup.splats.err : "Failed to load OBJ: " + startup.mesh.err)
+                  << std::endl;
+        if (startup.gl.window) glfwTerminate();
+        return 1;
+    }
+    if (!startup.gl.program) return 1;
+    GLFWwindow *window = startup.gl.window;
+    const GLuint program = startup.gl.program;
+    gx::GpuMesh &gpu = startup.gpu;
+    gx::GpuSplats &gpu_splats = startup.gpu_splats;
+    gx::DynamicGpuMesh &dynamic = startup.dynamic;
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // Frame the model (R returns to this view)
+    const gx::MeshBounds &bounds = splat_mode ? startup.splats.bounds : startup.mesh.bounds;
+    frame_bounds(state, bounds);
+    if (opt.deform) state.clip_margin = 1.5f; // deformation may leave the rest pose bounds
+    // --instances: the copies stand on a grid in the model's xz plane, three
+    // radii apart, the original in the front row; near/far enclose them all
+    std::vector<gx::Vec3> instance_offsets;
+    if (opt.instances) {
+        const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(opt.instances))));
+        const float spacing = 3.0f * state.radius;
+        float extent = 0.0f;
+        for (size_t k = 0; k < opt.instances; ++k) {
+            const float col = static_cast<float>(k % side) - 0.5f * static_cast<float>(side - 1);
+            const gx::Vec3 offset(col * spacing, 0.0f, -static_cast<float>(k / side) * spacing);
+            instance_offsets.push_back(offset);
+            extent = std::max(extent, gx::length(offset));
+        }
+        state.clip_margin = 1.1f * (extent + state.radius) / state.radius;
+    }
+    const InteractionState home = state;
+    std::cout << "bounds: radius " << bounds.sphere.radius << ", oriented box " << 2.0f * bounds.obb.half.x << " x "
+              << 2.0f * bounds.obb.half.y << " x " << 2.0f * bounds.obb.half.z << std::endl;
+    bool first_frame = true;
 
-    glBindVertexArray(0);
+    // Splat mode: the sorter keeps the centers; the packed data is on the GPU
+    std::unique_ptr<gx::SplatSorter> sorter;
+    std::vector<uint32_t> splat_order;
+    float sort_row[4] = {0, 0, 0, 0};
+    if (splat_mode) {
+        gx::publish_splat_metrics(startup.splats, startup.upload_ms);
+        sorter = std::make_unique<gx::SplatSorter>(std::move(startup.splats.splats.centers));
+        startup.splats.splats = gx::PackedSplats{};
+    } else {
+        gx::publish_mesh_metrics(startup.mesh, startup.upload_ms);
+        if (const auto &shared = startup.mesh.shared) {
+            std::cout << "mesh cache: " << (startup.mesh.cache_hit ? "mapped" : "published") << " "
+                      << shared->bytes() / (1024 * 1024) << " MB, " << shared->holders() << " viewer(s)" << std::endl;
+        }
+        if (const gx::AoBakeStats &ao = startup.mesh.ao_stats; ao.rays) {
+            std::cout << "ao: " << startup.mesh.vertex_count() << " vertices x " << opt.ao_rays << " rays in " << ao.ms
+                      << " ms (BVH " << ao.bvh_ms << " ms), " << ao.rays_per_second() / 1e6 << " M rays/s on "
+                      << ao.threads << " thread(s)" << std::endl;
+        } else if (opt.ao_rays && startup.mesh.ao_data()) {
+            std::cout << "ao: from the mesh cache" << std::endl;
+        }
+    }
+
+    // --deform: the CPU copy in startup.mesh.interleaved stays authoritative,
+    // changed ranges are streamed into the dynamic VBO
+    std::unique_ptr<gx::MeshDeformer> deformer;
+    gx::DeformParams applied;
+    metrics::Counter &upload_bytes = metrics::Registry::instance().counter(
+        "gx_vbo_upload_bytes_total", "Vertex bytes uploaded after startup (deformation)");
+    if (opt.deform) {
+        deformer = std::make_unique<gx::MeshDeformer>(startup.mesh.mesh);
+        deformer->add_morph_target(make_bulge_target(startup.mesh.mesh));
+        std::cout << "deform: 1/2 twist, 3/4 bend, 5/6 bulge, R reset ("
+                  << (gx::persistent_mapping_supported() ? "persistent mapping" : "glMapBufferRange") << ")" << std::endl;
+    }
+    // Meshes with several o/g parts draw only the parts that pass occlusion
+    // culling (not with --deform: the part bounds would go stale)
+    std::unique_ptr<gx::OcclusionCuller> culler;
+    if (!splat_mode && !deformer && instance_offsets.empty() && opt.occlusion && startup.mesh.mesh.parts.size() > 1) {
+        culler = std::make_unique<gx::OcclusionCuller>(startup.mesh.positions(), startup.mesh.index_data(),
+                                                       startup.mesh.mesh.parts);
+        std::cout << "occlusion culling: " << culler->stats().parts << " parts, " << culler->stats().occluders
+                  << " occluders (" << culler->stats().occluder_triangles << " triangles)" << std::endl;
+    }
+    // Mesh mode records its draw like exp2 does (one object, so serially).
+    // Material ranges are drawn sorted by material, so the material uniform
+    // changes once per material and ranges of one material that follow each
+    // other in the index buffer merge into one draw.
+    gx::CommandBuffer commands;
+    const GLint loc_mvp = glGetUniformLocation(program, "u_mvp");
+    const GLint loc_model = glGetUniformLocation(program, "u_model");
+    const GLint loc_material = glGetUniformLocation(program, "u_material");
+    const auto &ranges = startup.mesh.mesh.ranges;
+    std::vector<uint32_t> range_order(ranges.size());
+    std::vector<uint8_t> part_visible(startup.mesh.mesh.parts.size(), 1);
+    if (!splat_mode) {
+        for (uint32_t i = 0; i < range_order.size(); ++i) range_order[i] = i;
+        std::sort(range_order.begin(), range_order.end(), [&](uint32_t a, uint32_t b) {
+            return std::tie(ranges[a].material, ranges[a].first_index) <
+                   std::tie(ranges[b].material, ranges[b].first_index);
+        });
+        for (GLuint p : {program, startup.gl.stereo_program}) {
+            if (!p) continue;
+            glUseProgram(p);
+            glUniform1i(glGetUniformLocation(p, "u_materials"), 1);
+        }
+        gx::bind_materials(startup.materials, 1);
+        std::cout << "materials: " << startup.mesh.mesh.materials.size() << " (" << ranges.size() << " ranges in "
+                  << startup.mesh.mesh.parts.size() << " parts)" << std::endl;
+    }
+    // Stereo: the scene pass is timed on the CPU (recording and submission) and
+    // on the GPU, per mode, so that single-pass can be held against two-pass
+    StereoMode stereo = opt.stereo;
+    const GLuint stereo_program = startup.gl.stereo_program;
+    const bool viewport_array = startup.gl.viewport_array;
+    if (stereo == StereoMode::SinglePass && !stereo_program) {
+        std::cerr << "stereo: single-pass shader unavailable, drawing two passes" << std::endl;
+        stereo = StereoMode::TwoPass;
+    }
+    const GLint loc_eye_mvp[2] = {glGetUniformLocation(stereo_program, "u_eye_mvp[0]"),
+                                  glGetUniformLocation(stereo_program, "u_eye_mvp[1]")};
+    const GLint loc_stereo_model = glGetUniformLocation(stereo_program, "u_model");
+    const GLint loc_stereo_material = glGetUniformLocation(stereo_program, "u_material");
+    bool impostors_on = false; // --instances: far copies as impostors, I toggles
+
+    // Pass timing covers the stereo and --instances modes: the scene pass is
+    // timed on the CPU (culling aside: recording and submission) and on the
+    // GPU, averaged since the mode last changed, so that single-pass stereo
+    // can be held against two-pass and impostors against meshes only
+    enum PassMode { kStereoSinglePass, kStereoTwoPass, kImpostors, kMeshesOnly, kPassModes };
+    const auto pass_mode = [&] {
+        if (stereo != StereoMode::Off) return stereo == StereoMode::SinglePass ? kStereoSinglePass : kStereoTwoPass;
+        return impostors_on ? kImpostors : kMeshesOnly;
+    };
+    const auto pass_name = [&](int mode) -> std::string {
+        switch (mode) {
+        case kStereoSinglePass:
+            return viewport_array ? "stereo single-pass (viewport array)" : "stereo single-pass (clip planes)";
+        case kStereoTwoPass:
+            return "stereo two-pass";
+        case kImpostors:
+            return "impostors";
+        default:
+            return "meshes only";
+        }
+    };
+    std::unique_ptr<gx::GpuTimer> pass_timer;
+    double pass_cpu_ms = 0.0, pass_gpu_ms = 0.0;
+    uint64_t pass_cpu_frames = 0, pass_gpu_frames = 0;
+    double pass_triangles = 0.0;            // summed over the timed frames
+    double pass_gpu_avg[kPassModes] = {};   // last report per mode
+    const auto report_pass = [&] {
+        if (pass_cpu_frames == 0) return;
+        const int mode = pass_mode();
+        const double gpu = pass_gpu_frames ? pass_gpu_ms / pass_gpu_frames : 0.0;
+        std::cout << pass_name(mode) << ": " << pass_cpu_ms / pass_cpu_frames << " ms CPU, " << gpu << " ms GPU per frame ("
+                  << pass_cpu_frames << " frames";
+        if (!instance_offsets.empty()) {
+            const double triangles = pass_triangles / pass_cpu_frames;
+            std::cout << ", " << triangles / 1e6 << " M triangles";
+            if (gpu > 0.0) std::cout << ", " << triangles / (gpu * 1e3) << " M triangles/s";
+        }
+        std::cout << ")" << std::endl;
+        pass_gpu_avg[mode] = gpu;
+        const int other = mode == kImpostors ? kMeshesOnly : mode == kMeshesOnly ? kImpostors : -1;
+        if (other >= 0 && gpu > 0.0 && pass_gpu_avg[other] > 0.0) {
+            const double meshes = pass_gpu_avg[kMeshesOnly], impostors = pass_gpu_avg[kImpostors];
+            std::cout << "impostors: " << meshes / impostors << "x the frame rate of meshes only on the GPU ("
+                      << impostors << " vs " << meshes << " ms)" << std::endl;
+        }
+    };
+    const auto start_pass = [&] {
+        pass_timer = std::make_unique<gx::GpuTimer>(); // drops results of the previous mode
+        pass_cpu_ms = pass_gpu_ms = pass_triangles = 0.0;
+        pass_cpu_frames = pass_gpu_frames = 0;
+    };
+    if (stereo != StereoMode::Off) {
+        start_pass();
+        std::cout << pass_name(pass_mode()) << ", eye separation " << opt.eye_separation << " x distance"
+                  << (stereo_program ? " (T switches single-pass / two-pass)" : "") << std::endl;
+    } else if (!instance_offsets.empty()) {
+        start_pass();
+    }
+    bool toggle_down = false, impostor_toggle_down = false;
+
+    // The material range loop of the scene pass; with instances > 1 each
+    // range is drawn once per eye
+    const auto record_ranges = [&](GLint loc, uint32_t instances) {
+        const auto draw = [&](uint32_t count, uint32_t first) {
+            if (instances > 1) {
+                commands.draw_elements_instanced(count, first, instances);
+            } else {
+                commands.draw_elements(count, first);
+            }
+        };
+        const uint32_t default_material = static_cast<uint32_t>(startup.mesh.mesh.materials.size());
+        uint32_t material = ~0u, first = 0, end = 0;
+        for (uint32_t r : range_order) {
+            const tinyobj::MeshRange &range = ranges[r];
+            if (!part_visible[range.part]) continue;
+            const uint32_t id = range.material == tinyobj::kNoMaterial ? default_material : range.material;
+            if (id == material && range.first_index == end) {
+                end += static_cast<uint32_t>(range.index_count);
+                continue;
+            }
+            if (end > first) draw(end - first, first);
+            if (id != material) commands.uniform1i(loc, static_cast<int32_t>(material = id));
+            first = static_cast<uint32_t>(range.first_index);
+            end = first + static_cast<uint32_t>(range.index_count);
+        }
+        if (end > first) draw(end - first, first);
+    };
+
+    // Impostor atlas of the mesh for the far copies, and the per-frame copy
+    // offsets (frame_offsets: meshes, then impostors)
+    gx::ImpostorAtlas impostors;
+    gx::GpuInstances gpu_instances;
+    std::vector<gx::Vec3> frame_offsets, far_offsets;
+    if (!instance_offsets.empty()) {
+        gpu_instances = gx::create_instances(instance_offsets.size(), gx::FrameRing::copies_for(opt.frames_in_flight));
+        if (opt.impostor_distance > 0.0f) {
+            impostors = gx::bake_impostors(state.center, state.radius, 1, [&](GLuint bake) {
+                commands.clear();
+                commands.use_program(bake);
+                commands.bind_vertex_array(gpu.vao);
+                record_ranges(glGetUniformLocation(bake, "u_material"), 1);
+                gx::replay(commands);
+                glBindVertexArray(0);
+            });
+            std::cout << "impostors: " << impostors.views << "x" << impostors.views << " views of "
+                      << impostors.cell << " px baked in " << impostors.bake_ms << " ms, copies beyond "
+                      << opt.impostor_distance << " radii (I switches impostors off / on)" << std::endl;
+        }
+        impostors_on = impostors.program != 0;
+        std::cout << "instances: " << instance_offsets.size() << " copies, " << gpu.index_count / 3
+                  << " triangles each" << std::endl;
+    }
+
+    // Still mode: once the camera has rested for still_delay seconds the job
+    // system ray-traces the view with shadows and ambient occlusion, and the
+    // tiles fade in over the raster frame as they refine. Any change of the
+    // view drops them at once. Static single views only (the tracer sees the
+    // rest pose of one copy).
+    std::unique_ptr<gx::ProgressiveTracer> tracer;
+    gx::TileOverlay still_overlay;
+    if (!splat_mode && !deformer && instance_offsets.empty() && stereo == StereoMode::Off && opt.still) {
+        gx::TraceOptions trace_opt;
+        trace_opt.max_samples = opt.still_samples;
+        tracer = std::make_unique<gx::ProgressiveTracer>(startup.mesh.vertex_data(), startup.mesh.index_data(),
+                                                         startup.mesh.index_count(), ranges,
+                                                         with_default_material(startup.mesh.mesh.materials),
+                                                         state.radius, trace_opt);
+        still_overlay = gx::create_tile_overlay();
+        std::cout << "still mode: ray-traced after " << opt.still_delay << " s without input, " << opt.still_samples
+                  << " samples" << std::endl;
+    }
+    std::array<float, 8> still_view = {};
+    auto last_input = std::chrono::steady_clock::now();
+    bool still_active = false, still_reported = false, bvh_reported = false;
+    std::vector<gx::TraceTile> still_tiles;
+
+    auto &registry = metrics::Registry::instance();
+    metrics::Histogram *pass_cpu_seconds[kPassModes], *pass_gpu_seconds[kPassModes];
+    const char *pass_labels[kPassModes] = {R"(mode="stereo_single_pass")", R"(mode="stereo_two_pass")",
+                                           R"(mode="impostors")", R"(mode="meshes_only")"};
+    for (int i = 0; i < kPassModes; ++i) {
+        pass_cpu_seconds[i] = &registry.histogram("gx_pass_submit_seconds", "CPU time to record and submit the scene pass",
+                                                  metrics::frame_time_buckets(), pass_labels[i]);
+        pass_gpu_seconds[i] = &registry.histogram("gx_pass_gpu_seconds", "GPU time of the scene pass",
+                                                  metrics::frame_time_buckets(), pass_labels[i]);
+    }
+    metrics::Counter &still_rays = registry.counter("gx_still_rays_total", "Rays traced for still frames");
+    metrics::Histogram &still_seconds =
+        registry.histogram("gx_still_seconds", "Time to trace a still frame to the last sample",
+                           {0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0});
+    // Logs a still when it has converged, or counts its rays when it was cut short
+    const auto finish_still = [&](bool cancelled) {
+        const gx::TraceProgress p = tracer->progress();
+        if (!bvh_reported && p.bvh_ready) {
+            std::cout << "still mode: BVH of " << startup.mesh.index_count() / 3 << " triangles, " << p.bvh_nodes
+                      << " nodes, built in " << p.bvh_ms << " ms" << std::endl;
+            bvh_reported = true;
+        }
+        if (still_reported || (!cancelled && !p.converged)) return;
+        still_rays.inc(p.rays);
+        still_reported = true;
+        if (cancelled) return;
+        still_seconds.observe(p.ms / 1e3);
+        std::cout << "still: " << p.samples << " samples in " << p.ms << " ms, "
+                  << (p.ms > 0.0 ? static_cast<double>(p.rays) / (p.ms * 1e3) : 0.0) << " M rays/s ("
+                  << jobs::JobSystem::instance().concurrency() << " threads)" << std::endl;
+    };
+    metrics::Gauge &impostor_count =
+        registry.gauge("gx_impostor_instances", "Copies drawn as impostors in the last frame (--instances)");
+    metrics::Histogram &frame_seconds =
+        registry.histogram("gx_frame_seconds", "Interval between presented frames", metrics::frame_time_buckets());
+    metrics::Counter &frames = registry.counter("gx_frames_total", "Presented frames");
+    metrics::Gauge &first_frame_seconds =
+        registry.gauge("gx_time_to_first_frame_seconds", "Process start to first presented frame");
+    metrics::Gauge &culled_ratio =
+        registry.gauge("gx_occlusion_culled_ratio", "Fraction of mesh parts culled in the last frame");
+    metrics::Histogram &cull_seconds = registry.histogram(
+        "gx_occlusion_seconds", "Occluder rasterization plus part tests per frame", metrics::frame_time_buckets());
+    metrics::Histogram &frame_wait_seconds = registry.histogram(
+        "gx_frame_wait_seconds", "CPU wait for the GPU to release a frame slot", metrics::frame_time_buckets());
+    auto last_swap = std::chrono::steady_clock::now();
+    auto last_title = last_swap;
+
+    // At most frames_in_flight frames are queued; each frame starts by waiting
+    // for the one that used its slot, then may overwrite that frame's buffers
+    auto ring = std::make_unique<gx::FrameRing>(opt.frames_in_flight);
+    const GLint loc_modelview = glGetUniformLocation(program, "u_modelview");
+    const GLint loc_proj = glGetUniformLocation(program, "u_proj");
+    const GLint loc_viewport = glGetUniformLocation(program, "u_viewport");
 
     while (!glfwWindowShouldClose(window)) {
+        TRACE_SCOPE("frame");
+        ALLOC_PHASE("frame_loop");
+        frame_wait_seconds.observe(ring->begin_frame() / 1e3);
+        tracing::Scope input_scope("input");
         glfwPollEvents();
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
             glfwSetWindowShouldClose(window, GLFW_TRUE);
@@ -370,8 +836,8 @@ void main() {
         if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) state.pan_x += pan_step;
         if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) state.pan_y += pan_step;
         if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) state.pan_y -= pan_step;
-        if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) state.distance = std::clamp(state.distance * 0.99f, 0.5f, 50.0f);
-        if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) state.distance = std::clamp(state.distance * 1.01f, 0.5f, 50.0f);
+        if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) state.distance = std::clamp(state.distance * 0.99f, state.min_distance, state.max_distance);
+        if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) state.distance = std::clamp(state.distance * 1.01f, state.min_distance, state.max_distance);
 
         if (glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_KP_ADD) == GLFW_PRESS)
             state.model_scale = std::clamp(state.model_scale * 1.01f, 0.05f, 20.0f);
@@ -379,35 +845,252 @@ void main() {
             state.model_scale = std::clamp(state.model_scale * 0.99f, 0.05f, 20.0f);
 
         if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
-            state = InteractionState{};
+            state = home;
+        }
+        const bool toggle = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+        if (toggle && !toggle_down && stereo != StereoMode::Off && stereo_program) {
+            report_pass();
+            stereo = stereo == StereoMode::SinglePass ? StereoMode::TwoPass : StereoMode::SinglePass;
+            start_pass();
         }
+        toggle_down = toggle;
+        const bool impostor_toggle = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+        if (impostor_toggle && !impostor_toggle_down && impostors.program) {
+            report_pass();
+            impostors_on = !impostors_on;
+            start_pass();
+        }
+        impostor_toggle_down = impostor_toggle;
+
+        if (deformer) {
+            gx::DeformParams &d = state.deform;
+            d.morph_weights.resize(1);
+            const float step = 0.02f;
+            if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) d.twist -= step;
+            if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS) d.twist += step;
+            if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS) d.bend = std::clamp(d.bend - step, -1.5f, 1.5f);
+            if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS) d.bend = std::clamp(d.bend + step, -1.5f, 1.5f);
+            if (glfwGetKey(window, GLFW_KEY_5) == GLFW_PRESS) d.morph_weights[0] = std::max(d.morph_weights[0] - step, 0.0f);
+            if (glfwGetKey(window, GLFW_KEY_6) == GLFW_PRESS) d.morph_weights[0] = std::min(d.morph_weights[0] + step, 1.0f);
+            if (d.twist != applied.twist || d.bend != applied.bend || d.morph_weights != applied.morph_weights) {
+                const auto &ranges = deformer->update(d, startup.mesh.interleaved);
+                upload_bytes.inc(gx::update_dynamic_mesh(dynamic, *ring, startup.mesh.interleaved, ranges));
+                applied = d;
+            }
+        }
+
+        input_scope.end();
 
+        tracing::Scope draw_scope("draw");
         int width, height;
         glfwGetFramebufferSize(window, &width, &height);
         float aspect = (height == 0) ? 1.0f : static_cast<float>(width) / static_cast<float>(height);
-        auto [mvp, model] = compute_matrices(state, aspect);
+        FrameMatrices m = compute_matrices(state, aspect);
+
+        // Still mode: a view unchanged for still_delay starts the tracer, the
+        // next change cancels it
+        if (tracer) {
+            const std::array<float, 8> view = {state.yaw,    state.pitch,    state.pan_x,
+                                               state.pan_y,  state.distance, state.model_scale,
+                                               static_cast<float>(width), static_cast<float>(height)};
+            const auto now = std::chrono::steady_clock::now();
+            if (view != still_view || state.rotating || state.panning) {
+                still_view = view;
+                last_input = now;
+                if (still_active) {
+                    finish_still(true);
+                    tracer->cancel();
+                    still_active = false;
+                }
+            } else if (!still_active && width > 0 && height > 0 &&
+                       std::chrono::duration<float>(now - last_input).count() >= opt.still_delay) {
+                tracer->start({m.model, m.modelview, m.proj, width, height});
+                gx::clear_tile_overlay(still_overlay, width, height);
+                still_active = true;
+                still_reported = false;
+            }
+            if (still_active) {
+                still_tiles.clear();
+                if (tracer->take(still_tiles)) gx::update_tile_overlay(still_overlay, still_tiles);
+                finish_still(false);
+            }
+        }
 
         glViewport(0, 0, width, height);
         glClearColor(0.07f, 0.08f, 0.10f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(program);
-        GLint loc_mvp = glGetUniformLocation(program, "u_mvp");
-        GLint loc_model = glGetUniformLocation(program, "u_model");
-        glUniformMatrix4fv(loc_mvp, 1, GL_FALSE, mvp.m);
-        glUniformMatrix4fv(loc_model, 1, GL_FALSE, model.m);
-
-        glBindVertexArray(vao);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_INT, nullptr);
-        glBindVertexArray(0);
+        if (sorter) {
+            glUseProgram(program);
+            // Sort for the current view; draw with the newest finished order
+            const float row[4] = {m.modelview.m[2], m.modelview.m[6], m.modelview.m[10], m.modelview.m[14]};
+            if (!std::equal(row, row + 4, sort_row)) {
+                std::copy(row, row + 4, sort_row);
+                sorter->request(row);
+            }
+            if (sorter->take(splat_order)) gx::update_splat_order(gpu_splats, *ring, splat_order);
+            glUniformMatrix4fv(loc_modelview, 1, GL_FALSE, m.modelview.m);
+            glUniformMatrix4fv(loc_proj, 1, GL_FALSE, m.proj.m);
+            glUniform2f(loc_viewport, static_cast<float>(width), static_cast<float>(height));
+            gx::draw_splats(gpu_splats, program);
+        } else {
+            // Stereo: each eye gets half the window; a part is drawn when
+            // either eye sees it
+            const int half_width = width / 2;
+            const int eye_count = stereo == StereoMode::Off ? 1 : 2;
+            std::array<FrameMatrices, 2> eyes;
+            if (eye_count == 2) {
+                eyes = compute_eye_matrices(state, height == 0 ? 1.0f : static_cast<float>(half_width) / height,
+                                            opt.eye_separation);
+            }
+            if (culler) {
+                std::fill(part_visible.begin(), part_visible.end(), 0);
+                double ms = 0.0;
+                for (int e = 0; e < eye_count; ++e) {
+                    for (uint32_t p : culler->cull(eye_count == 1 ? m.mvp : eyes[e].mvp)) part_visible[p] = 1;
+                    ms += culler->stats().raster_ms + culler->stats().test_ms;
+                }
+                const size_t visible = static_cast<size_t>(std::count(part_visible.begin(), part_visible.end(), 1));
+                culled_ratio.set(1.0 - static_cast<double>(visible) / static_cast<double>(part_visible.size()));
+                cull_seconds.observe(ms / 1e3);
+            }
+            const auto t_submit = std::chrono::steady_clock::now();
+            if (pass_timer) pass_timer->begin();
+            const GLuint vao = deformer ? dynamic.vao[dynamic.current] : gpu.vao;
+            // --instances: copies whose center is beyond the impostor distance
+            // (model space) are drawn as impostors, the rest as instanced meshes
+            uint32_t mesh_instances = 1;
+            size_t impostor_instances = 0;
+            gx::Vec3 camera;
+            if (!instance_offsets.empty()) {
+                camera = gx::eye_in_model(m.modelview);
+                const float far = opt.impostor_distance * state.radius;
+                frame_offsets.clear();
+                far_offsets.clear();
+                for (const gx::Vec3 &o : instance_offsets) {
+                    const gx::Vec3 d = state.center + o - camera;
+                    (impostors_on && gx::dot(d, d) > far * far ? far_offsets : frame_offsets).push_back(o);
+                }
+                mesh_instances = static_cast<uint32_t>(frame_offsets.size());
+                impostor_instances = far_offsets.size();
+                frame_offsets.insert(frame_offsets.end(), far_offsets.begin(), far_offsets.end());
+                const size_t base = gx::update_instances(gpu_instances, *ring, frame_offsets);
+                gx::bind_instance_offsets(gpu.vao, 2, gpu_instances, base);
+                gx::bind_instance_offsets(gpu_instances.vao, 0, gpu_instances, base + mesh_instances * sizeof(gx::Vec3));
+                impostor_count.set(static_cast<double>(impostor_instances));
+                pass_triangles += static_cast<double>(mesh_instances) * (gpu.index_count / 3) + 2.0 * impostor_instances;
+            }
+            if (stereo == StereoMode::SinglePass) {
+                if (viewport_array) {
+                    glViewportIndexedf(0, 0.0f, 0.0f, static_cast<float>(half_width), static_cast<float>(height));
+                    glViewportIndexedf(1, static_cast<float>(half_width), 0.0f, static_cast<float>(width - half_width),
+                                       static_cast<float>(height));
+                } else {
+                    glEnable(GL_CLIP_DISTANCE0);
+                }
+                commands.clear();
+                commands.use_program(stereo_program);
+                commands.bind_vertex_array(vao);
+                commands.uniform_matrix4(loc_eye_mvp[0], eyes[0].mvp.m);
+                commands.uniform_matrix4(loc_eye_mvp[1], eyes[1].mvp.m);
+                commands.uniform_matrix4(loc_stereo_model, m.model.m);
+                record_ranges(loc_stereo_material, 2);
+                gx::replay(commands);
+                if (!viewport_array) glDisable(GL_CLIP_DISTANCE0);
+            } else {
+                for (int e = 0; e < eye_count; ++e) {
+                    if (eye_count == 2) glViewport(e == 0 ? 0 : half_width, 0, e == 0 ? half_width : width - half_width, height);
+                    commands.clear();
+                    commands.use_program(program);
+                    commands.bind_vertex_array(vao);
+                    commands.uniform_matrix4(loc_mvp, eye_count == 1 ? m.mvp.m : eyes[e].mvp.m);
+                    commands.uniform_matrix4(loc_model, m.model.m);
+                    if (mesh_instances) record_ranges(loc_material, mesh_instances);
+                    gx::replay(commands);
+                }
+                gx::draw_impostors(impostors, gpu_instances, static_cast<GLsizei>(impostor_instances), m.mvp, m.model,
+                                   camera);
+            }
+            glBindVertexArray(0);
+            if (pass_timer) {
+                pass_timer->end();
+                const int mode = pass_mode();
+                const double cpu_ms =
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_submit).count();
+                pass_cpu_ms += cpu_ms;
+                ++pass_cpu_frames;
+                pass_cpu_seconds[mode]->observe(cpu_ms / 1e3);
+                for (double gpu_ms; pass_timer->poll(gpu_ms);) {
+                    pass_gpu_ms += gpu_ms;
+                    ++pass_gpu_frames;
+                    pass_gpu_seconds[mode]->observe(gpu_ms / 1e3);
+                }
+            }
+            if (still_active) gx::draw_tile_overlay(still_overlay);
+        }
+        draw_scope.end();
 
+        TRACE_SCOPE("swap_buffers");
         glfwSwapBuffers(window);
+        ring->end_frame();
+        const auto now = std::chrono::steady_clock::now();
+        frames.inc();
+        if (first_frame) {
+            first_frame = false;
+            double ms = std::chrono::duration<double, std::milli>(now - start_time).count();
+            first_frame_seconds.set(ms / 1e3);
+            std::cout << "time to first frame: " << ms << " ms (" << (sequential ? "sequential" : "overlapped")
+                      << " startup, " << ring->frames() << " frames in flight)" << std::endl;
+        } else {
+            frame_seconds.observe(std::chrono::duration<double>(now - last_swap).count());
+        }
+        last_swap = now;
+        if ((culler || pass_timer || tracer) && now - last_title > std::chrono::milliseconds(250)) {
+            std::string title = "OBJ Preview";
+            char buf[160];
+            if (still_active) {
+                const gx::TraceProgress p = tracer->progress();
+                std::snprintf(buf, sizeof(buf), " - still: %u/%u samples", p.samples, opt.still_samples);
+                title += buf;
+            }
+            if (pass_timer && pass_cpu_frames) {
+                std::snprintf(buf, sizeof(buf), " - %s: %.2f ms CPU, %.2f ms GPU", pass_name(pass_mode()).c_str(),
+                              pass_cpu_ms / pass_cpu_frames, pass_gpu_frames ? pass_gpu_ms / pass_gpu_frames : 0.0);
+                title += buf;
+            }
+            if (culler) {
+                const gx::OcclusionStats &cs = culler->stats();
+                const size_t visible = static_cast<size_t>(std::count(part_visible.begin(), part_visible.end(), 1));
+                std::snprintf(buf, sizeof(buf), " - %zu/%zu parts (%.0f%% culled, %.2f ms raster + %.2f ms test)", visible,
+                              cs.parts, (1.0 - static_cast<double>(visible) / static_cast<double>(cs.parts)) * 100.0,
+                              cs.raster_ms, cs.test_ms);
+                title += buf;
+            }
+            glfwSetWindowTitle(window, title.c_str());
+            last_title = now;
+        }
     }
 
+    report_pass();
+    sorter.reset();
+    tracer.reset();
+    if (still_overlay.program) gx::destroy_tile_overlay(still_overlay);
+    pass_timer.reset();
+    ring.reset();
     glDeleteProgram(program);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
-    glDeleteVertexArrays(1, &vao);
+    if (stereo_program) glDeleteProgram(stereo_program);
+    if (!instance_offsets.empty()) {
+        gx::destroy_impostors(impostors);
+        gx::destroy_instances(gpu_instances);
+    }
+    if (splat_mode) {
+        gx::destroy_splats(gpu_splats);
+    } else if (deformer) {
+        gx::destroy_dynamic_mesh(dynamic);
+    } else {
+        gx::destroy_mesh(gpu);
+    }
+    if (!splat_mode) gx::destroy_materials(startup.materials);
 
     glfwDestroyWindow(window);
     glfwTerminate();
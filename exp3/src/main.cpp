@@ -1,47 +1,33 @@
 #include <GL/glut.h>
 
+#include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <iostream>
 #include <vector>
 
-struct Vec3 {
-    float x, y, z;
-    Vec3() : x(0), y(0), z(0) {}
-    Vec3(float X, float Y, float Z) : x(X), y(Y), z(Z) {}
+#define ALLOC_TRACKER_IMPLEMENTATION
+#include "alloc_tracker.h"
+#include "job_system.h"
+#include "math3d.h"
+#include "metrics.h"
+#include "page_alloc.h"
+#include "perf_counters.h"
+#include "ray.h"
+#include "trace.h"
+
+using gx::cross;
+using gx::dot;
+using gx::length;
+using gx::normalize;
+using gx::Ray;
+using gx::Vec3;
 
-    Vec3 operator+(const Vec3 &o) const { return Vec3(x + o.x, y + o.y, z + o.z); }
-    Vec3 operator-(const Vec3 &o) const { return Vec3(x - o.x, y - o.y, z - o.z); }
-    Vec3 operator*(float s) const { return Vec3(x * s, y * s, z * s); }
-    Vec3 operator/(float s) const { return Vec3(x / s, y / s, z / s); }
-};
-
-static Vec3 operator*(float s, const Vec3 &v) { return Vec3(v.x * s, v.y * s, v.z * s); }
-
-static float dot(const Vec3 &a, const Vec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
-static Vec3 cross(const Vec3 &a, const Vec3 &b) {
-    return Vec3(
-        a.y * b.z - a.z * b.y,
-        a.z * b.x - a.x * b.z,
-        a.x * b.y - a.y * b.x);
-}
-static Vec3 normalize(const Vec3 &v) {
-    float len2 = dot(v, v);
-    if (len2 <= 1e-8f) return Vec3(0, 0, 0);
-    float inv = 1.0f / std::sqrt(len2);
-    return v * inv;
-}
-static float length(const Vec3 &v) { return std::sqrt(dot(v, v)); }
 static Vec3 clamp01(const Vec3 &v) {
     auto c = [](float x) { return x < 0 ? 0.f : (x > 1.f ? 1.f : x); };
     return Vec3(c(v.x), c(v.y), c(v.z));
 }
 
-struct Ray {
-    Vec3 o; // origin
-    Vec3 d; // direction (normalized)
-};
-
 struct Sphere {
     Vec3 center;
     float radius;
@@ -68,7 +54,24 @@ static Vec3 g_lightPos(2.5f, 3.0f, 6.0f); // 光源位置
 // 场景数据
 static std::vector<Sphere> g_spheres;
 static std::vector<Plane> g_planes;
-static std::vector<unsigned char> g_colorBuffer; // RGB buffer
+static pages::Vector<unsigned char> g_colorBuffer; // RGB buffer
+
+// Exported when METRICS_PORT is set. Rays are counted per thread and added to
+// the shared counter once per band of rows.
+static metrics::Registry &g_registry = metrics::Registry::instance();
+static metrics::Histogram &g_frameSeconds =
+    g_registry.histogram("gx_frame_seconds", "Render and present time per frame", metrics::frame_time_buckets());
+static metrics::Counter &g_raysTotal = g_registry.counter("gx_rays_total", "Rays traced (primary, shadow, reflection)");
+static metrics::Gauge &g_raysPerSecond = g_registry.gauge("gx_rays_per_second", "Rays traced per second in the last frame");
+static metrics::Gauge &g_cpuBytes = g_registry.gauge("gx_memory_bytes", "Estimated frame memory", R"(where="cpu")");
+static metrics::Gauge &g_gpuBytes = g_registry.gauge("gx_memory_bytes", "Estimated frame memory", R"(where="gpu")");
+static thread_local uint64_t t_rays = 0;
+
+// CPU: the RGB image; GPU: double-buffered RGBA8 color plus 32-bit depth
+static void update_memory_metrics() {
+    g_cpuBytes.set(static_cast<double>(g_colorBuffer.capacity()));
+    g_gpuBytes.set(static_cast<double>(g_width) * g_height * (2 * 4 + 4));
+}
 
 static void init_scene() {
     // 两个球：红、蓝
@@ -91,33 +94,18 @@ static void init_scene() {
     g_planes.push_back(Plane{Vec3(1, 0, 0), 0.0f, Vec3(1.0f, 1.0f, 1.0f)});
 
     g_colorBuffer.resize(g_width * g_height * 3);
+    update_memory_metrics();
+    g_registry.gauge("gx_scene_primitives", "Spheres and planes in the scene")
+        .set(static_cast<double>(g_spheres.size() + g_planes.size()));
 }
 
 static bool intersect_sphere(const Ray &ray, const Sphere &s, float &t, Vec3 &normal) {
-    Vec3 oc = ray.o - s.center;
-    float a = dot(ray.d, ray.d);
-    float b = 2.0f * dot(oc, ray.d);
-    float c = dot(oc, oc) - s.radius * s.radius;
-    float disc = b * b - 4 * a * c;
-    if (disc < 0.0f) return false;
-    float sqrt_disc = std::sqrt(disc);
-    float t0 = (-b - sqrt_disc) / (2 * a);
-    float t1 = (-b + sqrt_disc) / (2 * a);
-    float t_hit = t0;
-    if (t_hit < 1e-4f) t_hit = t1;
-    if (t_hit < 1e-4f) return false;
-    t = t_hit;
-    Vec3 hitPoint = ray.o + ray.d * t;
-    normal = normalize(hitPoint - s.center);
-    return true;
+    return gx::intersect_sphere(ray, s.center, s.radius, t, normal);
 }
 
 static bool intersect_plane(const Ray &ray, const Plane &pl, float &t, Vec3 &normal) {
-    float denom = dot(pl.n, ray.d);
-    if (std::fabs(denom) < 1e-6f) return false; // 平行
-    float num = -(dot(pl.n, ray.o) + pl.d);
-    float t_hit = num / denom;
-    if (t_hit < 1e-4f) return false;
+    float t_hit;
+    if (!gx::intersect_plane(ray, pl.n, pl.d, t_hit)) return false;
 
     Vec3 hitPoint = ray.o + ray.d * t_hit;
     // 房间限制：只保留盒子内部
@@ -137,6 +125,7 @@ static const int kMaxDepth = 2;
 // 简单光照：Lambert 漫反射 + 阴影（硬阴影）+ 高光
 static Vec3 shade(const Vec3 &hitPoint, const Vec3 &normal, const Vec3 &baseColor, const Vec3 &viewDir) {
     Vec3 L = normalize(g_lightPos - hitPoint);
+    ++t_rays;
     float lightDist = length(g_lightPos - hitPoint);
 
     // 阴影测试：从 hitPoint 沿 L 发一条光线，看是否被其它物体挡住
@@ -185,6 +174,7 @@ static Vec3 trace(const Ray &ray, int depth);
 static Vec3 trace(const Ray &ray) { return trace(ray, 0); }
 
 static Vec3 trace(const Ray &ray, int depth) {
+    ++t_rays;
     float tMin = 1e30f;
     Vec3 hitNormal;
     Vec3 hitColor(0, 0, 0);
@@ -242,7 +232,9 @@ static Vec3 trace(const Ray &ray, int depth) {
     return clamp01(localColor);
 }
 
-static void render_scene() {
+// Returns the number of rays traced.
+static uint64_t render_scene() {
+    TRACE_SCOPE("render_scene");
     // 简单固定相机：根据 g_camPos 和 g_camLook 构造视图平面
     Vec3 forward = normalize(g_camLook - g_camPos);
     Vec3 worldUp(0, 1, 0);
@@ -254,40 +246,61 @@ static void render_scene() {
     }
     Vec3 up = normalize(cross(right, forward));
 
-    float fov = 45.0f * 3.1415926f / 180.0f;
+    float fov = 45.0f * gx::kPi / 180.0f;
     float aspect = static_cast<float>(g_width) / static_cast<float>(g_height);
     float scale = std::tan(fov * 0.5f);
 
-    for (int y = 0; y < g_height; ++y) {
-        for (int x = 0; x < g_width; ++x) {
-            float u = (2.0f * ((x + 0.5f) / g_width) - 1.0f) * aspect * scale;
-            float v = (2.0f * ((y + 0.5f) / g_height) - 1.0f) * scale;
-
-            Vec3 dir = normalize(forward + u * right + v * up);
-            Ray ray;
-            ray.o = g_camPos;
-            ray.d = dir;
-
-            Vec3 col = trace(ray);
-            col = clamp01(col);
-            int idx = (y * g_width + x) * 3;
-            g_colorBuffer[idx + 0] = static_cast<unsigned char>(col.x * 255.0f);
-            g_colorBuffer[idx + 1] = static_cast<unsigned char>(col.y * 255.0f);
-            g_colorBuffer[idx + 2] = static_cast<unsigned char>(col.z * 255.0f);
+    // Rows are independent; hand out bands of rows to the job system
+    const uint64_t rays_before = g_raysTotal.value();
+    jobs::parallel_for(0, static_cast<size_t>(g_height), 8, [&](size_t row_begin, size_t row_end) {
+        TRACE_SCOPE_ARG("render_tile", "row", static_cast<int64_t>(row_begin));
+        PERF_SCOPE("render_tile");
+        t_rays = 0;
+        for (int y = static_cast<int>(row_begin); y < static_cast<int>(row_end); ++y) {
+            for (int x = 0; x < g_width; ++x) {
+                float u = (2.0f * ((x + 0.5f) / g_width) - 1.0f) * aspect * scale;
+                float v = (2.0f * ((y + 0.5f) / g_height) - 1.0f) * scale;
+
+                Vec3 dir = normalize(forward + u * right + v * up);
+                Ray ray;
+                ray.o = g_camPos;
+                ray.d = dir;
+
+                Vec3 col = trace(ray);
+                col = clamp01(col);
+                int idx = (y * g_width + x) * 3;
+                g_colorBuffer[idx + 0] = static_cast<unsigned char>(col.x * 255.0f);
+                g_colorBuffer[idx + 1] = static_cast<unsigned char>(col.y * 255.0f);
+                g_colorBuffer[idx + 2] = static_cast<unsigned char>(col.z * 255.0f);
+            }
         }
-    }
+        g_raysTotal.inc(t_rays);
+    });
+    return g_raysTotal.value() - rays_before;
 }
 
 static void display_cb() {
-    render_scene();
-
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glDisable(GL_DEPTH_TEST);
-
-    glRasterPos2f(-1.f, -1.f);
-    glDrawPixels(g_width, g_height, GL_RGB, GL_UNSIGNED_BYTE, g_colorBuffer.data());
+    TRACE_SCOPE("frame");
+    ALLOC_PHASE("frame");
+    const auto t0 = std::chrono::steady_clock::now();
+    const uint64_t rays = render_scene();
+    const double render_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (render_seconds > 0.0) g_raysPerSecond.set(static_cast<double>(rays) / render_seconds);
+
+    {
+        TRACE_SCOPE("draw_pixels");
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDisable(GL_DEPTH_TEST);
+
+        glRasterPos2f(-1.f, -1.f);
+        glDrawPixels(g_width, g_height, GL_RGB, GL_UNSIGNED_BYTE, g_colorBuffer.data());
+    }
 
-    glutSwapBuffers();
+    {
+        TRACE_SCOPE("swap_buffers");
+        glutSwapBuffers();
+    }
+    g_frameSeconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
 }
 
 static void reshape_cb(int w, int h) {
@@ -295,6 +308,7 @@ static void reshape_cb(int w, int h) {
     g_width = w;
     g_height = h;
     g_colorBuffer.resize(g_width * g_height * 3);
+    update_memory_metrics();
     glViewport(0, 0, w, h);
     glutPostRedisplay();
 }
@@ -332,14 +346,38 @@ static void keyboard_cb(unsigned char key, int /*x*/, int /*y*/) {
 }
 
 int main(int argc, char **argv) {
+    tracing::init_from_env();
+    perf::init_from_env();
+    metrics::init_from_env();
+    alloc::init();
+    TRACE_THREAD_NAME("main");
+    auto t0 = std::chrono::steady_clock::now();
+    tracing::Scope gl_init_scope("gl_init");
     glutInit(&argc, argv);
+    // What GLUT left over: --huge-pages / --prefault (page_alloc.h)
+    for (int i = 1; i < argc; ++i) pages::parse_flag(argv[i]);
+    if (const pages::Policy &p = pages::init_from_env(); p.huge || p.prefault) {
+        std::cout << "pages: " << pages::describe() << std::endl;
+    }
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     glutInitWindowSize(g_width, g_height);
     glutCreateWindow("Ray Tracing Room (WASDQE move , IJKLUO move light, ESC exit)");
 
     glClearColor(0.f, 0.f, 0.f, 1.f);
 
-    init_scene();
+    gl_init_scope.end();
+    auto seconds_since = [](std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+    };
+    g_registry.gauge("gx_load_seconds", "Startup stage wall time", R"(stage="gl_init")").set(seconds_since(t0));
+
+    t0 = std::chrono::steady_clock::now();
+    {
+        TRACE_SCOPE("init_scene");
+        ALLOC_PHASE("init_scene");
+        init_scene();
+    }
+    g_registry.gauge("gx_load_seconds", "Startup stage wall time", R"(stage="init_scene")").set(seconds_since(t0));
 
     glutDisplayFunc(display_cb);
     glutReshapeFunc(reshape_cb);
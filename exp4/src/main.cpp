@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gaussian_ply.h"
+#include "page_alloc.h"
+#include "splat_lod.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static void print_usage() {
+    std::cout << "Usage:\n"
+              << "  splat_lod build <input.ply> <output.lod> [--leaf N]\n"
+              << "  splat_lod cut <input.lod> <output.ply> [camera options]\n"
+              << "  splat_lod orbit <input.lod> [--frames N] [camera options]\n"
+              << "  splat_lod synth <output.ply> <count>\n"
+              << "Camera options:\n"
+              << "  --eye X Y Z  --target X Y Z  --fov DEG  --size W H\n"
+              << "  --error PX   screen-space error threshold (default 1)\n"
+              << "  --budget N   maximum splats per frame (default 2000000)\n"
+              << "Memory options (also GX_HUGE_PAGES=1, GX_PREFAULT=1):\n"
+              << "  --huge-pages 2 MB pages for the splat and node arrays\n"
+              << "  --prefault   populate those arrays in parallel when they are allocated\n";
+}
+
+struct CameraArgs {
+    float eye[3] = {0.0f, 0.0f, 5.0f};
+    float target[3] = {0.0f, 0.0f, 0.0f};
+    float fov_deg = 60.0f;
+    int width = 1280;
+    int height = 720;
+    int frames = 120;
+    uint32_t leaf = 16;
+    splat::CutOptions cut;
+};
+
+// Parses the shared options; returns false on an unknown flag.
+static bool parse_options(int argc, char **argv, int first, CameraArgs &a) {
+    for (int i = first; i < argc; ++i) {
+        std::string opt = argv[i];
+        auto need = [&](int n) { return i + n < argc; };
+        if (opt == "--eye" && need(3)) {
+            for (int k = 0; k < 3; ++k) a.eye[k] = std::strtof(argv[++i], nullptr);
+        } else if (opt == "--target" && need(3)) {
+            for (int k = 0; k < 3; ++k) a.target[k] = std::strtof(argv[++i], nullptr);
+        } else if (opt == "--fov" && need(1)) {
+            a.fov_deg = std::strtof(argv[++i], nullptr);
+        } else if (opt == "--size" && need(2)) {
+            a.width = std::atoi(argv[++i]);
+            a.height = std::atoi(argv[++i]);
+        } else if (opt == "--error" && need(1)) {
+            a.cut.error_px = std::strtof(argv[++i], nullptr);
+        } else if (opt == "--budget" && need(1)) {
+            a.cut.budget = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (opt == "--frames" && need(1)) {
+            a.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (opt == "--leaf" && need(1)) {
+            a.leaf = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (pages::parse_flag(opt)) {
+            // --huge-pages / --prefault
+        } else {
+            std::cerr << "Unknown or incomplete option: " << opt << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_cut_stats(const splat::CutStats &st, size_t total, double ms) {
+    std::cout << "cut: " << (st.aggregates + st.originals) << " splats ("
+              << st.aggregates << " aggregate, " << st.originals << " original) of " << total
+              << ", visited " << st.nodes_visited << " nodes, culled " << st.nodes_culled
+              << ", max error " << st.max_error_px << " px"
+              << (st.budget_limited ? ", budget limited" : "")
+              << ", " << ms << " ms" << std::endl;
+}
+
+static int cmd_build(int argc, char **argv) {
+    if (argc < 4) {
+        print_usage();
+        return 1;
+    }
+    CameraArgs args;
+    if (!parse_options(argc, argv, 4, args)) return 1;
+
+    splat::SplatCloud cloud;
+    std::string err;
+    auto t0 = Clock::now();
+    if (!splat::LoadPly(cloud, argv[2], err)) {
+        std::cerr << "Failed to load PLY: " << err << std::endl;
+        return 1;
+    }
+    std::cout << "loaded " << cloud.size() << " splats in " << ms_since(t0) << " ms" << std::endl;
+
+    splat::BuildOptions opt;
+    opt.max_leaf_splats = args.leaf;
+    splat::SplatLod lod;
+    t0 = Clock::now();
+    if (!splat::BuildLod(cloud, lod, opt, err)) {
+        std::cerr << "Failed to build LOD: " << err << std::endl;
+        return 1;
+    }
+    std::cout << "built " << lod.nodes.size() << " nodes in " << ms_since(t0) << " ms" << std::endl;
+
+    if (!splat::SaveLod(lod, argv[3], err)) {
+        std::cerr << "Failed to save LOD: " << err << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+static int cmd_cut(int argc, char **argv) {
+    if (argc < 4) {
+        print_usage();
+        return 1;
+    }
+    CameraArgs args;
+    if (!parse_options(argc, argv, 4, args)) return 1;
+
+    splat::SplatLod lod;
+    std::string err;
+    if (!splat::LoadLod(lod, argv[2], err)) {
+        std::cerr << "Failed to load LOD: " << err << std::endl;
+        return 1;
+    }
+
+    splat::CutCamera cam = splat::MakeCutCamera(args.eye, args.target, args.fov_deg * 3.1415926f / 180.0f,
+                                                args.width, args.height);
+    std::vector<uint32_t> cut;
+    splat::CutStats st;
+    auto t0 = Clock::now();
+    splat::SelectCut(lod, cam, args.cut, cut, &st);
+    print_cut_stats(st, lod.splats.size(), ms_since(t0));
+
+    splat::SplatCloud out;
+    splat::GatherCut(lod, cut, out);
+    if (!splat::SavePly(out, argv[3], err)) {
+        std::cerr << "Failed to save PLY: " << err << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Flies the camera around the target and reports per-frame cut cost, which
+// stays bounded by the budget rather than by the capture size.
+static int cmd_orbit(int argc, char **argv) {
+    if (argc < 3) {
+        print_usage();
+        return 1;
+    }
+    CameraArgs args;
+    if (!parse_options(argc, argv, 3, args)) return 1;
+
+    splat::SplatLod lod;
+    std::string err;
+    if (!splat::LoadLod(lod, argv[2], err)) {
+        std::cerr << "Failed to load LOD: " << err << std::endl;
+        return 1;
+    }
+
+    float dx = args.eye[0] - args.target[0];
+    float dz = args.eye[2] - args.target[2];
+    float radius = std::sqrt(dx * dx + dz * dz);
+    float phase = std::atan2(dz, dx);
+
+    std::vector<uint32_t> cut;
+    cut.reserve(args.cut.budget);
+    double total_ms = 0.0, worst_ms = 0.0;
+    size_t total_splats = 0, worst_splats = 0;
+    for (int f = 0; f < args.frames; ++f) {
+        float a = phase + 6.2831853f * static_cast<float>(f) / static_cast<float>(args.frames);
+        float eye[3] = {args.target[0] + radius * std::cos(a), args.eye[1], args.target[2] + radius * std::sin(a)};
+        splat::CutCamera cam = splat::MakeCutCamera(eye, args.target, args.fov_deg * 3.1415926f / 180.0f,
+                                                    args.width, args.height);
+        splat::CutStats st;
+        auto t0 = Clock::now();
+        splat::SelectCut(lod, cam, args.cut, cut, &st);
+        double ms = ms_since(t0);
+        total_ms += ms;
+        worst_ms = std::max(worst_ms, ms);
+        total_splats += cut.size();
+        worst_splats = std::max(worst_splats, cut.size());
+    }
+    std::cout << "orbit over " << args.frames << " frames: avg " << total_ms / args.frames << " ms, worst "
+              << worst_ms << " ms; avg " << total_splats / static_cast<size_t>(args.frames) << " splats, worst "
+              << worst_splats << " (budget " << args.cut.budget << ", capture " << lod.splats.size() << ")"
+              << std::endl;
+    return 0;
+}
+
+// Writes a random capture in the gaussian-splatting layout for testing.
+static int cmd_synth(int argc, char **argv) {
+    if (argc < 4) {
+        print_usage();
+        return 1;
+    }
+    size_t count = static_cast<size_t>(std::strtoull(argv[3], nullptr, 10));
+    splat::SplatCloud cloud;
+    cloud.properties = {"x", "y", "z", "nx", "ny", "nz", "f_dc_0", "f_dc_1", "f_dc_2", "opacity",
+                        "scale_0", "scale_1", "scale_2", "rot_0", "rot_1", "rot_2", "rot_3"};
+    cloud.data.resize(count * cloud.stride());
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+    for (size_t i = 0; i < count; ++i) {
+        float *s = cloud.splat(i);
+        // Points on a bumpy ground plane, like a street-level capture
+        float x = uni(rng) * 50.0f, z = uni(rng) * 50.0f;
+        float y = 0.5f * std::sin(x * 0.3f) * std::cos(z * 0.2f) + 0.05f * gauss(rng);
+        float v[] = {x, y, z, 0.0f, 0.0f, 0.0f, uni(rng), uni(rng), uni(rng), 2.0f + gauss(rng),
+                     -3.0f + 0.3f * gauss(rng), -3.0f + 0.3f * gauss(rng), -5.0f,
+                     1.0f, 0.1f * gauss(rng), 0.1f * gauss(rng), 0.1f * gauss(rng)};
+        std::copy(std::begin(v), std::end(v), s);
+    }
+
+    std::string err;
+    if (!splat::SavePly(cloud, argv[2], err)) {
+        std::cerr << "Failed to save PLY: " << err << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+    std::string cmd = argv[1];
+    pages::init_from_env();
+    if (cmd == "build") return cmd_build(argc, argv);
+    if (cmd == "cut") return cmd_cut(argc, argv);
+    if (cmd == "orbit") return cmd_orbit(argc, argv);
+    if (cmd == "synth") return cmd_synth(argc, argv);
+    print_usage();
+    return 1;
+}
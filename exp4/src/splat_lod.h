@@ -0,0 +1,678 @@
+#pragma once
+// Hierarchical level of detail for Gaussian splat captures.
+//
+// BuildLod sorts the splats along a Morton curve, splits them into an octree
+// and then merges Gaussians bottom-up: each leaf gets one aggregate splat that
+// moment-matches its original Gaussians, each interior node one aggregate of
+// its children's aggregates. SelectCut walks the tree at runtime and picks the
+// coarsest nodes whose projected size is below a pixel error, refining the
+// worst nodes first so that a fixed splat budget is never exceeded.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "gaussian_ply.h"
+
+namespace splat {
+
+struct LodNode {
+    float center[3];
+    float radius;          // bounds every splat of the subtree out to 3 sigma
+    uint32_t first_child;  // interior nodes: children are contiguous
+    uint32_t child_count;  // 0 for leaves
+    uint32_t first_splat;  // leaves: originals are contiguous in SplatLod::splats
+    uint32_t splat_count;
+};
+
+struct SplatLod {
+    SplatCloud splats;          // original splats, reordered so every leaf owns a range
+    SplatCloud aggregates;      // aggregates.splat(i) is the merged splat of nodes[i]
+    pages::Vector<LodNode> nodes; // nodes[0] is the root
+};
+
+struct BuildOptions {
+    uint32_t max_leaf_splats = 16;
+    uint32_t max_depth = 21;
+};
+
+// Cut entries: index into SplatLod::aggregates when kAggregateBit is set,
+// otherwise into SplatLod::splats.
+constexpr uint32_t kAggregateBit = 0x80000000u;
+
+struct CutCamera {
+    float eye[3];
+    float forward[3];
+    float planes[4][4]; // side planes, normals pointing inwards
+    float znear = 0.01f;
+    float focal_px = 1.0f; // pixels per unit at distance 1
+};
+
+struct CutOptions {
+    float error_px = 1.0f;        // refine nodes projecting larger than this
+    uint32_t budget = 2000000;    // never emit more splats than this
+    bool frustum_cull = true;
+};
+
+struct CutStats {
+    size_t nodes_visited = 0;
+    size_t nodes_culled = 0;
+    size_t aggregates = 0;
+    size_t originals = 0;
+    float max_error_px = 0.0f;    // largest error left in the cut
+    bool budget_limited = false;
+};
+
+namespace detail {
+
+using Mat3 = std::array<double, 9>; // row-major
+
+inline void quat_to_mat3(const float q_in[4], Mat3 &r) {
+    double w = q_in[0], x = q_in[1], y = q_in[2], z = q_in[3];
+    double len = std::sqrt(w * w + x * x + y * y + z * z);
+    if (len < 1e-12) {
+        w = 1.0;
+        x = y = z = 0.0;
+    } else {
+        w /= len; x /= len; y /= len; z /= len;
+    }
+    r = {1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y),
+         2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x),
+         2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y)};
+}
+
+inline void mat3_to_quat(const Mat3 &m, float q[4]) {
+    double tr = m[0] + m[4] + m[8];
+    double w, x, y, z;
+    if (tr > 0.0) {
+        double s = std::sqrt(tr + 1.0) * 2.0;
+        w = 0.25 * s;
+        x = (m[7] - m[5]) / s;
+        y = (m[2] - m[6]) / s;
+        z = (m[3] - m[1]) / s;
+    } else if (m[0] > m[4] && m[0] > m[8]) {
+        double s = std::sqrt(1.0 + m[0] - m[4] - m[8]) * 2.0;
+        w = (m[7] - m[5]) / s;
+        x = 0.25 * s;
+        y = (m[1] + m[3]) / s;
+        z = (m[2] + m[6]) / s;
+    } else if (m[4] > m[8]) {
+        double s = std::sqrt(1.0 + m[4] - m[0] - m[8]) * 2.0;
+        w = (m[2] - m[6]) / s;
+        x = (m[1] + m[3]) / s;
+        y = 0.25 * s;
+        z = (m[5] + m[7]) / s;
+    } else {
+        double s = std::sqrt(1.0 + m[8] - m[0] - m[4]) * 2.0;
+        w = (m[3] - m[1]) / s;
+        x = (m[2] + m[6]) / s;
+        y = (m[5] + m[7]) / s;
+        z = 0.25 * s;
+    }
+    q[0] = static_cast<float>(w);
+    q[1] = static_cast<float>(x);
+    q[2] = static_cast<float>(y);
+    q[3] = static_cast<float>(z);
+}
+
+// Cyclic Jacobi for a symmetric 3x3 matrix: a is destroyed, the eigenvalues
+// end up in eig and the eigenvectors in the columns of v.
+inline void eigen_symmetric(Mat3 a, double eig[3], Mat3 &v) {
+    v = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    for (int sweep = 0; sweep < 32; ++sweep) {
+        double off = a[1] * a[1] + a[2] * a[2] + a[5] * a[5];
+        if (off < 1e-30) break;
+        for (int p = 0; p < 2; ++p) {
+            for (int q = p + 1; q < 3; ++q) {
+                double apq = a[p * 3 + q];
+                if (std::fabs(apq) < 1e-300) continue;
+                double app = a[p * 3 + p];
+                double aqq = a[q * 3 + q];
+                double theta = (aqq - app) / (2.0 * apq);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                double s = t * c;
+                for (int k = 0; k < 3; ++k) {
+                    double akp = a[k * 3 + p];
+                    double akq = a[k * 3 + q];
+                    a[k * 3 + p] = c * akp - s * akq;
+                    a[k * 3 + q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    double apk = a[p * 3 + k];
+                    double aqk = a[q * 3 + k];
+                    a[p * 3 + k] = c * apk - s * aqk;
+                    a[q * 3 + k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    double vkp = v[k * 3 + p];
+                    double vkq = v[k * 3 + q];
+                    v[k * 3 + p] = c * vkp - s * vkq;
+                    v[k * 3 + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    eig[0] = a[0];
+    eig[1] = a[4];
+    eig[2] = a[8];
+}
+
+inline float sigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+inline float logit(float p) { return std::log(p / (1.0f - p)); }
+
+// Accumulates weighted first and second moments of a set of Gaussians and
+// produces the single Gaussian that matches them.
+class MomentMerger {
+public:
+    MomentMerger(const SplatCloud &layout_cloud, const SplatLayout &layout)
+        : layout_(layout), stride_(layout_cloud.stride()), other_(stride_, 0.0) {}
+
+    void reset() {
+        w_ = coverage_ = 0.0;
+        mean_[0] = mean_[1] = mean_[2] = 0.0;
+        second_.fill(0.0);
+        std::fill(other_.begin(), other_.end(), 0.0);
+    }
+
+    void add(const float *s) {
+        double sx = std::exp(s[layout_.scale[0]]);
+        double sy = std::exp(s[layout_.scale[1]]);
+        double sz = std::exp(s[layout_.scale[2]]);
+        double alpha = sigmoid(s[layout_.opacity]);
+        double area = sx * sy + sy * sz + sx * sz;
+        // Weight by visible surface so that large opaque splats dominate the merge
+        double w = alpha * area + 1e-20;
+
+        float q[4] = {s[layout_.rot[0]], s[layout_.rot[1]], s[layout_.rot[2]], s[layout_.rot[3]]};
+        Mat3 r;
+        quat_to_mat3(q, r);
+        double d[3] = {sx * sx, sy * sy, sz * sz};
+        double p[3] = {s[layout_.pos[0]], s[layout_.pos[1]], s[layout_.pos[2]]};
+
+        // second_ holds sum w * (Sigma + p p^T), upper triangle xx,xy,xz,yy,yz,zz
+        int idx = 0;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = i; j < 3; ++j) {
+                double cov = r[i * 3 + 0] * d[0] * r[j * 3 + 0] +
+                             r[i * 3 + 1] * d[1] * r[j * 3 + 1] +
+                             r[i * 3 + 2] * d[2] * r[j * 3 + 2];
+                second_[idx++] += w * (cov + p[i] * p[j]);
+            }
+        }
+        for (int i = 0; i < 3; ++i) mean_[i] += w * p[i];
+        for (size_t k = 0; k < stride_; ++k) other_[k] += w * s[k];
+        w_ += w;
+        coverage_ += alpha * area;
+    }
+
+    void write(float *out) const {
+        double inv = 1.0 / w_;
+        double m[3] = {mean_[0] * inv, mean_[1] * inv, mean_[2] * inv};
+        for (size_t k = 0; k < stride_; ++k) out[k] = static_cast<float>(other_[k] * inv);
+
+        Mat3 cov{};
+        int idx = 0;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = i; j < 3; ++j) {
+                double c = second_[idx++] * inv - m[i] * m[j];
+                cov[i * 3 + j] = c;
+                cov[j * 3 + i] = c;
+            }
+        }
+        double eig[3];
+        Mat3 v;
+        eigen_symmetric(cov, eig, v);
+        double det = v[0] * (v[4] * v[8] - v[5] * v[7]) -
+                     v[1] * (v[3] * v[8] - v[5] * v[6]) +
+                     v[2] * (v[3] * v[7] - v[4] * v[6]);
+        if (det < 0.0) {
+            v[2] = -v[2];
+            v[5] = -v[5];
+            v[8] = -v[8];
+        }
+        double s[3];
+        for (int i = 0; i < 3; ++i) s[i] = std::sqrt(std::max(eig[i], 1e-14));
+
+        float q[4];
+        mat3_to_quat(v, q);
+        for (int i = 0; i < 3; ++i) {
+            out[layout_.pos[i]] = static_cast<float>(m[i]);
+            out[layout_.scale[i]] = static_cast<float>(std::log(s[i]));
+        }
+        for (int i = 0; i < 4; ++i) out[layout_.rot[i]] = q[i];
+
+        // Keep the covered area: the merged splat is as opaque as the sum of
+        // its parts spread over its own footprint.
+        double area = s[0] * s[1] + s[1] * s[2] + s[0] * s[2];
+        float alpha = static_cast<float>(std::clamp(coverage_ / std::max(area, 1e-30), 0.01, 0.99));
+        out[layout_.opacity] = logit(alpha);
+    }
+
+private:
+    SplatLayout layout_;
+    size_t stride_;
+    double w_ = 0.0;
+    double coverage_ = 0.0;
+    double mean_[3] = {0.0, 0.0, 0.0};
+    std::array<double, 6> second_{};
+    std::vector<double> other_;
+};
+
+inline uint64_t spread_bits(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+inline float splat_extent(const float *s, const SplatLayout &l) {
+    float m = std::max(s[l.scale[0]], std::max(s[l.scale[1]], s[l.scale[2]]));
+    return 3.0f * std::exp(m);
+}
+
+inline float distance3(const float *a, const float *b) {
+    float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+struct Builder {
+    const SplatCloud &src;
+    const BuildOptions &opt;
+    const std::vector<uint64_t> &codes; // sorted, parallel to SplatLod::splats
+    pages::Vector<LodNode> &nodes;
+
+    // Splits [begin,end) on the three Morton bits of the given level.
+    void split(uint32_t node, uint32_t begin, uint32_t end, uint32_t depth) {
+        LodNode &n = nodes[node];
+        n.first_child = n.child_count = 0;
+        n.first_splat = begin;
+        n.splat_count = end - begin;
+        if (end - begin <= opt.max_leaf_splats || depth >= std::min(opt.max_depth, 21u)) return;
+
+        const int shift = 3 * static_cast<int>(20 - depth);
+        uint32_t bounds[9];
+        bounds[0] = begin;
+        uint32_t cursor = begin;
+        for (uint64_t child = 0; child < 8; ++child) {
+            while (cursor < end && ((codes[cursor] >> shift) & 7u) == child) ++cursor;
+            bounds[child + 1] = cursor;
+        }
+        uint32_t count = 0;
+        for (int c = 0; c < 8; ++c) count += bounds[c + 1] > bounds[c];
+        if (count == 1) {
+            // All splats share this cell: descend without creating a node
+            split(node, begin, end, depth + 1);
+            return;
+        }
+
+        uint32_t first = static_cast<uint32_t>(nodes.size());
+        nodes.resize(nodes.size() + count);
+        nodes[node].first_child = first;
+        nodes[node].child_count = count;
+        nodes[node].splat_count = 0;
+        uint32_t slot = first;
+        for (int c = 0; c < 8; ++c) {
+            if (bounds[c + 1] > bounds[c]) split(slot++, bounds[c], bounds[c + 1], depth + 1);
+        }
+    }
+};
+
+} // namespace detail
+
+inline bool BuildLod(const SplatCloud &src, SplatLod &lod, const BuildOptions &opt, std::string &err) {
+    SplatLayout layout = SplatLayout::from(src);
+    if (!layout.valid()) {
+        err = "Splat cloud lacks position, scale, rotation or opacity properties";
+        return false;
+    }
+    const size_t count = src.size();
+    if (count == 0) {
+        err = "Splat cloud is empty";
+        return false;
+    }
+    if (count >= kAggregateBit) {
+        err = "Too many splats for 31-bit cut indices";
+        return false;
+    }
+
+    float lo[3] = {1e30f, 1e30f, 1e30f};
+    float hi[3] = {-1e30f, -1e30f, -1e30f};
+    for (size_t i = 0; i < count; ++i) {
+        const float *s = src.splat(i);
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], s[layout.pos[k]]);
+            hi[k] = std::max(hi[k], s[layout.pos[k]]);
+        }
+    }
+    float extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+    float inv = extent > 0.0f ? 2097151.0f / extent : 0.0f;
+
+    std::vector<std::pair<uint64_t, uint32_t>> keyed(count);
+    for (size_t i = 0; i < count; ++i) {
+        const float *s = src.splat(i);
+        uint64_t q[3];
+        for (int k = 0; k < 3; ++k) {
+            float f = (s[layout.pos[k]] - lo[k]) * inv;
+            q[k] = static_cast<uint64_t>(std::clamp(f, 0.0f, 2097151.0f));
+        }
+        uint64_t code = detail::spread_bits(q[0]) | detail::spread_bits(q[1]) << 1 | detail::spread_bits(q[2]) << 2;
+        keyed[i] = {code, static_cast<uint32_t>(i)};
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    lod.splats.properties = src.properties;
+    lod.splats.data.resize(src.data.size());
+    std::vector<uint64_t> codes(count);
+    const size_t stride = src.stride();
+    for (size_t i = 0; i < count; ++i) {
+        codes[i] = keyed[i].first;
+        const float *s = src.splat(keyed[i].second);
+        std::copy(s, s + stride, lod.splats.splat(i));
+    }
+
+    lod.nodes.clear();
+    lod.nodes.resize(1);
+    detail::Builder builder{lod.splats, opt, codes, lod.nodes};
+    builder.split(0, 0, static_cast<uint32_t>(count), 0);
+
+    // Children always live after their parent, so a reverse sweep merges bottom-up.
+    lod.aggregates.properties = src.properties;
+    lod.aggregates.data.assign(lod.nodes.size() * stride, 0.0f);
+    detail::MomentMerger merger(src, layout);
+    for (size_t ni = lod.nodes.size(); ni-- > 0;) {
+        LodNode &n = lod.nodes[ni];
+        float *agg = lod.aggregates.splat(ni);
+        merger.reset();
+        if (n.child_count == 0) {
+            for (uint32_t i = 0; i < n.splat_count; ++i) merger.add(lod.splats.splat(n.first_splat + i));
+        } else {
+            for (uint32_t c = 0; c < n.child_count; ++c) merger.add(lod.aggregates.splat(n.first_child + c));
+        }
+        merger.write(agg);
+        for (int k = 0; k < 3; ++k) n.center[k] = agg[layout.pos[k]];
+
+        float r = 0.0f;
+        if (n.child_count == 0) {
+            for (uint32_t i = 0; i < n.splat_count; ++i) {
+                const float *s = lod.splats.splat(n.first_splat + i);
+                float p[3] = {s[layout.pos[0]], s[layout.pos[1]], s[layout.pos[2]]};
+                r = std::max(r, detail::distance3(p, n.center) + detail::splat_extent(s, layout));
+            }
+        } else {
+            for (uint32_t c = 0; c < n.child_count; ++c) {
+                const LodNode &child = lod.nodes[n.first_child + c];
+                r = std::max(r, detail::distance3(child.center, n.center) + child.radius);
+            }
+        }
+        n.radius = std::max(r, detail::splat_extent(agg, layout));
+    }
+    return true;
+}
+
+inline CutCamera MakeCutCamera(const float eye[3], const float target[3], float fovy_rad, int width, int height) {
+    CutCamera cam;
+    float f[3] = {target[0] - eye[0], target[1] - eye[1], target[2] - eye[2]};
+    float fl = std::sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    if (fl < 1e-12f) {
+        f[0] = 0.0f; f[1] = 0.0f; f[2] = -1.0f;
+    } else {
+        f[0] /= fl; f[1] /= fl; f[2] /= fl;
+    }
+    float up[3] = {0.0f, 1.0f, 0.0f};
+    if (std::fabs(f[1]) > 0.999f) {
+        up[1] = 0.0f;
+        up[2] = 1.0f;
+    }
+    float r[3] = {f[1] * up[2] - f[2] * up[1], f[2] * up[0] - f[0] * up[2], f[0] * up[1] - f[1] * up[0]};
+    float rl = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+    for (float &x : r) x /= rl;
+    float u[3] = {r[1] * f[2] - r[2] * f[1], r[2] * f[0] - r[0] * f[2], r[0] * f[1] - r[1] * f[0]};
+
+    float ty = std::tan(fovy_rad * 0.5f);
+    float tx = ty * static_cast<float>(width) / static_cast<float>(std::max(height, 1));
+    for (int k = 0; k < 3; ++k) {
+        cam.eye[k] = eye[k];
+        cam.forward[k] = f[k];
+    }
+    // Inward normals of the four side planes through the eye
+    const float *axes[2] = {r, u};
+    const float tans[2] = {tx, ty};
+    for (int a = 0; a < 2; ++a) {
+        for (int sgn = 0; sgn < 2; ++sgn) {
+            float s = sgn ? -1.0f : 1.0f;
+            float n[3];
+            for (int k = 0; k < 3; ++k) n[k] = f[k] * tans[a] + s * axes[a][k];
+            float nl = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            float *plane = cam.planes[a * 2 + sgn];
+            for (int k = 0; k < 3; ++k) plane[k] = n[k] / nl;
+            plane[3] = -(plane[0] * eye[0] + plane[1] * eye[1] + plane[2] * eye[2]);
+        }
+    }
+    cam.focal_px = 0.5f * static_cast<float>(height) / ty;
+    return cam;
+}
+
+namespace detail {
+inline bool sphere_culled(const CutCamera &cam, const LodNode &n) {
+    float z = (n.center[0] - cam.eye[0]) * cam.forward[0] +
+              (n.center[1] - cam.eye[1]) * cam.forward[1] +
+              (n.center[2] - cam.eye[2]) * cam.forward[2];
+    if (z + n.radius < cam.znear) return true;
+    for (const auto &p : cam.planes) {
+        if (p[0] * n.center[0] + p[1] * n.center[1] + p[2] * n.center[2] + p[3] < -n.radius) return true;
+    }
+    return false;
+}
+
+// Projected diameter in pixels; nodes containing the eye never satisfy any threshold.
+inline float screen_error(const CutCamera &cam, const LodNode &n) {
+    float d = distance3(n.center, cam.eye) - n.radius;
+    if (d <= cam.znear) return 1e30f;
+    return 2.0f * n.radius * cam.focal_px / d;
+}
+} // namespace detail
+
+// Greedy refinement: the node with the largest screen error is expanded first.
+// Work and output are O(budget log budget) no matter how large the capture is.
+inline void SelectCut(const SplatLod &lod, const CutCamera &cam, const CutOptions &opt,
+                      std::vector<uint32_t> &cut, CutStats *stats = nullptr) {
+    CutStats st;
+    cut.clear();
+    if (lod.nodes.empty() || opt.budget == 0) {
+        if (stats) *stats = st;
+        return;
+    }
+
+    using Entry = std::pair<float, uint32_t>;
+    std::priority_queue<Entry> open;
+    auto push = [&](uint32_t ni) {
+        ++st.nodes_visited;
+        const LodNode &n = lod.nodes[ni];
+        if (opt.frustum_cull && detail::sphere_culled(cam, n)) {
+            ++st.nodes_culled;
+            return;
+        }
+        open.emplace(detail::screen_error(cam, n), ni);
+    };
+    push(0);
+
+    // open.size() + cut.size() is what we would emit if refinement stopped now
+    while (!open.empty()) {
+        auto [error, ni] = open.top();
+        if (error <= opt.error_px) break;
+        open.pop();
+        const LodNode &n = lod.nodes[ni];
+        size_t emitted = open.size() + cut.size();
+        size_t expansion = n.child_count ? n.child_count : n.splat_count;
+        if (emitted + expansion > opt.budget) {
+            st.budget_limited = true;
+            st.max_error_px = std::max(st.max_error_px, error);
+            cut.push_back(ni | kAggregateBit);
+            ++st.aggregates;
+            continue;
+        }
+        if (n.child_count) {
+            for (uint32_t c = 0; c < n.child_count; ++c) push(n.first_child + c);
+        } else {
+            for (uint32_t i = 0; i < n.splat_count; ++i) cut.push_back(n.first_splat + i);
+            st.originals += n.splat_count;
+        }
+    }
+    while (!open.empty()) {
+        st.max_error_px = std::max(st.max_error_px, open.top().first);
+        cut.push_back(open.top().second | kAggregateBit);
+        ++st.aggregates;
+        open.pop();
+    }
+    if (stats) *stats = st;
+}
+
+inline void GatherCut(const SplatLod &lod, const std::vector<uint32_t> &cut, SplatCloud &out) {
+    const size_t stride = lod.splats.stride();
+    out.properties = lod.splats.properties;
+    out.data.resize(cut.size() * stride);
+    for (size_t i = 0; i < cut.size(); ++i) {
+        uint32_t e = cut[i];
+        const float *s = (e & kAggregateBit) ? lod.aggregates.splat(e & ~kAggregateBit) : lod.splats.splat(e);
+        std::copy(s, s + stride, out.splat(i));
+    }
+}
+
+// Binary container: magic, property names, nodes, originals, aggregates.
+namespace detail {
+constexpr char kLodMagic[8] = {'S', 'P', 'L', 'O', 'D', '0', '0', '1'};
+
+template <typename T>
+inline void write_pod(std::ofstream &ofs, const T &v) {
+    ofs.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template <typename T>
+inline bool read_pod(std::ifstream &ifs, T &v) {
+    ifs.read(reinterpret_cast<char *>(&v), sizeof(T));
+    return static_cast<size_t>(ifs.gcount()) == sizeof(T);
+}
+
+template <typename T, typename A>
+inline void write_array(std::ofstream &ofs, const std::vector<T, A> &v) {
+    write_pod(ofs, static_cast<uint64_t>(v.size()));
+    ofs.write(reinterpret_cast<const char *>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(T)));
+}
+
+// file_size bounds the count, so a corrupt one fails instead of allocating
+template <typename T, typename A>
+inline bool read_array(std::ifstream &ifs, std::vector<T, A> &v, uint64_t file_size) {
+    uint64_t n = 0;
+    if (!read_pod(ifs, n)) return false;
+    const auto pos = ifs.tellg();
+    if (pos < 0 || static_cast<uint64_t>(pos) > file_size) return false;
+    if (n > (file_size - static_cast<uint64_t>(pos)) / sizeof(T)) return false;
+    v.resize(static_cast<size_t>(n));
+    ifs.read(reinterpret_cast<char *>(v.data()), static_cast<std::streamsize>(n * sizeof(T)));
+    return static_cast<uint64_t>(ifs.gcount()) == n * sizeof(T);
+}
+// Every child and splat range within its array, children after their parent
+// (so walks terminate)
+inline bool valid_nodes(const SplatLod &lod) {
+    const uint64_t node_count = lod.nodes.size(), splat_count = lod.splats.size();
+    for (uint64_t i = 0; i < node_count; ++i) {
+        const LodNode &n = lod.nodes[static_cast<size_t>(i)];
+        if (n.child_count && (n.first_child <= i || n.first_child > node_count ||
+                              n.child_count > node_count - n.first_child)) {
+            return false;
+        }
+        if (n.first_splat > splat_count || n.splat_count > splat_count - n.first_splat) return false;
+    }
+    return true;
+}
+} // namespace detail
+
+inline bool SaveLod(const SplatLod &lod, const std::string &filename, std::string &err) {
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs) {
+        err = "Cannot write file: " + filename;
+        return false;
+    }
+    ofs.write(detail::kLodMagic, sizeof(detail::kLodMagic));
+    detail::write_pod(ofs, static_cast<uint32_t>(lod.splats.properties.size()));
+    for (const auto &p : lod.splats.properties) {
+        detail::write_pod(ofs, static_cast<uint32_t>(p.size()));
+        ofs.write(p.data(), static_cast<std::streamsize>(p.size()));
+    }
+    detail::write_array(ofs, lod.nodes);
+    detail::write_array(ofs, lod.splats.data);
+    detail::write_array(ofs, lod.aggregates.data);
+    if (!ofs) {
+        err = "Write failed: " + filename;
+        return false;
+    }
+    return true;
+}
+
+inline bool LoadLod(SplatLod &lod, const std::string &filename, std::string &err) {
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) {
+        err = "Cannot open file: " + filename;
+        return false;
+    }
+    ifs.seekg(0, std::ios::end);
+    const auto end = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+    const uint64_t file_size = end > 0 ? static_cast<uint64_t>(end) : 0;
+    char magic[8];
+    ifs.read(magic, sizeof(magic));
+    if (ifs.gcount() != sizeof(magic) || !std::equal(magic, magic + 8, detail::kLodMagic)) {
+        err = "Not a splat LOD file: " + filename;
+        return false;
+    }
+    uint32_t prop_count = 0;
+    if (!detail::read_pod(ifs, prop_count) || prop_count == 0) {
+        err = "Corrupt splat LOD header: " + filename;
+        return false;
+    }
+    std::vector<std::string> props(prop_count);
+    for (auto &p : props) {
+        uint32_t len = 0;
+        if (!detail::read_pod(ifs, len) || len > 256) {
+            err = "Corrupt splat LOD header: " + filename;
+            return false;
+        }
+        p.resize(len);
+        ifs.read(p.data(), len);
+        if (static_cast<uint32_t>(ifs.gcount()) != len) {
+            err = "Corrupt splat LOD header: " + filename;
+            return false;
+        }
+    }
+    lod.splats.properties = props;
+    lod.aggregates.properties = props;
+    if (!detail::read_array(ifs, lod.nodes, file_size) || !detail::read_array(ifs, lod.splats.data, file_size) ||
+        !detail::read_array(ifs, lod.aggregates.data, file_size)) {
+        err = "Truncated splat LOD file: " + filename;
+        return false;
+    }
+    if (lod.splats.data.size() % prop_count || lod.aggregates.data.size() % prop_count) {
+        err = "Splat data is not a whole number of splats: " + filename;
+        return false;
+    }
+    if (lod.aggregates.size() != lod.nodes.size()) {
+        err = "Node and aggregate counts differ: " + filename;
+        return false;
+    }
+    if (!detail::valid_nodes(lod)) {
+        err = "Node references out of range: " + filename;
+        return false;
+    }
+    return true;
+}
+
+} // namespace splat